@@ -60,9 +60,15 @@
 //const char *code = "{ var b = 1; for (var i=0;i<4;i=i+1) b = b * 2; }";
 const char *code = "function myfunc(x, y) { return x + y; } var a = myfunc(1,2); print(a);";
 
-void js_print(const CFunctionsScopePtr &v, void *) {
-	printf("> %s\n", v->getArgument("text")->toString().c_str());
-}
+// print and console.log write to the buffered console of the context - the lines are marked with "> "
+class CPrefixConsoleSink : public CScriptConsoleBufferedSink {
+public:
+	virtual void write(LEVEL Level, const char *Line, size_t Size) {
+		std::string Prefixed("> ");
+		Prefixed.append(Line, Size);
+		CScriptConsoleBufferedSink::write(Level, Prefixed.data(), Prefixed.size());
+	}
+} consoleSink;
 
 void js_dump(const CFunctionsScopePtr &v, void *) {
 	v->getContext()->getRoot()->trace(">  ");
@@ -76,21 +82,63 @@ char *topOfStack;
 
 class end { // this is for VisualStudio debugging stuff. It's holds the console open up to ENTER is pressed
 public:
-	end(){}
+	end() : active(true) {}
 	~end() {
+		if(active) {
 #ifdef _WIN32
 			system("pause");
 #else
 			printf("press Enter (end)");
 			getchar();
 #endif
+		}
 	}
+	bool active;
 } end;
 
-int main(int , char **)
+/*
+	Script -b bundle.jsb module.js [module2.js ...]	: writes the compiled modules into a bundle
+	Script -r bundle.jsb module							: requires the module from the bundle
+*/
+static int bundle_main(int argc, char **argv) {
+	if(strcmp(argv[1], "-b") == 0) {
+		STRING_VECTOR_t files(argv+3, argv+argc);
+		try {
+			CScriptBundle::write(argv[2], files, files);
+		} catch (CScriptException &e) {
+			printf("%s\n", e.toString().c_str());
+			return 1;
+		}
+		printf("%d modules written to %s\n", argc-3, argv[2]);
+		return 0;
+	}
+	CScriptBundle bundle;
+	if(!bundle.open(argv[2])) {
+		printf("%s is not a bundle\n", argv[2]);
+		return 1;
+	}
+	CTinyJS js;
+	js.setConsoleSink(&consoleSink);
+	js.addBundle(&bundle);
+	js.setStackBase(topOfStack-(sizeOfStack-sizeOfSafeStack));
+	try {
+		js.getRoot()->addChild("main", js.newScriptVar(argv[3]));
+		js.execute("require(main);");
+	} catch (CScriptException &e) {
+		printf("%s\n", e.toString().c_str());
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
 {
 	char dummy;
 	topOfStack = &dummy;
+	if(argc >= 4 && (strcmp(argv[1], "-b") == 0 || strcmp(argv[1], "-r") == 0)) {
+		end.active = false;
+		return bundle_main(argc, argv);
+	}
 //	printf("%i %i\n", __cplusplus, _MSC_VER);
 
 //	printf("Locale:%s\n",setlocale( LC_ALL, 0 ));
@@ -101,9 +149,8 @@ int main(int , char **)
 //	registerFunctions(js);
 //	registerStringFunctions(js);
 //	registerMathFunctions(js);
-	/* Add a native function */
-	js->addNative("function print(text)", &js_print, 0);
-	js->addNative("function console.log(text)", &js_print, 0);
+	/* print and console.log are built in - only the output is redirected */
+	js->setConsoleSink(&consoleSink);
 	//  js->addNative("function dump()", &js_dump, js);
 	/* Execute out bit of code - we could call 'evaluate' here if
 		we wanted something returned */
@@ -112,8 +159,10 @@ int main(int , char **)
 		js->execute("var lets_quit = 0; function quit() { lets_quit = 1; } dump = this.dump;");
 		js->execute("print(\"Interactive mode... Type quit(); to exit, or print(...); to print something, or dump() to dump the symbol table!\");");
 	} catch (CScriptException &e) {
+		js->flushConsole();
 		printf("%s\n", e.toString().c_str());
 	}
+	js->flushConsole();
 	int lineNumber = 0;
 	while (js->evaluate("lets_quit") == "0") {
 		std::string buffer;
@@ -121,8 +170,10 @@ int main(int , char **)
 		try {
 			js->execute(buffer, "console.input", lineNumber++);
 		} catch (CScriptException &e) {
+			js->flushConsole();
 			printf("%s\n", e.toString().c_str());
 		}
+		js->flushConsole();
 	}
 	delete js;
 #ifdef _WIN32
@@ -47,6 +47,14 @@
 #include <iomanip>
 #include <iterator>
 #include <sys/stat.h>
+#ifndef _WIN32
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#else
+#	include <malloc.h>
+#	include <intrin.h>
+#endif
 #include "TinyJS.h"
 
 #ifndef ASSERT
@@ -68,6 +76,10 @@
 #include <algorithm>
 #include <cmath>
 #include <memory>
+#include <chrono>
+#if defined(__SSE2__) || defined(_M_X64)
+#	include <emmintrin.h>
+#endif
 
 using namespace std;
 
@@ -629,7 +641,7 @@ void CScriptLex::getNextToken() {
 // CScriptTokenDataForwards
 //////////////////////////////////////////////////////////////////////////
 
-CScriptTokenDataForwards::CScriptTokenDataForwards(istream &in)
+CScriptTokenDataForwards::CScriptTokenDataForwards(istream &in) : bindingsBuilt(false)
 {
 	STRING_SET_t::size_type size;
 	for(int i=LETS; i<END; ++i) {
@@ -666,6 +678,44 @@ void CScriptTokenDataForwards::serialize(ostream &out) const
 bool CScriptTokenDataForwards::compare_fnc_token_by_name::operator()(const CScriptToken& lhs, const CScriptToken& rhs) const {
 	return lhs.Fnc().name < rhs.Fnc().name;
 }
+static bool binding_less(const CScriptTokenDataForwards::BINDING &lhs, const CScriptTokenDataForwards::BINDING &rhs) { return lhs.name < rhs.name; }
+void CScriptTokenDataForwards::buildBindings() {
+	// names are never array-indices - the order of the childs is the order of the names
+	letBindings.clear();
+	for(STRING_SET_it it=varNames[LETS].begin(); it!=varNames[LETS].end(); ++it) {
+		BINDING binding = { *it, SCRIPTVARLINK_VARDEFAULT, 0 };
+		letBindings.push_back(binding);
+	}
+	varBindings.clear();
+	for(int i=VARS; i<END; ++i) {
+		for(STRING_SET_it it=varNames[i].begin(); it!=varNames[i].end(); ++it) {
+			BINDING binding = { *it, i==CONSTS ? SCRIPTVARLINK_CONSTDEFAULT : SCRIPTVARLINK_VARDEFAULT, 0 };
+			varBindings.push_back(binding);
+		}
+	}
+	for(FNC_SET_it it=functions.begin(); it!=functions.end(); ++it) {
+		BINDING binding = { it->Fnc().name, SCRIPTVARLINK_VARDEFAULT, &*it };
+		varBindings.push_back(binding);
+	}
+	stable_sort(varBindings.begin(), varBindings.end(), binding_less);
+	// a var with the name of a function is the function (the functions are sorted behind)
+	BINDINGS_t unique;
+	for(BINDINGS_t::iterator it = varBindings.begin(); it != varBindings.end(); ++it) {
+		if(unique.size() && unique.back().name == it->name)
+			unique.back().function = it->function;
+		else
+			unique.push_back(*it);
+	}
+	varBindings.swap(unique);
+	bindingsBuilt = true;
+}
+const CScriptTokenDataForwards::BINDING *CScriptTokenDataForwards::findVarBinding(const string &Name) {
+	BINDING key = { Name, 0, 0 };
+	const BINDINGS_t &bindings = getVarBindings();
+	BINDINGS_t::const_iterator it = lower_bound(bindings.begin(), bindings.end(), key, binding_less);
+	return it != bindings.end() && it->name == Name ? &*it : 0;
+}
+
 bool CScriptTokenDataForwards::checkRedefinition(const string &Str, bool checkVarsInLetScope) {
 	STRING_SET_it it = varNames[LETS].find(Str);
 	if(it!=varNames[LETS].end()) return false;
@@ -849,6 +899,9 @@ void CScriptTokenDataString::serialize(ostream &out) const {
 //////////////////////////////////////////////////////////////////////////
 
 CScriptTokenDataFnc::CScriptTokenDataFnc(std::istream &in)
+#ifndef NO_JIT
+	: callCount(0), jitState(JIT_NONE), jitCode(0)
+#endif
 {
 	CScriptToken::unserialize(type, in);
 	CScriptToken::unserialize(file, in);
@@ -1119,6 +1172,10 @@ static token2str_t tokens2str_begin[] = {
 	{ LEX_OPTIONAL_CHAINING_MEMBER, 			"?.", 										false },
 	{ LEX_OPTIONAL_CHAINING_ARRAY, 				"?.[", 										false },
 	{ LEX_OPTIONAL_CHANING_FNC, 				"?.(", 										false },
+	{ LEX_T_TAIL_CALL, 							"(", 										false },
+	{ LEX_T_INC_ID, 							"LEX_T_INC_ID", 							false },
+	{ LEX_T_INC_MEMBER, 						"LEX_T_INC_MEMBER", 						false },
+	{ LEX_T_CMP_ID, 							"LEX_T_CMP_ID", 							false },
 
 	// special tokens
 	{ LEX_T_OF, 								"of", 										true  },
@@ -1387,6 +1444,8 @@ string CScriptToken::getParsableString(TOKEN_VECT_it Begin, TOKEN_VECT_it End, c
 			// ignore SKIP-Token
 		} else if(it->token == LEX_T_END_EXPRESSION) {
 			// ignore SKIP-Token
+		} else if(it->token >= LEX_TOKEN_SUPERINSTRUCTION_BEGIN && it->token <= LEX_TOKEN_SUPERINSTRUCTION_END) {
+			// ignore Superinstruction-Token
 		} else if(it->token == LEX_T_ARRAY_COMPREHENSIONS_BODY) {
 			// ignore Forwarder-Token
 		} else if(it->token == LEX_T_FORWARD) {
@@ -1514,6 +1573,211 @@ void CScriptToken::unserialize(TOKEN_VECT &Tokens, istream &in)
 }
 
 
+//////////////////////////////////////////////////////////////////////////
+/// CScriptTypeFeedback
+//////////////////////////////////////////////////////////////////////////
+
+bool CScriptTypeFeedback::SITE::isPolymorphic() const {
+	// more than one bit set
+	return (lhsTypes & (lhsTypes-1)) || (rhsTypes & (rhsTypes-1)) || calleePolymorphic;
+}
+
+const CScriptTypeFeedback::SITE *CScriptTypeFeedback::find(const string &File, int Line, int Column) const {
+	SITES_cit it = sites.find(KEY(File, (uint16_t)Line, (uint16_t)Column));
+	return it == sites.end() ? 0 : &it->second;
+}
+
+CScriptTypeFeedback::SITE &CScriptTypeFeedback::getSite(const string &File, const CScriptToken &Site) {
+	SITE &site = sites[KEY(File, Site.line, Site.column)];
+	site.token = Site.token;
+	++site.count;
+	return site;
+}
+
+void CScriptTypeFeedback::record(const string &File, const CScriptToken &Site, const CScriptVarPtr &Lhs) {
+	getSite(File, Site).lhsTypes |= getType(Lhs);
+}
+
+void CScriptTypeFeedback::record(const string &File, const CScriptToken &Site, const CScriptVarPtr &Lhs, const CScriptVarPtr &Rhs) {
+	SITE &site = getSite(File, Site);
+	site.lhsTypes |= getType(Lhs);
+	site.rhsTypes |= getType(Rhs);
+}
+
+void CScriptTypeFeedback::recordCall(const string &File, const CScriptToken &Site, const CScriptVarPtr &Callee, const vector<CScriptVarPtr> &Arguments) {
+	SITE &site = getSite(File, Site);
+	site.lhsTypes |= getType(Callee);
+	for(vector<CScriptVarPtr>::const_iterator it = Arguments.begin(); it != Arguments.end(); ++it)
+		site.rhsTypes |= getType(*it);
+	CScriptTokenDataFnc *Fnc = Callee->getFunctionData();
+	string callee = Fnc ? Fnc->name + ":" + int2string(Fnc->line) : "[native]";
+	if(site.callee.empty())
+		site.callee = callee;
+	else if(site.callee != callee)
+		site.calleePolymorphic = true;
+}
+
+bool CScriptTypeFeedback::hasFile(const string &File) const {
+	for(SITES_cit it = sites.begin(); it != sites.end(); ++it)
+		if(it->first.file == File) return true;
+	return false;
+}
+
+void CScriptTypeFeedback::merge(const CScriptTypeFeedback &Other, const string &File) {
+	for(SITES_cit it = Other.sites.begin(); it != Other.sites.end(); ++it) {
+		if(it->first.file != File) continue;
+		SITE &site = sites[it->first];
+		site.token = it->second.token;
+		site.count += it->second.count;
+		site.lhsTypes |= it->second.lhsTypes;
+		site.rhsTypes |= it->second.rhsTypes;
+		if(site.callee.empty())
+			site.callee = it->second.callee;
+		else if(it->second.callee.size() && site.callee != it->second.callee)
+			site.calleePolymorphic = true;
+		site.calleePolymorphic |= it->second.calleePolymorphic;
+	}
+}
+
+uint16_t CScriptTypeFeedback::getType(const CScriptVarPtr &Var) {
+	if(!Var) return TYPEFEEDBACK_UNDEFINED;
+	if(Var->isUndefined()) return TYPEFEEDBACK_UNDEFINED;
+	if(Var->isNull()) return TYPEFEEDBACK_NULL;
+	if(Var->isBool()) return TYPEFEEDBACK_BOOL;
+	if(Var->isInt()) return TYPEFEEDBACK_INT32;
+	if(Var->isNumber()) return TYPEFEEDBACK_DOUBLE;
+	if(Var->isString()) return TYPEFEEDBACK_STRING;
+	if(Var->isAccessor()) return TYPEFEEDBACK_OTHER;
+	if(Var->isArray()) return TYPEFEEDBACK_ARRAY;
+	if(Var->isFunction()) return TYPEFEEDBACK_FUNCTION;
+	if(Var->isObject()) return TYPEFEEDBACK_OBJECT;
+	return TYPEFEEDBACK_OTHER;
+}
+
+void CScriptTypeFeedback::serialize(ostream &out) const {
+	CScriptToken::serialize(sites.size(), out);
+	for(SITES_cit it = sites.begin(); it != sites.end(); ++it) {
+		CScriptToken::serialize(it->first.file, out);
+		CScriptToken::serialize(it->first.line, out);
+		CScriptToken::serialize(it->first.column, out);
+		CScriptToken::serialize(it->second.token, out);
+		CScriptToken::serialize(it->second.count, out);
+		CScriptToken::serialize(it->second.lhsTypes, out);
+		CScriptToken::serialize(it->second.rhsTypes, out);
+		CScriptToken::serialize(it->second.callee, out);
+		CScriptToken::serialize(it->second.calleePolymorphic, out);
+	}
+}
+
+void CScriptTypeFeedback::unserialize(istream &in) {
+	SITES_t::size_type size;
+	CScriptToken::unserialize(size, in);
+	sites.clear();
+	while(size--) {
+		string file;
+		uint16_t line, column;
+		CScriptToken::unserialize(file, in);
+		CScriptToken::unserialize(line, in);
+		CScriptToken::unserialize(column, in);
+		SITE &site = sites[KEY(file, line, column)];
+		CScriptToken::unserialize(site.token, in);
+		CScriptToken::unserialize(site.count, in);
+		CScriptToken::unserialize(site.lhsTypes, in);
+		CScriptToken::unserialize(site.rhsTypes, in);
+		CScriptToken::unserialize(site.callee, in);
+		CScriptToken::unserialize(site.calleePolymorphic, in);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptAllocationProfiler
+//////////////////////////////////////////////////////////////////////////
+
+CScriptAllocationProfiler::CScriptAllocationProfiler(uint32_t SampleEvery/*=1000*/, uint32_t SampleBytes/*=0*/)
+	: sampleEvery(max(SampleEvery, uint32_t(1))), sampleBytes(SampleBytes), samplesCount(0), lastSample(0) {
+	countdown = sampleBytes ? sampleBytes : sampleEvery;
+}
+
+void CScriptAllocationProfiler::record(const void *Var, size_t Size, const string &Stack) {
+	LIVE &sample = live[Var];
+	sample.stack = Stack;
+	sample.size = Size;
+	lastSample = Var;
+	++samplesCount;
+}
+
+void CScriptAllocationProfiler::freed(const void *Var, uint32_t TypeTag) {
+	map<const void *, LIVE>::iterator it = live.find(Var);
+	if(it == live.end()) return; // cleared
+	SITE &site = sites[make_pair(it->second.stack, string(getTypeName(TypeTag)))];
+	++site.count;
+	site.bytes += it->second.size;
+	live.erase(it);
+}
+
+void CScriptAllocationProfiler::detach(CTinyJS *Context) {
+	for(map<const void *, LIVE>::iterator it = live.begin(); it != live.end(); ) {
+		CScriptVar *var = static_cast<CScriptVar *>(const_cast<void *>(it->first));
+		if(var->context != Context) { ++it; continue; }
+		var->varFlags &= ~SCRIPTVAR_SAMPLED;
+		SITE &site = sites[make_pair(it->second.stack, string(getTypeName(var->getTypeTag())))];
+		++site.count;
+		site.bytes += it->second.size;
+		live.erase(it++);
+	}
+	lastSample = 0;
+}
+
+CScriptAllocationProfiler::SITES_t CScriptAllocationProfiler::getSites() const {
+	SITES_t ret(sites);
+	for(map<const void *, LIVE>::const_iterator it = live.begin(); it != live.end(); ++it) {
+		uint32_t typeTag = static_cast<const CScriptVar *>(it->first)->getTypeTag();
+		SITE &site = ret[make_pair(it->second.stack, string(getTypeName(typeTag)))];
+		++site.count;
+		++site.liveCount;
+		site.bytes += it->second.size;
+		site.liveBytes += it->second.size;
+	}
+	return ret;
+}
+
+static bool cmpSitesByBytes(const CScriptAllocationProfiler::SITES_cit &lhs, const CScriptAllocationProfiler::SITES_cit &rhs) {
+	return lhs->second.bytes > rhs->second.bytes;
+}
+void CScriptAllocationProfiler::report(ostream &out, size_t MaxSites/*=20*/) const {
+	SITES_t allSites = getSites();
+	vector<SITES_cit> sorted;
+	for(SITES_cit it = allSites.begin(); it != allSites.end(); ++it)
+		sorted.push_back(it);
+	sort(sorted.begin(), sorted.end(), cmpSitesByBytes);
+	out << samplesCount << " samples (every " << (sampleBytes ? sampleBytes : sampleEvery) << (sampleBytes ? " bytes)\n" : " allocations)\n");
+	out << "   count      bytes  live-cnt live-bytes type       site\n";
+	for(size_t i = 0; i < sorted.size() && i < MaxSites; ++i) {
+		const SITE &site = sorted[i]->second;
+		out << setw(8) << site.count << setw(11) << site.bytes << setw(10) << site.liveCount << setw(11) << site.liveBytes
+			<< " " << left << setw(10) << sorted[i]->first.second << right << " " << sorted[i]->first.first << "\n";
+	}
+}
+
+void CScriptAllocationProfiler::clear() {
+	live.clear();
+	sites.clear();
+	samplesCount = 0;
+	lastSample = 0;
+}
+
+const char *CScriptAllocationProfiler::getTypeName(uint32_t TypeTag) {
+	// the tag of the most derived class is the highest tag
+	static const char *names[] = { "Primitive", "Undefined", "Null", "String", "Number", "Bool", "Object", "Error",
+		"Array", "RegExp", "Date", "Function", "Bounded", "Native", "NativeDirect", "Accessor", "Scope", "ScopeFnc",
+		"ScopeLet", "ScopeWith", "Iterator", "Generator" };
+	const char *name = "Var";
+	for(uint32_t i = 0; i < sizeof(names)/sizeof(names[0]); ++i)
+		if(TypeTag & (1u<<i)) name = names[i];
+	return name;
+}
+
+
 //////////////////////////////////////////////////////////////////////////
 /// CScriptTokenizer
 //////////////////////////////////////////////////////////////////////////
@@ -1530,6 +1794,7 @@ CScriptTokenizer::CScriptTokenizer(const char *Code, const string &File, int Lin
 		CScriptLex lexer(Code, File, Line, Column);
 		tokenizeCode(lexer);
 	} else {
+		sourceFile = File;
 		struct stat js, jsc;
 		if(stat((File+'c').c_str(), &jsc) == 0 && stat(File.c_str(), &js) == 0 && js.st_mtime < jsc.st_mtime) {
 			unserialize(File, File+'c');
@@ -1554,21 +1819,8 @@ void CScriptTokenizer::unserialize(const string &File, const string &FileC)
 	if(FileC.size()) {
 		try {
 			ifstream in(FileC.c_str(), fstream::in | fstream::binary);
-			uint32_t id;
-			CScriptToken::unserialize(id, in);
-			if(id == COMPILED_TOKENS_ID) { // check file id and byte order
-				uint16_t v;
-				CScriptToken::unserialize(v, in);
-				if(v >= COMPILED_TOKENS_VERSION_MIN && COMPILED_TOKENS_VERSION_MAX >= v) {
-					tokens.clear();
-					tokenScopeStack.clear();
-					CScriptToken::unserialize(tokens, in);
-					pushTokenScope(tokens);
-					currentFile = File;
-					tk = getToken().token;
-					return;
-				}
-			}
+			if(unserialize(in, File))
+				return;
 		} catch(...) {
 			;
 		}
@@ -1580,6 +1832,27 @@ void CScriptTokenizer::unserialize(const string &File, const string &FileC)
 	if(writeCompiledTokens)
 		serialize(File+'c', nothrow);
 }
+bool CScriptTokenizer::unserialize(istream &in, const string &File)
+{
+	uint32_t id;
+	CScriptToken::unserialize(id, in);
+	if(id == COMPILED_TOKENS_ID) { // check file id and byte order
+		uint16_t v;
+		CScriptToken::unserialize(v, in);
+		if(v >= COMPILED_TOKENS_VERSION_MIN && COMPILED_TOKENS_VERSION_MAX >= v) {
+			tokens.clear();
+			tokenScopeStack.clear();
+			CScriptToken::unserialize(tokens, in);
+			typeFeedback.clear();
+			if(v >= 0x0103) typeFeedback.unserialize(in);
+			pushTokenScope(tokens);
+			currentFile = File;
+			tk = getToken().token;
+			return true;
+		}
+	}
+	return false;
+}
 void CScriptTokenizer::serialize(ostream &out) const
 {
 	uint32_t id = COMPILED_TOKENS_ID;
@@ -1587,6 +1860,7 @@ void CScriptTokenizer::serialize(ostream &out) const
 	CScriptToken::serialize(id, out);
 	CScriptToken::serialize(v, out);
 	CScriptToken::serialize(tokens, out);
+	typeFeedback.serialize(out);
 }
 
 void CScriptTokenizer::serialize(const string &File)
@@ -1604,6 +1878,242 @@ void CScriptTokenizer::serialize(const string &File, const nothrow_t &)
 	}
 }
 
+static void tokenizeSource(CScriptCompiledSource &Source, bool AsModule) {
+	try {
+		ifstream in(Source.file.c_str(), fstream::in | fstream::binary);
+		if(!in) {
+			Source.error = "can't read \"" + Source.file + "\"";
+			return;
+		}
+		string code;
+		read_string_from_istream(in, code);
+		CScriptTokenizer Tokenizer;
+		if(AsModule)
+			CScriptBundle::tokenizeModule(code, Source.name, Tokenizer);
+		else {
+			CScriptLex lexer(code.c_str(), Source.name);
+			Tokenizer.tokenizeCode(lexer);
+		}
+		ostringstream out;
+		Tokenizer.serialize(out);
+		Source.compiled = out.str();
+	} catch(CScriptException &e) {
+		Source.error = e.toString();
+	} catch(exception &e) {
+		Source.error = e.what();
+	}
+}
+
+#ifndef NO_THREADING
+// the workers take the next untokenized source until all sources are done
+class CScriptTokenizeWorker : public CScriptThread {
+public:
+	CScriptTokenizeWorker(vector<CScriptCompiledSource> &Sources, size_t &Next, CScriptMutex &Mutex, bool AsModules)
+		: sources(Sources), next(Next), mutex(Mutex), asModules(AsModules) {}
+	virtual int ThreadFnc() {
+		for(;;) {
+			mutex.lock();
+			size_t i = next++;
+			mutex.unlock();
+			if(i >= sources.size()) return 0;
+			tokenizeSource(sources[i], asModules);
+		}
+	}
+private:
+	vector<CScriptCompiledSource> &sources;
+	size_t &next;
+	CScriptMutex &mutex;
+	bool asModules;
+};
+#endif
+
+// the tokenizer uses no shared state except of the pool-allocator (it's locked)
+void CScriptTokenizer::tokenizeSources(vector<CScriptCompiledSource> &Sources, bool AsModules, unsigned Threads) {
+#ifndef NO_THREADING
+	if(Threads == 0) Threads = CScriptThread::hardwareConcurrency();
+	if(Threads > Sources.size()) Threads = unsigned(Sources.size());
+	if(Threads > 1) {
+		CScriptMutex mutex;
+		size_t next = 0;
+		vector<CScriptTokenizeWorker *> workers;
+		for(unsigned i = 0; i < Threads; ++i) {
+			workers.push_back(new CScriptTokenizeWorker(Sources, next, mutex, AsModules));
+			workers.back()->Run();
+		}
+		for(vector<CScriptTokenizeWorker *>::iterator it = workers.begin(); it != workers.end(); ++it) {
+			(*it)->Stop();
+			delete *it;
+		}
+		return;
+	}
+#endif
+	for(vector<CScriptCompiledSource>::iterator it = Sources.begin(); it != Sources.end(); ++it)
+		tokenizeSource(*it, AsModules);
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptBundle
+//////////////////////////////////////////////////////////////////////////
+
+// read-only streambuf over the bundle-data (the data is not copied)
+class CScriptMemoryBuf : public streambuf {
+public:
+	CScriptMemoryBuf(const char *Data, size_t Size) {
+		char *p = const_cast<char *>(Data);
+		setg(p, p, p + Size);
+	}
+};
+
+/*
+	bundle-layout (byte order of the host like the compiled tokens)
+	uint32_t	COMPILED_BUNDLE_ID
+	uint16_t	COMPILED_TOKENS_VERSION_MAX
+	uint32_t	count of modules
+	count times:
+		uint32_t	length of the name, name
+		uint32_t	offset of the compiled tokens (from begin of the file)
+		uint32_t	size of the compiled tokens
+	the compiled tokens of the modules (see CScriptTokenizer::serialize)
+*/
+#define COMPILED_BUNDLE_ID 0x626a7300 /* '\0', 's', 'j', 'b' */
+
+// removes "." and "name/.." from a module-name
+static string normalizeModuleName(const string &File) {
+	STRING_VECTOR_t parts;
+	string::size_type begin = 0, end;
+	do {
+		end = File.find_first_of("/\\", begin);
+		string part = File.substr(begin, end == string::npos ? end : end - begin);
+		if(part == ".." && parts.size() && parts.back() != "..")
+			parts.pop_back();
+		else if(part.size() && part != ".")
+			parts.push_back(part);
+		begin = end + 1;
+	} while(end != string::npos);
+	string name = File.size() && (File[0] == '/' || File[0] == '\\') ? "/" : "";
+	for(STRING_VECTOR_t::iterator it = parts.begin(); it != parts.end(); ++it)
+		name += (it == parts.begin() ? "" : "/") + *it;
+	return name;
+}
+
+static bool readBundleUInt32(const char *&pos, const char *end, uint32_t &value) {
+	if(size_t(end - pos) < sizeof(value)) return false;
+	memcpy(&value, pos, sizeof(value));
+	pos += sizeof(value);
+	return true;
+}
+
+bool CScriptBundle::open(const string &File) {
+	close();
+#ifdef _WIN32
+	ifstream in(File.c_str(), ios::in | ios::binary);
+	if(!in) return false;
+	in.seekg(0, ios::end);
+	size = (size_t)in.tellg();
+	in.seekg(0, ios::beg);
+	char *buffer = new char[size ? size : 1];
+	in.read(buffer, size);
+	data = buffer;
+#else
+	int fd = ::open(File.c_str(), O_RDONLY);
+	if(fd < 0) return false;
+	struct stat st;
+	void *mem = MAP_FAILED;
+	if(fstat(fd, &st) == 0 && st.st_size > 0)
+		mem = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(mem == MAP_FAILED) return false;
+	data = (const char *)mem;
+	size = st.st_size;
+	mapped = true;
+#endif
+	const char *pos = data, *end = data + size;
+	uint32_t id, count;
+	uint16_t v;
+	if(readBundleUInt32(pos, end, id) && id == COMPILED_BUNDLE_ID && size_t(end - pos) >= sizeof(v)) {
+		memcpy(&v, pos, sizeof(v));
+		pos += sizeof(v);
+		if(v >= COMPILED_TOKENS_VERSION_MIN && COMPILED_TOKENS_VERSION_MAX >= v && readBundleUInt32(pos, end, count)) {
+			for(; count; --count) {
+				uint32_t len, offset, length;
+				if(!readBundleUInt32(pos, end, len) || size_t(end - pos) < len) break;
+				string name(pos, len);
+				pos += len;
+				if(!readBundleUInt32(pos, end, offset) || !readBundleUInt32(pos, end, length) || offset > size || length > size - offset) break;
+				index[name] = make_pair(offset, length);
+			}
+			if(count == 0) return true;
+		}
+	}
+	close();
+	return false;
+}
+
+void CScriptBundle::close() {
+	if(data) {
+#ifdef _WIN32
+		delete [] data;
+#else
+		if(mapped) munmap(const_cast<char *>(data), size);
+#endif
+	}
+	data = 0;
+	size = 0;
+	mapped = false;
+	index.clear();
+}
+
+bool CScriptBundle::load(const string &Name, CScriptTokenizer &Tokenizer) const {
+	map<string, pair<uint32_t, uint32_t> >::const_iterator it = index.find(Name);
+	if(it == index.end()) return false;
+	CScriptMemoryBuf buf(data + it->second.first, it->second.second);
+	istream in(&buf);
+	return Tokenizer.unserialize(in, Name);
+}
+
+STRING_VECTOR_t CScriptBundle::getNames() const {
+	STRING_VECTOR_t names;
+	for(map<string, pair<uint32_t, uint32_t> >::const_iterator it = index.begin(); it != index.end(); ++it)
+		names.push_back(it->first);
+	return names;
+}
+
+void CScriptBundle::write(const string &File, const STRING_VECTOR_t &Names, const STRING_VECTOR_t &Files) {
+	vector<CScriptCompiledSource> sources;
+	uint32_t offset = sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint32_t);
+	for(size_t i = 0; i < Names.size(); ++i) {
+		sources.push_back(CScriptCompiledSource(Files[i], normalizeModuleName(Names[i])));
+		offset += 3 * sizeof(uint32_t) + sources.back().name.size();
+	}
+	CScriptTokenizer::tokenizeSources(sources, true);
+	for(size_t i = 0; i < sources.size(); ++i)
+		if(sources[i].error.size()) throw CScriptException(Error, sources[i].error);
+	ofstream out(File.c_str(), fstream::out | fstream::trunc | fstream::binary);
+	uint32_t id = COMPILED_BUNDLE_ID, count = uint32_t(Names.size());
+	uint16_t v = COMPILED_TOKENS_VERSION_MAX;
+	CScriptToken::serialize(id, out);
+	CScriptToken::serialize(v, out);
+	CScriptToken::serialize(count, out);
+	for(size_t i = 0; i < sources.size(); ++i) {
+		uint32_t len = uint32_t(sources[i].name.size()), length = uint32_t(sources[i].compiled.size());
+		CScriptToken::serialize(len, out);
+		out.write(sources[i].name.data(), len);
+		CScriptToken::serialize(offset, out);
+		CScriptToken::serialize(length, out);
+		offset += length;
+	}
+	for(size_t i = 0; i < sources.size(); ++i)
+		out.write(sources[i].compiled.data(), sources[i].compiled.size());
+	if(!out) throw CScriptException(Error, "can't write \"" + File + "\"");
+}
+
+void CScriptBundle::tokenizeModule(const string &Code, const string &Path, CScriptTokenizer &Tokenizer) {
+	// "" is a spezal-token - it's for the tokenizer and means the code begins not in Statement-level
+	string Wrapped = "function(exports, require, module, __filename, __dirname){" + Code + "\n}";
+	CScriptLex lexer(Wrapped.c_str(), Path);
+	Tokenizer.tokenizeCode(lexer);
+}
+
 void CScriptTokenizer::tokenizeCode(CScriptLex &Lexer) {
 	try {
 		l=&Lexer;
@@ -1685,6 +2195,40 @@ static inline void setTokenSkip(CScriptTokenizer::ScriptTokenState &State) {
 	State.Tokens[tokenBeginIdx].Int() = size2int32(State.Tokens.size()-tokenBeginIdx);
 }
 
+// returns the superinstruction for the expression [Begin, End) or 0
+// the superinstruction-token is executed by CTinyJS::execute_increment or CTinyJS::execute_compare
+static int getSuperInstruction(TOKEN_VECT_cit Begin, TOKEN_VECT_cit End) {
+	TOKEN_VECT_cit it = Begin;
+	bool prefix = it < End && (it->token == LEX_PLUSPLUS || it->token == LEX_MINUSMINUS);
+	if(prefix) ++it;
+	if(it == End || it->token != LEX_ID) return 0;
+	++it;
+	int fused = LEX_T_INC_ID;
+	if(End-it >= 2 && it->token == '.' && it[1].token == LEX_ID) {
+		fused = LEX_T_INC_MEMBER;
+		it += 2;
+	}
+	if(prefix) return it == End ? fused : 0;
+	if(End-it == 1 && (it->token == LEX_PLUSPLUS || it->token == LEX_MINUSMINUS)) return fused;
+	if(End-it == 2 && (it->token == LEX_PLUSEQUAL || it->token == LEX_MINUSEQUAL) && it[1].token == LEX_INT) return fused;
+	if(End-it == 2 && fused == LEX_T_INC_ID && (it->token == '<' || it->token == '>' || it->token == LEX_LEQUAL || it->token == LEX_GEQUAL) && (it[1].token == LEX_INT || it[1].token == LEX_ID)) return LEX_T_CMP_ID;
+	return 0;
+}
+
+// an expression-statement is fused by replacing the LEX_T_SKIP-token
+static inline void fuseStatement(CScriptTokenizer::ScriptTokenState &State) {
+	CScriptToken &skip = State.Tokens[State.Marks.back()];
+	int fused = getSuperInstruction(State.Tokens.begin()+State.Marks.back()+1, State.Tokens.end()-1);
+	if(skip.token == LEX_T_SKIP && (fused == LEX_T_INC_ID || fused == LEX_T_INC_MEMBER)) skip.token = fused;
+}
+
+// an expression of a for-loop is fused by inserting the superinstruction-token
+static inline void fuseExpression(TOKEN_VECT &Tokens, int Expected) {
+	int fused = getSuperInstruction(Tokens.begin(), Tokens.end());
+	if(fused && (fused == LEX_T_CMP_ID) == (Expected == LEX_T_CMP_ID))
+		Tokens.insert(Tokens.begin(), CScriptToken(fused, size2int32(Tokens.size()+1)));
+}
+
 enum {
 	TOKENIZE_FLAGS_canLabel			= 1<<0,
 	TOKENIZE_FLAGS_canBreak			= 1<<1,
@@ -1698,9 +2242,11 @@ enum {
 	TOKENIZE_FLAGS_callForNew		= 1<<9,
 	TOKENIZE_FLAGS_noBlockStart		= 1<<10,
 	TOKENIZE_FLAGS_nestedObject		= 1<<11,
+	TOKENIZE_FLAGS_canTailCall		= 1<<12,	/// return f(...) can be executed as tail-call (not in generators or try)
 };
 void CScriptTokenizer::tokenizeTry(ScriptTokenState &State, int Flags) {
 	l->match(LEX_R_TRY);
+	Flags &= ~TOKENIZE_FLAGS_canTailCall; // catch and finally must be executed after the call
 	CScriptToken TryToken(LEX_T_TRY);
 	CScriptTokenDataTry &TryData = TryToken.Try();
 	pushToken(State.Tokens, TryToken);
@@ -2036,12 +2582,14 @@ void CScriptTokenizer::tokenizeFor(ScriptTokenState &State, int Flags) {
 		l->check(';'); // no automatic ;-injection
 		l->match(';'); // no automatic ;-injection
 		State.Tokens.swap(LoopData.condition);
+		fuseExpression(LoopData.condition, LEX_T_CMP_ID);
 	}
 
 	if(for_in || l->tk != ')') tokenizeExpression(State, Flags);
 	l->match(')');
 	State.Tokens.swap(LoopData.iter);
-	Flags = (Flags & (TOKENIZE_FLAGS_canReturn | TOKENIZE_FLAGS_canYield)) | TOKENIZE_FLAGS_canBreak | TOKENIZE_FLAGS_canContinue;
+	if(!for_in) fuseExpression(LoopData.iter, LEX_T_INC_ID);
+	Flags = (Flags & (TOKENIZE_FLAGS_canReturn | TOKENIZE_FLAGS_canTailCall | TOKENIZE_FLAGS_canYield)) | TOKENIZE_FLAGS_canBreak | TOKENIZE_FLAGS_canContinue;
 	if(haveLetScope) Flags |= TOKENIZE_FLAGS_noBlockStart;
 	tokenizeStatementNoLet(State, Flags);
 	if(haveLetScope) State.Forwarders.pop_back();
@@ -2140,7 +2688,7 @@ void CScriptTokenizer::tokenizeArrowFunction(const TOKEN_VECT &Arguments, Script
 	ScriptTokenState functionState;
 	functionState.HaveReturnValue /*= functionState.FunctionIsGenerator*/ = false;
 	if(l->tk == '{')
-		tokenizeBlock(functionState, TOKENIZE_FLAGS_canReturn); // => { } 
+		tokenizeBlock(functionState, TOKENIZE_FLAGS_canReturn | TOKENIZE_FLAGS_canTailCall); // => { } 
 	else {
 		tokenizeAssignment(functionState, 0);
 		functionState.HaveReturnValue = true;
@@ -2197,7 +2745,7 @@ void CScriptTokenizer::tokenizeFunction(ScriptTokenState &State, int Flags, bool
 	
 	ScriptTokenState functionState;
 //	if(l->tk == '{' || tk==LEX_T_GET || tk==LEX_T_SET)
-		tokenizeBlock(functionState, TOKENIZE_FLAGS_canReturn | (Generator ? TOKENIZE_FLAGS_canYield : 0));
+		tokenizeBlock(functionState, TOKENIZE_FLAGS_canReturn | (Generator ? TOKENIZE_FLAGS_canYield : TOKENIZE_FLAGS_canTailCall));
 //	else {
 //		tokenizeExpression(functionState, TOKENIZE_FLAGS_canYield);
 //		if(Statement) l->match(';');
@@ -2671,11 +3219,13 @@ void CScriptTokenizer::tokenizeMember(ScriptTokenState &State, int Flags) {
 }
 void CScriptTokenizer::tokenizeFunctionCall(ScriptTokenState &State, int Flags) {
 	bool for_new = (Flags & TOKENIZE_FLAGS_callForNew)!=0; Flags &= ~TOKENIZE_FLAGS_callForNew;
+	size_t callBegin = State.Tokens.size();
 	tokenizeLiteral(State, Flags);
 	tokenizeMember(State, Flags);
 	while(l->tk == '(' || l->tk == LEX_OPTIONAL_CHANING_FNC /* '?.(' */) {
 		State.LeftHand = false;
-		State.Marks.push_back(pushToken(State.Tokens)); // push Token & push BeginIdx
+		size_t callOpen = pushToken(State.Tokens);
+		State.Marks.push_back(callOpen); // push Token & push BeginIdx
 		State.pushLeftHandState();
 		while(l->tk!=')') {
 			tokenizeAssignment(State, Flags & ~TOKENIZE_FLAGS_noIn);
@@ -2685,7 +3235,14 @@ void CScriptTokenizer::tokenizeFunctionCall(ScriptTokenState &State, int Flags)
 		pushToken(State.Tokens);
 		setTokenSkip(State);
 		if(for_new) break;
+		size_t callEnd = State.Tokens.size();
 		tokenizeMember(State, Flags);
+		if(callEnd == State.Tokens.size() && State.Tokens[callOpen].token == '(') {
+			// remember the call for the tail-call detection in tokenizeStatement
+			State.LastCallBegin = callBegin;
+			State.LastCallOpen = callOpen;
+			State.LastCallEnd = callEnd;
+		}
 	}
 }
 template<class T> void mysort(T b, T e) {
@@ -2865,8 +3422,15 @@ void CScriptTokenizer::tokenizeStatement(ScriptTokenState &State, int Flags) {
 	case LEX_R_THROW:
 		State.Marks.push_back(pushToken(State.Tokens)); // push Token & push BeginIdx
 		if (l->tk != ';' && l->tk != '}' && !l->lineBreakBeforeToken) {
+			size_t expressionBegin = State.Tokens.size();
 			if (tk == LEX_R_RETURN) State.HaveReturnValue = true;
 			tokenizeExpression(State, Flags);
+			// return f(...) ==> mark the call as tail-call
+			if (tk == LEX_R_RETURN && (Flags & TOKENIZE_FLAGS_canTailCall) && State.LastCallBegin == expressionBegin && State.LastCallEnd == State.Tokens.size()) {
+				CScriptToken &callOpen = State.Tokens[State.LastCallOpen];
+				if (callOpen.token == '(' && State.LastCallOpen + callOpen.Int() == State.LastCallEnd)
+					callOpen.token = LEX_T_TAIL_CALL;
+			}
 		}
 		pushToken(State.Tokens, ';'); // push ';'
 		setTokenSkip(State);
@@ -2906,6 +3470,7 @@ void CScriptTokenizer::tokenizeStatement(ScriptTokenState &State, int Flags) {
 			}
 			else {
 				pushToken(State.Tokens, ';');
+				fuseStatement(State);
 				setTokenSkip(State);
 			}
 		}
@@ -2916,6 +3481,7 @@ void CScriptTokenizer::tokenizeStatement(ScriptTokenState &State, int Flags) {
 		State.Marks.push_back(pushToken(State.Tokens, CScriptToken(LEX_T_SKIP))); // push skip & skiperBeginIdx
 		tokenizeExpression(State, Flags);
 		pushToken(State.Tokens, ';');
+		fuseStatement(State);
 		setTokenSkip(State);
 		break;
 	}
@@ -2986,6 +3552,185 @@ int64_t CScriptPropertyName::name2arrayIdx(const std::string &Name) {
 	return result;
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// CScriptVarHeap
+//////////////////////////////////////////////////////////////////////////
+
+CScriptVarHeap::CScriptVarHeap() : sweepList(0) {
+	for(int i=0; i<SIZE_CLASSES; ++i) available[i] = 0;
+}
+CScriptVarHeap::~CScriptVarHeap() {
+	// the pages of leaked vars are leaked too
+	for(size_t i = 0; i < pages.size(); )
+		if(pages[i]->used == 0) releasePage(pages[i]); // the last page takes the index
+		else ++i;
+}
+
+static inline uint32_t countTrailingZeros(uint32_t bits) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, bits);
+	return index;
+#else
+	return __builtin_ctz(bits);
+#endif
+}
+
+void *CScriptVarHeap::alloc(size_t Size) {
+	size_t slotSize = (max(Size, size_t(MIN_SLOT_SIZE)) + SLOT_ALIGN-1) & ~size_t(SLOT_ALIGN-1);
+	uint32_t sizeClass = uint32_t(slotSize / SLOT_ALIGN - 1);
+	if(sizeClass >= SIZE_CLASSES) { // a page for its own
+		Page *page = newPage(SIZE_CLASSES, slotSize);
+		page->bump = page->used = 1;
+		page->liveBits[0] = 1;
+		return page->slots();
+	}
+	Page *page = available[sizeClass];
+	if(!page) {
+		// sweeping frees slots - maybe in a page of this size-class
+		for(int i = 0; i < SWEEP_PAGES && sweepList && !available[sizeClass]; ++i) {
+			Page *sweep = sweepList;
+			sweepList = sweep->nextSweep;
+			sweepPage(sweep);
+		}
+		page = available[sizeClass];
+		if(!page) page = newPage(sizeClass, slotSize);
+	}
+	char *p;
+	if(page->freeList) {
+		p = static_cast<char*>(page->freeList);
+		page->freeList = *reinterpret_cast<void**>(p);
+	} else
+		p = page->slots() + page->bump++ * page->slotSize;
+	uint32_t i = page->indexOf(p);
+	page->liveBits[i>>5] |= 1u<<(i&31);
+	if(++page->used == page->slotCount) unlinkAvailable(page);
+	return p;
+}
+void CScriptVarHeap::free(void *p) {
+	Page *page = pageOf(p);
+	uint32_t i = page->indexOf(p), bit = 1u<<(i&31);
+	page->liveBits[i>>5] &= ~bit;
+	page->markBits[i>>5] &= ~bit;
+	page->garbageBits[i>>5] &= ~bit;
+	if(page->sizeClass == SIZE_CLASSES) {
+		page->used = 0;
+		if(!page->pendingSweep) page->heap->releasePage(page); // otherwise released by sweep
+		return;
+	}
+	*static_cast<void**>(p) = page->freeList;
+	page->freeList = p;
+	if(page->used-- == page->slotCount) page->heap->linkAvailable(page);
+}
+
+void CScriptVarHeap::getVars(vector<CScriptVar*> &Vars) {
+	for(vector<Page*>::iterator it = pages.begin(); it != pages.end(); ++it) {
+		Page *page = *it;
+		for(uint32_t w = 0; w < BITMAP_WORDS; ++w)
+			for(uint32_t bits = page->liveBits[w] & ~page->garbageBits[w]; bits; bits &= bits-1)
+				Vars.push_back(reinterpret_cast<CScriptVar*>(page->slots() + (w*32 + countTrailingZeros(bits)) * page->slotSize));
+	}
+}
+
+void CScriptVarHeap::markGarbage(uint32_t ID) {
+	for(vector<Page*>::iterator it = pages.begin(); it != pages.end(); ++it) {
+		Page *page = *it;
+		bool marked = page->markID == ID, garbage = false;
+		for(uint32_t w = 0; w < BITMAP_WORDS; ++w)
+			garbage |= (page->garbageBits[w] = page->liveBits[w] & ~(marked ? page->markBits[w] : 0)) != 0;
+		if(garbage && !page->pendingSweep) {
+			page->pendingSweep = true;
+			page->nextSweep = sweepList;
+			sweepList = page;
+		}
+	}
+}
+
+void CScriptVarHeap::sweep() {
+	while(sweepList) {
+		Page *page = sweepList;
+		sweepList = page->nextSweep;
+		sweepPage(page);
+	}
+	// release the empty pages
+	for(size_t i = 0; i < pages.size(); )
+		if(pages[i]->used == 0) releasePage(pages[i]); // the last page takes the index
+		else ++i;
+}
+
+void CScriptVarHeap::sweepPage(Page *page) {
+	page->pendingSweep = false;
+	if(page->used == 0) { // all garbage is freed while sweeping other pages
+		if(page->sizeClass == SIZE_CLASSES) releasePage(page);
+		return;
+	}
+	// the garbage is held until all are cleaned up - cleanUp4Destroy frees other slots
+	for(uint32_t w = 0; w < BITMAP_WORDS; ++w) {
+		for(uint32_t bits = page->garbageBits[w]; bits; bits &= bits-1)
+			garbage.push_back(reinterpret_cast<CScriptVar*>(page->slots() + (w*32 + countTrailingZeros(bits)) * page->slotSize)->ref());
+		page->garbageBits[w] = 0;
+	}
+	bool large = page->sizeClass == SIZE_CLASSES;
+	for(vector<CScriptVar*>::iterator it = garbage.begin(); it != garbage.end(); ++it)
+		(*it)->cleanUp4Destroy();
+	for(vector<CScriptVar*>::iterator it = garbage.begin(); it != garbage.end(); ++it)
+		(*it)->unref(); // releases a large page
+	garbage.clear();
+	// an empty page is released if the size-class has another page with free slots
+	if(!large && page->used == 0 && (page->prevAvailable || page->nextAvailable))
+		releasePage(page);
+}
+
+void CScriptVarHeap::Page::clearMarks(uint32_t ID) {
+	memset(markBits, 0, sizeof(markBits));
+	markID = ID;
+}
+
+CScriptVarHeap::Page *CScriptVarHeap::newPage(uint32_t SizeClass, size_t SlotSize) {
+	size_t size = max(size_t(PAGE_SIZE), HEADER_SIZE + SlotSize);
+	void *mem;
+#ifdef _WIN32
+	mem = _aligned_malloc(size, PAGE_SIZE);
+#else
+	if(posix_memalign(&mem, PAGE_SIZE, size) != 0) mem = 0;
+#endif
+	if(!mem) throw bad_alloc();
+	Page *page = static_cast<Page*>(memset(mem, 0, HEADER_SIZE));
+	page->heap = this;
+	page->sizeClass = SizeClass;
+	page->slotSize = uint32_t(SlotSize);
+	page->slotCount = SizeClass == SIZE_CLASSES ? 1 : uint32_t((PAGE_SIZE - HEADER_SIZE) / SlotSize);
+	page->index = uint32_t(pages.size());
+	pages.push_back(page);
+	if(SizeClass != SIZE_CLASSES) linkAvailable(page);
+	return page;
+}
+void CScriptVarHeap::releasePage(Page *page) {
+	if(page->available) unlinkAvailable(page);
+	Page *last = pages.back();
+	pages[page->index] = last;
+	last->index = page->index;
+	pages.pop_back();
+#ifdef _WIN32
+	_aligned_free(page);
+#else
+	::free(page);
+#endif
+}
+void CScriptVarHeap::linkAvailable(Page *page) {
+	page->available = true;
+	page->prevAvailable = 0;
+	page->nextAvailable = available[page->sizeClass];
+	if(page->nextAvailable) page->nextAvailable->prevAvailable = page;
+	available[page->sizeClass] = page;
+}
+void CScriptVarHeap::unlinkAvailable(Page *page) {
+	page->available = false;
+	if(page->prevAvailable) page->prevAvailable->nextAvailable = page->nextAvailable;
+	else available[page->sizeClass] = page->nextAvailable;
+	if(page->nextAvailable) page->nextAvailable->prevAvailable = page->prevAvailable;
+}
+
 //////////////////////////////////////////////////////////////////////////
 /// CScriptVar
 //////////////////////////////////////////////////////////////////////////
@@ -2993,17 +3738,9 @@ int64_t CScriptPropertyName::name2arrayIdx(const std::string &Name) {
 static uint32_t currentDebugID = 0;
 #endif
 CScriptVar::CScriptVar(CTinyJS *Context, const CScriptVarPtr &Prototype) {
-	extensible = true;
+	varFlags = SCRIPTVAR_EXTENSIBLE;
 	context = Context;
-	memset(temporaryMark, 0, sizeof(temporaryMark));
-	if(context->first) {
-		next = context->first;
-		next->prev = this;
-	} else {
-		next = 0;
-	}
-	context->first = this;
-	prev = 0;
+	if(context->allocationProfiler && context->allocationProfiler->isLastSample(this)) varFlags |= SCRIPTVAR_SAMPLED;
 	refs = 0;
 	if (Prototype) {
 		prototype = Prototype->ref();
@@ -3024,12 +3761,8 @@ CScriptVar::~CScriptVar(void) {
 		(*it)->setOwner(0);
 	removeAllChildren();
 	if (prototype) prototype->unref();
-	if(prev)
-		prev->next = next;
-	else
-		context->first = next;
-	if(next)
-		next->prev = prev;
+	context->eraseNestedMarks(this);
+	if((varFlags & SCRIPTVAR_SAMPLED) && context->allocationProfiler) context->allocationProfiler->freed(this, getTypeTag());
 }
 
 CScriptVarPtr CScriptVar::getPrototype() {
@@ -3043,29 +3776,11 @@ void CScriptVar::setPrototype(const CScriptVarPtr &Prototype) {
 
 /// Type
 
-bool CScriptVar::isObject()		{return false;}
-bool CScriptVar::isError()			{return false;}
-bool CScriptVar::isArray()			{return false;}
-bool CScriptVar::isDate()			{return false;}
-bool CScriptVar::isRegExp()		{return false;}
-bool CScriptVar::isAccessor()		{return false;}
-bool CScriptVar::isNull()			{return false;}
-bool CScriptVar::isUndefined()	{return false;}
-bool CScriptVar::isNullOrUndefined() { return isNull() || isUndefined(); }
 bool CScriptVar::isNaN()			{return false;}
-bool CScriptVar::isString()		{return false;}
 bool CScriptVar::isInt()			{return false;}
-bool CScriptVar::isBool()			{return false;}
 int CScriptVar::isInfinity()		{ return 0; } ///< +1==POSITIVE_INFINITY, -1==NEGATIVE_INFINITY, 0==is not an InfinityVar
 bool CScriptVar::isDouble()		{return false;}
 bool CScriptVar::isRealNumber()	{return false;}
-bool CScriptVar::isNumber()		{return false;}
-bool CScriptVar::isPrimitive()	{return false;}
-bool CScriptVar::isFunction()		{return false;}
-bool CScriptVar::isNative()		{return false;}
-bool CScriptVar::isBounded()		{return false;}
-bool CScriptVar::isIterator()		{return false;}
-bool CScriptVar::isGenerator()	{return false;}
 
 //////////////////////////////////////////////////////////////////////////
 /// Value
@@ -3256,7 +3971,7 @@ CScriptVarPtr CScriptVar::getOwnPropertyDescriptor(const string &Name) {
 	ret->addChild("configurable", constScriptVar(child->isConfigurable()));
 	return ret;
 }
-const char *CScriptVar::defineProperty(const string &Name, CScriptVarPtr Attributes) {
+const char *CScriptVar::defineProperty(const string &Name, const CScriptVarPtr &Attributes) {
 	CScriptVarPtr attr;
 	CScriptVarLinkPtr child = getOwnProperty(Name);
 
@@ -3269,8 +3984,8 @@ const char *CScriptVar::defineProperty(const string &Name, CScriptVarPtr Attribu
 	bool attr_isAccessorDescriptor		= attr_get || attr_set || (!attr_value && child && child->getVarPtr()->isAccessor());
 	if(attr_isAccessorDescriptor) {
 		if(attr_value || attr_writable) return "property descriptors must not specify a value or be writable when a getter or setter has been specified";
-		if(attr_get && (!attr_get->isUndefined() || !attr_get->isFunction())) return "property descriptor's getter field is neither undefined nor a function";
-		if(attr_set && (!attr_set->isUndefined() || !attr_set->isFunction())) return "property descriptor's setter field is neither undefined nor a function";
+		if(attr_get && (!attr_get->isUndefined() && !attr_get->isFunction())) return "property descriptor's getter field is neither undefined nor a function";
+		if(attr_set && (!attr_set->isUndefined() && !attr_set->isFunction())) return "property descriptor's setter field is neither undefined nor a function";
 	}
 	if(!child) {
 		if(!isExtensible()) return "is not extensible";
@@ -3317,7 +4032,7 @@ cant_redefine:
 
 CScriptVarLinkPtr CScriptVar::findChild(const string &childName) {
 	if(Childs.empty()) return 0;
-	SCRIPTVAR_CHILDS_it it = lower_bound(Childs.begin(), Childs.end(), childName);
+	SCRIPTVAR_CHILDS_it it = lower_bound(Childs.begin(), Childs.end(), CScriptVarChildKey(childName));
 	if(it != Childs.end() && (*it)->getName() == childName)
 		return *it;
 	return 0;
@@ -3423,7 +4138,7 @@ void CScriptVar::keys(set<string> &Keys, bool OnlyEnumerable/*=true*/, uint32_t
 /// add & remove
 CScriptVarLinkPtr CScriptVar::addChild(const string &childName, const CScriptVarPtr &child, int linkFlags /*= SCRIPTVARLINK_DEFAULT*/) {
 	CScriptVarLinkPtr link;
-	SCRIPTVAR_CHILDS_it it = lower_bound(Childs.begin(), Childs.end(), childName);
+	SCRIPTVAR_CHILDS_it it = lower_bound(Childs.begin(), Childs.end(), CScriptVarChildKey(childName));
 	if(it == Childs.end() || (*it)->getName() != childName) {
 		link = CScriptVarLinkPtr(child?child:constScriptVar(Undefined), childName, linkFlags);
 		link->setOwner(this);
@@ -3444,7 +4159,7 @@ CScriptVarLinkPtr CScriptVar::addChildNoDup(const string &childName, const CScri
 	return addChildOrReplace(childName, child, linkFlags);
 }
 CScriptVarLinkPtr CScriptVar::addChildOrReplace(const string &childName, const CScriptVarPtr &child, int linkFlags /*= SCRIPTVARLINK_DEFAULT*/) {
-	SCRIPTVAR_CHILDS_it it = lower_bound(Childs.begin(), Childs.end(), childName);
+	SCRIPTVAR_CHILDS_it it = lower_bound(Childs.begin(), Childs.end(), CScriptVarChildKey(childName));
 	if(it == Childs.end() || (*it)->getName() != childName) {
 		CScriptVarLinkPtr link(child, childName, linkFlags);
 		link->setOwner(this);
@@ -3461,7 +4176,7 @@ CScriptVarLinkPtr CScriptVar::addChildOrReplace(uint32_t childName, const CScrip
 
 bool CScriptVar::removeLink(CScriptVarLinkPtr &link) {
 	if (!link) return false;
-	SCRIPTVAR_CHILDS_it it = lower_bound(Childs.begin(), Childs.end(), link->getName());
+	SCRIPTVAR_CHILDS_it it = lower_bound(Childs.begin(), Childs.end(), CScriptVarChildKey(link->getName()));
 	if(it != Childs.end() && (*it) == link) {
 		Childs.erase(it);
 #ifdef _DEBUG
@@ -3474,7 +4189,7 @@ bool CScriptVar::removeLink(CScriptVarLinkPtr &link) {
 }
 
 bool CScriptVar::removeChild(const std::string &childName) {
-	SCRIPTVAR_CHILDS_it it = lower_bound(Childs.begin(), Childs.end(), childName);
+	SCRIPTVAR_CHILDS_it it = lower_bound(Childs.begin(), Childs.end(), CScriptVarChildKey(childName));
 	if(it != Childs.end() && (*it)->getName() == childName) {
 		Childs.erase(it);
 #ifdef _DEBUG
@@ -3500,8 +4215,13 @@ CScriptVarPtr CScriptVar::getProperty(uint32_t idx) {
 void CScriptVar::setProperty(const std::string &name, const CScriptVarPtr &rhs, bool ignoreReadOnly/*=false*/, bool ignoreNotExtensible/*=false*/)
 {
 	CScriptVarLinkWorkPtr lhs = findChildWithPrototypeChain(name);
-	if(lhs->isWritable()) {
-		if (!lhs->isOwned()) {
+	if(!lhs) {
+		if(isExtensible())
+			addChild(name, rhs);
+		else if(!ignoreNotExtensible)
+			throw newScriptVarError(context, TypeError, (name +" is not extensible").c_str());
+	} else if(lhs->isWritable()) {
+		if (!lhs->isOwned() && !lhs.isInheritedAccessor()) {
 			CScriptVarPtr fakedOwner = lhs.getReferencedOwner();
 			if(fakedOwner) {
 				if(!fakedOwner->isExtensible()) {
@@ -3600,20 +4320,20 @@ string CScriptVar::getFlagsAsString() {
 	return flagstr;
 }
 
+#ifdef WITH_REFCOUNT_STATISTICS
 CScriptVar *CScriptVar::ref() {
+	context->refCountStatistics.varRefs++;
 	refs++;
 	return this;
 }
 void CScriptVar::unref() {
+	context->refCountStatistics.varUnrefs++;
 	refs--;
-	if (refs<0)
-		do
-		{
-		} while (0);
 	ASSERT(refs>=0); // printf("OMFG, we have unreffed too far!\n");
 	if (refs==0)
 		delete this;
 }
+#endif
 
 int CScriptVar::getRefs() const {
 	return refs;
@@ -3644,7 +4364,7 @@ void CScriptVar::setTemporaryMark_recursive(uint32_t ID)
 //////////////////////////////////////////////////////////////////////////
 
 CScriptVarLink::CScriptVarLink(const CScriptVarPtr &Var, const string &Name /*=TINYJS_TEMP_NAME*/, int Flags /*=SCRIPTVARLINK_DEFAULT*/)
-	: name(Name), owner(0), flags(Flags), refs(0) {
+	: name(Name), owner(0), flags(Flags), arrayIndex(isArrayIndex(Name)), refs(0) {
 #if DEBUG_MEMORY
 	mark_allocated(this);
 #endif
@@ -3657,16 +4377,20 @@ CScriptVarLink::~CScriptVarLink() {
 #endif
 }
 
+#ifdef WITH_REFCOUNT_STATISTICS
 CScriptVarLink *CScriptVarLink::ref() {
+	if(var) var->getContext()->refCountStatistics.linkRefs++;
 	refs++;
 	return this;
 }
 void CScriptVarLink::unref() {
+	if(var) var->getContext()->refCountStatistics.linkUnrefs++;
 	refs--;
 	ASSERT(refs>=0); // printf("OMFG, we have unreffed too far!\n");
 	if (refs==0)
 		delete this;
 }
+#endif
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -3676,6 +4400,7 @@ void CScriptVarLink::unref() {
 CScriptVarLinkPtr & CScriptVarLinkPtr::operator()( const CScriptVarPtr &var, const string &name /*= TINYJS_TEMP_NAME*/, int flags /*= SCRIPTVARLINK_DEFAULT*/ ) {
 	if(link && link->refs == 1) { // the link is only refered by this
 		link->name = name;
+		link->arrayIndex = isArrayIndex(name);
 		link->owner = 0;
 		link->flags = flags;
 		link->var = var;
@@ -3687,16 +4412,7 @@ CScriptVarLinkPtr & CScriptVarLinkPtr::operator()( const CScriptVarPtr &var, con
 }
 
 bool CScriptVarLinkPtr::operator <(const string &rhs) const {
-	uint32_t lhs_int = isArrayIndex(link->getName());
-	uint32_t rhs_int = isArrayIndex(rhs);
-	if(lhs_int==uint32_t(-1)) {				// lhs is not an array-idx
-		if(rhs_int==uint32_t(-1))			// and rhs is not an array-idx
-			return link->getName() < rhs;	// normal string compare
-		else
-			return true;					// but rhs is an array-idx always true to sort array-idx at the end
-	} else if(rhs_int==uint32_t(-1))		// if lhs an array-idx but rhs not always false to sort array-idx at the end
-		return false;
-	return lhs_int < rhs_int;				// both are array-idx normal int compare 
+	return *this < CScriptVarChildKey(rhs);
 }
 
 
@@ -3730,6 +4446,22 @@ CScriptVarLinkWorkPtr CScriptVarLinkWorkPtr::getter(CScriptResult &execute) {
 	} 
 	return *this;
 }
+CScriptVarLinkWorkPtr &CScriptVarLinkWorkPtr::getterInPlace(CScriptResult &execute) {
+	if(execute && link) {
+		if (link->getVarPtr() && link->getVarPtr()->isAccessor()) {
+			CScriptVarLinkWorkPtr ret = getter(execute);
+			swap(ret);
+		} else if (referencedOwner) {
+			CScriptVarLinkPtr &ret = referencedOwner->getter(execute, *this);
+			if(&ret != this) {
+				CScriptVarLinkWorkPtr tmp(ret);
+				swap(tmp);
+			} else if(link->getOwner() != referencedOwner.getVar())
+				referencedOwner = link->getOwner();
+		}
+	}
+	return *this;
+}
 CScriptVarLinkWorkPtr CScriptVarLinkWorkPtr::setter( const CScriptVarPtr &Var ) {
 	if(link && link->getVarPtr()) {
 		CScriptResult execute;
@@ -3740,6 +4472,10 @@ CScriptVarLinkWorkPtr CScriptVarLinkWorkPtr::setter( const CScriptVarPtr &Var )
 	return *this;
 }
 
+bool CScriptVarLinkWorkPtr::isInheritedAccessor() const {
+	return link && referencedOwner && !link->isOwned() && link->getVarPtr() && link->getVarPtr()->isAccessor();
+}
+
 CScriptVarLinkWorkPtr CScriptVarLinkWorkPtr::setter( CScriptResult &execute, const CScriptVarPtr &Var ) {
 	if(execute && link) {
 		if(link->getVarPtr() && link->getVarPtr()->isAccessor()) {
@@ -3764,7 +4500,6 @@ CScriptVarLinkWorkPtr CScriptVarLinkWorkPtr::setter( CScriptResult &execute, con
 
 CScriptVarPrimitive::~CScriptVarPrimitive(){}
 
-bool CScriptVarPrimitive::isPrimitive() { return true; }
 CScriptVarPrimitivePtr CScriptVarPrimitive::getRawPrimitive() { return this; }
 bool CScriptVarPrimitive::toBoolean() { return false; }
 CScriptVarPtr CScriptVarPrimitive::toObject() { return this; }
@@ -3778,9 +4513,8 @@ CScriptVarPtr CScriptVarPrimitive::toString_CallBack( CScriptResult &execute, in
 //////////////////////////////////////////////////////////////////////////
 
 declare_dummy_t(Undefined);
-CScriptVarUndefined::CScriptVarUndefined(CTinyJS *Context) : CScriptVarPrimitive(Context, Context->objectPrototype) { }
+CScriptVarUndefined::CScriptVarUndefined(CTinyJS *Context) : CScriptVarPrimitive(Context, Context->objectPrototype) { varFlags |= TYPE_TAG_UNDEFINED; }
 CScriptVarUndefined::~CScriptVarUndefined() {}
-bool CScriptVarUndefined::isUndefined() { return true; }
 
 CNumber CScriptVarUndefined::toNumber_Callback() { return NaN; }
 string CScriptVarUndefined::toCString(int radix/*=0*/) { return "undefined"; }
@@ -3792,21 +4526,48 @@ string CScriptVarUndefined::getVarType() { return "undefined"; }
 //////////////////////////////////////////////////////////////////////////
 
 declare_dummy_t(Null);
-CScriptVarNull::CScriptVarNull(CTinyJS *Context) : CScriptVarPrimitive(Context, Context->objectPrototype) { }
+CScriptVarNull::CScriptVarNull(CTinyJS *Context) : CScriptVarPrimitive(Context, Context->objectPrototype) { varFlags |= TYPE_TAG_NULL; }
 CScriptVarNull::~CScriptVarNull() {}
-bool CScriptVarNull::isNull() { return true; }
 
 CNumber CScriptVarNull::toNumber_Callback() { return 0; }
 string CScriptVarNull::toCString(int radix/*=0*/) { return "null"; }
 string CScriptVarNull::getVarType() { return "null"; }
 
 
+//////////////////////////////////////////////////////////////////////////
+/// CScriptExternalData
+//////////////////////////////////////////////////////////////////////////
+
+CScriptExternalData::CScriptExternalData(const char *Data, size_t Size, RELEASE_FNC Release, void *Userdata)
+	: ptr(Size ? Data : ""), origin(Data), len(Size), release(Release), userdata(Userdata), refs(1) {}
+CScriptExternalData::~CScriptExternalData() {
+	if(release) release(origin, len, userdata);
+}
+CScriptExternalData *CScriptExternalData::create(const char *Data, size_t Size, RELEASE_FNC Release/*=0*/, void *Userdata/*=0*/) {
+	return new CScriptExternalData(Data, Size, Release, Userdata);
+}
+CScriptExternalData *CScriptExternalData::ref() {
+	++refs;
+	return this;
+}
+void CScriptExternalData::unref() {
+	if(--refs == 0) delete this;
+}
+
+
 //////////////////////////////////////////////////////////////////////////
 /// CScriptVarString
 //////////////////////////////////////////////////////////////////////////
 
-CScriptVarString::CScriptVarString(CTinyJS *Context, const string &Data) : CScriptVarPrimitive(Context, Context->stringPrototype), data(Data) {
-	addChild("length", newScriptVar(data.size()), SCRIPTVARLINK_CONSTANT);
+CScriptVarString::CScriptVarString(CTinyJS *Context, CScriptExternalData *External) : CScriptVarPrimitive(Context, Context->stringPrototype), external(External), hash(0), nextInterned(0), unitIndex(0) {
+	varFlags |= TYPE_TAG_STRING;
+	initLength();
+	addChild("length", newScriptVar(length), SCRIPTVARLINK_CONSTANT);
+}
+CScriptVarString::CScriptVarString(CTinyJS *Context, const string &Data) : CScriptVarPrimitive(Context, Context->stringPrototype), data(Data), external(0), hash(0), nextInterned(0), unitIndex(0) {
+	varFlags |= TYPE_TAG_STRING;
+	initLength();
+	addChild("length", newScriptVar(length), SCRIPTVARLINK_CONSTANT);
 /*
 	CScriptVarLinkPtr acc = addChild("length", newScriptVar(Accessor), 0);
 	CScriptVarFunctionPtr getter(::newScriptVar(Context, this, &CScriptVarString::native_Length, 0));
@@ -3814,19 +4575,25 @@ CScriptVarString::CScriptVarString(CTinyJS *Context, const string &Data) : CScri
 	acc->getVarPtr()->addChild(TINYJS_ACCESSOR_GET_VAR, getter, 0);
 */
 }
-CScriptVarString::~CScriptVarString() {}
-bool CScriptVarString::isString() { return true; }
+CScriptVarString::~CScriptVarString() {
+	if(isInterned()) context->internedStrings.remove(this);
+	if(external) external->unref();
+	delete unitIndex;
+}
 
-bool CScriptVarString::toBoolean() { return data.length()!=0; }
-CNumber CScriptVarString::toNumber_Callback() { return data.c_str(); }
-string CScriptVarString::toCString(int radix/*=0*/) { return data; }
+bool CScriptVarString::toBoolean() { return getDataSize()!=0; }
+CNumber CScriptVarString::toNumber_Callback() { return external ? toCString().c_str() : data.c_str(); }
+string CScriptVarString::toCString(int radix/*=0*/) { return external ? string(external->data(), external->size()) : data; }
 
-string CScriptVarString::getParsableString(const string &indentString, const string &indent, uint32_t uniqueID, bool &hasRecursion) { return indentString+getJSString(data); }
+string CScriptVarString::getParsableString(const string &indentString, const string &indent, uint32_t uniqueID, bool &hasRecursion) {
+	if(external) return indentString+getJSString(toCString());
+	return indentString+getJSString(data);
+}
 string CScriptVarString::getVarType() { return "string"; }
 
 CScriptVarPtr CScriptVarString::toObject() {
 	CScriptVarPtr ret = newScriptVar(CScriptVarPrimitivePtr(this), context->stringPrototype);
-	ret->addChild("length", newScriptVar(data.size()), SCRIPTVARLINK_CONSTANT);
+	ret->addChild("length", newScriptVar(length), SCRIPTVARLINK_CONSTANT);
 	return ret;
 }
 
@@ -3839,8 +4606,8 @@ CScriptVarLinkWorkPtr CScriptVarString::getOwnProperty(const std::string &childN
 	if(child) return child;
 	uint32_t Idx = isArrayIndex(childName);
 	if (Idx!=uint32_t(-1)) {
-		if((string::size_type)Idx < data.size())
-			child(newScriptVar(data.substr(Idx, 1)), childName, SCRIPTVARLINK_ENUMERABLE);
+		if(Idx < length)
+			child(newScriptVar(substrUnits(Idx, 1)), childName, SCRIPTVARLINK_ENUMERABLE);
 		else
 			child(constScriptVar(Undefined), childName, SCRIPTVARLINK_ENUMERABLE);
 		child.setReferencedOwner(this); // fake referenced Owner
@@ -3851,18 +4618,297 @@ CScriptVarLinkWorkPtr CScriptVarString::getOwnProperty(const std::string &childN
 
 void CScriptVarString::keys(STRING_SET_t &Keys, bool OnlyEnumerable/*=true*/, uint32_t ID/*=0*/) {
 	if(ID) setTemporaryMark(ID);
-	string::size_type length = data.size();
-	for(string::size_type i=0; i<length; ++i)
+	for(uint32_t i=0; i<length; ++i)
 		Keys.insert(int2string(i));
 	CScriptVar::keys(Keys, OnlyEnumerable, ID);
 }
 
-uint32_t CScriptVarString::getLength() { return data.length(); }
+// decodes the UTF-8 character at Data - returns the code-point and the count of its bytes
+// a lone surrogate is one character (WTF-8) - a byte that does not begin a valid sequence is one character (latin-1)
+static inline uint32_t decodeUtf8(const unsigned char *Data, const unsigned char *End, size_t &Bytes) {
+	uint32_t c = *Data;
+	Bytes = 1;
+	if(c < 0xc2 || c > 0xf4) return c;
+	size_t n = c < 0xe0 ? 2 : c < 0xf0 ? 3 : 4;
+	if(size_t(End-Data) < n) return c;
+	uint32_t cp = c & (0x7f >> n);
+	for(size_t i=1; i<n; ++i) {
+		if((Data[i] & 0xc0) != 0x80) return c;
+		cp = (cp << 6) | (Data[i] & 0x3f);
+	}
+	// overlong or out of range
+	if((n == 3 && cp < 0x800) || (n == 4 && (cp < 0x10000 || cp > 0x10ffff))) return c;
+	Bytes = n;
+	return cp;
+}
+
+bool CScriptVarString::isAscii(const char *Data, size_t Size) {
+	const char *end = Data+Size;
+#if defined(__SSE2__) || defined(_M_X64)
+	for(; end-Data >= 16; Data += 16)
+		if(_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)Data))) return false;
+#endif
+	for(; end-Data >= 8; Data += 8) {
+		uint64_t word;
+		memcpy(&word, Data, 8);
+		if(word & 0x8080808080808080ULL) return false;
+	}
+	for(; Data < end; ++Data)
+		if(*Data & 0x80) return false;
+	return true;
+}
+
+void CScriptVarString::appendUnit(string &Str, uint32_t Unit) {
+	if(Unit < 0x80)
+		Str += char(Unit);
+	else if(Unit < 0x800) {
+		Str += char(0xc0 | (Unit >> 6));
+		Str += char(0x80 | (Unit & 0x3f));
+	} else {
+		Str += char(0xe0 | (Unit >> 12));
+		Str += char(0x80 | ((Unit >> 6) & 0x3f));
+		Str += char(0x80 | (Unit & 0x3f));
+	}
+}
+
+// WTF-8: a high surrogate followed by a low surrogate (e.g. concatenated halves of a character) is joined to one 4-byte character
+static void joinSurrogatePairs(string &Data) {
+	size_t w = Data.find('\xed');
+	if(w == string::npos) return;
+	unsigned char *p = (unsigned char *)&Data[0];
+	for(size_t r = w, size = Data.size(); r < size; ) {
+		if(r+6 <= size && p[r] == 0xed && (p[r+1] & 0xf0) == 0xa0 && (p[r+2] & 0xc0) == 0x80 && p[r+3] == 0xed && (p[r+4] & 0xf0) == 0xb0 && (p[r+5] & 0xc0) == 0x80) {
+			uint32_t cp = 0x10000 + ((((p[r+1] & 0x0f) << 6) | (p[r+2] & 0x3f)) << 10) + (((p[r+4] & 0x0f) << 6) | (p[r+5] & 0x3f));
+			p[w++] = (unsigned char)(0xf0 | (cp >> 18));
+			p[w++] = (unsigned char)(0x80 | ((cp >> 12) & 0x3f));
+			p[w++] = (unsigned char)(0x80 | ((cp >> 6) & 0x3f));
+			p[w++] = (unsigned char)(0x80 | (cp & 0x3f));
+			r += 6;
+		} else
+			p[w++] = p[r++];
+	}
+	Data.resize(w);
+}
+
+void CScriptVarString::initLength() {
+	if(isAscii(getData(), getDataSize())) {
+		varFlags |= SCRIPTVAR_STRING_ASCII;
+		length = uint32_t(getDataSize());
+		return;
+	}
+	if(!external) joinSurrogatePairs(data);
+	const char *Data = getData();
+	size_t size = getDataSize();
+	length = 0;
+	const unsigned char *it = (const unsigned char *)Data, *end = it+size;
+	for(size_t bytes; it < end; it += bytes)
+		length += decodeUtf8(it, end, bytes) > 0xffff ? 2 : 1;
+}
+
+const vector<uint32_t> &CScriptVarString::getUnitIndex() {
+	if(!unitIndex) {
+		unitIndex = new vector<uint32_t>;
+		unitIndex->reserve(length+1);
+		const unsigned char *begin = (const unsigned char *)getData(), *it = begin, *end = it+getDataSize();
+		for(size_t bytes; it < end; it += bytes) {
+			uint32_t offset = uint32_t(it-begin);
+			unitIndex->push_back(offset);
+			if(decodeUtf8(it, end, bytes) > 0xffff) unitIndex->push_back(offset); // both code-units of a surrogate-pair
+		}
+		unitIndex->push_back(uint32_t(end-begin));
+	}
+	return *unitIndex;
+}
+
+size_t CScriptVarString::unitToByte(uint32_t Unit) {
+	if(Unit >= length) return getDataSize();
+	if(isAscii()) return Unit;
+	const vector<uint32_t> &index = getUnitIndex();
+	if(Unit && index[Unit] == index[Unit-1]) return index[Unit+1];
+	return index[Unit];
+}
+
+uint32_t CScriptVarString::byteToUnit(size_t Byte) {
+	if(isAscii()) return uint32_t(min(Byte, getDataSize()));
+	const vector<uint32_t> &index = getUnitIndex();
+	vector<uint32_t>::const_iterator it = lower_bound(index.begin(), index.end(), uint32_t(Byte));
+	if(it == index.end()) return length;
+	if(*it != Byte) --it; // inside of a character
+	return uint32_t(it-index.begin());
+}
+
+string CScriptVarString::substrUnits(uint32_t Start, uint32_t Count/*=uint32_t(-1)*/) {
+	if(Start >= length || !Count) return string();
+	uint32_t End = Count < length-Start ? Start+Count : length;
+	if(isAscii()) return string(getData()+Start, End-Start);
+	// a split surrogate-pair gives a lone surrogate
+	const vector<uint32_t> &index = getUnitIndex();
+	string ret;
+	if(Start && index[Start] == index[Start-1]) appendUnit(ret, getChar(Start));
+	size_t begin = unitToByte(Start);
+	size_t end = End < length && index[End] == index[End-1] ? index[End] : unitToByte(End);
+	if(end > begin) ret.append(getData()+begin, end-begin);
+	if(End < length && index[End] == index[End-1]) appendUnit(ret, getChar(End-1));
+	return ret;
+}
+
+uint32_t CScriptVarString::getLength() { return length; }
 int CScriptVarString::getChar(uint32_t Idx) {
-	if((string::size_type)Idx >= data.size())
+	if(Idx >= length)
 		return -1;
-	else
-		return (unsigned char)data[Idx];
+	if(isAscii())
+		return (unsigned char)getData()[Idx];
+	const vector<uint32_t> &index = getUnitIndex();
+	bool low = Idx && index[Idx] == index[Idx-1];
+	const unsigned char *data = (const unsigned char *)getData();
+	size_t bytes;
+	uint32_t cp = decodeUtf8(data+index[Idx], data+getDataSize(), bytes);
+	if(cp <= 0xffff) return cp;
+	cp -= 0x10000;
+	return low ? 0xdc00 + (cp & 0x3ff) : 0xd800 + (cp >> 10);
+}
+
+// FNV-1a
+uint32_t CScriptVarString::computeHash(const char *Data, size_t Size) {
+	uint32_t h = 2166136261u;
+	for(const char *end = Data+Size; Data < end; ++Data)
+		h = (h ^ (unsigned char)*Data) * 16777619u;
+	return h;
+}
+
+bool CScriptVarString::equals(CScriptVarString *Other) {
+	if(this == Other) return true;
+	if(isInterned() && Other->isInterned()) return false;
+	size_t size = getDataSize();
+	if(size != Other->getDataSize() || getHash() != Other->getHash()) return false;
+	return memcmp(getData(), Other->getData(), size) == 0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptStringTable
+//////////////////////////////////////////////////////////////////////////
+
+CScriptVarString *CScriptStringTable::find(const char *Data, size_t Size, uint32_t Hash) const {
+	if(buckets.empty()) return 0;
+	for(CScriptVarString *it = buckets[Hash & (buckets.size()-1)]; it; it = it->nextInterned)
+		if(it->hash == Hash && it->getDataSize() == Size && memcmp(it->getData(), Data, Size) == 0)
+			return it;
+	return 0;
+}
+
+void CScriptStringTable::insert(CScriptVarString *String) {
+	ASSERT(!String->isInterned());
+	if(count >= buckets.size()) {
+		// grow and rehash - the size is always a power of two
+		vector<CScriptVarString*> old(buckets.empty() ? 64 : buckets.size()*2, (CScriptVarString*)0);
+		old.swap(buckets);
+		for(vector<CScriptVarString*>::iterator it = old.begin(); it != old.end(); ++it) {
+			for(CScriptVarString *next, *str = *it; str; str = next) {
+				next = str->nextInterned;
+				CScriptVarString *&bucket = buckets[str->hash & (buckets.size()-1)];
+				str->nextInterned = bucket;
+				bucket = str;
+			}
+		}
+	}
+	CScriptVarString *&bucket = buckets[String->getHash() & (buckets.size()-1)];
+	String->nextInterned = bucket;
+	bucket = String;
+	String->varFlags |= SCRIPTVAR_STRING_INTERNED;
+	++count;
+}
+
+void CScriptStringTable::remove(CScriptVarString *String) {
+	ASSERT(String->isInterned());
+	for(CScriptVarString **it = &buckets[String->hash & (buckets.size()-1)]; *it; it = &(*it)->nextInterned) {
+		if(*it == String) {
+			*it = String->nextInterned;
+			String->nextInterned = 0;
+			String->varFlags &= ~SCRIPTVAR_STRING_INTERNED;
+			--count;
+			return;
+		}
+	}
+	ASSERT(0); // not in the table
+}
+
+void CScriptStringTable::removeGarbage() {
+	for(vector<CScriptVarString*>::iterator it = buckets.begin(); it != buckets.end(); ++it) {
+		for(CScriptVarString **str = &*it; *str; ) {
+			if(CScriptVarHeap::isGarbage(*str)) {
+				CScriptVarString *garbage = *str;
+				*str = garbage->nextInterned;
+				garbage->nextInterned = 0;
+				garbage->varFlags &= ~SCRIPTVAR_STRING_INTERNED;
+				--count;
+			} else
+				str = &(*str)->nextInterned;
+		}
+	}
+}
+
+void CScriptStringTable::clear() {
+	for(vector<CScriptVarString*>::iterator it = buckets.begin(); it != buckets.end(); ++it) {
+		for(CScriptVarString *next, *str = *it; str; str = next) {
+			next = str->nextInterned;
+			str->nextInterned = 0;
+			str->varFlags &= ~SCRIPTVAR_STRING_INTERNED;
+		}
+	}
+	buckets.clear();
+	count = 0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptStringRef
+//////////////////////////////////////////////////////////////////////////
+
+CScriptStringRef::CScriptStringRef(const CScriptVarPtr &Var) {
+	CScriptVarStringPtr String(Var);
+	if(String) {
+		var = String;
+		ptr = String->getData();
+		len = String->getDataSize();
+	} else {
+		copy = Var->toString();
+		ptr = copy.data();
+		len = copy.size();
+	}
+}
+string CScriptStringRef::substr(size_t Pos/*=0*/, size_t Count/*=npos*/) const {
+	if(Pos > len) throw out_of_range("CScriptStringRef::substr");
+	return string(ptr+Pos, min(Count, len-Pos));
+}
+size_t CScriptStringRef::find(const string &Str, size_t Pos/*=0*/) const {
+	if(Pos > len) return npos;
+	const char *found = search(ptr+Pos, ptr+len, Str.begin(), Str.end());
+	return found == ptr+len && Str.size() ? npos : found-ptr;
+}
+size_t CScriptStringRef::rfind(const string &Str, size_t Pos/*=npos*/) const {
+	if(Str.size() > len) return npos;
+	size_t last = min(Pos, len-Str.size());
+	if(Str.empty()) return last;
+	const char *end = ptr+last+Str.size(), *found = find_end(ptr, end, Str.begin(), Str.end());
+	return found == end ? npos : found-ptr;
+}
+size_t CScriptStringRef::find_first_not_of(const char *Chars, size_t Pos/*=0*/) const {
+	for(; Pos < len; ++Pos)
+		if(!ptr[Pos] || !strchr(Chars, ptr[Pos])) return Pos;
+	return npos;
+}
+size_t CScriptStringRef::find_last_not_of(const char *Chars, size_t Pos/*=npos*/) const {
+	if(!len) return npos;
+	for(Pos = min(Pos, len-1);; --Pos) {
+		if(!ptr[Pos] || !strchr(Chars, ptr[Pos])) return Pos;
+		if(!Pos) return npos;
+	}
+}
+int CScriptStringRef::compare(const string &Str) const {
+	int ret = memcmp(ptr, Str.data(), min(len, Str.size()));
+	if(ret) return ret;
+	return len < Str.size() ? -1 : (len > Str.size() ? 1 : 0);
 }
 
 
@@ -4029,6 +5075,8 @@ CNumber CNumber::operator-() const {
 	case tInt32:
 		if(Int32==0)
 			return CNumber(NegativeZero);
+		if(Int32==numeric_limits<int32_t>::min())
+			return CNumber(-double(Int32)); // prevent integer overflow
 		FALLTHROUGH;
 	case tnNULL:
 		return CNumber(-Int32);
@@ -4402,9 +5450,8 @@ double CNumber::toDouble() const
 /// CScriptVarNumber
 //////////////////////////////////////////////////////////////////////////
 
-CScriptVarNumber::CScriptVarNumber(CTinyJS *Context, const CNumber &Data) : CScriptVarPrimitive(Context, Context->numberPrototype), data(Data) {}
+CScriptVarNumber::CScriptVarNumber(CTinyJS *Context, const CNumber &Data) : CScriptVarPrimitive(Context, Context->numberPrototype), data(Data) { varFlags |= TYPE_TAG_NUMBER; }
 CScriptVarNumber::~CScriptVarNumber() {}
-bool CScriptVarNumber::isNumber() { return true; }
 bool CScriptVarNumber::isInt() { return data.isInt32(); }
 bool CScriptVarNumber::isDouble() { return data.isDouble(); }
 bool CScriptVarNumber::isRealNumber() { return isInt() || isDouble(); }
@@ -4424,7 +5471,7 @@ define_newScriptVar_Fnc(Number, CTinyJS *Context, const CNumber &Obj) {
 		if(Obj.isInfinity()) return Context->constScriptVar(Infinity(Obj.sign()));
 		if(Obj.isNegativeZero()) return Context->constScriptVar(NegativeZero);
 	}
-	return new CScriptVarNumber(Context, Obj);
+	return new(Context) CScriptVarNumber(Context, Obj);
 }
 
 
@@ -4432,9 +5479,8 @@ define_newScriptVar_Fnc(Number, CTinyJS *Context, const CNumber &Obj) {
 // CScriptVarBool
 //////////////////////////////////////////////////////////////////////////
 
-CScriptVarBool::CScriptVarBool(CTinyJS *Context, bool Data) : CScriptVarPrimitive(Context, Context->booleanPrototype), data(Data) {}
+CScriptVarBool::CScriptVarBool(CTinyJS *Context, bool Data) : CScriptVarPrimitive(Context, Context->booleanPrototype), data(Data) { varFlags |= TYPE_TAG_BOOL; }
 CScriptVarBool::~CScriptVarBool() {}
-bool CScriptVarBool::isBool() { return true; }
 
 bool CScriptVarBool::toBoolean() { return data; }
 CNumber CScriptVarBool::toNumber_Callback() { return data?1:0; }
@@ -4449,7 +5495,7 @@ CScriptVarPtr CScriptVarBool::toObject() { return newScriptVar(CScriptVarPrimiti
 //////////////////////////////////////////////////////////////////////////
 
 declare_dummy_t(Object);
-CScriptVarObject::CScriptVarObject(CTinyJS *Context) : CScriptVar(Context, Context->objectPrototype) { }
+CScriptVarObject::CScriptVarObject(CTinyJS *Context) : CScriptVar(Context, Context->objectPrototype) { varFlags |= TYPE_TAG_OBJECT; }
 CScriptVarObject::~CScriptVarObject() {}
 
 void CScriptVarObject::removeAllChildren()
@@ -4459,7 +5505,6 @@ void CScriptVarObject::removeAllChildren()
 }
 
 CScriptVarPrimitivePtr CScriptVarObject::getRawPrimitive() { return value; }
-bool CScriptVarObject::isObject() { return true; }
 
 string CScriptVarObject::getParsableString(const string &indentString, const string &indent, uint32_t uniqueID, bool &hasRecursion) {
 	getParsableStringRecursionsCheckBegin();
@@ -4530,6 +5575,7 @@ string CScriptVarObjectTypeTagged::getVarTypeTagName() { return typeTagName; }
 const char *ERROR_NAME[] = {"Error", "EvalError", "RangeError", "ReferenceError", "SyntaxError", "TypeError"};
 
 CScriptVarError::CScriptVarError(CTinyJS *Context, ERROR_TYPES type, const char *message, const char *file, int line, int column) : CScriptVarObject(Context, Context->getErrorPrototype(type)) {
+	varFlags |= TYPE_TAG_ERROR;
 	if(message && *message) addChild("message", newScriptVar(message));
 	if(file && *file) addChild("fileName", newScriptVar(file));
 	if(line>=0) addChild("lineNumber", newScriptVar(line+1));
@@ -4537,7 +5583,6 @@ CScriptVarError::CScriptVarError(CTinyJS *Context, ERROR_TYPES type, const char
 }
 
 CScriptVarError::~CScriptVarError() {}
-bool CScriptVarError::isError() { return true; }
 
 CScriptVarPtr CScriptVarError::toString_CallBack(CScriptResult &execute, int radix) {
 	CScriptVarLinkPtr link;
@@ -4578,6 +5623,7 @@ CScriptException CScriptVarError::toCScriptException()
 
 declare_dummy_t(Array);
 CScriptVarArray::CScriptVarArray(CTinyJS *Context) : CScriptVarObject(Context, Context->arrayPrototype), toStringRecursion(false) {
+	varFlags |= TYPE_TAG_ARRAY;
 	CScriptVarLinkPtr acc = addChild("length", newScriptVar(0), SCRIPTVARLINK_WRITABLE);
 /*
 	CScriptVarLinkPtr acc = addChild("length", newScriptVar(Accessor), SCRIPTVARLINK_WRITABLE);
@@ -4591,7 +5637,6 @@ CScriptVarArray::CScriptVarArray(CTinyJS *Context) : CScriptVarObject(Context, C
 }
 
 CScriptVarArray::~CScriptVarArray() {}
-bool CScriptVarArray::isArray() { return true; }
 string CScriptVarArray::getParsableString(const string &indentString, const string &indent, uint32_t uniqueID, bool &hasRecursion) {
 	getParsableStringRecursionsCheckBegin();
 	string destination;
@@ -4621,7 +5666,7 @@ CScriptVarPtr CScriptVarArray::toString_CallBack( CScriptResult &execute, int ra
 		uint32_t len = getLength();
 		for (uint32_t i=0;execute && i<len;i++) {
 			CScriptVarLinkWorkPtr element = findChildWithPrototypeChain(int2string(i));
-			if(element && !(element = element.getter(execute))->getVarPtr()->isUndefined() )
+			if(element && !element.getterInPlace(execute)->getVarPtr()->isUndefined() )
 				destination << element->toString(execute);
 			if (i<len-1) destination  << ",";
 		}
@@ -4642,7 +5687,7 @@ void CScriptVarArray::setter(CScriptResult &execute, const CScriptVarLinkPtr &li
 		if((value->toNumber(execute).isUInt32())) {
 			newlen = value->toNumber(execute).toUInt32();
 			if(newlen < link->getVarPtr()->toNumber()) {
-				SCRIPTVAR_CHILDS_it begin = lower_bound(Childs.begin(), Childs.end(), int2string(newlen));
+				SCRIPTVAR_CHILDS_it begin = lower_bound(Childs.begin(), Childs.end(), CScriptVarChildKey(int2string(newlen)));
 				//SCRIPTVAR_CHILDS_it end = Childs.end();
 #if (__cplusplus >= 201103L || _MSVC_LANG >= 201103L || _MSC_VER >= 1600) // Visual Studio? I do not know exactly! 2010 and above ???
 				Childs.erase(begin, Childs.end());
@@ -4673,7 +5718,7 @@ void CScriptVarArray::setter(CScriptResult &execute, const CScriptVarLinkPtr &li
 CScriptVarLinkPtr &CScriptVarArray::getter(CScriptResult &execute, CScriptVarLinkPtr &link) {
 	const std::string &name = link->getName();
 	if (name == "length") {
-		uint32_t len = isArrayIndex(Childs.back()->getName()) + 1;
+		uint32_t len = Childs.back()->getArrayIndex() + 1;
 //		uint32_t val = link->getVarPtr()->toNumber().toUInt32();
 		if (len > link->getVarPtr()->toNumber())
 			link->setVarPtr(newScriptVar(len));
@@ -4685,7 +5730,7 @@ CScriptVarLinkPtr &CScriptVarArray::getter(CScriptResult &execute, CScriptVarLin
 uint32_t CScriptVarArray::getLength() {
 	auto length = findChild("length");
 	if (length) {
-		uint32_t real_len = isArrayIndex(Childs.back()->getName()) + 1;
+		uint32_t real_len = Childs.back()->getArrayIndex() + 1;
 		uint32_t curr_len = length->getVarPtr()->toNumber().toUInt32();
 		if (real_len > curr_len) {
 			length->setVarPtr(newScriptVar(real_len));
@@ -4720,7 +5765,7 @@ void CScriptVarArray::native_setLength(const CFunctionsScopePtr &c, void *data)
 	if(newLen.isUInt32()) {
 		uint32_t len = newLen.toUInt32();
 		if(len < length) {
-			SCRIPTVAR_CHILDS_it it = lower_bound(Childs.begin(), Childs.end(), int2string(len));
+			SCRIPTVAR_CHILDS_it it = lower_bound(Childs.begin(), Childs.end(), CScriptVarChildKey(int2string(len)));
 			Childs.erase(it, Childs.end());
 		}
 		length = len;
@@ -4737,6 +5782,7 @@ void CScriptVarArray::native_setLength(const CFunctionsScopePtr &c, void *data)
 #ifndef NO_REGEXP
 
 CScriptVarRegExp::CScriptVarRegExp(CTinyJS *Context, const string &Regexp, const string &Flags) : CScriptVarObject(Context, Context->regexpPrototype), regexp(Regexp), flags(Flags) {
+	varFlags |= TYPE_TAG_REGEXP;
 	addChild("global", ::newScriptVarAccessor<CScriptVarRegExp>(Context, this, &CScriptVarRegExp::native_Global, 0, 0, 0), 0);
 	addChild("ignoreCase", ::newScriptVarAccessor<CScriptVarRegExp>(Context, this, &CScriptVarRegExp::native_IgnoreCase, 0, 0, 0), 0);
 	addChild("multiline", ::newScriptVarAccessor<CScriptVarRegExp>(Context, this, &CScriptVarRegExp::native_Multiline, 0, 0, 0), 0);
@@ -4745,7 +5791,6 @@ CScriptVarRegExp::CScriptVarRegExp(CTinyJS *Context, const string &Regexp, const
 	addChild("lastIndex", newScriptVar(0));
 }
 CScriptVarRegExp::~CScriptVarRegExp() {}
-bool CScriptVarRegExp::isRegExp() { return true; }
 //int CScriptVarRegExp::getInt() {return strtol(regexp.c_str(),0,0); }
 //bool CScriptVarRegExp::getBool() {return regexp.length()!=0;}
 //double CScriptVarRegExp::getDouble() {return strtod(regexp.c_str(),0);}
@@ -4776,28 +5821,37 @@ unsigned int CScriptVarRegExp::LastIndex() {
 }
 
 CScriptVarPtr CScriptVarRegExp::exec( const string &Input, bool Test /*= false*/ )
+{
+	return exec(CScriptStringRef(Input), Test);
+}
+
+CScriptVarPtr CScriptVarRegExp::exec( const CScriptStringRef &Input, bool Test /*= false*/ )
 {
 	regex::flag_type flags = regex_constants::ECMAScript;
 	if(IgnoreCase()) flags |= regex_constants::icase;
 	bool global = Global(), sticky = Sticky();
 	unsigned int lastIndex = LastIndex();
 	size_t offset = 0;
+	// lastIndex and index are code-units (see CScriptVarString::getLength) - the regex works on bytes
+	CScriptVarStringPtr inputVar(Input.getVar());
+	if(!inputVar) inputVar = newScriptVar(Input.str());
 	if(global || sticky) {
-		if(lastIndex > Input.length()) goto failed;
-		offset=lastIndex;
+		if(lastIndex > inputVar->getLength()) goto failed;
+		offset = inputVar->unitToByte(lastIndex);
 	}
 	{
 		regex_constants::match_flag_type mflag = sticky?regex_constants::match_continuous:regex_constants::match_default;
 		if(offset) mflag |= regex_constants::match_prev_avail;
-		smatch match;
+		cmatch match;
 		if(regex_search(Input.begin()+offset, Input.end(), match, regex(regexp, flags), mflag) ) {
-			addChildOrReplace("lastIndex", newScriptVar(offset+match.position()+match.str().length()));
+			size_t matchOffset = offset+match.position();
+			addChildOrReplace("lastIndex", newScriptVar(inputVar->byteToUnit(matchOffset+match.length())));
 			if(Test) return constScriptVar(true);
 
 			CScriptVarArrayPtr retVar = newScriptVar(Array);
-			retVar->addChild("input", newScriptVar(Input));
-			retVar->addChild("index", newScriptVar(match.position()));
-			for(smatch::size_type idx=0; idx<match.size(); idx++)
+			retVar->addChild("input", inputVar);
+			retVar->addChild("index", newScriptVar(inputVar->byteToUnit(matchOffset)));
+			for(cmatch::size_type idx=0; idx<match.size(); idx++)
 				retVar->addChild(int2string(idx), newScriptVar(match[idx].str()));
 			return retVar;
 		}
@@ -4839,24 +5893,24 @@ const char * CScriptVarRegExp::ErrorStr( int Error )
 //declare_dummy_t(DefaultIterator);
 CScriptVarDefaultIterator::CScriptVarDefaultIterator(CTinyJS *Context, const CScriptVarPtr &Object, IteratorMode Mode)
 	: CScriptVarObject(Context, Context->iteratorPrototype), mode(Mode), object(Object) {
+	varFlags |= TYPE_TAG_ITERATOR;
 	object->keys(keys, true);
 	pos = keys.begin();
 	addChild("next", ::newScriptVar(context, this, &CScriptVarDefaultIterator::native_next, 0));
 }
 CScriptVarDefaultIterator::~CScriptVarDefaultIterator() {}
-bool CScriptVarDefaultIterator::isIterator()		{return true;}
 void CScriptVarDefaultIterator::native_next(const CFunctionsScopePtr &c, void *data) {
 	if(pos==keys.end()) throw constScriptVar(StopIteration);
-	pos++;
+	const string &key = *pos++;
 	if(mode==RETURN_ARRAY) {
 		CScriptVarArrayPtr arr = newScriptVar(Array);
-		arr->setArrayElement(0, newScriptVar(*pos));
-		arr->setArrayElement(1, object->getOwnProperty(*pos));
+		arr->setArrayElement(0, newScriptVar(key));
+		arr->setArrayElement(1, object->getOwnProperty(key));
 		c->setReturnVar(arr);
 	} else if(mode==RETURN_KEY)
-		c->setReturnVar(newScriptVar(*pos));
+		c->setReturnVar(context->internString(key));
 	else
-		c->setReturnVar(object->getOwnProperty(*pos));
+		c->setReturnVar(object->getOwnProperty(key));
 }
 
 
@@ -4874,6 +5928,7 @@ CScriptVarGenerator::CScriptVarGenerator(CTinyJS *Context, const CScriptVarPtr &
 	: CScriptVarObject(Context, Context->generatorPrototype), functionRoot(FunctionRoot), function(Function),
 	closed(false), yieldVarIsException(false), coroutine(this), 
 	callersStackBase(nullptr), callersScopeSize(0) , callersTokenizer(nullptr), callersHaveTry(false) {
+	varFlags |= TYPE_TAG_GENERATOR;
 //		addChild("next", ::newScriptVar(context, this, &CScriptVarGenerator::native_send, 0, "Generator.next"));
 	//	addChild("send", ::newScriptVar(context, this, &CScriptVarGenerator::native_send, (void*)1, "Generator.send"));
 		//addChild("close", ::newScriptVar(context, this, &CScriptVarGenerator::native_throw, (void*)0, "Generator.close"));
@@ -4891,8 +5946,6 @@ CScriptVarGenerator::~CScriptVarGenerator() {
 		coroutine.Stop();
 	}
 }
-bool CScriptVarGenerator::isIterator()		{return true;}
-bool CScriptVarGenerator::isGenerator()	{return true;}
 
 string CScriptVarGenerator::getVarType() { return "generator"; }
 string CScriptVarGenerator::getVarTypeTagName() { return "Generator"; }
@@ -4985,12 +6038,10 @@ CScriptVarPtr CScriptVarGenerator::yield( CScriptResult &execute, CScriptVar *Yi
 //////////////////////////////////////////////////////////////////////////
 
 CScriptVarFunction::CScriptVarFunction(CTinyJS *Context, CScriptTokenDataFnc *Data) : CScriptVarObject(Context, Context->functionPrototype), data(0) {
+	varFlags |= TYPE_TAG_FUNCTION;
 	setFunctionData(Data);
 }
 CScriptVarFunction::~CScriptVarFunction() { if(data) data->unref(); }
-bool CScriptVarFunction::isObject() { return true; }
-bool CScriptVarFunction::isFunction() { return true; }
-bool CScriptVarFunction::isPrimitive()	{ return false; }
 
 //string CScriptVarFunction::getString() {return "[ Function ]";}
 string CScriptVarFunction::getVarType() { return "function"; }
@@ -5057,15 +6108,15 @@ void CScriptVarFunction::setFunctionData(CScriptTokenDataFnc *Data) {
 /// CScriptVarFunctionBounded
 //////////////////////////////////////////////////////////////////////////
 
-CScriptVarFunctionBounded::CScriptVarFunctionBounded(CScriptVarFunctionPtr BoundedFunction, CScriptVarPtr BoundedThis, const vector<CScriptVarPtr> &BoundedArguments)
+CScriptVarFunctionBounded::CScriptVarFunctionBounded(const CScriptVarFunctionPtr &BoundedFunction, const CScriptVarPtr &BoundedThis, const vector<CScriptVarPtr> &BoundedArguments)
 	: CScriptVarFunction(BoundedFunction->getContext(), new CScriptTokenDataFnc(LEX_R_FUNCTION)) ,
 	boundedFunction(BoundedFunction),
 	boundedThis(BoundedThis),
 	boundedArguments(BoundedArguments) {
+	varFlags |= TYPE_TAG_FUNCTION_BOUNDED;
 		getFunctionData()->name = BoundedFunction->getFunctionData()->name;
 }
 CScriptVarFunctionBounded::~CScriptVarFunctionBounded(){}
-bool CScriptVarFunctionBounded::isBounded() { return true; }
 void CScriptVarFunctionBounded::setTemporaryMark_recursive(uint32_t ID) {
 	CScriptVarFunction::setTemporaryMark_recursive(ID);
 	boundedThis->setTemporaryMark_recursive(ID);
@@ -5086,6 +6137,7 @@ CScriptVarPtr CScriptVarFunctionBounded::callFunction( CScriptResult &execute, v
 //////////////////////////////////////////////////////////////////////////
 
 CScriptVarFunctionNative::CScriptVarFunctionNative(CTinyJS *Context, void *Userdata, const char *Name, const char *Args) : CScriptVarFunction(Context, 0), jsUserData(Userdata) {
+	varFlags |= TYPE_TAG_FUNCTION_NATIVE;
 	CScriptTokenDataPtr<CScriptTokenDataFnc> FncData(*new CScriptTokenDataFnc(LEX_R_FUNCTION));
 	if (Name) FncData->name = Name;
 	if (Args) {
@@ -5106,7 +6158,6 @@ CScriptVarFunctionNative::CScriptVarFunctionNative(CTinyJS *Context, void *Userd
 	setFunctionData(FncData.operator->());
 }
 CScriptVarFunctionNative::~CScriptVarFunctionNative() {}
-bool CScriptVarFunctionNative::isNative() { return true; }
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -5117,15 +6168,32 @@ CScriptVarFunctionNativeCallback::~CScriptVarFunctionNativeCallback() {}
 void CScriptVarFunctionNativeCallback::callFunction(const CFunctionsScopePtr &c) { jsCallback(c, jsUserData); }
 
 
+//////////////////////////////////////////////////////////////////////////
+/// CScriptVarFunctionNativeDirect
+//////////////////////////////////////////////////////////////////////////
+
+CScriptVarFunctionNativeDirect::~CScriptVarFunctionNativeDirect() {}
+void CScriptVarFunctionNativeDirect::callFunction(const CFunctionsScopePtr &c) {
+	vector<CScriptVarPtr> Arguments;
+	for(uint32_t i = 0, length = c->getArgumentsLength(); i < length; ++i)
+		Arguments.push_back(c->getArgument(i));
+	c->setReturnVar(callDirect(c->getArgument("this"), Arguments));
+}
+void CScriptVarFunctionNativeDirect::throwError(ERROR_TYPES ErrorType, const string &message) {
+	throw newScriptVarError(context, ErrorType, message.c_str());
+}
+
+
 //////////////////////////////////////////////////////////////////////////
 /// CScriptVarAccessor
 //////////////////////////////////////////////////////////////////////////
 
 declare_dummy_t(Accessor);
-CScriptVarAccessor::CScriptVarAccessor(CTinyJS *Context) : CScriptVarObject(Context, Context->objectPrototype) { }
+CScriptVarAccessor::CScriptVarAccessor(CTinyJS *Context) : CScriptVarObject(Context, Context->objectPrototype) { varFlags |= TYPE_TAG_ACCESSOR; }
 CScriptVarAccessor::CScriptVarAccessor(CTinyJS *Context, JSCallback getterFnc, void *getterData, JSCallback setterFnc, void *setterData)
 	: CScriptVarObject(Context)
 {
+	varFlags |= TYPE_TAG_ACCESSOR;
 	if(getterFnc)
 		addChild(TINYJS_ACCESSOR_GET_VAR, ::newScriptVar(Context, getterFnc, getterData), 0);
 	if(setterFnc)
@@ -5133,6 +6201,7 @@ CScriptVarAccessor::CScriptVarAccessor(CTinyJS *Context, JSCallback getterFnc, v
 }
 
 CScriptVarAccessor::CScriptVarAccessor( CTinyJS *Context, const CScriptVarFunctionPtr &getter, const CScriptVarFunctionPtr &setter) : CScriptVarObject(Context, Context->objectPrototype) {
+	varFlags |= TYPE_TAG_ACCESSOR;
 	if(getter)
 		addChild(TINYJS_ACCESSOR_GET_VAR, getter, 0);
 	if(setter)
@@ -5140,8 +6209,6 @@ CScriptVarAccessor::CScriptVarAccessor( CTinyJS *Context, const CScriptVarFuncti
 }
 
 CScriptVarAccessor::~CScriptVarAccessor() {}
-bool CScriptVarAccessor::isAccessor() { return true; }
-bool CScriptVarAccessor::isPrimitive()	{ return false; }
 string CScriptVarAccessor::getParsableString(const string &indentString, const string &indent, uint32_t uniqueID, bool &hasRecursion) {
 	getParsableStringRecursionsCheckBegin();
 	string destination;
@@ -5162,7 +6229,6 @@ string CScriptVarAccessor::getVarType() { return "accessor"; }
 
 declare_dummy_t(Scope);
 CScriptVarScope::~CScriptVarScope() {}
-bool CScriptVarScope::isObject() { return false; }
 CScriptVarPtr CScriptVarScope::scopeVar() { return this; }	///< to create var like: var a = ...
 CScriptVarPtr CScriptVarScope::scopeLet() { return this; }	///< to create var like: let a = ...
 CScriptVarLinkWorkPtr CScriptVarScope::findInScopes(const string &childName) {
@@ -5177,9 +6243,20 @@ CScriptVarScopePtr CScriptVarScope::getParent() { return CScriptVarScopePtr(); }
 
 declare_dummy_t(ScopeFnc);
 CScriptVarScopeFnc::~CScriptVarScopeFnc() {}
+void CScriptVarScopeFnc::reset(const CScriptVarScopePtr &Closure) {
+	removeAllChildren();
+	closure = Closure ? addChild(TINYJS_FUNCTION_CLOSURE_VAR, Closure, 0) : CScriptVarLinkPtr();
+	lazyFunctions = CScriptTokenDataForwardsPtr();
+}
 CScriptVarLinkWorkPtr CScriptVarScopeFnc::findInScopes(const string &childName) {
+	return findInScopes(childName, this);
+}
+CScriptVarLinkWorkPtr CScriptVarScopeFnc::findInScopes(const string &childName, const CScriptVarPtr &LazyClosure) {
 	CScriptVarLinkWorkPtr ret = findChild(childName);
-	if( !ret ) {
+	if(ret) {
+		if(lazyFunctions && ret->getVarPtr() == context->constLazyFunction)
+			ret->setVarPtr(context->newHoistedFunction(*lazyFunctions->findVarBinding(childName)->function, LazyClosure));
+	} else {
 		if(closure) ret = CScriptVarScopePtr(closure)->findInScopes(childName);
 		else ret = context->getRoot()->findChild(childName);
 	}
@@ -5223,13 +6300,13 @@ void CScriptVarScopeFnc::throwError( ERROR_TYPES ErrorType, const char *message
 }
 
 
-void CScriptVarScopeFnc::assign(CScriptVarLinkWorkPtr &lhs, CScriptVarPtr rhs, bool ignoreReadOnly/*=false*/, bool ignoreNotOwned/*=false*/, bool ignoreNotExtensible/*=false*/)
+void CScriptVarScopeFnc::assign(CScriptVarLinkWorkPtr &lhs, const CScriptVarPtr &rhs, bool ignoreReadOnly/*=false*/, bool ignoreNotOwned/*=false*/, bool ignoreNotExtensible/*=false*/)
 {
 	if (!lhs->isOwned() && !lhs.hasReferencedOwner() && lhs->getName().empty()) {
 		if(ignoreNotOwned) return;
 		throwError(ReferenceError, "invalid assignment left-hand side (at runtime)");
 	} else if(lhs->isWritable()) {
-		if (!lhs->isOwned()) {
+		if (!lhs->isOwned() && !lhs.isInheritedAccessor()) {
 			CScriptVarPtr fakedOwner = lhs.getReferencedOwner();
 			if(fakedOwner) {
 				if(!fakedOwner->isExtensible()) {
@@ -5251,7 +6328,7 @@ void CScriptVarScopeFnc::setProperty(CScriptVarLinkWorkPtr &lhs, const CScriptVa
 		if(ignoreNotOwned) return;
 		throw newScriptVarError(context, ReferenceError, "invalid assignment left-hand side (at runtime)");
 	} else if(lhs->isWritable()) {
-		if (!lhs->isOwned()) {
+		if (!lhs->isOwned() && !lhs.isInheritedAccessor()) {
 			CScriptVarPtr fakedOwner = lhs.getReferencedOwner();
 			if(fakedOwner) {
 				if(!fakedOwner->isExtensible()) {
@@ -5274,7 +6351,7 @@ void CScriptVarScopeFnc::setProperty(CScriptVarLinkWorkPtr &lhs, const CScriptVa
 declare_dummy_t(ScopeLet);
 CScriptVarScopeLet::CScriptVarScopeLet(const CScriptVarScopePtr &Parent) // constructor for LetScope
 	: CScriptVarScope(Parent->getContext()), parent(addChild(TINYJS_SCOPE_PARENT_VAR, Parent, 0))
-	, letExpressionInitMode(false) {}
+	, letExpressionInitMode(false), lazyFunctionsClosure(false) { varFlags |= TYPE_TAG_SCOPE_LET; }
 
 CScriptVarScopeLet::~CScriptVarScopeLet() {}
 CScriptVarPtr CScriptVarScopeLet::scopeVar() {						// to create var like: var a = ...
@@ -5287,7 +6364,12 @@ CScriptVarLinkWorkPtr CScriptVarScopeLet::findInScopes(const string &childName)
 		return getParent()->findInScopes(childName);
 	} else {
 		ret = findChild(childName);
-		if( !ret ) ret = getParent()->findInScopes(childName);
+		if( !ret ) {
+			if(lazyFunctionsClosure)
+				ret = static_cast<CScriptVarScopeFnc*>(parent->getVarPtr().getVar())->findInScopes(childName, this);
+			else
+				ret = getParent()->findInScopes(childName);
+		}
 	}
 	return ret;
 }
@@ -5317,6 +6399,25 @@ CScriptVarLinkWorkPtr CScriptVarScopeWith::findInScopes(const string &childName)
 }
 
 
+//////////////////////////////////////////////////////////////////////////
+/// CScriptRandom
+//////////////////////////////////////////////////////////////////////////
+
+CScriptRandom::CScriptRandom() {
+	seed(uint64_t(time(0)) * 1000003u ^ uint64_t(clock()) ^ uint64_t(uintptr_t(this)));
+}
+
+void CScriptRandom::seed(uint64_t Seed) {
+	// the state is expanded with splitmix64 (the state must not be all zero)
+	for(int i=0; i<4; ++i) {
+		uint64_t z = (Seed += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		state[i] = z ^ (z >> 31);
+	}
+}
+
+
 //////////////////////////////////////////////////////////////////////////
 /// CTinyJS
 //////////////////////////////////////////////////////////////////////////
@@ -5325,6 +6426,7 @@ extern "C" void _registerFunctions(CTinyJS *tinyJS);
 extern "C" void _registerStringFunctions(CTinyJS *tinyJS);
 extern "C" void _registerMathFunctions(CTinyJS *tinyJS);
 extern "C" void _registerDateFunctions(CTinyJS *tinyJS);
+extern "C" void _registerConsoleFunctions(CTinyJS *tinyJS);
 
 // replace any_function.prototype
 static void replacePrototype(const CScriptVarPtr &var, const CScriptVarPtr &prototype) {
@@ -5343,10 +6445,21 @@ CTinyJS::CTinyJS() {
 	CScriptVarLinkPtr link;
 	t = 0;
 	haveTry = false;
-	first = 0;
 	uniqueID = 0;
 	currentMarkSlot = -1;
 	stackBase = 0;
+	typeFeedback = 0;
+	allocationProfiler = 0;
+#ifndef NO_THREADING
+	watchdog = 0;
+	watchdogFlag = false;
+	evaluationStart = 0;
+	evaluationDepth = 0;
+#endif
+	consoleSink = defaultConsoleSink = 0;
+#ifndef NO_JIT
+	jitThreshold = 100;
+#endif
 
 
 	//////////////////////////////////////////////////////////////////////////
@@ -5440,8 +6553,8 @@ CTinyJS::CTinyJS() {
 	var->addChild("EPSILON", newScriptVarNumber(this, numeric_limits<double>::epsilon()), SCRIPTVARLINK_CONSTANT);
 	var->addChild("MAX_VALUE", newScriptVarNumber(this, numeric_limits<double>::max()), SCRIPTVARLINK_CONSTANT);
 	var->addChild("MIN_VALUE", newScriptVarNumber(this, numeric_limits<double>::min()), SCRIPTVARLINK_CONSTANT);
-	var->addChild("MAX_SAFE_INTEGER", newScriptVarNumber(this, (1LL << numeric_limits<double>::digits)-1), SCRIPTVARLINK_CONSTANT);
-	var->addChild("MIN_SAFE_INTEGER", newScriptVarNumber(this, 1-(1LL << numeric_limits<double>::digits)), SCRIPTVARLINK_CONSTANT);
+	var->addChild("MAX_SAFE_INTEGER", newScriptVarNumber(this, int64_t((1LL << numeric_limits<double>::digits)-1)), SCRIPTVARLINK_CONSTANT);
+	var->addChild("MIN_SAFE_INTEGER", newScriptVarNumber(this, int64_t(1-(1LL << numeric_limits<double>::digits))), SCRIPTVARLINK_CONSTANT);
 	var->addChild("NaN", constNaN = newScriptVarNumber(this, NaN), SCRIPTVARLINK_CONSTANT);
 	var->addChild("POSITIVE_INFINITY", constInfinityPositive = newScriptVarNumber(this, InfinityPositive), SCRIPTVARLINK_CONSTANT);
 	var->addChild("NEGATIVE_INFINITY", constInfinityNegative = newScriptVarNumber(this, InfinityNegative), SCRIPTVARLINK_CONSTANT);
@@ -5550,6 +6663,7 @@ CTinyJS::CTinyJS() {
 	root->addChild("Infinity", constInfinityPositive, SCRIPTVARLINK_CONSTANT);
 	root->addChild("StopIteration", constStopIteration=newScriptVar(Object, var=newScriptVar(Object), "StopIteration"), SCRIPTVARLINK_CONSTANT);
 	constStopIteration->addChild(TINYJS_PROTOTYPE_CLASS, var, SCRIPTVARLINK_CONSTANT);	pseudo_refered.push_back(&constStopIteration);
+	constLazyFunction = newScriptVar(Object);	pseudo_refered.push_back(&constLazyFunction);
 	constNegativZero	= newScriptVarNumber(this, NegativeZero);	pseudo_refered.push_back(&constNegativZero);
 	constFalse	= newScriptVarBool(this, false);	pseudo_refered.push_back(&constFalse);
 	constTrue	= newScriptVarBool(this, true);	pseudo_refered.push_back(&constTrue);
@@ -5558,7 +6672,8 @@ CTinyJS::CTinyJS() {
 	// add global functions
 	addNative("function eval(jsCode)", this, &CTinyJS::native_eval);
 	native_require_read = 0;
-	addNative("function require(jsFile)", this, &CTinyJS::native_require);
+	addNative("function require(jsFile)", this, &CTinyJS::native_require)->addChild("cache", moduleCache = newScriptVar(Object), SCRIPTVARLINK_CONSTANT);
+	pseudo_refered.push_back(&moduleCache);
 	addNative("function isNaN(objc)", this, &CTinyJS::native_isNAN);
 	addNative("function isFinite(objc)", this, &CTinyJS::native_isFinite);
 	addNative("function parseInt(string, radix)", this, &CTinyJS::native_parseInt);
@@ -5571,10 +6686,16 @@ CTinyJS::CTinyJS() {
 	_registerStringFunctions(this);
 	_registerMathFunctions(this);
 	_registerDateFunctions(this);
+	_registerConsoleFunctions(this);
 }
 
 CTinyJS::~CTinyJS() {
 	ASSERT(!t);
+#ifndef NO_THREADING
+	CScriptWatchdog::unwatchContext(this);
+#endif
+	flushConsole();
+	delete defaultConsoleSink;
 //	objectPrototype->setPrototype(0);
 	for (vector<CScriptVarPtr*>::iterator it = pseudo_refered.begin(); it != pseudo_refered.end(); ++it) {
 		(**it)->cleanUp4Destroy();
@@ -5586,9 +6707,14 @@ CTinyJS::~CTinyJS() {
 	scopes.clear();
 	ClearUnreferedVars();
 	root = CScriptVarPtr();
+	heap.sweep();
+	setAllocationProfiler(0); // leaked vars must not stay live samples
+	internedStrings.clear(); // leaked strings must not remove themselves from the destroyed table
 #ifdef _DEBUG
-	for(CScriptVar *p = first; p; p=p->next)
-		printf("%p (%s) %s ID=%u\n", p, typeid(*p).name(), p->getParsableString().c_str(), p->debugID);
+	vector<CScriptVar*> vars;
+	heap.getVars(vars);
+	for(vector<CScriptVar*>::iterator it = vars.begin(); it != vars.end(); ++it)
+		printf("%p (%s) %s ID=%u\n", *it, typeid(**it).name(), (*it)->getParsableString().c_str(), (*it)->debugID);
 #endif
 #if DEBUG_MEMORY
 	show_allocated();
@@ -5627,6 +6753,135 @@ void CTinyJS::trace() {
 	root->trace();
 }
 
+// a frame of the stacks recorded by the allocation-profiler and the watchdog
+static string callFrameName(CScriptTokenDataFnc *Fnc) {
+	return (Fnc->name.size() ? Fnc->name : "(anonymous)") + "@" + Fnc->file + ":" + int2string(Fnc->line);
+}
+
+#ifndef NO_THREADING
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptWatchdog
+//////////////////////////////////////////////////////////////////////////
+
+// a monotonic time in ms
+static int64_t watchdogTime() {
+	return int64_t(chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/// the outermost evaluation from the host is watched
+class CEvaluationControl {
+public:
+	CEvaluationControl(CTinyJS *Context) : context(Context) {
+		if(context->evaluationDepth++ == 0) context->evaluationStart = max(watchdogTime(), int64_t(1));
+	}
+	~CEvaluationControl() {
+		if(--context->evaluationDepth == 0) {
+			context->evaluationStart = 0;
+			context->watchdogFlag = false;
+		}
+	}
+private:
+	CTinyJS *context;
+};
+
+CScriptWatchdog::CScriptWatchdog(uint32_t Threshold/*=100*/, bool Interrupt/*=false*/) : threshold(Threshold), interrupt(Interrupt) {
+	Run();
+}
+// guards CTinyJS::watchdog of all contexts and the calls of report
+// locked before the mutex of a watchdog
+static CScriptMutex &watchdogsMutex() {
+	static CScriptMutex mutex;
+	return mutex;
+}
+CScriptWatchdog::~CScriptWatchdog() {
+	{
+		CScriptUniqueLock<CScriptMutex> watchdogsLock(watchdogsMutex());
+		CScriptUniqueLock<CScriptMutex> lock(mutex);
+		for(map<CTinyJS*, int64_t>::iterator it = contexts.begin(); it != contexts.end(); ++it)
+			it->first->watchdog = 0;
+		contexts.clear();
+	}
+	Stop();
+}
+void CScriptWatchdog::watch(CTinyJS *Context) {
+	CScriptUniqueLock<CScriptMutex> watchdogsLock(watchdogsMutex());
+	if(Context->watchdog && Context->watchdog != this) Context->watchdog->remove(Context);
+	CScriptUniqueLock<CScriptMutex> lock(mutex);
+	Context->watchdog = this;
+	contexts[Context] = 0;
+}
+void CScriptWatchdog::unwatch(CTinyJS *Context) {
+	CScriptUniqueLock<CScriptMutex> watchdogsLock(watchdogsMutex());
+	remove(Context);
+}
+void CScriptWatchdog::unwatchContext(CTinyJS *Context) {
+	CScriptUniqueLock<CScriptMutex> watchdogsLock(watchdogsMutex());
+	if(Context->watchdog) Context->watchdog->remove(Context);
+}
+void CScriptWatchdog::remove(CTinyJS *Context) {
+	CScriptUniqueLock<CScriptMutex> lock(mutex);
+	if(contexts.erase(Context)) Context->watchdog = 0;
+}
+void CScriptWatchdog::report(const REPORT &Report) {
+	fprintf(stderr, "%s\n", Report.toJSON().c_str());
+}
+int CScriptWatchdog::ThreadFnc() {
+	// the contexts are checked 4 times per threshold
+	unsigned tick = max(threshold/4, uint32_t(1));
+	while(isActiv()) {
+		CScriptThread::sleep(tick);
+		int64_t now = watchdogTime();
+		CScriptUniqueLock<CScriptMutex> lock(mutex);
+		for(map<CTinyJS*, int64_t>::iterator it = contexts.begin(); it != contexts.end(); ++it) {
+			int64_t start = it->first->evaluationStart;
+			if(start && start != it->second && now - start >= threshold) {
+				it->second = start; // one report per evaluation
+				it->first->watchdogFlag = true;
+			}
+		}
+	}
+	return 0;
+}
+
+string CScriptWatchdog::REPORT::toJSON() const {
+	ostringstream out;
+	out << "{\"watchdog\":{\"elapsed\":" << elapsed << ",\"file\":" << getJSString(file) << ",\"line\":" << line
+		<< ",\"column\":" << column << ",\"stack\":[";
+	for(vector<string>::const_iterator it = stack.begin(); it != stack.end(); ++it)
+		out << (it == stack.begin() ? "" : ",") << getJSString(*it);
+	out << "],\"scopes\":" << scopes << ",\"heapBytes\":" << heapBytes << ",\"interrupted\":" << (interrupted ? "true" : "false") << "}}";
+	return out.str();
+}
+
+void CTinyJS::watchdogSafePoint() {
+	watchdogFlag = false;
+	if(!evaluationStart) return;
+	CScriptWatchdog::REPORT report;
+	report.elapsed = uint32_t(watchdogTime() - evaluationStart);
+	report.file = t->currentFile;
+	// synthetic tokens (e.g. LEX_T_SKIP) have no position - the position of the following token is used
+	CScriptTokenizer::ScriptTokenPosition &pos = t->getPos();
+	TOKEN_VECT_it it = pos.pos;
+	for(int i = 0; i < 4 && it+1 != pos.tokens->end() && it->line == 0 && it->column == 0; ++i) ++it;
+	report.line = it->line;
+	report.column = it->column;
+	for(vector<CScriptTokenDataFnc*>::reverse_iterator it = callFrames.rbegin(); it != callFrames.rend(); ++it)
+		report.stack.push_back(callFrameName(*it));
+	report.scopes = scopes.size();
+	report.heapBytes = heap.pagesCount() * CScriptVarHeap::PAGE_SIZE;
+	{
+		CScriptUniqueLock<CScriptMutex> watchdogsLock(watchdogsMutex());
+		if(!watchdog) return; // unwatched in the meantime
+		report.interrupted = watchdog->interrupt;
+		watchdog->report(report);
+	}
+	if(report.interrupted)
+		throw CScriptInterruptException("evaluation interrupted by the watchdog after " + int2string(report.elapsed) + "ms", t->currentFile, t->currentLine(), t->currentColumn());
+}
+
+#endif // NO_THREADING
+
 void CTinyJS::execute(CScriptTokenizer &Tokenizer) {
 	evaluateComplex(Tokenizer);
 }
@@ -5640,6 +6895,12 @@ void CTinyJS::execute(const string &Code, const string &File, int Line, int Colu
 }
 
 CScriptVarLinkPtr CTinyJS::evaluateComplex(CScriptTokenizer &Tokenizer) {
+#ifndef NO_THREADING
+	CEvaluationControl EvaluationControl(this);
+#endif
+	bool storeFeedback = typeFeedback && typeFeedback != &Tokenizer.typeFeedback && Tokenizer.sourceFile.size();
+	if(storeFeedback && !typeFeedback->hasFile(Tokenizer.sourceFile))
+		typeFeedback->merge(Tokenizer.typeFeedback, Tokenizer.sourceFile); // the feedback of the previous runs
 	t = &Tokenizer;
 	CScriptResult execute;
 	try {
@@ -5653,15 +6914,23 @@ CScriptVarLinkPtr CTinyJS::evaluateComplex(CScriptTokenizer &Tokenizer) {
 		throw; //
 	}
 	t=0;
+	if(storeFeedback) {
+		Tokenizer.typeFeedback.clear();
+		Tokenizer.typeFeedback.merge(*typeFeedback, Tokenizer.sourceFile);
+		if(CScriptTokenizer::writeCompiledTokens)
+			Tokenizer.serialize(Tokenizer.sourceFile+'c', nothrow);
+	}
 	ClearUnreferedVars(execute.value);
 
 	uint32_t UniqueID = allocUniqueID();
 	setTemporaryID_recursive(UniqueID);
 	if(execute.value) execute.value->setTemporaryMark_recursive(UniqueID);
-	for(CScriptVar *p = first; p; p=p->next)
+	vector<CScriptVar*> vars;
+	heap.getVars(vars);
+	for(vector<CScriptVar*>::iterator it = vars.begin(); it != vars.end(); ++it)
 	{
-		if(p->getTemporaryMark() != UniqueID)
-			printf("%s %p\n", p->getVarType().c_str(), p);
+		if((*it)->getTemporaryMark() != UniqueID)
+			printf("%s %p\n", (*it)->getVarType().c_str(), *it);
 	}
 	freeUniqueID();
 
@@ -5726,6 +6995,38 @@ CScriptVarLinkWorkPtr CTinyJS::parseFunctionDefinition(const CScriptToken &FncTo
 		funcVar->getVarPtr()->addChild(TINYJS_FUNCTION_CLOSURE_VAR, scope(), 0);
 	return funcVar;
 }
+CScriptVarPtr CTinyJS::newHoistedFunction(const CScriptToken &FncToken, const CScriptVarPtr &Closure) {
+	CScriptVarPtr funcVar = newScriptVar((CScriptTokenDataFnc*)&FncToken.Fnc());
+	if(Closure != root)
+		funcVar->addChild(TINYJS_FUNCTION_CLOSURE_VAR, Closure, 0);
+	return funcVar;
+}
+
+static bool child_less(const CScriptVarLinkPtr &lhs, const CScriptVarLinkPtr &rhs) {
+	uint32_t lhsIdx = lhs->getArrayIndex(), rhsIdx = rhs->getArrayIndex();
+	if(lhsIdx == uint32_t(-1)) return rhsIdx != uint32_t(-1) || lhs->getName() < rhs->getName();
+	return rhsIdx != uint32_t(-1) && lhsIdx < rhsIdx;
+}
+// adds the bindings of a forwarder to Scope - the missing childs are inserted with one merge
+// existing childs keep their values, only functions are replaced
+// with LazyFunctions the functions are created by the first lookup (see CScriptVarScopeFnc::findInScopes)
+void CTinyJS::installBindings(const CScriptVarPtr &Scope, const CScriptTokenDataForwards::BINDINGS_t &Bindings, bool LazyFunctions) {
+	if(Bindings.empty()) return;
+	vector<CScriptVarLinkPtr> added;
+	added.reserve(Bindings.size());
+	SCRIPTVAR_CHILDS_it child = Scope->Childs.begin(), end = Scope->Childs.end();
+	for(CScriptTokenDataForwards::BINDINGS_t::const_iterator it = Bindings.begin(); it != Bindings.end(); ++it) {
+		child = lower_bound(child, end, CScriptVarChildKey(it->name));
+		const CScriptVarPtr &value = !it->function ? constUndefined : LazyFunctions ? constLazyFunction : newHoistedFunction(*it->function, scope());
+		if(child != end && (*child)->getName() == it->name) {
+			if(it->function) (*child)->setVarPtr(value);
+		} else {
+			added.push_back(CScriptVarLinkPtr(value, it->name, it->flags));
+			added.back()->setOwner(Scope.getVar());
+		}
+	}
+	if(added.size()) Scope->Childs.merge(&added[0], added.size(), child_less);
+}
 
 CScriptVarLinkWorkPtr CTinyJS::parseFunctionsBodyFromString(const string &ArgumentList, const string &FncBody) {
 	string Fnc = "function ("+ArgumentList+"){"+FncBody+"}";
@@ -5733,124 +7034,305 @@ CScriptVarLinkWorkPtr CTinyJS::parseFunctionsBodyFromString(const string &Argume
 	return parseFunctionDefinition(tokenizer.getToken());
 }
 CScriptVarPtr CTinyJS::callFunction(const CScriptVarFunctionPtr &Function, vector<CScriptVarPtr> &Arguments, const CScriptVarPtr &This, CScriptVarPtr *newThis) {
+#ifndef NO_THREADING
+	CEvaluationControl EvaluationControl(this);
+#endif
 	CScriptResult execute;
 	CScriptVarPtr retVar = callFunction(execute, Function, Arguments, This, newThis);
 	execute.cThrow();
 	return retVar;
 }
 
-CScriptVarPtr CTinyJS::callFunction(CScriptResult &execute, const CScriptVarFunctionPtr &Function, vector<CScriptVarPtr> &Arguments, const CScriptVarPtr &This, CScriptVarPtr *newThis) {
-	ASSERT(Function && Function->isFunction());
+// a value thrown by a native function becomes a script exception if there is a try otherwise a CScriptException
+void CTinyJS::nativeException(CScriptResult &execute, const CScriptVarPtr &v, const string &Name) {
+	if(haveTry) {
+		execute.setThrow(v, "native function '"+Name+"'");
+	} else if(v->isError()) {
+		CScriptException err = CScriptVarErrorPtr(v)->toCScriptException();
+		if(err.fileName.empty()) err.fileName = "native function '"+Name+"'";
+		throw err;
+	}
+	else
+		throw CScriptException(Error, "uncaught exception: '"+v->toString(execute)+"' in native function '"+Name+"'");
+}
 
-	if(Function->isBounded()) return CScriptVarFunctionBoundedPtr(Function)->callFunction(execute, Arguments, This, newThis);
+/// the called function is a frame of the stacks recorded by the allocation-profiler and the watchdog
+class CCallFrameControl {
+public:
+	CCallFrameControl(CTinyJS *Context, CScriptTokenDataFnc *Fnc) : frames(Context->callFrames) { frames.push_back(Fnc); }
+	~CCallFrameControl() { frames.pop_back(); }
+private:
+	vector<CScriptTokenDataFnc*> &frames;
+};
 
-	CScriptTokenDataFnc *Fnc = Function->getFunctionData();
-	CScriptVarScopeFncPtr functionRoot(::newScriptVar(this, ScopeFnc, CScriptVarPtr(Function->findChild(TINYJS_FUNCTION_CLOSURE_VAR))));
-	if(Fnc->name.size()) functionRoot->addChild(Fnc->name, Function);
-	if(!Fnc->isArrowFunction()) {
-		// arrow functions get this from closure
-		if(This)
-			functionRoot->addChild("this", This);
-		else
-			functionRoot->addChild("this", root); // if no this given use root
-	}
-	CScriptVarPtr arguments = functionRoot->addChild(TINYJS_ARGUMENTS_VAR, newScriptVar(Object));
+void CTinyJS::setAllocationProfiler(CScriptAllocationProfiler *Profiler) {
+	if(allocationProfiler && allocationProfiler != Profiler) allocationProfiler->detach(this);
+	allocationProfiler = Profiler;
+}
 
-	CScopeControl ScopeControl(this);
-	CScriptVarPtr tmpArgsScope = ScopeControl.addLetScope();
+void CTinyJS::recordAllocation(const void *Var, size_t Size) {
+	ostringstream stack;
+	if(t) stack << t->currentFile << ":" << t->currentLine() << ":" << t->currentColumn();
+	else stack << "(host)";
+	for(vector<CScriptTokenDataFnc*>::reverse_iterator it = callFrames.rbegin(); it != callFrames.rend(); ++it)
+		stack << " < " << callFrameName(*it);
+	allocationProfiler->record(Var, Size, stack.str());
+}
 
-	CScriptResult function_execute;
-	size_t length_proto = Fnc->arguments.size();
-	size_t length_arguments = Arguments.size();
-	size_t length = max(length_proto, length_arguments);
-
-	STRING_VECTOR_t arg_names;
-	for(size_t arguments_idx = 0; arguments_idx<length_proto; ++arguments_idx) {
-		ASSERT(Fnc->arguments[arguments_idx].token == LEX_T_DESTRUCTURING_VAR);
-		Fnc->arguments[arguments_idx].DestructuringVar().getVarNames(arg_names);
-	}
-	for(STRING_VECTOR_it it = arg_names.begin(); it != arg_names.end(); ++it)
-		tmpArgsScope->addChildOrReplace(*it, constUndefined);
-
-	for(size_t arguments_idx = 0; execute && arguments_idx<length; ++arguments_idx) {
-		string arguments_idx_str = int2string(arguments_idx);
-		CScriptVarLinkWorkPtr value;
-		if(arguments_idx < length_arguments)
-			value = arguments->addChild(arguments_idx_str, Arguments[arguments_idx]);
-		else
-			value = constUndefined;
+CScriptVarPtr CTinyJS::internString(const string &Str) {
+	uint32_t hash = CScriptVarString::computeHash(Str.data(), Str.size());
+	CScriptVarString *str = internedStrings.find(Str.data(), Str.size(), hash);
+	if(str) return str;
+	CScriptVarPtr ret = newScriptVar(Str);
+	internedStrings.insert(static_cast<CScriptVarString*>(ret.getVar()));
+	return ret;
+}
+
+CScriptVarPtr CTinyJS::callFunction(CScriptResult &execute, const CScriptVarFunctionPtr &Callee, vector<CScriptVarPtr> &CalleeArguments, const CScriptVarPtr &CalleeThis, CScriptVarPtr *newThis) {
+	ASSERT(Callee && Callee->isFunction());
 
-		if(arguments_idx < length_proto) {
+	if(Callee->isBounded()) return CScriptVarFunctionBoundedPtr(Callee)->callFunction(execute, CalleeArguments, CalleeThis, newThis);
+
+	// Function, Arguments & This are replaced by a tail-call (return f(...))
+	// so the loop below reuses this frame instead of recursing
+	CScriptVarFunctionPtr Function(Callee);
+	vector<CScriptVarPtr> *Arguments = &CalleeArguments, tailArguments;
+	CScriptVarPtr This(CalleeThis);
+	// the function-scope & the arguments-object of the previous tail-call
+	// are reused if nothing else (closures, generators, ...) refers to them
+	CScriptVarScopeFncPtr tailRoot;
+	CScriptVarPtr tailArgumentsObject;
+	for(;;) {
+		CScriptTokenDataFnc *Fnc = Function->getFunctionData();
+		if(!newThis && Function->isNativeDirect()) {
+			try {
+				return static_cast<CScriptVarFunctionNativeDirect *>(Function.getVar())->callDirect(This ? This : CScriptVarPtr(root), *Arguments);
+			} catch (const CScriptVarPtr &v) {
+				nativeException(execute, v, Fnc->name);
+				return constUndefined;
+			}
+		}
+#ifndef NO_JIT
+		if(jitThreshold && !newThis && !Function->isNative()) {
+			CScriptVarPtr ret;
+			if(callJitCode(Function, *Arguments, ret)) return ret;
+		}
+#endif
+		CCallFrameControl CallFrame(this, Fnc);
+		CScriptVarScopeFncPtr functionRoot;
+		if(tailRoot && tailRoot->getRefs() == 1) {
+			functionRoot = tailRoot;
+			functionRoot->reset(CScriptVarPtr(Function->findChild(TINYJS_FUNCTION_CLOSURE_VAR)));
+		} else
+			functionRoot = ::newScriptVar(this, ScopeFnc, CScriptVarPtr(Function->findChild(TINYJS_FUNCTION_CLOSURE_VAR)));
+		tailRoot.clear();
+		if(Fnc->name.size()) functionRoot->addChild(Fnc->name, Function);
+		if(!Fnc->isArrowFunction()) {
+			// arrow functions get this from closure
+			if(This)
+				functionRoot->addChild("this", This);
+			else
+				functionRoot->addChild("this", root); // if no this given use root
+		}
+		CScriptVarPtr arguments;
+		if(tailArgumentsObject && tailArgumentsObject->getRefs() == 1 && tailArgumentsObject->isExtensible() && tailArgumentsObject->getPrototype() == objectPrototype) {
+			tailArgumentsObject->removeAllChildren();
+			arguments = tailArgumentsObject;
+		} else
+			arguments = newScriptVar(Object);
+		tailArgumentsObject.clear();
+		functionRoot->addChild(TINYJS_ARGUMENTS_VAR, arguments);
+
+		CScriptResult function_execute;
+		size_t length_proto = Fnc->arguments.size();
+		size_t length_arguments = Arguments->size();
+		size_t length = max(length_proto, length_arguments);
+
+		STRING_VECTOR_t arg_names;
+		bool simpleArgs = true; // no default values and no destructuring
+		for(size_t arguments_idx = 0; arguments_idx<length_proto; ++arguments_idx) {
+			ASSERT(Fnc->arguments[arguments_idx].token == LEX_T_DESTRUCTURING_VAR);
 			CScriptTokenDataDestructuringVar &DestructuringVar = Fnc->arguments[arguments_idx].DestructuringVar();
-			if(value->getVarPtr()->isUndefined()) {
-				if(DestructuringVar.assignment.size()) {
-					t->pushTokenScope(DestructuringVar.assignment);
-					assign_destructuring_var(execute, DestructuringVar, execute_assignment(execute), tmpArgsScope);
+			if(DestructuringVar.vars.size() != 1 || DestructuringVar.assignment.size()) simpleArgs = false;
+			DestructuringVar.getVarNames(arg_names);
+		}
+
+		// default values are evaluated in tmpArgsScope - simple arguments go directly into functionRoot
+		CScopeControl ScopeControl(this);
+		CScriptVarPtr tmpArgsScope = simpleArgs ? CScriptVarPtr(functionRoot) : CScriptVarPtr(ScopeControl.addLetScope());
+		for(STRING_VECTOR_it it = arg_names.begin(); it != arg_names.end(); ++it)
+			tmpArgsScope->addChildOrReplace(*it, constUndefined);
+
+		for(size_t arguments_idx = 0; execute && arguments_idx<length; ++arguments_idx) {
+			string arguments_idx_str = int2string(arguments_idx);
+			CScriptVarLinkWorkPtr value;
+			if(arguments_idx < length_arguments)
+				value = arguments->addChild(arguments_idx_str, (*Arguments)[arguments_idx]);
+			else
+				value = constUndefined;
+
+			if(arguments_idx < length_proto) {
+				CScriptTokenDataDestructuringVar &DestructuringVar = Fnc->arguments[arguments_idx].DestructuringVar();
+				if(value->getVarPtr()->isUndefined()) {
+					if(DestructuringVar.assignment.size()) {
+						t->pushTokenScope(DestructuringVar.assignment);
+						assign_destructuring_var(execute, DestructuringVar, execute_assignment(execute), tmpArgsScope);
+					}
+				} else {
+					assign_destructuring_var(execute, DestructuringVar, value, tmpArgsScope);
 				}
-			} else {
-				assign_destructuring_var(execute, DestructuringVar, value, tmpArgsScope);
 			}
 		}
-	}
-	if(!execute) return constUndefined;
-	// copy args from tmpArgsScope to functionRoot
-	for(STRING_VECTOR_it it = arg_names.begin(); it != arg_names.end(); ++it) {
-		functionRoot->addChildOrReplace(*it, tmpArgsScope->findChild(*it));
-	}
-	arguments->addChild("length", newScriptVar(length_arguments));
+		if(!execute) return constUndefined;
+		// copy args from tmpArgsScope to functionRoot
+		if(!simpleArgs) for(STRING_VECTOR_it it = arg_names.begin(); it != arg_names.end(); ++it) {
+			functionRoot->addChildOrReplace(*it, tmpArgsScope->findChild(*it));
+		}
+		tmpArgsScope.clear();
+		arguments->addChild("length", newScriptVar(length_arguments));
 
 #ifndef NO_GENERATORS
-	if(Fnc->isGenerator()) {
-		return ::newScriptVarCScriptVarGenerator(this, functionRoot, Function);
-	}
+		if(Fnc->isGenerator()) {
+			return ::newScriptVarCScriptVarGenerator(this, functionRoot, Function);
+		}
 #endif /*NO_GENERATORS*/
-	// execute function!
-	ScopeControl.clear(); 	// remove tmpArgsScope from scope-chain
-	// add the function's execute space to the symbol table so we can recurse
-	ScopeControl.addFncScope(functionRoot);
-	if (Function->isNative()) {
-		try {
-			CScriptVarFunctionNativePtr(Function)->callFunction(functionRoot);
-			CScriptVarLinkPtr ret = functionRoot->findChild(TINYJS_RETURN_VAR);
-			function_execute.set(CScriptResult::Return, ret ? CScriptVarPtr(ret) : constUndefined);
-		} catch (CScriptVarPtr v) {
-			if(haveTry) {
-				function_execute.setThrow(v, "native function '"+Fnc->name+"'");
-			} else if(v->isError()) {
-				CScriptException err = CScriptVarErrorPtr(v)->toCScriptException();
-				if(err.fileName.empty()) err.fileName = "native function '"+Fnc->name+"'";
-				throw err;
+		// execute function!
+		ScopeControl.clear(); 	// remove tmpArgsScope from scope-chain
+		// add the function's execute space to the symbol table so we can recurse
+		ScopeControl.addFncScope(functionRoot);
+		if (Function->isNative()) {
+			try {
+				CScriptVarFunctionNativePtr(Function)->callFunction(functionRoot);
+				CScriptVarLinkPtr ret = functionRoot->findChild(TINYJS_RETURN_VAR);
+				function_execute.set(CScriptResult::Return, ret ? CScriptVarPtr(ret) : constUndefined);
+			} catch (const CScriptVarPtr &v) {
+				nativeException(function_execute, v, Fnc->name);
 			}
-			else
-				throw CScriptException(Error, "uncaught exception: '"+v->toString(function_execute)+"' in native function '"+Fnc->name+"'");
+		} else {
+			/* we just want to execute the block, but something could
+				* have messed up and left us with the wrong ScriptLex, so
+				* we want to be careful here... */
+			string oldFile = t->currentFile;
+			t->currentFile = Fnc->file;
+			t->pushTokenScope(Fnc->body);
+			if(Fnc->body.front().token == '{')
+				execute_block(function_execute);
+			else {
+				CScriptVarPtr ret = execute_base(function_execute);
+				if(function_execute) function_execute.set(CScriptResult::Return, ret);
+			}
+			t->currentFile = oldFile;
+
+			// because return will probably have called this, and set execute to false
+		}
+		if(function_execute.isTailCall()) {
+			CScriptVarFunctionPtr tailFunction(function_execute.value);
+			vector<CScriptVarPtr> nextArguments;
+			nextArguments.swap(tailCallArguments);
+			CScriptVarPtr tailThis(tailCallThis);
+			tailCallThis.clear();
+			if(newThis || tailFunction->isBounded()) {
+				// constructors need their own this and bounded functions have their own callFunction
+				ScopeControl.clear();
+				CScriptVarPtr ret = callFunction(execute, tailFunction, nextArguments, tailThis);
+				if(newThis && execute) *newThis = functionRoot->findChild("this");
+				return ret;
+			}
+			tailArguments.swap(nextArguments);
+			Arguments = &tailArguments;
+			Function = tailFunction;
+			This = tailThis;
+			tailRoot = functionRoot;
+			tailArgumentsObject = arguments;
+			continue;
 		}
-	} else {
-		/* we just want to execute the block, but something could
-			* have messed up and left us with the wrong ScriptLex, so
-			* we want to be careful here... */
-		string oldFile = t->currentFile;
-		t->currentFile = Fnc->file;
-		t->pushTokenScope(Fnc->body);
-		if(Fnc->body.front().token == '{')
-			execute_block(function_execute);
+		if(function_execute.isReturnNormal()) {
+			if(newThis) *newThis = functionRoot->findChild("this");
+			if(function_execute.isReturn()) {
+				CScriptVarPtr ret = function_execute.value;
+				return ret;
+			}
+		} else
+			execute = function_execute;
+		return constScriptVar(Undefined);
+	}
+}
+#ifndef NO_JIT
+// compiles a function after jitThreshold calls or Now (a callee of native code)
+bool CTinyJS::compileJitCode(CScriptTokenDataFnc *Fnc, bool Now) {
+	if(Fnc->jitState == CScriptTokenDataFnc::JIT_COMPILED) return true;
+	if(Fnc->jitState == CScriptTokenDataFnc::JIT_FAILED || (++Fnc->callCount < jitThreshold && !Now)) return false;
+	Fnc->jitCode = CScriptJitCode::compile(*Fnc);
+	Fnc->jitState = Fnc->jitCode ? CScriptTokenDataFnc::JIT_COMPILED : CScriptTokenDataFnc::JIT_FAILED;
+	return Fnc->jitCode != 0;
+}
+bool CTinyJS::callJitCode(const CScriptVarPtr &Function, const vector<CScriptVarPtr> &Arguments, CScriptVarPtr &Result) {
+	CScriptTokenDataFnc *Fnc = Function->getFunctionData();
+	if(!compileJitCode(Fnc, false)) return false;
+	// the native code needs int32 for all declared arguments otherwise the interpreter is used
+	size_t count = Fnc->jitCode->argumentsCount();
+	if(Arguments.size() < count) return false;
+	int32_t args[CScriptJitCode::MAX_ARGUMENTS], ret;
+	for(size_t i=0; i<count; ++i) {
+		if(!Arguments[i]->isInt()) return false;
+		args[i] = Arguments[i]->toNumber().toInt32();
+	}
+	if(!callJitCode(Function, args, ret)) return false;
+	Result = newScriptVar(ret);
+	return true;
+}
+bool CTinyJS::callJitCode(const CScriptVarPtr &Function, const int32_t *Arguments, int32_t &Result) {
+	CScriptTokenDataFnc *Fnc = Function->getFunctionData();
+	CScriptJitEnv env;
+#ifndef NO_THREADING
+	env.interrupt = reinterpret_cast<const volatile char *>(&watchdogFlag);
+#else
+	static const char noInterrupt = 0;
+	env.interrupt = &noInterrupt;
+#endif
+	env.call = &CTinyJS::jitCallback;
+	env.context = this;
+	env.function = Function.getVar();
+	env.code = Fnc->jitCode;
+	if(Fnc->jitCode->call(Arguments, Result, env)) return true;
+	// too many returns to the interpreter - the code is kept until the function is destroyed (it may be on the stack)
+	if(Fnc->jitCode->bailout()) Fnc->jitState = CScriptTokenDataFnc::JIT_FAILED;
+	return false;
+}
+// called by native code to call a function by name - returns 0 to bail out to the interpreter
+int CTinyJS::jitCallback(CScriptJitEnv *Env, uint32_t Callee, const int64_t *Arguments, uint32_t Count, int32_t *Result) {
+	CTinyJS *context = Env->context;
+	if(*Env->interrupt) return 0;
+	if(context->stackBase) {
+		char dummy = 0;
+		if(&dummy < context->stackBase) return 0; // the interpreter throws "too much recursion"
+	}
+	try {
+		// the same lookup as in the interpreter - the name of the function is bound in its function-scope
+		const string &name = Env->code->getCallee(Callee);
+		CScriptVarPtr Function;
+		if(name == Env->function->getFunctionData()->name)
+			Function = CScriptVarPtr(Env->function);
 		else {
-			CScriptVarPtr ret = execute_base(function_execute);
-			if(function_execute) function_execute.set(CScriptResult::Return, ret);
-		}
-		t->currentFile = oldFile;
-
-		// because return will probably have called this, and set execute to false
+			CScriptVarLinkPtr closure = Env->function->findChild(TINYJS_FUNCTION_CLOSURE_VAR);
+			CScriptVarScopePtr scope = closure ? CScriptVarScopePtr(closure->getVarPtr()) : context->root;
+			CScriptVarLinkWorkPtr link = scope->findInScopes(name);
+			if(!link) return 0;
+			Function = link->getVarPtr();
+		}
+		if(!Function->isFunction() || Function->isNative() || Function->isBounded()) return 0;
+		CScriptTokenDataFnc *Fnc = Function->getFunctionData();
+		if(!context->compileJitCode(Fnc, true) || Fnc->jitCode->argumentsCount() > Count) return 0;
+		int32_t args[CScriptJitCode::MAX_ARGUMENTS];
+		for(uint32_t i=0; i<Fnc->jitCode->argumentsCount(); ++i)
+			args[i] = int32_t(Arguments[Count-1-i]);
+		return context->callJitCode(Function, args, *Result) ? 1 : 0;
+	} catch(...) {
+		return 0;
 	}
-	if(function_execute.isReturnNormal()) {
-		if(newThis) *newThis = functionRoot->findChild("this");
-		if(function_execute.isReturn()) {
-			CScriptVarPtr ret = function_execute.value;
-			return ret;
-		}
-	} else
-		execute = function_execute;
-	return constScriptVar(Undefined);
 }
+#endif
+
 #ifndef NO_GENERATORS
 void CTinyJS::generator_start(CScriptVarGenerator *Generator)
 {
@@ -6016,11 +7498,25 @@ CScriptVarPtr CTinyJS::generator_yield(CScriptResult &execute, CScriptVar *Yield
 
 
 
+// the part of the type-tag that corresponds to getVarType()
+static inline uint32_t varTypeOfTag(uint32_t Tag) {
+	const uint32_t special = TYPE_TAG_FUNCTION | TYPE_TAG_GENERATOR | TYPE_TAG_ACCESSOR;
+	if(Tag & special) return Tag & special;
+	return Tag & (TYPE_TAG_UNDEFINED | TYPE_TAG_NULL | TYPE_TAG_STRING | TYPE_TAG_NUMBER | TYPE_TAG_BOOL | TYPE_TAG_OBJECT);
+}
+
 inline CScriptVarPtr CTinyJS::mathsOp(CScriptResult &execute, const CScriptVarPtr &A, const CScriptVarPtr &B, int op) {
 	if(!execute) return constUndefined;
+	if(A->isString() && B->isString()) {
+		// string (in)equality without copying the characters
+		switch(op) {
+		case LEX_EQUAL: case LEX_TYPEEQUAL:		return constScriptVar(static_cast<CScriptVarString*>(A.getVar())->equals(static_cast<CScriptVarString*>(B.getVar())));
+		case LEX_NEQUAL: case LEX_NTYPEEQUAL:	return constScriptVar(!static_cast<CScriptVarString*>(A.getVar())->equals(static_cast<CScriptVarString*>(B.getVar())));
+		}
+	}
 	if (op == LEX_TYPEEQUAL || op == LEX_NTYPEEQUAL) {
 		// check type first
-		if( (A->getVarType() == B->getVarType()) ^ (op == LEX_TYPEEQUAL)) return constFalse;
+		if(varTypeOfTag(A->getTypeTag()) != varTypeOfTag(B->getTypeTag())) return constScriptVar(op == LEX_NTYPEEQUAL);
 		// check value second
 		return mathsOp(execute, A, B, op == LEX_TYPEEQUAL ? LEX_EQUAL : LEX_NEQUAL);
 	}
@@ -6124,7 +7620,7 @@ inline void CTinyJS::assign_destructuring_var(CScriptResult &execute, const CScr
 			} else {
 				if(it->second.empty()) continue; // skip empty entries
 				CScriptVarLinkWorkPtr var = Path.back()->getOwnProperty(it->first);
-				if(var) var = var.getter(execute); else var = constUndefined;
+				if(var) var.getterInPlace(execute); else var = constUndefined;
 				if(!execute) return;
 				if(it->second == "{" || it->second == "[") {
 					string newPathStr = PathStr.back() +  it->first;
@@ -6191,7 +7687,7 @@ inline void CTinyJS::execute_destructuring(CScriptResult &execute, CScriptTokenD
 			CScriptVarLinkWorkPtr lhs = execute_condition(execute);
 			t->match(LEX_T_END_EXPRESSION); // eat LEX_T_END_EXPRESSION
 			if(lhs->isWritable()) {
-				if (!lhs->isOwned()) {
+				if (!lhs->isOwned() && !lhs.isInheritedAccessor()) {
 					CScriptVarPtr fakedOwner = lhs.getReferencedOwner();
 					if(fakedOwner) {
 						if(!fakedOwner->isExtensible())
@@ -6246,7 +7742,7 @@ CScriptVarLinkWorkPtr CTinyJS::execute_literals(CScriptResult &execute) {
 		break;
 	case LEX_STR:
 		{
-			CScriptVarPtr a = newScriptVar(t->getToken().String());
+			CScriptVarPtr a = internString(t->getToken().String());
 			t->match(LEX_STR);
 			return a;
 		}
@@ -6354,7 +7850,8 @@ CScriptVarLinkWorkPtr CTinyJS::execute_literals(CScriptResult &execute) {
 		if (execute) {
 			t->match(LEX_R_NEW);
 			CScriptVarLinkWorkPtr parent = execute_literals(execute);
-			CScriptVarLinkWorkPtr objClass = execute_member(parent, execute).getter(execute);
+			CScriptVarLinkWorkPtr objClass = execute_member(parent, execute);
+			objClass.getterInPlace(execute);
 			if (execute) {
 				CScriptVarFunctionPtr Constructor = objClass->getVarPtr();
 				if(Constructor) {
@@ -6375,7 +7872,8 @@ CScriptVarLinkWorkPtr CTinyJS::execute_literals(CScriptResult &execute) {
 					if (t->tk == '(') {
 						t->match('(');
 						while(t->tk!=')') {
-							CScriptVarPtr value = execute_assignment(execute).getter(execute);
+							CScriptVarLinkWorkPtr value = execute_assignment(execute);
+							value.getterInPlace(execute);
 							if (execute)
 								arguments.push_back(value);
 							if (t->tk!=')') t->match(',', ')');
@@ -6407,7 +7905,8 @@ CScriptVarLinkWorkPtr CTinyJS::execute_literals(CScriptResult &execute) {
 	case '(':
 		if(execute) {
 			t->match('(');
-			CScriptVarLinkWorkPtr a = execute_base(execute).getter(execute);
+			CScriptVarLinkWorkPtr a = execute_base(execute);
+			a.getterInPlace(execute);
 			t->match(')');
 			return a;
 		} else
@@ -6430,7 +7929,7 @@ inline CScriptVarLinkWorkPtr CTinyJS::execute_member(CScriptVarLinkWorkPtr &pare
 	bool chaining_state = true;
 	while (t->tk == '.' || t->tk == LEX_OPTIONAL_CHAINING_MEMBER || t->tk == '[' || t->tk == LEX_OPTIONAL_CHAINING_ARRAY) {
 		if (execute) {
-			a = a.getter(execute); // a is now the "getted" var
+			a.getterInPlace(execute); // a is now the "getted" var
 			parent.swap(a);
 			if (execute && parent->getVarPtr()->isNullOrUndefined()) {
 				if (t->tk == LEX_OPTIONAL_CHAINING_MEMBER || t->tk == LEX_OPTIONAL_CHAINING_ARRAY) {
@@ -6443,6 +7942,7 @@ inline CScriptVarLinkWorkPtr CTinyJS::execute_member(CScriptVarLinkWorkPtr &pare
 			}
 		}
 		string name;
+		const CScriptToken &site = t->getToken();
 		if (t->tk == '.' || t->tk == LEX_OPTIONAL_CHAINING_MEMBER) {
 			t->match(t->tk);
 			name = t->tkStr();
@@ -6457,6 +7957,7 @@ inline CScriptVarLinkWorkPtr CTinyJS::execute_member(CScriptVarLinkWorkPtr &pare
 		}
 		if (execute) {
 			CScriptVarPtr parentVar = parent;
+			if(typeFeedback) typeFeedback->record(t->currentFile, site, parentVar);
 			a = parentVar->findChildWithPrototypeChain(name);
 			if (!a) {
 				a(constScriptVar(Undefined), name);
@@ -6474,9 +7975,9 @@ inline CScriptVarLinkWorkPtr CTinyJS::execute_function_call(CScriptResult &execu
 	CScriptVarLinkWorkPtr parent = execute_literals(execute);
 	CScriptVarLinkWorkPtr a = execute_member(parent, execute);
 	bool chaining_state = true;
-	while (t->tk == '(' || t->tk == LEX_OPTIONAL_CHANING_FNC) {
+	while (t->tk == '(' || t->tk == LEX_OPTIONAL_CHANING_FNC || t->tk == LEX_T_TAIL_CALL) {
 		if (execute) {
-			a = a.getter(execute);
+			a.getterInPlace(execute);
 			if (execute && a->getVarPtr()->isNullOrUndefined()) {
 				if (t->tk == LEX_OPTIONAL_CHANING_FNC) {
 					chaining_state = false;
@@ -6496,12 +7997,15 @@ inline CScriptVarLinkWorkPtr CTinyJS::execute_function_call(CScriptResult &execu
 					throwError(execute, Error, "too much recursion");
 			}
 
+			bool tailCall = t->tk == LEX_T_TAIL_CALL;
+			const CScriptToken &site = t->getToken();
 			t->match(t->tk); // path += '(';
 
 			// grab in all parameters
 			vector<CScriptVarPtr> arguments;
 			while(t->tk!=')') {
-				CScriptVarLinkWorkPtr value = execute_assignment(execute).getter(execute);
+				CScriptVarLinkWorkPtr value = execute_assignment(execute);
+				value.getterInPlace(execute);
 //				path += (*value)->getString();
 				if (execute) {
 					arguments.push_back(value);
@@ -6512,11 +8016,19 @@ inline CScriptVarLinkWorkPtr CTinyJS::execute_function_call(CScriptResult &execu
 			// setup a return variable
 			CScriptVarLinkWorkPtr returnVar;
 			if(execute) {
+				if(typeFeedback) typeFeedback->recordCall(t->currentFile, site, fnc, arguments);
 				if (!parent)
 					parent = findInScopes("this");
 				// if no parent use the root-scope
 				CScriptVarPtr This(parent ? parent->getVarPtr() : (CScriptVarPtr )root);
-				a = callFunction(execute, fnc, arguments, This);
+				if(tailCall) {
+					// return f(...) ==> the call is done by callFunction of the current function
+					tailCallArguments.swap(arguments);
+					tailCallThis = This;
+					execute.set(CScriptResult::TailCall, fnc);
+					a = constScriptVar(Undefined);
+				} else
+					a = callFunction(execute, fnc, arguments, This);
 			}
 		} else {
 			// function, but not executing - just parse args and be done
@@ -6527,7 +8039,8 @@ inline CScriptVarLinkWorkPtr CTinyJS::execute_function_call(CScriptResult &execu
 			}
 			t->match(')');
 		}
-		a = execute_member(parent = a, execute);
+		parent.swap(a);
+		a = execute_member(parent, execute);
 	}
 	if (chaining_state == false) {
 		execute.set(CScriptResult::Normal, false);
@@ -6538,7 +8051,8 @@ inline CScriptVarLinkWorkPtr CTinyJS::execute_function_call(CScriptResult &execu
 // R<-L: Precedence 14 (pre-increment/decrement) ++. --.  (unary) ! ~ + - typeof void delete
 inline bool CTinyJS::execute_unary_rhs(CScriptResult &execute, CScriptVarLinkWorkPtr& a) {
 	t->match(t->tk);
-	a = execute_unary(execute).getter(execute);
+	a = execute_unary(execute);
+	a.getterInPlace(execute);
 	if(execute) CheckRightHandVar(execute, a);
 	return execute;
 };
@@ -6563,7 +8077,7 @@ CScriptVarLinkWorkPtr CTinyJS::execute_unary(CScriptResult &execute) {
 		break;
 	case LEX_R_TYPEOF:
 		if(execute_unary_rhs(execute, a))
-			a = newScriptVar(a->getVarPtr()->getVarType());
+			a = internString(a->getVarPtr()->getVarType());
 		break;
 	case LEX_R_VOID:
 		if(execute_unary_rhs(execute, a))
@@ -6637,11 +8151,13 @@ inline CScriptVarLinkWorkPtr CTinyJS::execute_exponentiation(CScriptResult& exec
 	CScriptVarLinkWorkPtr a = execute_unary(execute);
 	if (t->tk == LEX_ASTERISKASTERISK) {
 		CheckRightHandVar(execute, a);
+		const CScriptToken &site = t->getToken();
 		t->match(t->tk);
 		CScriptVarLinkWorkPtr b = execute_exponentiation(execute); // L<-R
 		if (execute) {
 			CheckRightHandVar(execute, b);
-			a = mathsOp(execute, a.getter(execute), b.getter(execute), LEX_ASTERISKASTERISK);
+			a.getterInPlace(execute); b.getterInPlace(execute);
+			a(mathsOp(execute, site, a, b, LEX_ASTERISKASTERISK));
 		}
 	}
 	return a;
@@ -6655,11 +8171,13 @@ inline CScriptVarLinkWorkPtr CTinyJS::execute_term(CScriptResult &execute) {
 		CheckRightHandVar(execute, a);
 		while (t->tk=='*' || t->tk=='/' || t->tk=='%') {
 			int op = t->tk;
+			const CScriptToken &site = t->getToken();
 			t->match(t->tk);
 			CScriptVarLinkWorkPtr b = execute_exponentiation(execute); // L->R
 			if (execute) {
 				CheckRightHandVar(execute, b);
-				a = mathsOp(execute, a.getter(execute), b.getter(execute), op);
+				a.getterInPlace(execute); b.getterInPlace(execute);
+				a(mathsOp(execute, site, a, b, op));
 			}
 		}
 	}
@@ -6673,11 +8191,13 @@ inline CScriptVarLinkWorkPtr CTinyJS::execute_expression(CScriptResult &execute)
 		CheckRightHandVar(execute, a);
 		while (t->tk=='+' || t->tk=='-') {
 			int op = t->tk;
+			const CScriptToken &site = t->getToken();
 			t->match(t->tk);
 			CScriptVarLinkWorkPtr b = execute_term(execute); // L->R
 			if (execute) {
 				CheckRightHandVar(execute, b);
-				a = mathsOp(execute, a.getter(execute), b.getter(execute), op);
+				a.getterInPlace(execute); b.getterInPlace(execute);
+				a(mathsOp(execute, site, a, b, op));
 			}
 		}
 	}
@@ -6691,13 +8211,15 @@ inline CScriptVarLinkWorkPtr CTinyJS::execute_binary_shift(CScriptResult &execut
 		CheckRightHandVar(execute, a);
 		while (t->tk>=LEX_SHIFTS_BEGIN && t->tk<=LEX_SHIFTS_END) {
 			int op = t->tk;
+			const CScriptToken &site = t->getToken();
 			t->match(t->tk);
 
 			CScriptVarLinkWorkPtr b = execute_expression(execute); // L->R
 			if (execute) {
 				CheckRightHandVar(execute, a);
 				 // not in-place, so just replace
-				 a = mathsOp(execute, a.getter(execute), b.getter(execute), op);
+				 a.getterInPlace(execute); b.getterInPlace(execute);
+				 a(mathsOp(execute, site, a, b, op));
 			}
 		}
 	}
@@ -6710,23 +8232,25 @@ inline CScriptVarLinkWorkPtr CTinyJS::execute_relation(CScriptResult &execute, i
 	if ((set==LEX_EQUAL && t->tk>=LEX_EQUALS_BEGIN && t->tk<=LEX_EQUALS_END)
 				||	(set=='<' && (t->tk==LEX_LEQUAL || t->tk==LEX_GEQUAL || t->tk=='<' || t->tk=='>' || t->tk == LEX_R_IN || t->tk == LEX_R_INSTANCEOF))) {
 		CheckRightHandVar(execute, a);
-		a = a.getter(execute);
+		a.getterInPlace(execute);
 		while ((set==LEX_EQUAL && t->tk>=LEX_EQUALS_BEGIN && t->tk<=LEX_EQUALS_END)
 					||	(set=='<' && (t->tk==LEX_LEQUAL || t->tk==LEX_GEQUAL || t->tk=='<' || t->tk=='>' || t->tk == LEX_R_IN || t->tk == LEX_R_INSTANCEOF))) {
 			int op = t->tk;
+			const CScriptToken &site = t->getToken();
 			t->match(t->tk);
 			CScriptVarLinkWorkPtr b = set_n ? execute_relation(execute, set_n, 0) : execute_binary_shift(execute); // L->R
 			if (execute) {
 				CheckRightHandVar(execute, b);
 				string nameOf_b = b->getName();
-				b = b.getter(execute);
+				b.getterInPlace(execute);
 				if(op == LEX_R_IN) {
 					if(!b->getVarPtr()->isObject())
 						throwError(execute, TypeError, "invalid 'in' operand "+nameOf_b);
 					a(constScriptVar( (bool)b->getVarPtr()->findChildWithPrototypeChain(a->toString(execute))));
 				} else if(op == LEX_R_INSTANCEOF) {
-					CScriptVarPtr prototype = b->getVarPtr()->getPrototype();
-					if(!prototype)
+					CScriptVarPtr prototype;
+					if(b->getVarPtr()->isFunction()) prototype = b->getVarPtr()->findChild(TINYJS_PROTOTYPE_CLASS);
+					if(!prototype || !prototype->isObject())
 						throwError(execute, TypeError, "invalid 'instanceof' operand "+nameOf_b);
 					else {
 						unsigned int uniqueID = allocUniqueID();
@@ -6739,7 +8263,7 @@ inline CScriptVarLinkWorkPtr CTinyJS::execute_relation(CScriptResult &execute, i
 						a(constScriptVar(object && object==prototype));
 					}
 				} else
-					a = mathsOp(execute, a, b, op);
+					a(mathsOp(execute, site, a, b, op));
 			}
 		}
 	}
@@ -6753,13 +8277,15 @@ inline CScriptVarLinkWorkPtr CTinyJS::execute_binary_logic(CScriptResult &execut
 	CScriptVarLinkWorkPtr a = op_n1 ? execute_binary_logic(execute, op_n1, op_n2, 0) : execute_relation(execute);
 	if (t->tk==op) {
 		CheckRightHandVar(execute, a);
-		a = a.getter(execute);
+		a.getterInPlace(execute);
 		while (t->tk==op) {
+			const CScriptToken &site = t->getToken();
 			t->match(t->tk);
 			CScriptVarLinkWorkPtr b = op_n1 ? execute_binary_logic(execute, op_n1, op_n2, 0) : execute_relation(execute); // L->R
 			if (execute) {
 				CheckRightHandVar(execute, b);
-				a = mathsOp(execute, a, b.getter(execute), op);
+				b.getterInPlace(execute);
+				a(mathsOp(execute, site, a, b, op));
 			}
 		}
 	}
@@ -6827,6 +8353,7 @@ inline CScriptVarLinkPtr CTinyJS::execute_assignment(CScriptVarLinkWorkPtr lhs,
 	if (t->tk=='=' || (t->tk>=LEX_ASSIGNMENTS_BEGIN && t->tk<=LEX_ASSIGNMENTS_END)) {
 		int op = t->tk;
 		CScriptTokenizer::ScriptTokenPosition leftHandPos = t->getPos();
+		const CScriptToken &site = t->getToken();
 		t->match(t->tk);
 		if (execute) {
 			if (op != '=' && !lhs->isOwned()) {
@@ -6852,7 +8379,7 @@ inline CScriptVarLinkPtr CTinyJS::execute_assignment(CScriptVarLinkWorkPtr lhs,
 			}
 			else if(lhs->isWritable()) {
 				if (op=='=') {
-					if (!lhs->isOwned()) {
+					if (!lhs->isOwned() && !lhs.isInheritedAccessor()) {
 						CScriptVarPtr fakedOwner = lhs.getReferencedOwner();
 						if(fakedOwner) {
 							if(!fakedOwner->isExtensible())
@@ -6866,7 +8393,7 @@ inline CScriptVarLinkPtr CTinyJS::execute_assignment(CScriptVarLinkWorkPtr lhs,
 				} else {
 					CScriptVarPtr result;
 					//static int assignments[] = {'+', '-', '*', '/', '%', LEX_LSHIFT, LEX_RSHIFT, LEX_RSHIFTU, '&', '|', '^'};
-					result = mathsOp(execute, lhs.getter(execute), rhs, op /*assignments[op - LEX_PLUSEQUAL]*/);
+					result = mathsOp(execute, site, lhs.getter(execute), rhs, op /*assignments[op - LEX_PLUSEQUAL]*/);
 					lhs.setter(execute, result);
 					return result;
 				}
@@ -6878,7 +8405,7 @@ inline CScriptVarLinkPtr CTinyJS::execute_assignment(CScriptVarLinkWorkPtr lhs,
 	}
 	else
 		CheckRightHandVar(execute, lhs);
-	return lhs.getter(execute);
+	return lhs.getterInPlace(execute);
 }
 // L->R: Precedence 1 (comma) ,
 inline CScriptVarLinkPtr CTinyJS::execute_base(CScriptResult &execute) {
@@ -6893,6 +8420,57 @@ inline CScriptVarLinkPtr CTinyJS::execute_base(CScriptResult &execute) {
 	}
 	return a;
 }
+// superinstructions (see getSuperInstruction)
+// only the common case (a writable number) is executed directly
+// all other cases are executed by the tokens following the superinstruction-token
+inline CScriptVarPtr CTinyJS::execute_increment(CScriptResult &execute) {
+	if(!typeFeedback) {
+		TOKEN_VECT_it begin = t->getPos().pos, it = begin+1;
+		bool prefix = it->token != LEX_ID, postfix = false;
+		CNumber delta(it->token == LEX_MINUSMINUS ? -1 : 1);
+		if(prefix) ++it;
+		CScriptVarLinkWorkPtr a(findInScopes(it->String()));
+		if(begin->token == LEX_T_INC_MEMBER) {
+			if(a && a->getVarPtr()->isObject() && !a->getVarPtr()->isAccessor()) a = a->getVarPtr()->findChild(it[2].String());
+			else a.clear();
+			it += 2;
+		}
+		++it;
+		if(!prefix) {
+			postfix = it->token == LEX_PLUSPLUS || it->token == LEX_MINUSMINUS;
+			if(it->token == LEX_MINUSMINUS) delta = -1;
+			else if(it->token == LEX_PLUSEQUAL) delta = (++it)->Int();
+			else if(it->token == LEX_MINUSEQUAL) delta = -CNumber((++it)->Int());
+			++it;
+		}
+		// a not owned link (e.g. an inherited property of a with-object) needs the referenced owner of the tokens
+		if(a && a->isOwned() && a->isWritable() && a->getVarPtr()->isNumber()) {
+			CScriptVarPtr old = a->getVarPtr();
+			CScriptVarPtr res = newScriptVar(old->toNumber(execute).add(delta));
+			a.setter(execute, res);
+			t->skip(size2int32(it-begin));
+			return postfix ? old : res;
+		}
+	}
+	t->match(t->tk);
+	return execute_base(execute);
+}
+inline bool CTinyJS::execute_compare(CScriptResult &execute) {
+	if(!typeFeedback) {
+		TOKEN_VECT_it begin = t->getPos().pos;
+		CScriptVarLinkPtr lhs = findInScopes(begin[1].String()), rhs;
+		if(begin[3].token == LEX_ID) rhs = findInScopes(begin[3].String());
+		if(lhs && lhs->getVarPtr()->isNumber() && (begin[3].token == LEX_INT || (rhs && rhs->getVarPtr()->isNumber()))) {
+			CNumber l = lhs->getVarPtr()->toNumber(execute);
+			CNumber r = begin[3].token == LEX_INT ? CNumber(begin[3].Int()) : rhs->getVarPtr()->toNumber(execute);
+			int op = begin[2].token;
+			t->skip(4);
+			return op == '<' ? l < r : op == '>' ? l > r : op == LEX_LEQUAL ? l <= r : l >= r;
+		}
+	}
+	t->match(t->tk);
+	return execute_base(execute)->toBoolean();
+}
 inline void CTinyJS::execute_block(CScriptResult &execute) {
 	if(execute) {
 		t->match('{');
@@ -6908,6 +8486,12 @@ inline void CTinyJS::execute_block(CScriptResult &execute) {
 		t->skip(t->getToken().Int());
 }
 void CTinyJS::execute_statement(CScriptResult &execute) {
+#ifdef WITH_REFCOUNT_STATISTICS
+	if(execute) refCountStatistics.statements++;
+#endif
+#ifndef NO_THREADING
+	if(watchdogFlag.load(std::memory_order_relaxed)) watchdogSafePoint();
+#endif
 	switch(t->tk) {
 	case '{':		/* A block of code */
 		execute_block(execute);
@@ -6917,20 +8501,23 @@ void CTinyJS::execute_statement(CScriptResult &execute) {
 		break;
 	case LEX_T_FORWARD:
 		{
-			CScriptVarPtr in_scope = scope()->scopeLet();
-			STRING_SET_t *varNames = t->getToken().Forwarder().varNames;
-			for(int i=0; i<CScriptTokenDataForwards::END; ++i) {
-				for(STRING_SET_it it=varNames[i].begin(); it!=varNames[i].end(); ++it) {
-					CScriptVarLinkPtr a = in_scope->findChild(*it);
-					if(!a) in_scope->addChild(*it, constScriptVar(Undefined), i==CScriptTokenDataForwards::CONSTS ? SCRIPTVARLINK_CONSTDEFAULT : SCRIPTVARLINK_VARDEFAULT);
+			CScriptTokenDataForwards &forwarder = t->getToken().Forwarder();
+			installBindings(scope()->scopeLet(), forwarder.getLetBindings(), false);
+			CScriptVarPtr varScope = scope()->scopeVar();
+			// the functions of a function-body (a let-scope in a function-scope) are created lazily
+			// the let-scope is the closure of the functions
+			bool lazy = false;
+			if(forwarder.functions.size() && (scope()->getTypeTag() & (TYPE_TAG_SCOPE_LET | TYPE_TAG_SCOPE_WITH)) == TYPE_TAG_SCOPE_LET) {
+				CScriptVarScopeLet *letScope = static_cast<CScriptVarScopeLet*>(scope().getVar());
+				if(letScope->parent->getVarPtr() == varScope && varScope->hasTypeTag(TYPE_TAG_SCOPE_FNC)) {
+					CScriptVarScopeFnc *fncScope = static_cast<CScriptVarScopeFnc*>(varScope.getVar());
+					if(!fncScope->lazyFunctions) {
+						fncScope->lazyFunctions = forwarder;
+						letScope->lazyFunctionsClosure = lazy = true;
+					}
 				}
-				in_scope = scope()->scopeVar();
-			}
-			CScriptTokenDataForwards::FNC_SET_t &functions = t->getToken().Forwarder().functions;
-			for(CScriptTokenDataForwards::FNC_SET_it it=functions.begin(); it!=functions.end(); ++it) {
-				CScriptVarLinkWorkPtr funcVar = parseFunctionDefinition(*it);
-				in_scope->addChildOrReplace(funcVar->getName(), funcVar, SCRIPTVARLINK_VARDEFAULT);
 			}
+			installBindings(varScope, forwarder.getVarBindings(), lazy);
 			t->match(LEX_T_FORWARD);
 		}
 		break;
@@ -7082,7 +8669,7 @@ void CTinyJS::execute_statement(CScriptResult &execute) {
 			bool loopCond = true;	// Empty Condition -->always true
 			if(LoopData.type != CScriptTokenDataLoop::DO && LoopData.condition.size()) {
 				t->pushTokenScope(LoopData.condition);
-				loopCond = execute_base(execute)->toBoolean();
+				loopCond = t->tk == LEX_T_CMP_ID ? execute_compare(execute) : execute_base(execute)->toBoolean();
 				if(!execute) break;
 			}
 			while (loopCond && execute) {
@@ -7100,11 +8687,14 @@ void CTinyJS::execute_statement(CScriptResult &execute) {
 				}
 				if(LoopData.type == CScriptTokenDataLoop::FOR && execute && LoopData.iter.size()) {
 					t->pushTokenScope(LoopData.iter);
-					execute_base(execute);
+					if(t->tk == LEX_T_INC_ID || t->tk == LEX_T_INC_MEMBER)
+						execute_increment(execute);
+					else
+						execute_base(execute);
 				}
 				if(execute && LoopData.condition.size()) {
 					t->pushTokenScope(LoopData.condition);
-					loopCond = execute_base(execute)->toBoolean();
+					loopCond = t->tk == LEX_T_CMP_ID ? execute_compare(execute) : execute_base(execute)->toBoolean();
 				}
 			}
 		}
@@ -7132,7 +8722,8 @@ void CTinyJS::execute_statement(CScriptResult &execute) {
 			if (t->tk != ';')
 				result = execute_base(execute);
 			t->match(';');
-			execute.set(CScriptResult::Return, result);
+			if (execute) // leave Throw or TailCall untouched
+				execute.set(CScriptResult::Return, result);
 		} else
 			t->skip(t->getToken().Int());
 		break;
@@ -7313,6 +8904,15 @@ end_while:
 	case LEX_EOF:
 		t->match(LEX_EOF);
 		break;
+	case LEX_T_INC_ID:
+	case LEX_T_INC_MEMBER:
+		if(execute) {
+			CScriptVarPtr ret = execute_increment(execute);
+			if(execute) execute.set(CScriptResult::Normal, ret);
+			t->match(';');
+		} else
+			t->skip(t->getToken().Int());
+		break;
 	default:
 		if(t->tk!=LEX_T_SKIP || execute) {
 			if(t->tk==LEX_T_SKIP) t->match(LEX_T_SKIP);
@@ -7328,7 +8928,7 @@ end_while:
 
 
 /// Finds a child, looking recursively up the scopes
-CScriptVarLinkPtr CTinyJS::findInScopes(const string &childName) {
+CScriptVarLinkWorkPtr CTinyJS::findInScopes(const string &childName) {
 	return scope()->findInScopes(childName);
 }
 
@@ -7717,6 +9317,10 @@ void CTinyJS::native_eval(const CFunctionsScopePtr &c, void *data) {
 			execute_statement(execute);
 			while (t->tk==';') t->match(';'); // skip empty statements
 		} while (t->tk!=LEX_EOF);
+	} catch (CScriptInterruptException &) { // never catchable
+		t = oldTokenizer; // restore tokenizer
+		scopes.push_back(scEvalScope); // restore Scopes;
+		throw; // rethrow
 	} catch (CScriptException &e) { // script exceptions
 		t = oldTokenizer; // restore tokenizer
 		scopes.push_back(scEvalScope); // restore Scopes;
@@ -7749,20 +9353,201 @@ static int _native_require_read(const string &Fname, string &Data) {
 	return errno;
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// CScriptModuleTokens - the compiled tokens of the modules (shared by all contexts)
+//////////////////////////////////////////////////////////////////////////
+
+// the tokens are stored serialized, so every context gets its own copy of the token-data
+class CScriptModuleTokens {
+public:
+	static bool get(const string &Path, const struct stat &St, string &Compiled);
+	static void put(const string &Path, const struct stat &St, const string &Compiled);
+private:
+	struct ENTRY {
+		time_t mtime;
+		off_t size;
+		string compiled;
+	};
+	typedef map<string, ENTRY> ENTRIES_t;
+	static ENTRIES_t entries;
+#ifndef NO_THREADING
+	static CScriptMutex mutex;
+#endif
+};
+CScriptModuleTokens::ENTRIES_t CScriptModuleTokens::entries;
+#ifndef NO_THREADING
+CScriptMutex CScriptModuleTokens::mutex;
+#endif
+
+bool CScriptModuleTokens::get(const string &Path, const struct stat &St, string &Compiled) {
+#ifndef NO_THREADING
+	mutex.lock();
+#endif
+	ENTRIES_t::iterator it = entries.find(Path);
+	bool found = it != entries.end() && it->second.mtime == St.st_mtime && it->second.size == St.st_size;
+	if(found) Compiled = it->second.compiled;
+#ifndef NO_THREADING
+	mutex.unlock();
+#endif
+	return found;
+}
+void CScriptModuleTokens::put(const string &Path, const struct stat &St, const string &Compiled) {
+#ifndef NO_THREADING
+	mutex.lock();
+#endif
+	ENTRY &entry = entries[Path];
+	entry.mtime = St.st_mtime;
+	entry.size = St.st_size;
+	entry.compiled = Compiled;
+#ifndef NO_THREADING
+	mutex.unlock();
+#endif
+}
+
+static string getModuleDirName(const string &Path) {
+	string::size_type pos = Path.find_last_of("/\\");
+	if(pos == string::npos) return ".";
+	return Path.substr(0, pos ? pos : 1);
+}
+
+// "./" and "../" are relative to the directory of the requiring module
+// all others are relative to the current directory
+// ".js" is appended if the file not exists without
+static string resolveModulePath(const string &Dir, const string &File) {
+	string path = File;
+	if(Dir.size() && (File.compare(0, 2, "./") == 0 || File.compare(0, 3, "../") == 0))
+		path = Dir + '/' + File;
+	struct stat st;
+	if(stat(path.c_str(), &st) != 0 && stat((path + ".js").c_str(), &st) == 0)
+		path += ".js";
+#ifdef _WIN32
+	char full[_MAX_PATH];
+	if(_fullpath(full, path.c_str(), _MAX_PATH)) path = full;
+#else
+	char *full = realpath(path.c_str(), 0);
+	if(full) {
+		path = full;
+		free(full);
+	}
+#endif
+	return path;
+}
+
+size_t CTinyJS::precompileModules(const STRING_VECTOR_t &Files, unsigned Threads) {
+	vector<CScriptCompiledSource> sources;
+	vector<struct stat> stats;
+	for(STRING_VECTOR_t::const_iterator it = Files.begin(); it != Files.end(); ++it) {
+		string Path = resolveModulePath("", *it);
+		struct stat St;
+		if(stat(Path.c_str(), &St) != 0) continue;
+		sources.push_back(CScriptCompiledSource(Path));
+		stats.push_back(St);
+	}
+	CScriptTokenizer::tokenizeSources(sources, true, Threads);
+	size_t count = 0;
+	for(size_t i = 0; i < sources.size(); ++i) {
+		if(sources[i].error.size()) continue;
+		CScriptModuleTokens::put(sources[i].file, stats[i], sources[i].compiled);
+		++count;
+	}
+	return count;
+}
+
+/// CommonJS-like modules:
+/// the module is executed once per context as function(exports, require, module, __filename, __dirname)
+/// and the exports are cached in require.cache[resolved path]
 void CTinyJS::native_require(const CFunctionsScopePtr &c, void *data) {
 	string File = c->getArgument("jsFile")->toString();
-	string Code;
-	int ErrorNo;
-	if(!native_require_read)
-		native_require_read = _native_require_read; // use builtin if no callback
 
-	if((ErrorNo = native_require_read(File, Code))) {
-		ostringstream msg;
-		msg << "can't read \"" << File << "\" (Error=" << ErrorNo << ")";
-		c->throwError(Error, msg.str());
+	// "this" is the module-object if called by the require of a module
+	string Dir;
+	CScriptVarPtr This = c->getArgument("this");
+	CScriptVarLinkPtr thisFilename = This->isObject() ? This->findChild("filename") : CScriptVarLinkPtr();
+	if(thisFilename && moduleCache->findChild(thisFilename->toString()))
+		Dir = getModuleDirName(thisFilename->toString());
+
+	// the modules of a bundle are named by their normalized relative path
+	string Path;
+	const CScriptBundle *Bundle = 0;
+	if(bundles.size()) {
+		bool relative = File.compare(0, 2, "./") == 0 || File.compare(0, 3, "../") == 0;
+		string Name = normalizeModuleName(relative && Dir.size() ? Dir + '/' + File : File);
+		for(vector<const CScriptBundle *>::iterator it = bundles.begin(); !Bundle && it != bundles.end(); ++it) {
+			if((*it)->find(Name)) Path = Name;
+			else if((*it)->find(Name + ".js")) Path = Name + ".js";
+			else continue;
+			Bundle = *it;
+		}
+	}
+	if(!Bundle)
+		Path = resolveModulePath(Dir, File);
+
+	CScriptVarLinkPtr cached = moduleCache->findChild(Path);
+	if(cached) {
+		c->setReturnVar(cached->getVarPtr()->getProperty("exports"));
+		return;
 	}
-	c->addChildOrReplace("jsCode", c->newScriptVar(Code));
-	native_eval(c, data);
+
+	// the compiled tokens are shared between the contexts if the module is read by the builtin reader
+	CScriptTokenizer Tokenizer;
+	struct stat St;
+	bool shared = !Bundle && !native_require_read && stat(Path.c_str(), &St) == 0;
+	bool compiled = Bundle && Bundle->load(Path, Tokenizer);
+	if(shared) {
+		string Compiled;
+		if(CScriptModuleTokens::get(Path, St, Compiled)) {
+			istringstream in(Compiled);
+			compiled = Tokenizer.unserialize(in, Path);
+		}
+	}
+	if(!compiled) {
+		string Code;
+		int ErrorNo;
+		if((ErrorNo = (native_require_read ? native_require_read : _native_require_read)(Path, Code))) {
+			ostringstream msg;
+			msg << "can't read \"" << File << "\" (Error=" << ErrorNo << ")";
+			c->throwError(Error, msg.str());
+		}
+		CScriptBundle::tokenizeModule(Code, Path, Tokenizer);
+		if(shared) {
+			ostringstream out;
+			Tokenizer.serialize(out);
+			CScriptModuleTokens::put(Path, St, out.str());
+		}
+	}
+	if(typeFeedback && !typeFeedback->hasFile(Path))
+		typeFeedback->merge(Tokenizer.typeFeedback, Path); // the feedback of the previous contexts
+
+	CScriptVarFunctionPtr Function = newScriptVar(&Tokenizer.getToken().Fnc());
+	CScriptVarPtr Module = newScriptVar(Object), Exports = newScriptVar(Object);
+	Module->addChild("id", newScriptVar(Path));
+	Module->addChild("filename", newScriptVar(Path));
+	Module->addChild("loaded", constScriptVar(false));
+	Module->addChild("exports", Exports);
+	moduleCache->addChild(Path, Module); // added before the execution for circular requires
+
+	vector<CScriptVarPtr> Arguments;
+	Arguments.push_back(Exports);
+	Arguments.push_back(newScriptVarFunctionBounded(root->findChild("require")->getVarPtr(), Module, vector<CScriptVarPtr>()));
+	Arguments.push_back(Module);
+	Arguments.push_back(newScriptVar(Path));
+	Arguments.push_back(newScriptVar(getModuleDirName(Path)));
+	try {
+		callFunction(Function, Arguments, Exports);
+	} catch(...) {
+		moduleCache->removeChild(Path);
+		throw;
+	}
+	Module->addChildOrReplace("loaded", constScriptVar(true));
+	if(typeFeedback && shared) {
+		// the feedback recorded until the module is loaded is stored with the shared tokens
+		Tokenizer.typeFeedback.clear();
+		Tokenizer.typeFeedback.merge(*typeFeedback, Path);
+		ostringstream out;
+		Tokenizer.serialize(out);
+		CScriptModuleTokens::put(Path, St, out.str());
+	}
+	c->setReturnVar(Module->getProperty("exports"));
 }
 
 void CTinyJS::native_isNAN(const CFunctionsScopePtr &c, void *data) {
@@ -7808,6 +9593,18 @@ void CTinyJS::native_JSON_parse(const CFunctionsScopePtr &c, void *data) {
 		c->setReturnVar(returnVar);
 }
 
+void CTinyJS::setConsoleSink(CScriptConsoleSink *Sink) {
+	flushConsole();
+	consoleSink = Sink;
+}
+CScriptConsoleSink *CTinyJS::getConsoleSink() {
+	if(!consoleSink) {
+		if(!defaultConsoleSink) defaultConsoleSink = new CScriptConsoleBufferedSink();
+		consoleSink = defaultConsoleSink;
+	}
+	return consoleSink;
+}
+
 void CTinyJS::setTemporaryID_recursive(uint32_t ID) {
 	for(vector<CScriptVarPtr*>::iterator it = pseudo_refered.begin(); it!=pseudo_refered.end(); ++it)
 		if(**it) (**it)->setTemporaryMark_recursive(ID);
@@ -7817,22 +9614,13 @@ void CTinyJS::setTemporaryID_recursive(uint32_t ID) {
 }
 
 void CTinyJS::ClearUnreferedVars(const CScriptVarPtr &extra/*=CScriptVarPtr()*/) {
+	// the garbage of the last collection not swept yet is found again as garbage
 	uint32_t UniqueID = allocUniqueID();
 	setTemporaryID_recursive(UniqueID);
 	if(extra) extra->setTemporaryMark_recursive(UniqueID);
-	CScriptVar *p = first;
-
-	while (p)
-	{
-		if(p->getTemporaryMark() != UniqueID)
-		{
-			CScriptVarPtr var = p;
-			var->cleanUp4Destroy();
-			p = var->next;
-		}
-		else
-			p = p->next;
-	}
+	// the unmarked vars are swept lazily (see CScriptVarHeap)
+	heap.markGarbage(UniqueID);
+	internedStrings.removeGarbage(); // internString must not return a string swept later
 	freeUniqueID();
 }
 
@@ -53,7 +53,10 @@
 #	include <stdint.h> // <cstdint> is C++11
 #endif
 #include <climits>
+#include <cstdlib>
 #include <cstring>
+#include <iterator>
+#include <new>
 #include <cassert>
 #include <ctime>
 #include <limits>
@@ -68,6 +71,11 @@
 #	include "pool_allocator.h"
 #endif
 #include "TinyJS_Threading.h"
+#ifndef NO_THREADING
+#	include <atomic>
+#endif
+#include "TinyJS_Jit.h"
+#include "TinyJS_Console.h"
 
 
 #ifdef _MSC_VER
@@ -105,7 +113,7 @@
  *  when enum LEX_TYPES are changed, then increment this version
  *  compiled js are created with this version
  */
-#define COMPILED_TOKENS_VERSION_MAX 0x0101
+#define COMPILED_TOKENS_VERSION_MAX 0x0104
 /*!
  *  indicates the lowest supported version of compiled js
  *  when id's inserted, removed or reordered, then set version min to version max
@@ -237,6 +245,15 @@ enum LEX_TYPES {
 	LEX_OPTIONAL_CHAINING_ARRAY,	// .?[ ... ]
 	LEX_OPTIONAL_CHANING_FNC,		// .?( ... )
 
+	LEX_T_TAIL_CALL,				// '(' of a call in tail-position (return f( ... ))
+
+	// superinstructions - the token is followed by the original tokens
+#define LEX_TOKEN_SUPERINSTRUCTION_BEGIN LEX_T_INC_ID
+	LEX_T_INC_ID,					// ID++ ID-- ++ID --ID ID+=INT ID-=INT
+	LEX_T_INC_MEMBER,				// ID.ID++ ID.ID-- ++ID.ID --ID.ID ID.ID+=INT ID.ID-=INT
+	LEX_T_CMP_ID,					// ID<INT ID<=INT ID>INT ID>=INT (or ID instead of INT)
+#define LEX_TOKEN_SUPERINSTRUCTION_END LEX_T_CMP_ID
+
 };
 #define LEX_TOKEN_DATA_STRING(tk)							((LEX_TOKEN_STRING_BEGIN<= tk && tk <= LEX_TOKEN_STRING_END))
 #define LEX_TOKEN_DATA_FLOAT(tk)							(tk==LEX_FLOAT)
@@ -333,6 +350,9 @@ std::string getJSString(const std::string &str);
 /// convert the given double into a string
 std::string float2string(const double &floatData);
 
+/// returns the array-index of str or uint32_t(-1) if str is not an array-index
+uint32_t isArrayIndex(const std::string &str);
+
 
 //////////////////////////////////////////////////////////////////////////
 /// CScriptException
@@ -356,6 +376,13 @@ public:
 	std::string toString();
 };
 
+/// aborts an evaluation (e.g. by CScriptWatchdog) - never converted into a script-Error (e.g. by eval)
+class CScriptInterruptException : public CScriptException {
+public:
+	CScriptInterruptException(const std::string &Message, const std::string &File, int32_t Line=-1, int32_t Column=-1) :
+		CScriptException(Error, Message, File, Line, Column) {}
+};
+
 
 //////////////////////////////////////////////////////////////////////////
 /// CScriptLex
@@ -453,7 +480,12 @@ private:
 
 class CScriptTokenDataFnc : public fixed_size_object<CScriptTokenDataFnc>, public CScriptTokenData {
 public:
+#ifndef NO_JIT
+	CScriptTokenDataFnc(int32_t Type) : type(Type), line(0), callCount(0), jitState(JIT_NONE), jitCode(0) {}
+	virtual ~CScriptTokenDataFnc() OVERRIDE { delete jitCode; }
+#else
 	CScriptTokenDataFnc(int32_t Type) : type(Type), line(0) {}
+#endif
 	CScriptTokenDataFnc(std::istream &in);
 	virtual void serialize(std::ostream &out) const OVERRIDE;
 	std::string getArgumentsString(bool forArrowFunction=false);
@@ -467,12 +499,21 @@ public:
 	bool isGenerator() { return type == LEX_T_GENERATOR || type == LEX_T_GENERATOR_OPERATOR || type == LEX_T_GENERATOR_MEMBER; }
 	bool isArrowFunction() { return type == LEX_T_FUNCTION_ARROW; }
 
+#ifndef NO_JIT
+	// baseline-JIT (see CTinyJS::setJitThreshold)
+	uint32_t callCount;
+	enum { JIT_NONE, JIT_COMPILED, JIT_FAILED } jitState;
+	CScriptJitCode *jitCode;
+private:
+	CScriptTokenDataFnc(const CScriptTokenDataFnc &) MEMBER_DELETE;
+	CScriptTokenDataFnc &operator=(const CScriptTokenDataFnc &) MEMBER_DELETE;
+#endif
 };
 typedef CScriptTokenDataPtr<CScriptTokenDataFnc> CScriptTokenDataFncPtr;
 
 class CScriptTokenDataForwards : public fixed_size_object<CScriptTokenDataForwards>, public CScriptTokenData {
 public:
-	CScriptTokenDataForwards() {}
+	CScriptTokenDataForwards() : bindingsBuilt(false) {}
 	CScriptTokenDataForwards(std::istream &in);
 	virtual void serialize(std::ostream &out) const OVERRIDE;
 
@@ -499,7 +540,22 @@ public:
 	typedef FNC_SET_t::iterator FNC_SET_it;
 	FNC_SET_t functions;
 
+	/// a binding of the scope-template - sorted by name like the childs of a scope
+	struct BINDING {
+		std::string name;
+		int flags;
+		const CScriptToken *function; ///< the hoisted function or 0 (undefined)
+	};
+	typedef std::vector<BINDING> BINDINGS_t;
+	/// the lets (for the let-scope) and the vars, consts and functions (for the var-scope)
+	/// built on the first use from the names above - installed with CTinyJS::installBindings
+	const BINDINGS_t &getLetBindings() { if(!bindingsBuilt) buildBindings(); return letBindings; }
+	const BINDINGS_t &getVarBindings() { if(!bindingsBuilt) buildBindings(); return varBindings; }
+	const BINDING *findVarBinding(const std::string &Name);
 private:
+	void buildBindings();
+	bool bindingsBuilt;
+	BINDINGS_t letBindings, varBindings;
 };
 
 #ifdef old
@@ -716,12 +772,138 @@ private:
 };
 
 
+//////////////////////////////////////////////////////////////////////////
+/// CScriptTypeFeedback - observed types at token-sites
+//////////////////////////////////////////////////////////////////////////
+
+enum TYPEFEEDBACK_TYPES {
+	TYPEFEEDBACK_UNDEFINED	= 1<<0,
+	TYPEFEEDBACK_NULL		= 1<<1,
+	TYPEFEEDBACK_BOOL		= 1<<2,
+	TYPEFEEDBACK_INT32		= 1<<3,
+	TYPEFEEDBACK_DOUBLE		= 1<<4,	///< Double, NaN or Infinity
+	TYPEFEEDBACK_STRING		= 1<<5,
+	TYPEFEEDBACK_ARRAY		= 1<<6,
+	TYPEFEEDBACK_FUNCTION	= 1<<7,
+	TYPEFEEDBACK_OBJECT		= 1<<8,	///< all other objects
+	TYPEFEEDBACK_OTHER		= 1<<9,	///< e.g. Accessor or Symbol
+};
+
+class CScriptVarPtr;
+/// the side-table for arithmetic-, comparison-, property-access- and call-sites
+/// filled by CTinyJS in profiling mode (see CTinyJS::setTypeFeedback)
+/// the sites are identified by file, line & column of the token
+class CScriptTypeFeedback {
+public:
+	struct SITE {
+		SITE() : token(0), count(0), lhsTypes(0), rhsTypes(0), calleePolymorphic(false) {}
+		uint16_t token;				///< the operator, '.', '[' or '('
+		uint32_t count;				///< how often the site was executed
+		uint16_t lhsTypes;			///< TYPEFEEDBACK_TYPES of the left operand, the object of a property-access or the callee
+		uint16_t rhsTypes;			///< TYPEFEEDBACK_TYPES of the right operand or of the arguments of a call
+		std::string callee;			///< first callee of a call-site ("name:line")
+		bool calleePolymorphic;		///< more than one callee was called at this site
+		bool isPolymorphic() const;
+	};
+	struct KEY {
+		KEY(const std::string &File, uint16_t Line, uint16_t Column) : file(File), line(Line), column(Column) {}
+		bool operator<(const KEY &rhs) const { return line != rhs.line ? line < rhs.line : column != rhs.column ? column < rhs.column : file < rhs.file; }
+		std::string file;
+		uint16_t line;
+		uint16_t column;
+	};
+	typedef std::map<KEY, SITE> SITES_t;
+	typedef SITES_t::iterator SITES_it;
+	typedef SITES_t::const_iterator SITES_cit;
+
+	const SITE *find(const std::string &File, int Line, int Column) const;
+	const SITES_t &getSites() const { return sites; }
+	bool empty() const { return sites.empty(); }
+	void clear() { sites.clear(); }
+	bool hasFile(const std::string &File) const; ///< returns true if a site of File is recorded
+	void merge(const CScriptTypeFeedback &Other, const std::string &File); ///< adds the sites of File recorded in Other
+
+	void record(const std::string &File, const CScriptToken &Site, const CScriptVarPtr &Lhs);
+	void record(const std::string &File, const CScriptToken &Site, const CScriptVarPtr &Lhs, const CScriptVarPtr &Rhs);
+	void recordCall(const std::string &File, const CScriptToken &Site, const CScriptVarPtr &Callee, const std::vector<CScriptVarPtr> &Arguments);
+	static uint16_t getType(const CScriptVarPtr &Var);
+
+	void serialize(std::ostream &out) const;
+	void unserialize(std::istream &in);
+private:
+	SITE &getSite(const std::string &File, const CScriptToken &Site);
+	SITES_t sites;
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptAllocationProfiler
+//////////////////////////////////////////////////////////////////////////
+
+class CTinyJS;
+
+/// samples the allocations of script objects (see CTinyJS::setAllocationProfiler)
+/// every SampleEvery'th allocation is sampled - or with SampleBytes the first allocation after SampleBytes bytes
+/// a sample records the JS stack (the current position and the called functions) and is attributed to the
+/// type of the var when the var is freed or the sites are requested
+class CScriptAllocationProfiler {
+public:
+	CScriptAllocationProfiler(uint32_t SampleEvery=1000, uint32_t SampleBytes=0);
+	struct SITE {
+		SITE() : count(0), bytes(0), liveCount(0), liveBytes(0) {}
+		uint64_t count, bytes;			///< the sampled allocations
+		uint64_t liveCount, liveBytes;	///< the sampled allocations not freed yet
+	};
+	/// the key is the stack (innermost first e.g. "file:12:5 < f@file:10") and the type of the var
+	typedef std::map<std::pair<std::string, std::string>, SITE> SITES_t;
+	typedef SITES_t::const_iterator SITES_cit;
+	/// the sites of the freed and the live samples
+	SITES_t getSites() const;
+	/// writes the MaxSites sites with the most sampled bytes
+	void report(std::ostream &out, size_t MaxSites=20) const;
+	void clear();
+	uint64_t getSamplesCount() const { return samplesCount; }
+
+	// called by CTinyJS and CScriptVar
+	bool sample(size_t Size) {
+		if((countdown -= sampleBytes ? int64_t(Size) : 1) > 0) return false;
+		countdown = sampleBytes ? sampleBytes : sampleEvery;
+		return true;
+	}
+	void record(const void *Var, size_t Size, const std::string &Stack);
+	bool isLastSample(const void *Var) { if(Var != lastSample) return false; lastSample = 0; return true; }
+	void freed(const void *Var, uint32_t TypeTag);
+	/// the live samples of Context are moved into the sites - the vars are not tracked anymore
+	void detach(CTinyJS *Context);
+private:
+	struct LIVE {
+		std::string stack;
+		size_t size;
+	};
+	static const char *getTypeName(uint32_t TypeTag);
+	std::map<const void *, LIVE> live;
+	SITES_t sites;
+	uint32_t sampleEvery, sampleBytes;
+	int64_t countdown;
+	uint64_t samplesCount;
+	const void *lastSample;
+};
+
+
 //////////////////////////////////////////////////////////////////////////
 /// CScriptTokenizer - converts the code in a vector with tokens
 //////////////////////////////////////////////////////////////////////////
 
 typedef std::vector<size_t> MARKS_t;
 
+/// a source-file for CScriptTokenizer::tokenizeSources
+struct CScriptCompiledSource {
+	CScriptCompiledSource(const std::string &File, const std::string &Name="") : file(File), name(Name.size() ? Name : File) {}
+	std::string file;		///< the file to read
+	std::string name;		///< the file-name used by the tokens (error-messages, __filename)
+	std::string compiled;	///< the compiled tokens (see CScriptTokenizer::unserialize) - empty on error
+	std::string error;		///< the error-message if the file can't be read or tokenized
+};
+
 class CScriptTokenizer
 {
 public:
@@ -738,7 +920,7 @@ public:
 		int currentColumn() const { return pos->column; }
 	};
 	struct ScriptTokenState {
-		ScriptTokenState() : LeftHand(false), /*FunctionIsGenerator(false),*/ HaveReturnValue(false) {}
+		ScriptTokenState() : LeftHand(false), /*FunctionIsGenerator(false),*/ HaveReturnValue(false), LastCallBegin(0), LastCallOpen(0), LastCallEnd(0) {}
 		TOKEN_VECT Tokens;
 		FORWARDER_VECTOR_t Forwarders;
 		MARKS_t Marks;
@@ -750,17 +932,26 @@ public:
 		std::vector<bool> States;
 //		bool FunctionIsGenerator;
 		bool HaveReturnValue;
+		size_t LastCallBegin, LastCallOpen, LastCallEnd; // token-indices of the last tokenized call-expression
 	};
 	CScriptTokenizer();
 	CScriptTokenizer(CScriptLex &Lexer);
 	CScriptTokenizer(const char *Code, const std::string &File="", int Line=0, int Column=0);
 	static bool writeCompiledTokens;
+	/// tokenizes the independent Sources on Threads threads (0 = one per processor)
+	/// with AsModules the sources are wrapped like the modules of require (see CScriptBundle::tokenizeModule)
+	static void tokenizeSources(std::vector<CScriptCompiledSource> &Sources, bool AsModules=false, unsigned Threads=0);
+	/// collected type-feedback (see CTinyJS::setTypeFeedback) is stored with the compiled tokens
+	CScriptTypeFeedback typeFeedback;
+	/// the source-file of the tokens read by CScriptTokenizer(0, File) - the .jsc is File+'c'
+	std::string sourceFile;
 private:
 	void unserialize(const std::string &File, const std::string &FileC="");
+public:
 	void serialize(std::ostream &out) const;
+	bool unserialize(std::istream &in, const std::string &File); ///< returns false if the stream contains no compatible compiled tokens
 	void serialize(const std::string &File);
 	void serialize(const std::string &File, const std::nothrow_t &);
-public:
 
 	void tokenizeCode(CScriptLex &Lexer);
 
@@ -823,6 +1014,36 @@ private:
 	std::vector<ScriptTokenPosition> tokenScopeStack;
 };
 
+//////////////////////////////////////////////////////////////////////////
+/// CScriptBundle
+//////////////////////////////////////////////////////////////////////////
+
+/// a bundle (.jsb) holds the compiled tokens of many modules in one file
+/// the file is mapped once and a module is unserialized on its first require
+/// a bundle is read-only and can be shared by all contexts (see CTinyJS::addBundle)
+class CScriptBundle {
+public:
+	CScriptBundle() : data(0), size(0), mapped(false) {}
+	~CScriptBundle() { close(); }
+	bool open(const std::string &File); ///< returns false if the file is not a compatible bundle
+	void close();
+	bool isOpen() const { return data != 0; }
+	bool find(const std::string &Name) const { return index.find(Name) != index.end(); }
+	bool load(const std::string &Name, CScriptTokenizer &Tokenizer) const;
+	STRING_VECTOR_t getNames() const;
+	/// writes a bundle of the modules Files, Names are the module-names (relative paths as used by require)
+	static void write(const std::string &File, const STRING_VECTOR_t &Names, const STRING_VECTOR_t &Files);
+	/// wraps the code of a module into function(exports, require, module, __filename, __dirname){...}
+	static void tokenizeModule(const std::string &Code, const std::string &Path, CScriptTokenizer &Tokenizer);
+private:
+	CScriptBundle(const CScriptBundle &);
+	CScriptBundle &operator=(const CScriptBundle &);
+	const char *data;
+	size_t size;
+	bool mapped;
+	std::map<std::string, std::pair<uint32_t, uint32_t> > index; // name -> offset, size
+};
+
 
 //////////////////////////////////////////////////////////////////////////
 /// forward-declaration
@@ -886,17 +1107,241 @@ private:
 /// CScriptVar
 //////////////////////////////////////////////////////////////////////////
 
-typedef	std::vector<class CScriptVarLinkPtr> SCRIPTVAR_CHILDS_t;
+/// a vector with the size of one pointer - an empty vector allocates no memory
+/// the elements are moved with memmove - T must be relocatable (e.g. a smart-pointer)
+template<typename T>
+class CScriptCompactVector {
+public:
+	typedef T value_type;
+	typedef T *iterator;
+	typedef const T *const_iterator;
+	typedef std::reverse_iterator<iterator> reverse_iterator;
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+	typedef size_t size_type;
+
+	CScriptCompactVector() : block(0) {}
+	~CScriptCompactVector() { clear(); free(block); }
+
+	iterator begin() { return block ? block->data() : 0; }
+	iterator end() { return block ? block->data()+block->size : 0; }
+	const_iterator begin() const { return block ? block->data() : 0; }
+	const_iterator end() const { return block ? block->data()+block->size : 0; }
+	reverse_iterator rbegin() { return reverse_iterator(end()); }
+	reverse_iterator rend() { return reverse_iterator(begin()); }
+	size_type size() const { return block ? block->size : 0; }
+	bool empty() const { return !block || block->size == 0; }
+	T &operator[](size_type Idx) { return block->data()[Idx]; }
+	const T &operator[](size_type Idx) const { return block->data()[Idx]; }
+	T &front() { return *begin(); }
+	T &back() { return end()[-1]; }
+
+	iterator insert(iterator Pos, const T &Value) {
+		size_type idx = Pos - begin();
+		T copy(Value); // Value can be an element of this
+		reserve(size()+1);
+		T *pos = block->data()+idx;
+		memmove((void*)(pos+1), (void*)pos, (block->size-idx)*sizeof(T));
+		new(pos) T();
+		pos->swap(copy);
+		++block->size;
+		return pos;
+	}
+	void insert(iterator Pos, size_type Count, const T &Value) { while(Count--) Pos = insert(Pos, Value); }
+	/// inserts the sorted Values into this sorted vector with one pass from the back (Less compares two elements)
+	template<typename LESS> void merge(const T *Values, size_type Count, LESS Less) {
+		if(!Count) return;
+		reserve(size()+Count);
+		T *data = block->data(), *src = data+block->size, *dst = src+Count;
+		const T *value = Values+Count;
+		while(value != Values) {
+			if(src != data && Less(value[-1], src[-1])) {
+				--src; --dst;
+				memcpy((void*)dst, (void*)src, sizeof(T)); // relocate
+			} else {
+				--value; --dst;
+				new(dst) T(*value);
+			}
+		}
+		block->size += uint32_t(Count);
+	}
+	void push_back(const T &Value) { insert(end(), Value); }
+	iterator erase(iterator Pos) { return erase(Pos, Pos+1); }
+	iterator erase(iterator First, iterator Last) {
+		if(First == Last) return First;
+		size_type idx = First - begin();
+		for(iterator it = First; it != Last; ++it) it->~T();
+		memmove((void*)First, (void*)Last, (end()-Last)*sizeof(T));
+		block->size -= uint32_t(Last-First);
+		return begin()+idx;
+	}
+	void clear() { if(block) erase(begin(), end()); }
+	void reserve(size_type Capacity) {
+		if(Capacity <= (block ? block->capacity : 0)) return;
+		size_type capacity = block ? block->capacity*2 : 2;
+		if(capacity < Capacity) capacity = Capacity;
+		Block *newBlock = (Block*)realloc(block, sizeof(Block)+capacity*sizeof(T));
+		if(!newBlock) throw std::bad_alloc();
+		if(!block) newBlock->size = 0;
+		newBlock->capacity = uint32_t(capacity);
+		block = newBlock;
+	}
+private:
+	CScriptCompactVector(const CScriptCompactVector &Copy) MEMBER_DELETE;
+	CScriptCompactVector &operator=(const CScriptCompactVector &Copy) MEMBER_DELETE;
+	struct Block {
+		uint32_t size, capacity;
+		T *data() { return reinterpret_cast<T*>(this+1); }
+	};
+	Block *block;
+};
+
+/// the search-key in the childs-array - the name is parsed for an array-index only once per search
+struct CScriptVarChildKey {
+	CScriptVarChildKey(const std::string &Name) : name(Name), arrayIndex(isArrayIndex(Name)) {}
+	const std::string &name;
+	uint32_t arrayIndex;
+};
+
+typedef	CScriptCompactVector<class CScriptVarLinkPtr> SCRIPTVAR_CHILDS_t;
 typedef	SCRIPTVAR_CHILDS_t::iterator SCRIPTVAR_CHILDS_it;
 typedef	SCRIPTVAR_CHILDS_t::reverse_iterator SCRIPTVAR_CHILDS_rit;
 typedef	SCRIPTVAR_CHILDS_t::const_iterator SCRIPTVAR_CHILDS_cit;
 
+/// the type-tags of the CScriptVar-classes
+/// every constructor adds the tag of its class - a var has the tags of its class and of all base-classes
+enum SCRIPTVAR_TYPE_TAG {
+	TYPE_TAG_PRIMITIVE				= 1<<0,
+	TYPE_TAG_UNDEFINED				= 1<<1,
+	TYPE_TAG_NULL					= 1<<2,
+	TYPE_TAG_STRING					= 1<<3,
+	TYPE_TAG_NUMBER					= 1<<4,
+	TYPE_TAG_BOOL					= 1<<5,
+	TYPE_TAG_OBJECT					= 1<<6,
+	TYPE_TAG_ERROR					= 1<<7,
+	TYPE_TAG_ARRAY					= 1<<8,
+	TYPE_TAG_REGEXP					= 1<<9,
+	TYPE_TAG_DATE					= 1<<10,
+	TYPE_TAG_FUNCTION				= 1<<11,
+	TYPE_TAG_FUNCTION_BOUNDED		= 1<<12,
+	TYPE_TAG_FUNCTION_NATIVE		= 1<<13,
+	TYPE_TAG_FUNCTION_NATIVE_DIRECT	= 1<<14,
+	TYPE_TAG_ACCESSOR				= 1<<15,
+	TYPE_TAG_SCOPE					= 1<<16,
+	TYPE_TAG_SCOPE_FNC				= 1<<17,
+	TYPE_TAG_SCOPE_LET				= 1<<18,
+	TYPE_TAG_SCOPE_WITH				= 1<<19,
+	TYPE_TAG_ITERATOR				= 1<<20,
+	TYPE_TAG_GENERATOR				= 1<<21,
+};
+/// CScriptVar::varFlags holds the type-tags in the lower bits and the flags above
+enum SCRIPTVAR_FLAGS {
+	SCRIPTVAR_TYPE_TAG_MASK			= (1<<24)-1,
+	SCRIPTVAR_EXTENSIBLE			= 1<<24,
+	SCRIPTVAR_SAMPLED				= 1<<25,	///< sampled by the CScriptAllocationProfiler of the context
+	SCRIPTVAR_STRING_HASHED			= 1<<26,	///< CScriptVarString::hash is computed
+	SCRIPTVAR_STRING_INTERNED		= 1<<27,	///< the string is in the CScriptStringTable of the context
+	SCRIPTVAR_STRING_ASCII			= 1<<28,	///< all characters of the string are ASCII (code-unit == byte)
+};
+/// the type-tag of a class (see define_ScriptVarPtr_TaggedType)
+/// classes without a tag (e.g. classes of an application) are casted with dynamic_cast
+template<typename C> struct CScriptVarTypeTag { enum { value = 0 }; };
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptVarHeap
+//////////////////////////////////////////////////////////////////////////
+
+/// the vars of a context are allocated from size-segregated pages owned by the context
+/// (see CScriptVar::operator new). A page holds the slots of one size-class, allocation
+/// pops the free-list of the page or bumps into the never used slots of the page.
+/// The live- and mark-bits of the slots are bitmaps in the page-header, so the garbage
+/// collector enumerates the vars page by page in memory-order. The unreachable vars
+/// are swept lazily and incrementally: an allocation that needs a new page sweeps
+/// up to SWEEP_PAGES pages with garbage first. So the pause of a collection is the
+/// marking only, the garbage is finalized (cleanUp4Destroy) in the thread of the context
+/// in the order of the pages
+class CScriptVarHeap {
+public:
+	enum {
+		PAGE_SIZE		= 16384,	///< pages are aligned to PAGE_SIZE - the page of a var is found by its address
+		MIN_SLOT_SIZE	= 32,
+		SLOT_ALIGN		= 16,
+		SIZE_CLASSES	= 64,		///< vars up to SIZE_CLASSES*SLOT_ALIGN bytes - bigger vars gets a page for its own
+		BITMAP_WORDS	= PAGE_SIZE/MIN_SLOT_SIZE/32,
+		SWEEP_PAGES		= 2,		///< the pages swept by an allocation at most
+	};
+	CScriptVarHeap();
+	~CScriptVarHeap();
+
+	void *alloc(size_t Size);
+	static void free(void *p);
+
+	/// the mark of the first mark-slot (see CScriptVar::setTemporaryMark)
+	/// a page holds the marks of one ID only - setting a new ID clears the marks of the old ID
+	static void setMark(const void *p, uint32_t ID) {
+		Page *page = pageOf(p); uint32_t i = page->indexOf(p);
+		if(ID && page->markID != ID) page->clearMarks(ID);
+		if(ID) page->markBits[i>>5] |= 1u<<(i&31);
+		else page->markBits[i>>5] &= ~(1u<<(i&31));
+	}
+	static uint32_t getMark(const void *p) {
+		Page *page = pageOf(p); uint32_t i = page->indexOf(p);
+		return page->markBits[i>>5] & (1u<<(i&31)) ? page->markID : 0;
+	}
+	/// true if the var is garbage not swept yet
+	static bool isGarbage(const void *p) {
+		Page *page = pageOf(p); uint32_t i = page->indexOf(p);
+		return (page->garbageBits[i>>5] & (1u<<(i&31))) != 0;
+	}
+
+	/// all live vars without the garbage not swept yet in memory-order
+	void getVars(std::vector<CScriptVar*> &Vars);
+	/// the live vars without the mark ID becomes garbage and are swept lazily
+	void markGarbage(uint32_t ID);
+	/// sweeps all pages with garbage and releases the empty pages (e.g. at the end of the context or in idle-time)
+	void sweep();
+	size_t pagesCount() const { return pages.size(); }
+private:
+	CScriptVarHeap(const CScriptVarHeap &Copy) MEMBER_DELETE;
+	CScriptVarHeap &operator=(const CScriptVarHeap &Copy) MEMBER_DELETE;
+	struct Page {
+		CScriptVarHeap *heap;
+		Page *prevAvailable, *nextAvailable;	///< the pages of the size-class with free slots
+		Page *nextSweep;						///< the pages with garbage
+		void *freeList;
+		uint32_t sizeClass, slotSize, slotCount;
+		uint32_t used, bump;					///< the count of live slots, the first never used slot
+		uint32_t index;							///< the index in CScriptVarHeap::pages
+		uint32_t markID;
+		bool available, pendingSweep;
+		uint32_t liveBits[BITMAP_WORDS], markBits[BITMAP_WORDS], garbageBits[BITMAP_WORDS];
+		char *slots() { return reinterpret_cast<char*>(this) + HEADER_SIZE; }
+		uint32_t indexOf(const void *p) { return uint32_t(static_cast<const char*>(p) - slots()) / slotSize; }
+		void clearMarks(uint32_t ID);
+	};
+	enum { HEADER_SIZE = (sizeof(Page) + SLOT_ALIGN-1) & ~(SLOT_ALIGN-1) };
+	static Page *pageOf(const void *p) { return reinterpret_cast<Page*>(uintptr_t(p) & ~uintptr_t(PAGE_SIZE-1)); }
+	Page *newPage(uint32_t SizeClass, size_t SlotSize);
+	void releasePage(Page *page);
+	void linkAvailable(Page *page);
+	void unlinkAvailable(Page *page);
+	void sweepPage(Page *page);
+	std::vector<Page*> pages;
+	Page *available[SIZE_CLASSES];
+	Page *sweepList;
+	std::vector<CScriptVar*> garbage;
+};
+
 // CScriptVar is the base class of all variable values.
 // Instances of CScriptVar can only exists as pointer. CScriptVarPtr holds this pointer
 
 // CScriptVar is the base class of all variable values.
 //
-class CScriptVar : public fixed_size_object<CScriptVar> {
+class CScriptVar {
+public:
+	/// the vars are allocated from the heap of the context: new(Context) CScriptVarXXX(Context, ...)
+	static void *operator new(size_t Size, CTinyJS *Context); // defined as inline at end of this file
+	static void operator delete(void *p, CTinyJS *) { CScriptVarHeap::free(p); } // only called if a constructor throws
+	static void operator delete(void *p) { CScriptVarHeap::free(p); }
 protected:
 	CScriptVar(CTinyJS* Context, const CScriptVarPtr& Prototype); ///< Create
 	CScriptVar(const CScriptVar& Copy) MEMBER_DELETE; ///< Copy protected
@@ -916,33 +1361,36 @@ public:
 
 	void setPrototype(const CScriptVarPtr& Prototype);
 
-	/// Type
-	virtual bool isObject();	///< is an Object
-	virtual bool isArray();		///< is an Array
-	virtual bool isDate();		///< is a Date-Object
-	virtual bool isError();		///< is an ErrorObject
-	virtual bool isRegExp();	///< is a RegExpObject
-	virtual bool isAccessor();	///< is an Accessor
-	virtual bool isNull();		///< is Null
-	virtual bool isUndefined();	///< is Undefined
-	bool isNullOrUndefined();	///< is Null or Undefined
+	/// Type - the type-predicates compares only the type-tag
+	uint32_t getTypeTag() const { return varFlags & SCRIPTVAR_TYPE_TAG_MASK; }
+	bool hasTypeTag(uint32_t Tag) const { return (varFlags & Tag) != 0; }
+	bool isObject() const { return (varFlags & (TYPE_TAG_OBJECT|TYPE_TAG_SCOPE)) == TYPE_TAG_OBJECT; }	///< is an Object (scopes are not)
+	bool isArray() const { return hasTypeTag(TYPE_TAG_ARRAY); }			///< is an Array
+	bool isDate() const { return hasTypeTag(TYPE_TAG_DATE); }			///< is a Date-Object
+	bool isError() const { return hasTypeTag(TYPE_TAG_ERROR); }			///< is an ErrorObject
+	bool isRegExp() const { return hasTypeTag(TYPE_TAG_REGEXP); }		///< is a RegExpObject
+	bool isAccessor() const { return hasTypeTag(TYPE_TAG_ACCESSOR); }	///< is an Accessor
+	bool isNull() const { return hasTypeTag(TYPE_TAG_NULL); }			///< is Null
+	bool isUndefined() const { return hasTypeTag(TYPE_TAG_UNDEFINED); }	///< is Undefined
+	bool isNullOrUndefined() const { return hasTypeTag(TYPE_TAG_NULL|TYPE_TAG_UNDEFINED); } ///< is Null or Undefined
 	virtual bool isNaN();		///< is NaN
-	virtual bool isString();	///< is String
+	bool isString() const { return hasTypeTag(TYPE_TAG_STRING); }		///< is String
 	virtual bool isInt();		///< is Integer
-	virtual bool isBool();		///< is Bool
+	bool isBool() const { return hasTypeTag(TYPE_TAG_BOOL); }			///< is Bool
 	virtual int isInfinity();	///< is Infinity ///< +1==POSITIVE_INFINITY, -1==NEGATIVE_INFINITY, 0==is not an InfinityVar
 	virtual bool isDouble();	///< is Double
 
 	virtual bool isRealNumber();///< is isInt | isDouble
-	virtual bool isNumber();	///< is isNaN | isInt | isDouble | isInfinity
-	virtual bool isPrimitive();	///< isNull | isUndefined | isNaN | isString | isInt | isDouble | isInfinity
+	bool isNumber() const { return hasTypeTag(TYPE_TAG_NUMBER); }		///< is isNaN | isInt | isDouble | isInfinity
+	bool isPrimitive() const { return hasTypeTag(TYPE_TAG_PRIMITIVE); }	///< isNull | isUndefined | isNaN | isString | isInt | isDouble | isInfinity
 
-	virtual bool isFunction();	///< is CScriptVarFunction / CScriptVarFunctionNativeCallback / CScriptVarFunctionNativeClass
-	virtual bool isNative();	///< is CScriptVarFunctionNativeCallback / CScriptVarFunctionNativeClass
-	virtual bool isBounded();	///< is CScriptVarFunctionBounded
+	bool isFunction() const { return hasTypeTag(TYPE_TAG_FUNCTION); }	///< is CScriptVarFunction / CScriptVarFunctionNativeCallback / CScriptVarFunctionNativeClass
+	bool isNative() const { return hasTypeTag(TYPE_TAG_FUNCTION_NATIVE); }	///< is CScriptVarFunctionNativeCallback / CScriptVarFunctionNativeClass
+	bool isNativeDirect() const { return hasTypeTag(TYPE_TAG_FUNCTION_NATIVE_DIRECT); }	///< is CScriptVarFunctionNativeDirect
+	bool isBounded() const { return hasTypeTag(TYPE_TAG_FUNCTION_BOUNDED); }	///< is CScriptVarFunctionBounded
 
-	virtual bool isIterator();
-	virtual bool isGenerator();
+	bool isIterator() const { return hasTypeTag(TYPE_TAG_ITERATOR|TYPE_TAG_GENERATOR); }
+	bool isGenerator() const { return hasTypeTag(TYPE_TAG_GENERATOR); }
 
 	//bool isBasic() const { return Childs.empty(); } ///< Is this *not* an array/object/etc
 
@@ -1008,12 +1456,12 @@ public:
 
 
 	CScriptVarPtr getOwnPropertyDescriptor(const std::string &Name);
-	const char *defineProperty(const std::string &Name, CScriptVarPtr Attributes);
+	const char *defineProperty(const std::string &Name, const CScriptVarPtr &Attributes);
 
 	/// flags
-	void setExtensible(bool On=true)	{ extensible=On; }
-	void preventExtensions()			{ extensible=false; }
-	bool isExtensible() const			{ return extensible; }
+	void setExtensible(bool On=true)	{ if(On) varFlags |= SCRIPTVAR_EXTENSIBLE; else varFlags &= ~SCRIPTVAR_EXTENSIBLE; }
+	void preventExtensions()			{ varFlags &= ~SCRIPTVAR_EXTENSIBLE; }
+	bool isExtensible() const			{ return (varFlags & SCRIPTVAR_EXTENSIBLE) != 0; }
 	void seal();
 	bool isSealed() const;
 	void freeze();
@@ -1065,16 +1513,27 @@ public:
 	SCRIPTVAR_CHILDS_t Childs;
 
 private:
+#ifdef WITH_REFCOUNT_STATISTICS
 	CScriptVar *ref(); ///< Add reference to this variable
 	void unref(); ///< Remove a reference, and delete this variable if required
+#else
+	CScriptVar *ref() { refs++; return this; } ///< Add reference to this variable
+	void unref() { ASSERT(refs>0); if(--refs==0) delete this; } ///< Remove a reference, and delete this variable if required
+#endif
 public:
 	int getRefs() const; ///< Get the number of references to this script variable
 
 	// cast template
 	template<class T>
-	operator T *(){ T *ret = dynamic_cast<T*>(this); ASSERT(ret!=0); return ret; }
+	operator T *(){ T *ret = cast<T>(this); ASSERT(ret!=0); return ret; }
 	template<class T>
-	T *get(){ T *ret = dynamic_cast<T*>(this); ASSERT(ret!=0); return ret; }
+	T *get(){ T *ret = cast<T>(this); ASSERT(ret!=0); return ret; }
+	/// checked cast - a compare of the type-tag for tagged classes otherwise a dynamic_cast
+	template<class T>
+	static T *cast(CScriptVar *Var) {
+		if(CScriptVarTypeTag<T>::value != 0) return Var && Var->hasTypeTag(CScriptVarTypeTag<T>::value) ? static_cast<T*>(Var) : 0;
+		return dynamic_cast<T*>(Var);
+	}
 
 	
 	/// newScriptVar
@@ -1083,20 +1542,20 @@ public:
 	template<typename T>	const CScriptVarPtr &constScriptVar(T t); // { return ::newScriptVar(context, t); }
 
 	/// For memory management/garbage collection
-	void setTemporaryMark(uint32_t ID); // defined as inline at end of this file { temporaryMark[context->getCurrentMarkSlot()] = ID; }
+	/// the marks of the first slot are stored in the page of the var, the marks of nested slots in CTinyJS (see allocUniqueID)
+	void setTemporaryMark(uint32_t ID); // defined as inline at end of this file
 	virtual void cleanUp4Destroy();
 	virtual void setTemporaryMark_recursive(uint32_t ID);
-	uint32_t getTemporaryMark(); // defined as inline at end of this file { return temporaryMark[context->getCurrentMarkSlot()]; }
+	uint32_t getTemporaryMark(); // defined as inline at end of this file
 protected:
-	bool extensible;
-	CTinyJS *context;
+	uint32_t varFlags; ///< the SCRIPTVAR_TYPE_TAG's of the class and the base-classes and the SCRIPTVAR_FLAGS
 	int refs; ///< The number of references held to this - used for garbage collection
+	CTinyJS *context;
 	CScriptVar *prototype;
-	CScriptVar *prev;
-	CScriptVar *next;
-	uint32_t temporaryMark[TEMPORARY_MARK_SLOTS];
 	friend class CTinyJS;
 	friend class CScriptVarPtr;
+	friend class CScriptVarHeap;
+	friend class CScriptAllocationProfiler;
 #if _DEBUG
 	uint32_t debugID;
 #endif
@@ -1131,6 +1590,8 @@ public:
 	// deconstruct
 	~CScriptVarPtr() { if(var) var->unref(); }
 
+	void swap(CScriptVarPtr &Other) { CScriptVar *_var = var; var = Other.var; Other.var = _var; }
+
 	// if
 	operator bool() const { return var!=0; }
 
@@ -1154,10 +1615,25 @@ template<typename C>
 class CScriptVarPointer : public CScriptVarPtr {
 public:
 	CScriptVarPointer() {}
-	CScriptVarPointer(CScriptVar *Var) : CScriptVarPtr(dynamic_cast<C*>(Var)) {}
-	CScriptVarPointer(const CScriptVarPtr &Copy) : CScriptVarPtr(dynamic_cast<C*>(Copy.getVar())) {}
-	CScriptVarPointer<C> &operator=(const CScriptVarPtr &Copy) { CScriptVarPtr::operator=(dynamic_cast<C*>(Copy.getVar())); return *this; }
-	C * operator ->() const { C *Var = dynamic_cast<C*>(var); ASSERT(var && Var); return Var; }
+	CScriptVarPointer(CScriptVar *Var) : CScriptVarPtr(CScriptVar::cast<C>(Var)) {}
+	CScriptVarPointer(const CScriptVarPtr &Copy) : CScriptVarPtr(CScriptVar::cast<C>(Copy.getVar())) {}
+	CScriptVarPointer<C> &operator=(const CScriptVarPtr &Copy) { CScriptVarPtr::operator=(CScriptVar::cast<C>(Copy.getVar())); return *this; }
+	// copy (no cast needed)
+	CScriptVarPointer(const CScriptVarPointer<C> &Copy) : CScriptVarPtr(Copy) {}
+	CScriptVarPointer<C> &operator=(const CScriptVarPointer<C> &Copy) { CScriptVarPtr::operator=(Copy); return *this; }
+#if HAVE_CXX11_RVALUE_REFERENCE
+	// move - the reference is taken over if the var is a C otherwise Other is cleared
+	CScriptVarPointer(CScriptVarPtr &&Other) NOEXCEPT { if(CScriptVar::cast<C>(Other.getVar())) swap(Other); else Other.clear(); }
+	CScriptVarPointer<C> &operator=(CScriptVarPtr &&Other) NOEXCEPT { if(CScriptVar::cast<C>(Other.getVar())) swap(Other); else clear(); Other.clear(); return *this; }
+	CScriptVarPointer(CScriptVarPointer<C> &&Other) NOEXCEPT { swap(Other); }
+	CScriptVarPointer<C> &operator=(CScriptVarPointer<C> &&Other) NOEXCEPT { swap(Other); Other.clear(); return *this; }
+#endif
+	/// var is checked on construction/assignment - a tagged class needs no further check
+	C * operator ->() const {
+		ASSERT(var && CScriptVar::cast<C>(var));
+		if(CScriptVarTypeTag<C>::value != 0) return static_cast<C*>(var);
+		return dynamic_cast<C*>(var);
+	}
 };
 
 
@@ -1170,6 +1646,8 @@ public:
  *  1. a name
  *  2. a CScriptVarPtr as value
  *  3. an owner (scope or object)
+ *  The links in the childs-array are the storage of the properties. The interpreter evaluates
+ *  every expression to a link (see CScriptVarLinkWorkPtr), so a property always needs its link.
  */
 class CScriptVarLink : public fixed_size_object<CScriptVarLink>
 {
@@ -1189,7 +1667,8 @@ public:
 
 	const std::string &getName() const { return name; }
 
-	void reName(const std::string newName) { name = newName; } ///< !!!! Danger !!!! - need resort of childs-array
+	void reName(const std::string newName) { name = newName; arrayIndex = isArrayIndex(name); } ///< !!!! Danger !!!! - need resort of childs-array
+	uint32_t getArrayIndex() const { return arrayIndex; } ///< the name as array-index or uint32_t(-1)
 
 	int getFlags() const { return flags; }
 	const CScriptVarPtr &getVarPtr() const { return var; }
@@ -1236,12 +1715,18 @@ private:
 	std::string name;
 	CScriptVar *owner; // pointer to the owner CScriptVar
 	uint32_t flags;
+	uint32_t arrayIndex; // cached isArrayIndex(name) - the sort-key in the childs-array
 	CScriptVarPtr var;
 #ifdef _DEBUG
 	char dummy[24];
 #endif
+#ifdef WITH_REFCOUNT_STATISTICS
 	CScriptVarLink *ref();
 	void unref();
+#else
+	CScriptVarLink *ref() { refs++; return this; }
+	void unref() { ASSERT(refs>0); if(--refs==0) delete this; }
+#endif
 private:
 	int refs;
 	friend class CScriptVarLinkPtr;
@@ -1301,12 +1786,18 @@ public:
 
 	// for sorting in child-list
 	bool operator<(const std::string &rhs) const;
+	bool operator<(const CScriptVarChildKey &rhs) const {
+		if(link->getArrayIndex() == uint32_t(-1))		// lhs is not an array-idx
+			return rhs.arrayIndex != uint32_t(-1) || link->getName() < rhs.name; // array-idx are sorted at the end
+		return rhs.arrayIndex != uint32_t(-1) && link->getArrayIndex() < rhs.arrayIndex;
+	}
 	bool operator ==(const CScriptVarLinkPtr &rhs) const { return link==rhs.link; }
 	// access to CScriptVarLink
 	CScriptVarLink *operator ->() const { return link; }
 
 	operator const CScriptVarPtr &() const { static CScriptVarPtr NullPtr; return link?link->getVarPtr():NullPtr; }
 
+	void swap(CScriptVarLinkPtr &Other) { CScriptVarLink *_link = link; link = Other.link; Other.link = _link; }
 	void clear() { if(link) link->unref(); link=0; }
 protected:
 	CScriptVarLink *link;
@@ -1341,6 +1832,7 @@ public:
 	// move
 	CScriptVarLinkWorkPtr(CScriptVarLinkWorkPtr &&Other) NOEXCEPT : CScriptVarLinkPtr(std::move(Other)), referencedOwner(std::move(Other.referencedOwner)) {}
 	CScriptVarLinkWorkPtr &operator=(CScriptVarLinkWorkPtr &&Other) NOEXCEPT { CScriptVarLinkPtr::operator=(std::move(Other)); referencedOwner = std::move(Other.referencedOwner); return *this; }
+	CScriptVarLinkWorkPtr(CScriptVarLinkPtr &&Other) NOEXCEPT : CScriptVarLinkPtr(std::move(Other)) { if(link) referencedOwner = link->getOwner(); }
 #endif
 	// assign
 	//void assign(CScriptVarPtr rhs, bool ignoreReadOnly=false, bool ignoreNotOwned=false, bool ignoreNotExtensible=false);
@@ -1353,15 +1845,17 @@ public:
 	CScriptVarLinkWorkPtr setter(CScriptResult &execute, const CScriptVarPtr &Var);
 
 
-	void swap(CScriptVarLinkWorkPtr &Link) {
-		CScriptVarPtr _referencedOwner = referencedOwner; referencedOwner = Link.referencedOwner; Link.referencedOwner = _referencedOwner;
-		CScriptVarLink *_link=link; link=Link.link; Link.link=_link;
-	}
+	void swap(CScriptVarLinkWorkPtr &Link) { CScriptVarLinkPtr::swap(Link); referencedOwner.swap(Link.referencedOwner); }
+
+	/// same as *this = getter(execute) but without a copy of *this if no getter is called
+	CScriptVarLinkWorkPtr &getterInPlace(CScriptResult &execute);
 
 	void clear() { CScriptVarLinkPtr::clear(); referencedOwner.clear(); }
 	void setReferencedOwner(const CScriptVarPtr &Owner) { referencedOwner = Owner; }
 	const CScriptVarPtr &getReferencedOwner() const { return referencedOwner; }
 	bool hasReferencedOwner() const { return referencedOwner; }
+	// true if the link points to an accessor found in the prototype-chain of the referenced owner
+	bool isInheritedAccessor() const;
 private:
 	CScriptVarPtr referencedOwner;
 };
@@ -1377,6 +1871,7 @@ inline CScriptVarLinkWorkPtr CScriptVarLinkPtr::setter( CScriptResult &execute,
 #define define_newScriptVar_Fnc(t1, ...) CScriptVarPtr newScriptVar(__VA_ARGS__)
 #define define_newScriptVar_NamedFnc(t1, ...) CScriptVarPtr newScriptVar##t1(__VA_ARGS__)
 #define define_ScriptVarPtr_Type(t1) class CScriptVar##t1; typedef CScriptVarPointer<CScriptVar##t1> CScriptVar##t1##Ptr
+#define define_ScriptVarPtr_TaggedType(t1, Tag) define_ScriptVarPtr_Type(t1); template<> struct CScriptVarTypeTag<CScriptVar##t1> { enum { value = Tag }; }
 
 #define define_DEPRECATED_newScriptVar_Fnc(t1, ...) CScriptVarPtr DEPRECATED("newScriptVar("#__VA_ARGS__") is deprecated use constScriptVar("#__VA_ARGS__") instead") newScriptVar(__VA_ARGS__)
 
@@ -1385,15 +1880,14 @@ inline CScriptVarLinkWorkPtr CScriptVarLinkPtr::setter( CScriptResult &execute,
 /// CScriptVarPrimitive
 //////////////////////////////////////////////////////////////////////////
 
-define_ScriptVarPtr_Type(Primitive);
+define_ScriptVarPtr_TaggedType(Primitive, TYPE_TAG_PRIMITIVE);
 class CScriptVarPrimitive : public CScriptVar {
 protected:
-	CScriptVarPrimitive(CTinyJS *Context, const CScriptVarPtr &Prototype) : CScriptVar(Context, Prototype) { setExtensible(false); }
+	CScriptVarPrimitive(CTinyJS *Context, const CScriptVarPtr &Prototype) : CScriptVar(Context, Prototype) { varFlags |= TYPE_TAG_PRIMITIVE; setExtensible(false); }
 	CScriptVarPrimitive(const CScriptVarPrimitive& Copy) MEMBER_DELETE;
 public:
 	virtual ~CScriptVarPrimitive() OVERRIDE;
 
-	virtual bool isPrimitive() OVERRIDE;	///< return true;
 
 	virtual CScriptVarPrimitivePtr getRawPrimitive() OVERRIDE;
 	virtual bool toBoolean() OVERRIDE;							/// false by default
@@ -1411,7 +1905,7 @@ protected:
 //////////////////////////////////////////////////////////////////////////
 
 define_dummy_t(Undefined);
-define_ScriptVarPtr_Type(Undefined);
+define_ScriptVarPtr_TaggedType(Undefined, TYPE_TAG_UNDEFINED);
 class CScriptVarUndefined : public CScriptVarPrimitive {
 protected:
 	CScriptVarUndefined(CTinyJS *Context);
@@ -1419,7 +1913,6 @@ protected:
 public:
 	virtual ~CScriptVarUndefined() OVERRIDE;
 
-	virtual bool isUndefined() OVERRIDE; // { return true; }
 
 	virtual CNumber toNumber_Callback() OVERRIDE; // { return NaN; }
 	virtual std::string toCString(int radix=0) OVERRIDE;// { return "undefined"; }
@@ -1428,8 +1921,8 @@ public:
 	friend define_DEPRECATED_newScriptVar_Fnc(Undefined, CTinyJS *, Undefined_t);
 	friend define_newScriptVar_NamedFnc(Undefined, CTinyJS *Context);
 };
-inline define_DEPRECATED_newScriptVar_Fnc(Undefined, CTinyJS *Context, Undefined_t) { return new CScriptVarUndefined(Context); }
-inline define_newScriptVar_NamedFnc(Undefined, CTinyJS *Context) { return new CScriptVarUndefined(Context); }
+inline define_DEPRECATED_newScriptVar_Fnc(Undefined, CTinyJS *Context, Undefined_t) { return new(Context) CScriptVarUndefined(Context); }
+inline define_newScriptVar_NamedFnc(Undefined, CTinyJS *Context) { return new(Context) CScriptVarUndefined(Context); }
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -1437,7 +1930,7 @@ inline define_newScriptVar_NamedFnc(Undefined, CTinyJS *Context) { return new CS
 //////////////////////////////////////////////////////////////////////////
 
 define_dummy_t(Null);
-define_ScriptVarPtr_Type(Null);
+define_ScriptVarPtr_TaggedType(Null, TYPE_TAG_NULL);
 class CScriptVarNull : public CScriptVarPrimitive {
 protected:
 	CScriptVarNull(CTinyJS *Context);
@@ -1445,7 +1938,6 @@ protected:
 public:
 	virtual ~CScriptVarNull() OVERRIDE;
 
-	virtual bool isNull() OVERRIDE; // { return true; }
 
 	virtual CNumber toNumber_Callback() OVERRIDE; // { return 0; }
 	virtual std::string toCString(int radix=0) OVERRIDE;// { return "null"; }
@@ -1455,22 +1947,57 @@ public:
 	friend define_DEPRECATED_newScriptVar_Fnc(Null, CTinyJS *Context, Null_t);
 	friend define_newScriptVar_NamedFnc(Null, CTinyJS *Context);
 };
-inline define_DEPRECATED_newScriptVar_Fnc(Null, CTinyJS *Context, Null_t) { return new CScriptVarNull(Context); }
-inline define_newScriptVar_NamedFnc(Null, CTinyJS *Context) { return new CScriptVarNull(Context); }
+inline define_DEPRECATED_newScriptVar_Fnc(Null, CTinyJS *Context, Null_t) { return new(Context) CScriptVarNull(Context); }
+inline define_newScriptVar_NamedFnc(Null, CTinyJS *Context) { return new(Context) CScriptVarNull(Context); }
+
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptExternalData
+//////////////////////////////////////////////////////////////////////////
+
+/// host-owned memory (e.g. a request-body or a mapped file) used as string-value without copying
+/// the handle is refcounted and can be shared by many strings and contexts (also in different threads).
+/// Release is called when the last reference is dropped - the memory must be valid until then.
+/// Binary data (buffers) are passed the same way - a string in 42TinyJS is a sequence of bytes.
+class CScriptExternalData {
+public:
+	typedef void (*RELEASE_FNC)(const char *Data, size_t Size, void *Userdata);
+	/// creates a handle with a refcount of 1
+	static CScriptExternalData *create(const char *Data, size_t Size, RELEASE_FNC Release=0, void *Userdata=0);
+	CScriptExternalData *ref();
+	void unref();
+	const char *data() const { return ptr; }
+	size_t size() const { return len; }
+private:
+	CScriptExternalData(const char *Data, size_t Size, RELEASE_FNC Release, void *Userdata);
+	~CScriptExternalData();
+	CScriptExternalData(const CScriptExternalData &Copy) MEMBER_DELETE;
+	CScriptExternalData &operator=(const CScriptExternalData &Copy) MEMBER_DELETE;
+	const char *ptr;	// "" for an empty string
+	const char *origin;	// the Data given to create - passed to release
+	size_t len;
+	RELEASE_FNC release;
+	void *userdata;
+#ifndef NO_THREADING
+	std::atomic<int> refs;
+#else
+	int refs;
+#endif
+};
 
 
 //////////////////////////////////////////////////////////////////////////
 /// CScriptVarString
 //////////////////////////////////////////////////////////////////////////
 
-define_ScriptVarPtr_Type(String);
+define_ScriptVarPtr_TaggedType(String, TYPE_TAG_STRING);
 class CScriptVarString : public CScriptVarPrimitive {
 protected:
 	CScriptVarString(CTinyJS *Context, const std::string &Data);
+	CScriptVarString(CTinyJS *Context, CScriptExternalData *External); ///< takes over the reference of External
 	CScriptVarString(const CScriptVarString& Copy) MEMBER_DELETE;
 public:
 	virtual ~CScriptVarString() OVERRIDE;
-	virtual bool isString() OVERRIDE; // { return true; }
 
 	virtual bool toBoolean() OVERRIDE;
 	virtual CNumber toNumber_Callback() OVERRIDE;
@@ -1487,18 +2014,125 @@ public:
 
 
 	size_t DEPRECATED("stringLength is deprecated use getLength instead!") stringLength() { return data.size(); }
+	/// the characters are UTF-8 - a lone surrogate is one character (WTF-8) and
+	/// every byte of an invalid sequence is one character (latin-1)
+	/// length and positions are UTF-16 code-units (a character above U+FFFF has two)
 	virtual uint32_t getLength() OVERRIDE;
-	int getChar(uint32_t Idx);
+	int getChar(uint32_t Idx); ///< the code-unit at Idx or -1
+
+	/// true if every byte is ASCII - the code-units are the bytes
+	bool isAscii() { return (varFlags & SCRIPTVAR_STRING_ASCII) != 0; }
+	static bool isAscii(const char *Data, size_t Size);
+	/// the byte-offset of a code-unit (Unit <= getLength())
+	/// the second code-unit of a surrogate-pair has the offset behind the character
+	size_t unitToByte(uint32_t Unit);
+	/// the code-unit of a byte-offset (Byte <= getDataSize())
+	uint32_t byteToUnit(size_t Byte);
+	/// Count code-units beginning at the code-unit Start - a split surrogate-pair gives a lone surrogate
+	std::string substrUnits(uint32_t Start, uint32_t Count=uint32_t(-1));
+	/// appends a code-unit as UTF-8 (a surrogate as WTF-8)
+	static void appendUnit(std::string &Str, uint32_t Unit);
+
+	/// the characters without copying - not 0-terminated if the string is external
+	const char *getData() { return external ? external->data() : data.data(); }
+	size_t getDataSize() { return external ? external->size() : data.size(); }
+	bool isExternal() { return external != 0; }
+
+	/// the hash of the characters - computed on first use
+	uint32_t getHash() {
+		if(!(varFlags & SCRIPTVAR_STRING_HASHED)) { hash = computeHash(getData(), getDataSize()); varFlags |= SCRIPTVAR_STRING_HASHED; }
+		return hash;
+	}
+	static uint32_t computeHash(const char *Data, size_t Size);
+	/// interned strings are unique by its characters in the context (see CTinyJS::internString)
+	bool isInterned() { return (varFlags & SCRIPTVAR_STRING_INTERNED) != 0; }
+	/// true if both strings have the same characters
+	/// interned strings are compared by the pointers, all other by the length and the hash first
+	bool equals(CScriptVarString *Other);
 protected:
 	std::string data;
+	CScriptExternalData *external;
+	uint32_t hash;
+	CScriptVarString *nextInterned;
+	friend class CScriptStringTable;
+	void initLength();
+	const std::vector<uint32_t> &getUnitIndex();
+	uint32_t length;					// in code-units
+	std::vector<uint32_t> *unitIndex;	// non-ASCII only: the byte-offset of each code-unit and of the end - built on first use
 private:
 	friend define_newScriptVar_Fnc(String, CTinyJS *Context, const std::string &);
 	friend define_newScriptVar_Fnc(String, CTinyJS *Context, const char *);
 	friend define_newScriptVar_Fnc(String, CTinyJS *Context, char *);
+	friend define_newScriptVar_Fnc(String, CTinyJS *Context, CScriptExternalData *);
+};
+inline define_newScriptVar_Fnc(String, CTinyJS *Context, const std::string &Obj) { return new(Context) CScriptVarString(Context, Obj); }
+inline define_newScriptVar_Fnc(String, CTinyJS *Context, const char *Obj) { return new(Context) CScriptVarString(Context, Obj); }
+inline define_newScriptVar_Fnc(String, CTinyJS *Context, char *Obj) { return new(Context) CScriptVarString(Context, Obj); }
+/// an external string - the reference of Obj is taken over (use Obj->ref() to keep an own reference)
+inline define_newScriptVar_Fnc(String, CTinyJS *Context, CScriptExternalData *Obj) { return new(Context) CScriptVarString(Context, Obj); }
+
+/// the interned strings of a context (hash-table with chaining over CScriptVarString::nextInterned)
+/// the table holds no references - an interned string removes itself on destruction
+class CScriptStringTable {
+public:
+	CScriptStringTable() : count(0) {}
+	~CScriptStringTable() { clear(); }
+	CScriptVarString *find(const char *Data, size_t Size, uint32_t Hash) const;
+	void insert(CScriptVarString *String);
+	void remove(CScriptVarString *String);
+	/// removes the garbage not swept yet - a string marked as garbage must not be found again
+	void removeGarbage();
+	/// removes all strings from the table
+	void clear();
+	size_t size() const { return count; }
+private:
+	CScriptStringTable(const CScriptStringTable &) MEMBER_DELETE;
+	CScriptStringTable &operator=(const CScriptStringTable &) MEMBER_DELETE;
+	std::vector<CScriptVarString*> buckets;
+	size_t count;
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptStringRef
+//////////////////////////////////////////////////////////////////////////
+
+/// a read-only view of the characters of a value (used by the string-functions)
+/// string-values (also external strings) are referenced without copying, other values are converted with toString()
+class CScriptStringRef {
+public:
+	typedef const char *const_iterator;
+	static const size_t npos = size_t(-1);
+	CScriptStringRef(const CScriptVarPtr &Var);
+	explicit CScriptStringRef(const std::string &Str) : ptr(Str.data()), len(Str.size()) {} ///< Str must live longer than this
+	CScriptStringRef(const CScriptStringRef &Copy) : var(Copy.var), copy(Copy.copy) { assign(Copy); }
+	CScriptStringRef &operator=(const CScriptStringRef &Copy) { var = Copy.var; copy = Copy.copy; assign(Copy); return *this; }
+
+	const char *data() const { return ptr; }
+	size_t size() const { return len; }
+	size_t length() const { return len; }
+	bool empty() const { return len == 0; }
+	const_iterator begin() const { return ptr; }
+	const_iterator end() const { return ptr+len; }
+	char operator[](size_t Idx) const { return ptr[Idx]; }
+	/// the string-value or an empty pointer if the characters are not referenced from a string-value
+	const CScriptVarPtr &getVar() const { return var; }
+
+	std::string str() const { return std::string(ptr, len); }
+	operator std::string() const { return str(); }
+	std::string substr(size_t Pos=0, size_t Count=npos) const;
+	size_t find(const std::string &Str, size_t Pos=0) const;
+	size_t rfind(const std::string &Str, size_t Pos=npos) const;
+	size_t find_first_not_of(const char *Chars, size_t Pos=0) const;
+	size_t find_last_not_of(const char *Chars, size_t Pos=npos) const;
+	int compare(const std::string &Str) const;
+private:
+	void assign(const CScriptStringRef &Copy) { if(Copy.ptr == Copy.copy.data()) ptr = copy.data(); else ptr = Copy.ptr; len = Copy.len; }
+	CScriptVarPtr var;
+	std::string copy;
+	const char *ptr;
+	size_t len;
 };
-inline define_newScriptVar_Fnc(String, CTinyJS *Context, const std::string &Obj) { return new CScriptVarString(Context, Obj); }
-inline define_newScriptVar_Fnc(String, CTinyJS *Context, const char *Obj) { return new CScriptVarString(Context, Obj); }
-inline define_newScriptVar_Fnc(String, CTinyJS *Context, char *Obj) { return new CScriptVarString(Context, Obj); }
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -1645,14 +2279,13 @@ inline CNumber abs(const CNumber &lhs) { return lhs.abs(); }
 /// CScriptVarNumber
 //////////////////////////////////////////////////////////////////////////
 
-define_ScriptVarPtr_Type(Number);
+define_ScriptVarPtr_TaggedType(Number, TYPE_TAG_NUMBER);
 class CScriptVarNumber : public CScriptVarPrimitive {
 protected:
 	CScriptVarNumber(CTinyJS *Context, const CNumber &Data);
 	CScriptVarNumber(const CScriptVarNumber& Copy) MEMBER_DELETE;
 public:
 	virtual ~CScriptVarNumber() OVERRIDE;
-	virtual bool isNumber() OVERRIDE; // { return true; }
 	virtual bool isInt() OVERRIDE; // { return true; }
 	virtual bool isDouble() OVERRIDE; // { return true; }
 	virtual bool isRealNumber() OVERRIDE; // { return true; }
@@ -1672,7 +2305,7 @@ private:
 	friend define_newScriptVar_NamedFnc(Number, CTinyJS *Context, const CNumber &);
 };
 define_newScriptVar_Fnc(Number, CTinyJS *Context, const CNumber &Obj);
-inline define_newScriptVar_NamedFnc(Number, CTinyJS *Context, const CNumber &Obj) { return new CScriptVarNumber(Context, Obj); }
+inline define_newScriptVar_NamedFnc(Number, CTinyJS *Context, const CNumber &Obj) { return new(Context) CScriptVarNumber(Context, Obj); }
 inline define_newScriptVar_Fnc(Number, CTinyJS *Context, char Obj) { return newScriptVarNumber(Context, CNumber(Obj)); }
 inline define_newScriptVar_Fnc(Number, CTinyJS *Context, int32_t Obj) { return newScriptVarNumber(Context, CNumber(Obj)); }
 inline define_newScriptVar_Fnc(Number, CTinyJS *Context, uint32_t Obj) { return newScriptVarNumber(Context, CNumber(Obj)); }
@@ -1687,14 +2320,13 @@ inline define_DEPRECATED_newScriptVar_Fnc(Infinity, CTinyJS *Context, Infinity O
 /// CScriptVarBool
 //////////////////////////////////////////////////////////////////////////
 
-define_ScriptVarPtr_Type(Bool);
+define_ScriptVarPtr_TaggedType(Bool, TYPE_TAG_BOOL);
 class CScriptVarBool : public CScriptVarPrimitive {
 protected:
 	CScriptVarBool(CTinyJS *Context, bool Data);
 	CScriptVarBool(const CScriptVarBool& Copy) MEMBER_DELETE;
 public:
 	virtual ~CScriptVarBool() OVERRIDE;
-	virtual bool isBool() OVERRIDE; // { return true; }
 
 	virtual bool toBoolean() OVERRIDE;
 	virtual CNumber toNumber_Callback() OVERRIDE;
@@ -1709,8 +2341,8 @@ protected:
 	friend define_DEPRECATED_newScriptVar_Fnc(Bool, CTinyJS *, bool);
 	friend define_newScriptVar_NamedFnc(Bool, CTinyJS *Context, bool);
 };
-inline define_DEPRECATED_newScriptVar_Fnc(Bool, CTinyJS *Context, bool Obj) { return new CScriptVarBool(Context, Obj); }
-inline define_newScriptVar_NamedFnc(Bool, CTinyJS *Context, bool Obj) { return new CScriptVarBool(Context, Obj); }
+inline define_DEPRECATED_newScriptVar_Fnc(Bool, CTinyJS *Context, bool Obj) { return new(Context) CScriptVarBool(Context, Obj); }
+inline define_newScriptVar_NamedFnc(Bool, CTinyJS *Context, bool Obj) { return new(Context) CScriptVarBool(Context, Obj); }
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -1718,13 +2350,13 @@ inline define_newScriptVar_NamedFnc(Bool, CTinyJS *Context, bool Obj) { return n
 //////////////////////////////////////////////////////////////////////////
 
 define_dummy_t(Object);
-define_ScriptVarPtr_Type(Object);
+define_ScriptVarPtr_TaggedType(Object, TYPE_TAG_OBJECT);
 
 class CScriptVarObject : public CScriptVar {
 protected:
 	CScriptVarObject(CTinyJS *Context);
-	CScriptVarObject(CTinyJS *Context, const CScriptVarPtr &Prototype) : CScriptVar(Context, Prototype) {}
-	CScriptVarObject(CTinyJS *Context, const CScriptVarPrimitivePtr &Value, const CScriptVarPtr &Prototype) : CScriptVar(Context, Prototype), value(Value) {}
+	CScriptVarObject(CTinyJS *Context, const CScriptVarPtr &Prototype) : CScriptVar(Context, Prototype) { varFlags |= TYPE_TAG_OBJECT; }
+	CScriptVarObject(CTinyJS *Context, const CScriptVarPrimitivePtr &Value, const CScriptVarPtr &Prototype) : CScriptVar(Context, Prototype), value(Value) { varFlags |= TYPE_TAG_OBJECT; }
 	CScriptVarObject(const CScriptVarObject& Copy) MEMBER_DELETE;
 public:
 	virtual ~CScriptVarObject() OVERRIDE;
@@ -1732,7 +2364,6 @@ public:
 	virtual void removeAllChildren() OVERRIDE;
 
 	virtual CScriptVarPrimitivePtr getRawPrimitive() OVERRIDE;
-	virtual bool isObject() OVERRIDE; // { return true; }
 
 	virtual std::string getParsableString(const std::string &indentString, const std::string &indent, uint32_t uniqueID, bool &hasRecursion) OVERRIDE;
 	virtual std::string getVarType() OVERRIDE; ///< always "object"
@@ -1750,10 +2381,10 @@ private:
 	friend define_newScriptVar_Fnc(Object, CTinyJS *Context, const CScriptVarPtr &);
 	friend define_newScriptVar_Fnc(Object, CTinyJS *Context, const CScriptVarPrimitivePtr &, const CScriptVarPtr &);
 };
-inline define_newScriptVar_Fnc(Object, CTinyJS *Context, Object_t) { return new CScriptVarObject(Context); }
-inline define_newScriptVar_Fnc(Object, CTinyJS *Context, Object_t, const CScriptVarPtr &Prototype) { return new CScriptVarObject(Context, Prototype); }
-inline define_newScriptVar_Fnc(Object, CTinyJS *Context, const CScriptVarPtr &Prototype) { return new CScriptVarObject(Context, Prototype); }
-inline define_newScriptVar_Fnc(Object, CTinyJS *Context, const CScriptVarPrimitivePtr &Value, const CScriptVarPtr &Prototype) { return new CScriptVarObject(Context, Value, Prototype); }
+inline define_newScriptVar_Fnc(Object, CTinyJS *Context, Object_t) { return new(Context) CScriptVarObject(Context); }
+inline define_newScriptVar_Fnc(Object, CTinyJS *Context, Object_t, const CScriptVarPtr &Prototype) { return new(Context) CScriptVarObject(Context, Prototype); }
+inline define_newScriptVar_Fnc(Object, CTinyJS *Context, const CScriptVarPtr &Prototype) { return new(Context) CScriptVarObject(Context, Prototype); }
+inline define_newScriptVar_Fnc(Object, CTinyJS *Context, const CScriptVarPrimitivePtr &Value, const CScriptVarPtr &Prototype) { return new(Context) CScriptVarObject(Context, Value, Prototype); }
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -1777,15 +2408,15 @@ private:
 	friend define_newScriptVar_Fnc(Object, CTinyJS *Context, Object_t, const CScriptVarPtr &, const std::string &);
 	friend define_newScriptVar_Fnc(Object, CTinyJS *Context, const CScriptVarPtr &, const std::string &);
 };
-inline define_newScriptVar_Fnc(Object, CTinyJS *Context, Object_t, const CScriptVarPtr &Prototype, const std::string &TypeTagName) { return new CScriptVarObjectTypeTagged(Context, Prototype, TypeTagName); }
-inline define_newScriptVar_Fnc(Object, CTinyJS *Context, const CScriptVarPtr &Prototype, const std::string &TypeTagName) { return new CScriptVarObjectTypeTagged(Context, Prototype, TypeTagName); }
+inline define_newScriptVar_Fnc(Object, CTinyJS *Context, Object_t, const CScriptVarPtr &Prototype, const std::string &TypeTagName) { return new(Context) CScriptVarObjectTypeTagged(Context, Prototype, TypeTagName); }
+inline define_newScriptVar_Fnc(Object, CTinyJS *Context, const CScriptVarPtr &Prototype, const std::string &TypeTagName) { return new(Context) CScriptVarObjectTypeTagged(Context, Prototype, TypeTagName); }
 
 
 //////////////////////////////////////////////////////////////////////////
 /// CScriptVarError
 //////////////////////////////////////////////////////////////////////////
 
-define_ScriptVarPtr_Type(Error);
+define_ScriptVarPtr_TaggedType(Error, TYPE_TAG_ERROR);
 
 class CScriptVarError : public CScriptVarObject {
 protected:
@@ -1793,7 +2424,6 @@ protected:
 	CScriptVarError(const CScriptVarError& Copy) MEMBER_DELETE;
 public:
 	virtual ~CScriptVarError() OVERRIDE;
-	virtual bool isError() OVERRIDE; // { return true; }
 
 //	virtual std::string getParsableString(const std::string &indentString, const std::string &indent) OVERRIDE; ///< get Data as a parsable javascript string
 
@@ -1803,22 +2433,21 @@ private:
 	friend define_newScriptVar_NamedFnc(Error, CTinyJS *Context, ERROR_TYPES type, const char *message, const char *file, int line, int column);
 	friend define_newScriptVar_NamedFnc(Error, CTinyJS *Context, const CScriptException &Exception);
 };
-inline define_newScriptVar_NamedFnc(Error, CTinyJS *Context, ERROR_TYPES type, const char *message=0, const char *file=0, int line=-1, int column=-1) { return new CScriptVarError(Context, type, message, file, line, column); }
-inline define_newScriptVar_NamedFnc(Error, CTinyJS *Context, const CScriptException &Exception) { return new CScriptVarError(Context, Exception.errorType, Exception.message.c_str(), Exception.fileName.c_str(), Exception.lineNumber, Exception.column); }
+inline define_newScriptVar_NamedFnc(Error, CTinyJS *Context, ERROR_TYPES type, const char *message=0, const char *file=0, int line=-1, int column=-1) { return new(Context) CScriptVarError(Context, type, message, file, line, column); }
+inline define_newScriptVar_NamedFnc(Error, CTinyJS *Context, const CScriptException &Exception) { return new(Context) CScriptVarError(Context, Exception.errorType, Exception.message.c_str(), Exception.fileName.c_str(), Exception.lineNumber, Exception.column); }
 
 //////////////////////////////////////////////////////////////////////////
 /// CScriptVarArray
 //////////////////////////////////////////////////////////////////////////
 
 define_dummy_t(Array);
-define_ScriptVarPtr_Type(Array);
+define_ScriptVarPtr_TaggedType(Array, TYPE_TAG_ARRAY);
 class CScriptVarArray : public CScriptVarObject {
 protected:
 	CScriptVarArray(CTinyJS *Context);
 	CScriptVarArray(const CScriptVarArray& Copy) MEMBER_DELETE;
 public:
 	virtual ~CScriptVarArray() OVERRIDE;
-	virtual bool isArray() OVERRIDE; // { return true; }
 
 	virtual std::string getParsableString(const std::string &indentString, const std::string &indent, uint32_t uniqueID, bool &hasRecursion) OVERRIDE;
 
@@ -1837,7 +2466,7 @@ private:
 //	uint32_t length;
 	friend define_newScriptVar_Fnc(Array, CTinyJS *Context, Array_t);
 };
-inline define_newScriptVar_Fnc(Array, CTinyJS *Context, Array_t) { return new CScriptVarArray(Context); }
+inline define_newScriptVar_Fnc(Array, CTinyJS *Context, Array_t) { return new(Context) CScriptVarArray(Context); }
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -1845,17 +2474,17 @@ inline define_newScriptVar_Fnc(Array, CTinyJS *Context, Array_t) { return new CS
 //////////////////////////////////////////////////////////////////////////
 #ifndef NO_REGEXP
 
-define_ScriptVarPtr_Type(RegExp);
+define_ScriptVarPtr_TaggedType(RegExp, TYPE_TAG_REGEXP);
 class CScriptVarRegExp : public CScriptVarObject {
 protected:
 	CScriptVarRegExp(CTinyJS *Context, const std::string &Source, const std::string &Flags);
 	CScriptVarRegExp(const CScriptVarRegExp& Copy) MEMBER_DELETE;
 public:
 	virtual ~CScriptVarRegExp() OVERRIDE;
-	virtual bool isRegExp() OVERRIDE; // { return true; }
 	virtual CScriptVarPtr toString_CallBack(CScriptResult &execute, int radix=0) OVERRIDE;
 
 	CScriptVarPtr exec(const std::string &Input, bool Test=false);
+	CScriptVarPtr exec(const CScriptStringRef &Input, bool Test=false);
 
 	bool Global() { return flags.find('g')!=std::string::npos; }
 	bool IgnoreCase() { return flags.find('i')!=std::string::npos; }
@@ -1878,7 +2507,7 @@ private:
 	friend define_newScriptVar_Fnc(RegExp, CTinyJS *Context, const std::string &, const std::string &);
 
 };
-inline define_newScriptVar_Fnc(RegExp, CTinyJS *Context, const std::string &Obj, const std::string &Flags) { return new CScriptVarRegExp(Context, Obj, Flags); }
+inline define_newScriptVar_Fnc(RegExp, CTinyJS *Context, const std::string &Obj, const std::string &Flags) { return new(Context) CScriptVarRegExp(Context, Obj, Flags); }
 
 #endif /* NO_REGEXP */
 
@@ -1887,16 +2516,13 @@ inline define_newScriptVar_Fnc(RegExp, CTinyJS *Context, const std::string &Obj,
 /// CScriptVarFunction
 //////////////////////////////////////////////////////////////////////////
 
-define_ScriptVarPtr_Type(Function);
+define_ScriptVarPtr_TaggedType(Function, TYPE_TAG_FUNCTION);
 class CScriptVarFunction : public CScriptVarObject {
 protected:
 	CScriptVarFunction(CTinyJS *Context, CScriptTokenDataFnc *Data);
 	CScriptVarFunction(const CScriptVarFunction& Copy) MEMBER_DELETE;
 public:
 	virtual ~CScriptVarFunction() OVERRIDE;
-	virtual bool isObject() OVERRIDE; // { return true; }
-	virtual bool isFunction() OVERRIDE; // { return true; }
-	virtual bool isPrimitive() OVERRIDE; // { return false; }
 
 	virtual std::string getVarType() OVERRIDE; // { return "function"; }
 	virtual std::string getParsableString(const std::string &indentString, const std::string &indent, uint32_t uniqueID, bool &hasRecursion) OVERRIDE;
@@ -1914,21 +2540,20 @@ private:
 
 	friend define_newScriptVar_Fnc(Function, CTinyJS *Context, CScriptTokenDataFnc *);
 };
-inline define_newScriptVar_Fnc(Function, CTinyJS *Context, CScriptTokenDataFnc *Obj) { return new CScriptVarFunction(Context, Obj); }
+inline define_newScriptVar_Fnc(Function, CTinyJS *Context, CScriptTokenDataFnc *Obj) { return new(Context) CScriptVarFunction(Context, Obj); }
 
 
 //////////////////////////////////////////////////////////////////////////
 /// CScriptVarFunctionBounded
 //////////////////////////////////////////////////////////////////////////
 
-define_ScriptVarPtr_Type(FunctionBounded);
+define_ScriptVarPtr_TaggedType(FunctionBounded, TYPE_TAG_FUNCTION_BOUNDED);
 class CScriptVarFunctionBounded : public CScriptVarFunction {
 protected:
-	CScriptVarFunctionBounded(CScriptVarFunctionPtr BoundedFunction, CScriptVarPtr BoundedThis, const std::vector<CScriptVarPtr> &BoundedArguments);
+	CScriptVarFunctionBounded(const CScriptVarFunctionPtr &BoundedFunction, const CScriptVarPtr &BoundedThis, const std::vector<CScriptVarPtr> &BoundedArguments);
 	CScriptVarFunctionBounded(const CScriptVarFunctionBounded& Copy) MEMBER_DELETE;
 public:
 	virtual ~CScriptVarFunctionBounded() OVERRIDE;
-	virtual bool isBounded() OVERRIDE;	///< is CScriptVarFunctionBounded
 	virtual void setTemporaryMark_recursive(uint32_t ID) OVERRIDE;
 	CScriptVarPtr callFunction(CScriptResult &execute, std::vector<CScriptVarPtr> &Arguments, const CScriptVarPtr &This, CScriptVarPtr *newThis=0);
 protected:
@@ -1937,23 +2562,22 @@ private:
 	CScriptVarPtr boundedThis;
 	std::vector<CScriptVarPtr> boundedArguments;
 
-	friend define_newScriptVar_NamedFnc(FunctionBounded, CScriptVarFunctionPtr BoundedFunction, CScriptVarPtr BoundedThis, const std::vector<CScriptVarPtr> &BoundedArguments);
+	friend define_newScriptVar_NamedFnc(FunctionBounded, const CScriptVarFunctionPtr &BoundedFunction, const CScriptVarPtr &BoundedThis, const std::vector<CScriptVarPtr> &BoundedArguments);
 };
-inline define_newScriptVar_NamedFnc(FunctionBounded, CScriptVarFunctionPtr BoundedFunction, CScriptVarPtr BoundedThis, const std::vector<CScriptVarPtr> &BoundedArguments) { return new CScriptVarFunctionBounded(BoundedFunction, BoundedThis, BoundedArguments); }
+inline define_newScriptVar_NamedFnc(FunctionBounded, const CScriptVarFunctionPtr &BoundedFunction, const CScriptVarPtr &BoundedThis, const std::vector<CScriptVarPtr> &BoundedArguments) { return new(BoundedFunction->getContext()) CScriptVarFunctionBounded(BoundedFunction, BoundedThis, BoundedArguments); }
 
 
 //////////////////////////////////////////////////////////////////////////
 /// CScriptVarFunctionNative
 //////////////////////////////////////////////////////////////////////////
 
-define_ScriptVarPtr_Type(FunctionNative);
+define_ScriptVarPtr_TaggedType(FunctionNative, TYPE_TAG_FUNCTION_NATIVE);
 class CScriptVarFunctionNative : public CScriptVarFunction {
 protected:
 	CScriptVarFunctionNative(CTinyJS *Context, void *Userdata, const char *Name, const char *Args);
 	CScriptVarFunctionNative(const CScriptVarFunctionNative& Copy) MEMBER_DELETE;
 public:
 	virtual ~CScriptVarFunctionNative() OVERRIDE;
-	virtual bool isNative() OVERRIDE; // { return true; }
 
 	virtual void callFunction(const CFunctionsScopePtr &c)=0;// { jsCallback(c, jsCallbackUserData); }
 protected:
@@ -1977,7 +2601,7 @@ private:
 	JSCallback jsCallback; ///< Callback for native functions
 	friend define_newScriptVar_Fnc(FunctionNativeCallback, CTinyJS *Context, JSCallback Callback, void*, const char*, const char*);
 };
-inline define_newScriptVar_Fnc(FunctionNativeCallback, CTinyJS *Context, JSCallback Callback, void *Userdata, const char *Name=0, const char *Args=0) { return new CScriptVarFunctionNativeCallback(Context, Callback, Userdata, Name, Args); }
+inline define_newScriptVar_Fnc(FunctionNativeCallback, CTinyJS *Context, JSCallback Callback, void *Userdata, const char *Name=0, const char *Args=0) { return new(Context) CScriptVarFunctionNativeCallback(Context, Callback, Userdata, Name, Args); }
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -1999,7 +2623,29 @@ private:
 	friend define_newScriptVar_Fnc(FunctionNativeCallback, CTinyJS*, native2 *, void (native2::*)(const CFunctionsScopePtr &, void *), void *, const char *, const char *);
 };
 template<typename native>
-define_newScriptVar_Fnc(FunctionNativeCallback, CTinyJS *Context, native *ClassPtr, void (native::*ClassFnc)(const CFunctionsScopePtr &, void *), void *Userdata, const char *Name=0, const char *Args=0) { return new CScriptVarFunctionNativeClass<native>(Context, ClassPtr, ClassFnc, Userdata, Name, Args); }
+define_newScriptVar_Fnc(FunctionNativeCallback, CTinyJS *Context, native *ClassPtr, void (native::*ClassFnc)(const CFunctionsScopePtr &, void *), void *Userdata, const char *Name=0, const char *Args=0) { return new(Context) CScriptVarFunctionNativeClass<native>(Context, ClassPtr, ClassFnc, Userdata, Name, Args); }
+
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptVarFunctionNativeDirect
+//////////////////////////////////////////////////////////////////////////
+
+/// a native function with positional arguments (see TinyJS_Binding.h)
+/// callFunction calls it without a function-scope, an arguments-object and lookups of the arguments by name
+/// only a call as constructor (new) goes the way over the function-scope
+define_ScriptVarPtr_TaggedType(FunctionNativeDirect, TYPE_TAG_FUNCTION_NATIVE_DIRECT);
+class CScriptVarFunctionNativeDirect : public CScriptVarFunctionNative {
+protected:
+	CScriptVarFunctionNativeDirect(CTinyJS *Context, const char *Name, const char *Args) : CScriptVarFunctionNative(Context, 0, Name, Args) { varFlags |= TYPE_TAG_FUNCTION_NATIVE_DIRECT; }
+	CScriptVarFunctionNativeDirect(const CScriptVarFunctionNativeDirect& Copy) MEMBER_DELETE;
+public:
+	virtual ~CScriptVarFunctionNativeDirect() OVERRIDE;
+
+	/// throw a CScriptVarPtr (see throwError) for errors
+	virtual CScriptVarPtr callDirect(const CScriptVarPtr &This, const std::vector<CScriptVarPtr> &Arguments)=0;
+	virtual void callFunction(const CFunctionsScopePtr &c) OVERRIDE;
+	void throwError(ERROR_TYPES ErrorType, const std::string &message);
+};
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -2007,13 +2653,14 @@ define_newScriptVar_Fnc(FunctionNativeCallback, CTinyJS *Context, native *ClassP
 //////////////////////////////////////////////////////////////////////////
 
 define_dummy_t(Accessor);
-define_ScriptVarPtr_Type(Accessor);
+define_ScriptVarPtr_TaggedType(Accessor, TYPE_TAG_ACCESSOR);
 
 class CScriptVarAccessor : public CScriptVarObject {
 protected:
 	CScriptVarAccessor(CTinyJS *Context);
 	CScriptVarAccessor(CTinyJS *Context, JSCallback getter, void *getterdata, JSCallback setter, void *setterdata);
 	template<class C>	CScriptVarAccessor(CTinyJS *Context, C *class_ptr, void(C::*getterFnc)(const CFunctionsScopePtr &, void *), void *getterData, void(C::*setterFnc)(const CFunctionsScopePtr &, void *), void *setterData) : CScriptVarObject(Context) {
+		varFlags |= TYPE_TAG_ACCESSOR;
 		if(getterFnc)
 			addChild(TINYJS_ACCESSOR_GET_VAR, ::newScriptVar(Context, class_ptr, getterFnc, getterData), 0);
 		if(setterFnc)
@@ -2024,8 +2671,6 @@ protected:
 	CScriptVarAccessor(const CScriptVarAccessor& Copy) MEMBER_DELETE;
 public:
 	virtual ~CScriptVarAccessor() OVERRIDE;
-	virtual bool isAccessor() OVERRIDE; // { return true; }
-	virtual bool isPrimitive() OVERRIDE; // { return false; }
 
 	virtual std::string getParsableString(const std::string &indentString, const std::string &indent, uint32_t uniqueID, bool &hasRecursion) OVERRIDE;
 	virtual std::string getVarType() OVERRIDE; // { return "object"; }
@@ -2037,10 +2682,10 @@ public:
 	template<class C> friend define_newScriptVar_NamedFnc(Accessor, CTinyJS *Context, C *class_ptr, void(C::*getterFnc)(const CFunctionsScopePtr &, void *), void *getterData, void(C::*setterFnc)(const CFunctionsScopePtr &, void *), void *setterData);
 	friend define_newScriptVar_NamedFnc(Accessor, CTinyJS *Context, const CScriptVarFunctionPtr &, const CScriptVarFunctionPtr &);
 };
-inline define_newScriptVar_Fnc(Accessor, CTinyJS *Context, Accessor_t) { return new CScriptVarAccessor(Context); }
-inline define_newScriptVar_NamedFnc(Accessor, CTinyJS *Context, JSCallback getter, void *getterdata, JSCallback setter, void *setterdata) { return new CScriptVarAccessor(Context, getter, getterdata, setter, setterdata); }
-template<class C> define_newScriptVar_NamedFnc(Accessor, CTinyJS *Context, C *class_ptr, void(C::*getterFnc)(const CFunctionsScopePtr &, void *), void *getterData, void(C::*setterFnc)(const CFunctionsScopePtr &, void *), void *setterData)  { return new CScriptVarAccessor(Context, class_ptr, getterFnc, getterData, setterFnc, setterData); }
-inline define_newScriptVar_NamedFnc(Accessor, CTinyJS *Context, const CScriptVarFunctionPtr &getter, const CScriptVarFunctionPtr &setter) { return new CScriptVarAccessor(Context, getter, setter); }
+inline define_newScriptVar_Fnc(Accessor, CTinyJS *Context, Accessor_t) { return new(Context) CScriptVarAccessor(Context); }
+inline define_newScriptVar_NamedFnc(Accessor, CTinyJS *Context, JSCallback getter, void *getterdata, JSCallback setter, void *setterdata) { return new(Context) CScriptVarAccessor(Context, getter, getterdata, setter, setterdata); }
+template<class C> define_newScriptVar_NamedFnc(Accessor, CTinyJS *Context, C *class_ptr, void(C::*getterFnc)(const CFunctionsScopePtr &, void *), void *getterData, void(C::*setterFnc)(const CFunctionsScopePtr &, void *), void *setterData)  { return new(Context) CScriptVarAccessor(Context, class_ptr, getterFnc, getterData, setterFnc, setterData); }
+inline define_newScriptVar_NamedFnc(Accessor, CTinyJS *Context, const CScriptVarFunctionPtr &getter, const CScriptVarFunctionPtr &setter) { return new(Context) CScriptVarAccessor(Context, getter, setter); }
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -2060,12 +2705,11 @@ public:
 //////////////////////////////////////////////////////////////////////////
 
 define_dummy_t(Scope);
-define_ScriptVarPtr_Type(Scope);
+define_ScriptVarPtr_TaggedType(Scope, TYPE_TAG_SCOPE);
 class CScriptVarScope : public CScriptVarObject {
 protected: // only derived classes or friends can be created
 	CScriptVarScope(CTinyJS *Context) // constructor for rootScope
-		: CScriptVarObject(Context) {}
-	virtual bool isObject() OVERRIDE; // { return false; }
+		: CScriptVarObject(Context) { varFlags |= TYPE_TAG_SCOPE; }
 public:
 	virtual ~CScriptVarScope() OVERRIDE;
 	virtual CScriptVarPtr scopeVar(); ///< to create var like: var a = ...
@@ -2074,7 +2718,7 @@ public:
 	virtual CScriptVarScopePtr getParent();
 	friend define_newScriptVar_Fnc(Scope, CTinyJS *Context, Scope_t);
 };
-inline define_newScriptVar_Fnc(Scope, CTinyJS *Context, Scope_t) { return new CScriptVarScope(Context); }
+inline define_newScriptVar_Fnc(Scope, CTinyJS *Context, Scope_t) { return new(Context) CScriptVarScope(Context); }
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -2082,14 +2726,16 @@ inline define_newScriptVar_Fnc(Scope, CTinyJS *Context, Scope_t) { return new CS
 //////////////////////////////////////////////////////////////////////////
 
 define_dummy_t(ScopeFnc);
-define_ScriptVarPtr_Type(ScopeFnc);
+define_ScriptVarPtr_TaggedType(ScopeFnc, TYPE_TAG_SCOPE_FNC);
 class CScriptVarScopeFnc : public CScriptVarScope {
 protected: // only derived classes or friends can be created
 	CScriptVarScopeFnc(CTinyJS *Context, const CScriptVarScopePtr &Closure) // constructor for FncScope
-		: CScriptVarScope(Context), closure(Closure ? addChild(TINYJS_FUNCTION_CLOSURE_VAR, Closure, 0) : CScriptVarLinkPtr()) {}
+		: CScriptVarScope(Context), closure(Closure ? addChild(TINYJS_FUNCTION_CLOSURE_VAR, Closure, 0) : CScriptVarLinkPtr()) { varFlags |= TYPE_TAG_SCOPE_FNC; }
 public:
 	virtual ~CScriptVarScopeFnc() OVERRIDE;
 	virtual CScriptVarLinkWorkPtr findInScopes(const std::string &childName) OVERRIDE;
+	/// a lazy hoisted function found in this scope is created with LazyClosure as closure
+	CScriptVarLinkWorkPtr findInScopes(const std::string &childName, const CScriptVarPtr &LazyClosure);
 
 	void setReturnVar(const CScriptVarPtr &var); ///< Set the result value. Use this when setting complex return data as it avoids a deepCopy()
 
@@ -2104,7 +2750,9 @@ public:
 	void throwError(ERROR_TYPES ErrorType, const std::string &message);
 	void throwError(ERROR_TYPES ErrorType, const char *message);
 
-	void assign(CScriptVarLinkWorkPtr &lhs, CScriptVarPtr rhs, bool ignoreReadOnly=false, bool ignoreNotOwned=false, bool ignoreNotExtensible=false);
+	void reset(const CScriptVarScopePtr &Closure); ///< removes all children and sets a new closure (used by tail-calls to reuse the scope)
+
+	void assign(CScriptVarLinkWorkPtr &lhs, const CScriptVarPtr &rhs, bool ignoreReadOnly=false, bool ignoreNotOwned=false, bool ignoreNotExtensible=false);
 	CScriptVarLinkWorkPtr getProperty(const CScriptVarPtr &Objc, const std::string &name) { return Objc->findChildWithPrototypeChain(name); }
 	CScriptVarLinkWorkPtr getProperty(const CScriptVarPtr &Objc, uint32_t idx)  { return Objc->findChildWithPrototypeChain(int2string(idx)); }
 	CScriptVarPtr getPropertyValue(const CScriptVarPtr &Objc, const std::string &name) { return getProperty(Objc, name).getter(); } // short for getProperty().getter()
@@ -2121,9 +2769,11 @@ public:
 
 protected:
 	CScriptVarLinkPtr closure;
+	CScriptTokenDataForwardsPtr lazyFunctions;	// the forwarder of the functions not created yet (see CTinyJS::installBindings)
+	friend class CTinyJS;
 	friend define_newScriptVar_Fnc(ScopeFnc, CTinyJS *Context, ScopeFnc_t, const CScriptVarScopePtr &Closure);
 };
-inline define_newScriptVar_Fnc(ScopeFnc, CTinyJS *Context, ScopeFnc_t, const CScriptVarScopePtr &Closure) { return new CScriptVarScopeFnc(Context, Closure); }
+inline define_newScriptVar_Fnc(ScopeFnc, CTinyJS *Context, ScopeFnc_t, const CScriptVarScopePtr &Closure) { return new(Context) CScriptVarScopeFnc(Context, Closure); }
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -2131,7 +2781,7 @@ inline define_newScriptVar_Fnc(ScopeFnc, CTinyJS *Context, ScopeFnc_t, const CSc
 //////////////////////////////////////////////////////////////////////////
 
 define_dummy_t(ScopeLet);
-define_ScriptVarPtr_Type(ScopeLet);
+define_ScriptVarPtr_TaggedType(ScopeLet, TYPE_TAG_SCOPE_LET);
 class CScriptVarScopeLet : public CScriptVarScope {
 protected: // only derived classes or friends can be created
 	CScriptVarScopeLet(const CScriptVarScopePtr &Parent); // constructor for LetScope
@@ -2145,9 +2795,11 @@ public:
 protected:
 	CScriptVarLinkPtr parent;
 	bool letExpressionInitMode;
+	bool lazyFunctionsClosure;	// the closure of the lazy functions of the parent (a function-scope)
+	friend class CTinyJS;
 	friend define_newScriptVar_Fnc(ScopeLet, CTinyJS *Context, ScopeLet_t, const CScriptVarScopePtr &Parent);
 };
-inline define_newScriptVar_Fnc(ScopeLet, CTinyJS *, ScopeLet_t, const CScriptVarScopePtr &Parent) { return new CScriptVarScopeLet(Parent); }
+inline define_newScriptVar_Fnc(ScopeLet, CTinyJS *Context, ScopeLet_t, const CScriptVarScopePtr &Parent) { return new(Context) CScriptVarScopeLet(Parent); }
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -2155,11 +2807,11 @@ inline define_newScriptVar_Fnc(ScopeLet, CTinyJS *, ScopeLet_t, const CScriptVar
 //////////////////////////////////////////////////////////////////////////
 
 define_dummy_t(ScopeWith);
-define_ScriptVarPtr_Type(ScopeWith);
+define_ScriptVarPtr_TaggedType(ScopeWith, TYPE_TAG_SCOPE_WITH);
 class CScriptVarScopeWith : public CScriptVarScopeLet {
 protected:
 	CScriptVarScopeWith(const CScriptVarScopePtr &Parent, const CScriptVarPtr &With)
-		: CScriptVarScopeLet(Parent), with(addChild(TINYJS_SCOPE_WITH_VAR, With, 0)) {}
+		: CScriptVarScopeLet(Parent), with(addChild(TINYJS_SCOPE_WITH_VAR, With, 0)) { varFlags |= TYPE_TAG_SCOPE_WITH; }
 
 public:
 	virtual ~CScriptVarScopeWith() OVERRIDE;
@@ -2169,7 +2821,7 @@ private:
 	CScriptVarLinkPtr with;
 	friend define_newScriptVar_Fnc(ScopeWith, CTinyJS *Context, ScopeWith_t, const CScriptVarScopePtr &Parent, const CScriptVarPtr &With);
 };
-inline define_newScriptVar_Fnc(ScopeWith, CTinyJS *, ScopeWith_t, const CScriptVarScopePtr &Parent, const CScriptVarPtr &With) { return new CScriptVarScopeWith(Parent, With); }
+inline define_newScriptVar_Fnc(ScopeWith, CTinyJS *Context, ScopeWith_t, const CScriptVarScopePtr &Parent, const CScriptVarPtr &With) { return new(Context) CScriptVarScopeWith(Parent, With); }
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -2177,7 +2829,7 @@ inline define_newScriptVar_Fnc(ScopeWith, CTinyJS *, ScopeWith_t, const CScriptV
 //////////////////////////////////////////////////////////////////////////
 
 define_dummy_t(DefaultIterator);
-define_ScriptVarPtr_Type(DefaultIterator);
+define_ScriptVarPtr_TaggedType(DefaultIterator, TYPE_TAG_ITERATOR);
 
 class CScriptVarDefaultIterator : public CScriptVarObject {
 protected:
@@ -2185,7 +2837,6 @@ protected:
 	CScriptVarDefaultIterator(const CScriptVarDefaultIterator& Copy) MEMBER_DELETE;
 public:
 	virtual ~CScriptVarDefaultIterator() OVERRIDE;
-	virtual bool isIterator() OVERRIDE;
 
 	void native_next(const CFunctionsScopePtr &c, void *data);
 private:
@@ -2196,7 +2847,7 @@ private:
 	friend define_newScriptVar_NamedFnc(DefaultIterator, CTinyJS *, const CScriptVarPtr &, IteratorMode);
 
 };
-inline define_newScriptVar_NamedFnc(DefaultIterator, CTinyJS *Context, const CScriptVarPtr &_Object, IteratorMode Mode) { return new CScriptVarDefaultIterator(Context, _Object, Mode); }
+inline define_newScriptVar_NamedFnc(DefaultIterator, CTinyJS *Context, const CScriptVarPtr &_Object, IteratorMode Mode) { return new(Context) CScriptVarDefaultIterator(Context, _Object, Mode); }
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -2206,7 +2857,7 @@ inline define_newScriptVar_NamedFnc(DefaultIterator, CTinyJS *Context, const CSc
 #ifndef NO_GENERATORS
 
 define_dummy_t(Generator);
-define_ScriptVarPtr_Type(Generator);
+define_ScriptVarPtr_TaggedType(Generator, TYPE_TAG_GENERATOR);
 
 class CScriptVarGenerator : public CScriptVarObject {
 protected:
@@ -2214,8 +2865,6 @@ protected:
 	CScriptVarGenerator(const CScriptVarGenerator& Copy) MEMBER_DELETE;
 public:
 	virtual ~CScriptVarGenerator() OVERRIDE;
-	virtual bool isIterator() OVERRIDE;
-	virtual bool isGenerator() OVERRIDE;
 	virtual std::string getVarType() OVERRIDE; // { return "generator"; }
 	virtual std::string getVarTypeTagName() OVERRIDE; // { return "Generator"; }
 
@@ -2258,7 +2907,7 @@ public:
 	friend define_newScriptVar_NamedFnc(CScriptVarGenerator, CTinyJS *, const CScriptVarPtr &, const CScriptVarFunctionPtr &);
 
 };
-inline define_newScriptVar_NamedFnc(CScriptVarGenerator, CTinyJS *Context, const CScriptVarPtr &FunctionRoot, const CScriptVarFunctionPtr &Function) { return new CScriptVarGenerator(Context, FunctionRoot, Function); }
+inline define_newScriptVar_NamedFnc(CScriptVarGenerator, CTinyJS *Context, const CScriptVarPtr &FunctionRoot, const CScriptVarFunctionPtr &Function) { return new(Context) CScriptVarGenerator(Context, FunctionRoot, Function); }
 
 #endif
 
@@ -2278,6 +2927,7 @@ public:
 		Break,
 		Continue,
 		Return,
+		TailCall,
 		Throw,
 		noncatchableThrow,
 		noExecute
@@ -2291,6 +2941,7 @@ public:
 	bool isBreakContinue() const { return type == Break || type == Continue; }
 	bool isReturn() const { return type == Return; }
 	bool isReturnNormal() const { return type == Return || type == Normal; }
+	bool isTailCall() const { return type == TailCall; }
 	bool isThrow() const { return type == Throw; }
 
 	bool useStrict() const { return strictMode; }
@@ -2317,6 +2968,80 @@ public:
 };
 
 
+//////////////////////////////////////////////////////////////////////////
+/// CScriptRandom - xoshiro256** pseudo random number generator
+//////////////////////////////////////////////////////////////////////////
+
+/// every CTinyJS has its own generator (Math.random needs no lock)
+class CScriptRandom {
+public:
+	CScriptRandom(); ///< seeded from the current time and the address of the generator
+	CScriptRandom(uint64_t Seed) { seed(Seed); }
+	void seed(uint64_t Seed); ///< the same Seed gives the same sequence
+	uint64_t next() {
+		const uint64_t result = rotl(state[1] * 5, 7) * 9;
+		const uint64_t t = state[1] << 17;
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = rotl(state[3], 45);
+		return result;
+	}
+	double nextDouble() { return double(next() >> 11) * (1.0 / 9007199254740992.0); } ///< [0, 1) with 53 random bits
+private:
+	static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+	uint64_t state[4];
+};
+
+
+#ifndef NO_THREADING
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptWatchdog
+//////////////////////////////////////////////////////////////////////////
+
+/// a thread watching the evaluations (execute, evaluate & callFunction from the host) of contexts
+/// an evaluation running longer than Threshold ms flags its context. At the next statement the
+/// context snapshots the JS stack and some metrics and calls report in the thread of the context.
+/// With Interrupt the evaluation is aborted afterwards with a CScriptInterruptException (not catchable by the script)
+/// report is called with the watchdogs locked - it must not call watch or unwatch
+class CScriptWatchdog : private CScriptThread {
+public:
+	struct REPORT {
+		uint32_t elapsed;					///< ms since the start of the evaluation
+		std::string file;					///< the current position
+		int line, column;
+		std::vector<std::string> stack;		///< the called functions innermost first ("name@file:line")
+		size_t scopes;						///< the depth of the scope-chain
+		size_t heapBytes;					///< the size of the pages of the var-heap
+		bool interrupted;
+		/// the report as one JSON-line
+		std::string toJSON() const;
+	};
+	CScriptWatchdog(uint32_t Threshold=100, bool Interrupt=false);
+	virtual ~CScriptWatchdog();
+	void watch(CTinyJS *Context);
+	void unwatch(CTinyJS *Context);
+	/// unwatches Context from its watchdog (if any)
+	static void unwatchContext(CTinyJS *Context);
+	uint32_t getThreshold() const { return threshold; }
+	bool getInterrupt() const { return interrupt; }
+protected:
+	/// writes the JSON of the report to stderr
+	virtual void report(const REPORT &Report);
+private:
+	virtual int ThreadFnc();
+	void remove(CTinyJS *Context);
+	CScriptMutex mutex;
+	std::map<CTinyJS*, int64_t> contexts;	// the context and the start of the last flagged evaluation
+	uint32_t threshold;
+	bool interrupt;
+	friend class CTinyJS;
+};
+
+#endif // NO_THREADING
 
 //////////////////////////////////////////////////////////////////////////
 /// CTinyJS
@@ -2326,6 +3051,9 @@ typedef int (*native_require_read_fnc)(const std::string &Fname, std::string &Da
 
 class CTinyJS {
 public:
+	/// all vars of this context - declared first, so it's destroyed after all members holding vars
+	CScriptVarHeap heap;
+
 	CTinyJS();
 	~CTinyJS();
 
@@ -2360,6 +3088,13 @@ public:
 	 * 'undefined' */
 	std::string evaluate(const std::string &code, const std::string &File="", int Line=0, int Column=0);
 
+	/// modules found in a bundle are loaded from the bundle instead of the file-system
+	/// the bundle is not owned by the context and must live as long as the context
+	void addBundle(const CScriptBundle *Bundle) { bundles.push_back(Bundle); }
+	/// tokenizes the modules in parallel into the module-cache shared by all contexts (see require)
+	/// returns the count of the precompiled modules
+	static size_t precompileModules(const STRING_VECTOR_t &Files, unsigned Threads=0);
+
 	native_require_read_fnc setRequireReadFnc(native_require_read_fnc fnc) {
 		native_require_read_fnc old = native_require_read;
 		native_require_read = fnc;
@@ -2472,6 +3207,8 @@ private:
 	CScriptVarPtr constTrue;
 	CScriptVarPtr constFalse;
 	CScriptVarPtr constStopIteration;
+	CScriptVarPtr constLazyFunction; ///< the value of a hoisted function until the first lookup
+	CScriptVarPtr moduleCache; ///< require.cache - the module-objects by resolved path
 
 	std::vector<CScriptVarPtr *> pseudo_refered;
 
@@ -2491,6 +3228,9 @@ public:
 	// function call
 	CScriptVarPtr callFunction(const CScriptVarFunctionPtr &Function, std::vector<CScriptVarPtr> &Arguments, const CScriptVarPtr &This=0, CScriptVarPtr *newThis=0);
 	CScriptVarPtr callFunction(CScriptResult &execute, const CScriptVarFunctionPtr &Function, std::vector<CScriptVarPtr> &Arguments, const CScriptVarPtr &This, CScriptVarPtr *newThis=0);
+private:
+	void nativeException(CScriptResult &execute, const CScriptVarPtr &v, const std::string &Name);
+public:
 	//////////////////////////////////////////////////////////////////////////
 #ifndef NO_GENERATORS
 	std::vector<CScriptVarGenerator *> generatorStack;
@@ -2501,6 +3241,10 @@ public:
 
 	// parsing - in order of precedence
 	CScriptVarPtr mathsOp(CScriptResult &execute, const CScriptVarPtr &a, const CScriptVarPtr &b, int op);
+	CScriptVarPtr mathsOp(CScriptResult &execute, const CScriptToken &Site, const CScriptVarPtr &a, const CScriptVarPtr &b, int op) {
+		if(typeFeedback) typeFeedback->record(t->currentFile, Site, a, b);
+		return mathsOp(execute, a, b, op);
+	}
 private:
 	void assign_destructuring_var(CScriptResult &execute, const CScriptTokenDataDestructuringVar &Objc, const CScriptVarPtr &Val, const CScriptVarPtr &Scope);
 	void execute_var_init(CScriptResult &execute, bool hideLetScope);
@@ -2521,17 +3265,22 @@ private:
 	CScriptVarLinkPtr execute_assignment(CScriptVarLinkWorkPtr Lhs, CScriptResult &execute);
 	CScriptVarLinkPtr execute_assignment(CScriptResult &execute);
 	CScriptVarLinkPtr execute_base(CScriptResult &execute);
+	CScriptVarPtr execute_increment(CScriptResult &execute);
+	bool execute_compare(CScriptResult &execute);
 	void execute_block(CScriptResult &execute);
 	void execute_statement(CScriptResult &execute);
 	// parsing utility functions
 	CScriptVarLinkWorkPtr parseFunctionDefinition(const CScriptToken &FncToken);
+	CScriptVarPtr newHoistedFunction(const CScriptToken &FncToken, const CScriptVarPtr &Closure);
+	void installBindings(const CScriptVarPtr &Scope, const CScriptTokenDataForwards::BINDINGS_t &Bindings, bool LazyFunctions);
+	friend class CScriptVarScopeFnc;
 	CScriptVarLinkWorkPtr parseFunctionsBodyFromString(const std::string &ArgumentList, const std::string &FncBody);
 public:
-	CScriptVarLinkPtr findInScopes(const std::string &childName); ///< Finds a child, looking recursively up the scopes
+	CScriptVarLinkWorkPtr findInScopes(const std::string &childName); ///< Finds a child, looking recursively up the scopes
 private:
 	//////////////////////////////////////////////////////////////////////////
 	/// addNative-helper
-	CScriptVarFunctionNativePtr addNative(const std::string &funcDesc, CScriptVarFunctionNativePtr Var, int LinkFlags);
+	CScriptVarFunctionNativePtr addNative(const std::string &funcDesc, const CScriptVarFunctionNativePtr &Var, int LinkFlags);
 
 	//////////////////////////////////////////////////////////////////////////
 	/// throws an Error & Exception
@@ -2602,6 +3351,7 @@ private:
 	void native_eval(const CFunctionsScopePtr &c, void *data);
 	void native_require(const CFunctionsScopePtr &c, void *data);
 	native_require_read_fnc native_require_read;
+	std::vector<const CScriptBundle *> bundles;
 	void native_isNAN(const CFunctionsScopePtr &c, void *data);
 	void native_isFinite(const CFunctionsScopePtr &c, void *data);
 	void native_parseInt(const CFunctionsScopePtr &c, void *data);
@@ -2613,6 +3363,49 @@ private:
 	uint32_t uniqueID;
 	int32_t currentMarkSlot;
 	void *stackBase;
+#ifndef NO_JIT
+	uint32_t jitThreshold;
+	bool compileJitCode(CScriptTokenDataFnc *Fnc, bool Now);
+	bool callJitCode(const CScriptVarPtr &Function, const std::vector<CScriptVarPtr> &Arguments, CScriptVarPtr &Result);
+	bool callJitCode(const CScriptVarPtr &Function, const int32_t *Arguments, int32_t &Result);
+	static int jitCallback(CScriptJitEnv *Env, uint32_t Callee, const int64_t *Arguments, uint32_t Count, int32_t *Result);
+#endif
+	CScriptTypeFeedback *typeFeedback;
+	CScriptAllocationProfiler *allocationProfiler;
+	CScriptStringTable internedStrings;
+	friend class CScriptVarString;
+	std::vector<CScriptTokenDataFnc*> callFrames;	// the called functions (stacks of the allocation-profiler & watchdog)
+	void recordAllocation(const void *Var, size_t Size);
+	friend class CCallFrameControl;
+	friend class CScriptVar;
+#ifndef NO_THREADING
+	CScriptWatchdog *watchdog;				// guarded by the mutex of all watchdogs (see CScriptWatchdog::watch)
+	std::atomic<bool> watchdogFlag;			// set by the watchdog - checked at every statement
+	std::atomic<int64_t> evaluationStart;	// the start of the evaluation from the host (0 = none)
+	uint32_t evaluationDepth;
+	void watchdogSafePoint();
+	friend class CScriptWatchdog;
+	friend class CEvaluationControl;
+#endif
+	CScriptRandom random;
+	CScriptConsoleSink *consoleSink, *defaultConsoleSink;
+	std::vector<CScriptVarPtr> tailCallArguments;	// arguments of a pending tail-call (CScriptResult::TailCall holds the function)
+	CScriptVarPtr tailCallThis;						// this of a pending tail-call
+#ifdef WITH_REFCOUNT_STATISTICS
+public:
+	struct RefCountStatistics {
+		RefCountStatistics() : varRefs(0), varUnrefs(0), linkRefs(0), linkUnrefs(0), statements(0) {}
+		uint64_t varRefs, varUnrefs;	///< ref/unref of CScriptVar's
+		uint64_t linkRefs, linkUnrefs;	///< ref/unref of CScriptVarLink's (counted by the context of the linked var)
+		uint64_t statements;			///< executed statements
+	};
+	const RefCountStatistics &getRefCountStatistics() const { return refCountStatistics; }
+	void resetRefCountStatistics() { refCountStatistics = RefCountStatistics(); }
+private:
+	RefCountStatistics refCountStatistics;
+	friend class CScriptVar;
+	friend class CScriptVarLink;
+#endif
 public:
 	int32_t getCurrentMarkSlot() const {
 		ASSERT(currentMarkSlot >= 0); // UniqueID not allocated
@@ -2625,13 +3418,46 @@ public:
 	}
 	void freeUniqueID() {
 		ASSERT(currentMarkSlot >= 0); // freeUniqueID without allocUniqueID
+		if(currentMarkSlot > 0) nestedMarks[currentMarkSlot-1].clear();
 		--currentMarkSlot;
 	}
-	CScriptVar *first;
+	/// the temporary marks of the nested mark-slots (the first slot is stored in the pages of the heap)
+	std::map<CScriptVar*, uint32_t> nestedMarks[TEMPORARY_MARK_SLOTS-1];
+	void eraseNestedMarks(CScriptVar *Var) { for(int32_t slot = currentMarkSlot; slot > 0; --slot) nestedMarks[slot-1].erase(Var); }
 	void setTemporaryID_recursive(uint32_t ID);
 	void ClearUnreferedVars(const CScriptVarPtr &extra=CScriptVarPtr());
 	void setStackBase(void * StackBase) { stackBase = StackBase; }
 	void setStackBase(uint32_t StackSize) { char dummy = 0; stackBase = StackSize ? &dummy - StackSize : 0; }
+	/// profiling mode: if Feedback is set the types at all operator-, property- and call-sites are recorded in Feedback
+	/// the feedback of a file (CScriptTokenizer(0, File)) or a module (require) is stored with its compiled tokens
+	/// after the execution: in the .jsc if CScriptTokenizer::writeCompiledTokens is set and in the tokens shared by
+	/// the contexts for modules - the stored feedback is added to Feedback if the file has no sites in Feedback yet
+	void setTypeFeedback(CScriptTypeFeedback *Feedback) { typeFeedback = Feedback; }
+	CScriptTypeFeedback *getTypeFeedback() const { return typeFeedback; }
+	/// samples the allocations of script objects in Profiler - 0 stops the sampling
+	/// the profiler is not owned by the context and must live as long as the context or until it is replaced
+	/// a replaced profiler keeps the samples of vars not freed yet as freed samples (see CScriptAllocationProfiler::detach)
+	void setAllocationProfiler(CScriptAllocationProfiler *Profiler);
+	CScriptAllocationProfiler *getAllocationProfiler() const { return allocationProfiler; }
+	/// returns the unique string var with the characters of Str (created if needed)
+	/// used for literals and property-names - the equality of interned strings is a pointer compare
+	CScriptVarPtr internString(const std::string &Str);
+	size_t internedStringsCount() const { return internedStrings.size(); }
+	/// the generator of Math.random and Math.randomFill
+	/// use getRandom().seed(Seed) for reproducible runs
+	CScriptRandom &getRandom() { return random; }
+	/// the output of print() and console.* goes to Sink - 0 restores the default sink (buffered stdout)
+	/// the sink is not owned by the context and must live as long as the context or until it is replaced
+	void setConsoleSink(CScriptConsoleSink *Sink);
+	CScriptConsoleSink *getConsoleSink();
+	/// writes the buffered output of print() and console.* (also done at the end of the context)
+	void flushConsole() { if(consoleSink) consoleSink->flush(); }
+#ifndef NO_JIT
+	/// functions called more than Calls times are compiled to native code (if possible)
+	/// 0 disables the JIT
+	void setJitThreshold(uint32_t Calls) { jitThreshold = Calls; }
+	uint32_t getJitThreshold() const { return jitThreshold; }
+#endif
 };
 
 
@@ -2642,8 +3468,22 @@ inline const CScriptVarPtr &CScriptVar::constScriptVar(T t) { return context->co
 inline CNumber CScriptVarLink::toNumber() { return var->toNumber(); }
 inline CNumber CScriptVarLink::toNumber(CScriptResult &execute) { return var->toNumber(execute); }
 
-inline void CScriptVar::setTemporaryMark(uint32_t ID) { temporaryMark[context->getCurrentMarkSlot()] = ID; }
-inline uint32_t CScriptVar::getTemporaryMark() { return temporaryMark[context->getCurrentMarkSlot()]; }
+inline void *CScriptVar::operator new(size_t Size, CTinyJS *Context) {
+	void *p = Context->heap.alloc(Size);
+	if(Context->allocationProfiler && Context->allocationProfiler->sample(Size)) Context->recordAllocation(p, Size);
+	return p;
+}
+inline void CScriptVar::setTemporaryMark(uint32_t ID) {
+	int32_t slot = context->getCurrentMarkSlot();
+	if(slot == 0) CScriptVarHeap::setMark(this, ID);
+	else context->nestedMarks[slot-1][this] = ID;
+}
+inline uint32_t CScriptVar::getTemporaryMark() {
+	int32_t slot = context->getCurrentMarkSlot();
+	if(slot == 0) return CScriptVarHeap::getMark(this);
+	std::map<CScriptVar*, uint32_t>::iterator it = context->nestedMarks[slot-1].find(this);
+	return it == context->nestedMarks[slot-1].end() ? 0 : it->second;
+}
 
 
 #endif
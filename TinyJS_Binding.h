@@ -0,0 +1,271 @@
+#ifndef TinyJS_Binding_h__
+#define TinyJS_Binding_h__
+/*
+ * 42TinyJS
+ *
+ * A fork of TinyJS with the goal to makes a more JavaScript/ECMA compliant engine
+ *
+ * Authored By Armin Diedering <armin@diedering.de>
+ *
+ * Copyright (C) 2010-2015 ardisoft
+ *
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <tuple>
+#include "TinyJS_Bridge.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptVarHostObject
+//////////////////////////////////////////////////////////////////////////
+
+/// the script object of a bound C++ object (see CScriptClassBinding)
+class CScriptVarHostObject : public CScriptVarObject {
+public:
+	CScriptVarHostObject(CTinyJS *Context, const CScriptVarPtr &Prototype, const void *ClassTag, void *Object, void (*Deleter)(void *))
+		: CScriptVarObject(Context, Prototype), classTag(ClassTag), object(Object), deleter(Deleter) {}
+	virtual ~CScriptVarHostObject() OVERRIDE { if(deleter) deleter(object); }
+	/// returns the C++ object if it's an object of the class identified by ClassTag otherwise 0
+	static void *getObject(const CScriptVarPtr &Var, const void *ClassTag) {
+		CScriptVarHostObject *Host = dynamic_cast<CScriptVarHostObject *>(Var.getVar());
+		return Host && Host->classTag == ClassTag ? Host->object : 0;
+	}
+private:
+	CScriptVarHostObject(const CScriptVarHostObject& Copy) MEMBER_DELETE;
+	const void *classTag;
+	void *object;
+	void (*deleter)(void *);
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// binding helpers
+//////////////////////////////////////////////////////////////////////////
+
+template<size_t... I> struct CScriptBindingIndexes {};
+template<size_t N, size_t... I> struct CScriptBindingMakeIndexes : CScriptBindingMakeIndexes<N-1, N-1, I...> {};
+template<size_t... I> struct CScriptBindingMakeIndexes<0, I...> { typedef CScriptBindingIndexes<I...> type; };
+
+template<class C> struct CScriptBindingClass {
+	static const void *tag() { static const char Tag = 0; return &Tag; }
+	static void deleter(void *Object) { delete static_cast<C *>(Object); }
+	static C *unwrap(const CScriptVarPtr &Var) { return static_cast<C *>(CScriptVarHostObject::getObject(Var, tag())); }
+	static CScriptVarPtr wrap(CTinyJS *Context, const CScriptVarPtr &Prototype, C *Object, bool Owned) {
+		return new(Context) CScriptVarHostObject(Context, Prototype, tag(), Object, Owned ? &deleter : 0);
+	}
+};
+
+/// an argument is converted by CScriptValue (see TinyJS_Bridge.h)
+/// arguments of the bound class itself (C, C &, const C &, C *, const C *) are the bound C++ objects
+template<class C, typename T> struct CScriptBindingArg {
+	typedef typename std::decay<T>::type storage;
+	static bool get(const CScriptVarPtr &Var, storage &Value) { return fromScriptVar(Var, Value); }
+	static storage &pass(storage &Value) { return Value; }
+};
+template<class C> struct CScriptBindingObjectArg {
+	typedef C *storage;
+	static bool get(const CScriptVarPtr &Var, storage &Value) { return (Value = CScriptBindingClass<C>::unwrap(Var)) != 0; }
+};
+template<class C> struct CScriptBindingArg<C, C *> : CScriptBindingObjectArg<C> { static C *pass(C *Value) { return Value; } };
+template<class C> struct CScriptBindingArg<C, const C *> : CScriptBindingObjectArg<C> { static C *pass(C *Value) { return Value; } };
+template<class C> struct CScriptBindingArg<C, C &> : CScriptBindingObjectArg<C> { static C &pass(C *Value) { return *Value; } };
+template<class C> struct CScriptBindingArg<C, const C &> : CScriptBindingObjectArg<C> { static C &pass(C *Value) { return *Value; } };
+template<class C> struct CScriptBindingArg<C, C> : CScriptBindingObjectArg<C> { static C &pass(C *Value) { return *Value; } };
+
+/// a result of the bound class itself is returned as a new script object with the prototype of the class
+template<class C, typename R> struct CScriptBindingResult {
+	static CScriptVarPtr get(CTinyJS *Context, const CScriptVarPtr &, const R &Value) { return toScriptVar(Context, Value); }
+};
+template<class C> struct CScriptBindingResult<C, C> {
+	static CScriptVarPtr get(CTinyJS *Context, const CScriptVarPtr &Prototype, const C &Value) { return CScriptBindingClass<C>::wrap(Context, Prototype, new C(Value), true); }
+};
+
+template<typename F> struct CScriptBindingVoid {
+	CScriptBindingVoid(F Fnc) : fnc(Fnc) {}
+	template<typename... A> int operator()(A&&... Arguments) const { fnc(std::forward<A>(Arguments)...); return 0; }
+	F fnc;
+};
+
+/// calls Fnc(Object, converted Arguments...)
+template<class C, typename R, typename... Args> struct CScriptBindingCall {
+	template<typename F, size_t... I>
+	static R invoke(CScriptVarFunctionNativeDirect *Native, F Fnc, C *Object, const std::vector<CScriptVarPtr> &Arguments, CScriptBindingIndexes<I...>) {
+		std::tuple<typename CScriptBindingArg<C, Args>::storage...> Values;
+		convert<0>(Native, Arguments, Values);
+		return Fnc(Object, CScriptBindingArg<C, Args>::pass(std::get<I>(Values))...);
+	}
+	template<typename F, typename Indexes>
+	static CScriptVarPtr call(CScriptVarFunctionNativeDirect *Native, const CScriptVarPtr &Prototype, F Fnc, C *Object, const std::vector<CScriptVarPtr> &Arguments, Indexes) {
+		return CScriptBindingResult<C, typename std::decay<R>::type>::get(Native->getContext(), Prototype, invoke(Native, Fnc, Object, Arguments, Indexes()));
+	}
+	template<size_t N, typename T>
+	static typename std::enable_if<N == std::tuple_size<T>::value>::type convert(CScriptVarFunctionNativeDirect *, const std::vector<CScriptVarPtr> &, T &) {}
+	template<size_t N, typename T>
+	static typename std::enable_if<N < std::tuple_size<T>::value>::type convert(CScriptVarFunctionNativeDirect *Native, const std::vector<CScriptVarPtr> &Arguments, T &Values) {
+		typedef typename std::tuple_element<N, std::tuple<Args...> >::type Arg;
+		if(!CScriptBindingArg<C, Arg>::get(N < Arguments.size() ? Arguments[N] : Native->constScriptVar(Undefined), std::get<N>(Values)))
+			Native->throwError(TypeError, "argument " + int2string(N+1) + " of " + Native->getFunctionData()->name + " has the wrong type");
+		convert<N+1>(Native, Arguments, Values);
+	}
+};
+template<class C, typename... Args> struct CScriptBindingCall<C, void, Args...> : CScriptBindingCall<C, int, Args...> {
+	template<typename F, typename Indexes>
+	static CScriptVarPtr call(CScriptVarFunctionNativeDirect *Native, const CScriptVarPtr &, F Fnc, C *Object, const std::vector<CScriptVarPtr> &Arguments, Indexes) {
+		CScriptBindingCall<C, int, Args...>::invoke(Native, CScriptBindingVoid<F>(Fnc), Object, Arguments, Indexes());
+		return Native->constScriptVar(Undefined);
+	}
+};
+
+template<class C, typename M> struct CScriptBindingMethodTraits;
+template<class C, typename R, typename... Args> struct CScriptBindingMethodTraits<C, R (C::*)(Args...)> {
+	typedef CScriptBindingCall<C, R, Args...> call_type;
+	typedef typename CScriptBindingMakeIndexes<sizeof...(Args)>::type indexes;
+	struct invoker {
+		invoker(R (C::*Method)(Args...)) : method(Method) {}
+		R operator()(C *Object, Args... Arguments) const { return (Object->*method)(std::forward<Args>(Arguments)...); }
+		R (C::*method)(Args...);
+	};
+};
+template<class C, typename R, typename... Args> struct CScriptBindingMethodTraits<C, R (C::*)(Args...) const> {
+	typedef CScriptBindingCall<C, R, Args...> call_type;
+	typedef typename CScriptBindingMakeIndexes<sizeof...(Args)>::type indexes;
+	struct invoker {
+		invoker(R (C::*Method)(Args...) const) : method(Method) {}
+		R operator()(C *Object, Args... Arguments) const { return (Object->*method)(std::forward<Args>(Arguments)...); }
+		R (C::*method)(Args...) const;
+	};
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// the natives of a binding
+//////////////////////////////////////////////////////////////////////////
+
+template<class C, typename M> class CScriptBindingMethod : public CScriptVarFunctionNativeDirect {
+public:
+	CScriptBindingMethod(CTinyJS *Context, const char *Name, M Method) : CScriptVarFunctionNativeDirect(Context, Name, 0), method(Method) {}
+	virtual CScriptVarPtr callDirect(const CScriptVarPtr &This, const std::vector<CScriptVarPtr> &Arguments) OVERRIDE {
+		C *Object = CScriptBindingClass<C>::unwrap(This);
+		if(!Object) throwError(TypeError, getFunctionData()->name + " called on an incompatible object");
+		typedef CScriptBindingMethodTraits<C, M> traits;
+		return traits::call_type::call(this, This->getPrototype(), typename traits::invoker(method), Object, Arguments, typename traits::indexes());
+	}
+private:
+	M method;
+};
+
+template<class C, typename F> class CScriptBindingFieldGetter : public CScriptVarFunctionNativeDirect {
+public:
+	CScriptBindingFieldGetter(CTinyJS *Context, const char *Name, F C::*Field) : CScriptVarFunctionNativeDirect(Context, Name, 0), field(Field) {}
+	virtual CScriptVarPtr callDirect(const CScriptVarPtr &This, const std::vector<CScriptVarPtr> &) OVERRIDE {
+		C *Object = CScriptBindingClass<C>::unwrap(This);
+		if(!Object) return constScriptVar(Undefined); // e.g. Class.prototype.field
+		return toScriptVar(context, Object->*field);
+	}
+private:
+	F C::*field;
+};
+template<class C, typename F> class CScriptBindingFieldSetter : public CScriptVarFunctionNativeDirect {
+public:
+	CScriptBindingFieldSetter(CTinyJS *Context, const char *Name, F C::*Field) : CScriptVarFunctionNativeDirect(Context, Name, 0), field(Field) {}
+	virtual CScriptVarPtr callDirect(const CScriptVarPtr &This, const std::vector<CScriptVarPtr> &Arguments) OVERRIDE {
+		C *Object = CScriptBindingClass<C>::unwrap(This);
+		if(!Object) throwError(TypeError, getFunctionData()->name + " called on an incompatible object");
+		if(Arguments.empty() || !fromScriptVar(Arguments[0], Object->*field))
+			throwError(TypeError, "can't assign " + (Arguments.empty() ? std::string("undefined") : Arguments[0]->toString()) + " to " + getFunctionData()->name);
+		return constScriptVar(Undefined);
+	}
+private:
+	F C::*field;
+};
+
+template<class C> class CScriptBindingConstructor : public CScriptVarFunctionNativeDirect {
+public:
+	typedef C *(*FACTORY)(CScriptVarFunctionNativeDirect *Native, const std::vector<CScriptVarPtr> &Arguments);
+	CScriptBindingConstructor(CTinyJS *Context, const char *Name) : CScriptVarFunctionNativeDirect(Context, Name, 0), factory(0) {}
+	virtual CScriptVarPtr callDirect(const CScriptVarPtr &, const std::vector<CScriptVarPtr> &Arguments) OVERRIDE {
+		if(!factory) throwError(TypeError, getFunctionData()->name + " is not a constructor");
+		return CScriptBindingClass<C>::wrap(context, getProperty(TINYJS_PROTOTYPE_CLASS), factory(this, Arguments), true);
+	}
+	template<typename... Args> static C *create(CScriptVarFunctionNativeDirect *Native, const std::vector<CScriptVarPtr> &Arguments) {
+		return CScriptBindingCall<C, C *, Args...>::invoke(Native, construct(), 0, Arguments, typename CScriptBindingMakeIndexes<sizeof...(Args)>::type());
+	}
+	FACTORY factory;
+private:
+	struct construct {
+		template<typename... Args> C *operator()(C *, Args&&... Arguments) const { return new C(std::forward<Args>(Arguments)...); }
+	};
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptClassBinding
+//////////////////////////////////////////////////////////////////////////
+
+/// describes the methods and fields of a C++ class once - all objects of the class share one prototype
+/// the natives are called with positional arguments (see CScriptVarFunctionNativeDirect)
+/// arguments and results are converted by CScriptValue (see TinyJS_Bridge.h)
+/// example:
+///   CScriptClassBinding<Vec> VecBinding(&js, "Vec");
+///   VecBinding.constructor<double, double>()
+///     .field("x", &Vec::x)
+///     .method("length", &Vec::length);
+///   js.getRoot()->addChild("origin", VecBinding.wrap(&origin));
+template<class C> class CScriptClassBinding {
+public:
+	/// creates the constructor-function Name (a global if Parent is 0) and the prototype
+	CScriptClassBinding(CTinyJS *Context, const std::string &Name, const CScriptVarPtr &Parent=CScriptVarPtr()) : context(Context) {
+		constructorFnc = new(Context) CScriptBindingConstructor<C>(Context, Name.c_str());
+		constructorVar = constructorFnc;
+		prototype = ::newScriptVar(Context, Object);
+		constructorVar->addChildOrReplace(TINYJS_PROTOTYPE_CLASS, prototype, 0);
+		prototype->addChild("constructor", constructorVar, SCRIPTVARLINK_BUILDINDEFAULT);
+		(Parent ? Parent : Context->getRoot())->addChildOrReplace(Name, constructorVar, SCRIPTVARLINK_BUILDINDEFAULT);
+	}
+	/// "new Name(...)" creates the C++ object by C(Args...)
+	template<typename... Args> CScriptClassBinding &constructor() {
+		constructorFnc->factory = &CScriptBindingConstructor<C>::template create<Args...>;
+		return *this;
+	}
+	/// a method (const or non-const member function)
+	template<typename M> CScriptClassBinding &method(const char *Name, M Method) {
+		prototype->addChild(Name, new(context) CScriptBindingMethod<C, M>(context, Name, Method), SCRIPTVARLINK_BUILDINDEFAULT);
+		return *this;
+	}
+	/// a field as accessor-property
+	template<typename F> CScriptClassBinding &field(const char *Name, F C::*Field, bool ReadOnly=false) {
+		CScriptVarFunctionPtr Getter(new(context) CScriptBindingFieldGetter<C, F>(context, Name, Field));
+		CScriptVarFunctionPtr Setter;
+		if(!ReadOnly) Setter = CScriptVarFunctionPtr(new(context) CScriptBindingFieldSetter<C, F>(context, Name, Field));
+		prototype->addChild(Name, ::newScriptVarAccessor(context, Getter, Setter), ReadOnly ? 0 : SCRIPTVARLINK_WRITABLE);
+		return *this;
+	}
+	const CScriptVarPtr &getPrototype() const { return prototype; }
+	const CScriptVarPtr &getConstructor() const { return constructorVar; }
+
+	/// creates a script object for a C++ object - Owned objects are deleted with the script object
+	CScriptVarPtr wrap(C *Object, bool Owned=false) const { return CScriptBindingClass<C>::wrap(context, prototype, Object, Owned); }
+	/// returns the C++ object of a script object or 0
+	static C *unwrap(const CScriptVarPtr &Var) { return CScriptBindingClass<C>::unwrap(Var); }
+private:
+	CTinyJS *context;
+	CScriptBindingConstructor<C> *constructorFnc;
+	CScriptVarPtr constructorVar;
+	CScriptVarPtr prototype;
+};
+
+#endif // TinyJS_Binding_h__
@@ -0,0 +1,261 @@
+#ifndef TinyJS_Bridge_h__
+#define TinyJS_Bridge_h__
+/*
+ * 42TinyJS
+ *
+ * A fork of TinyJS with the goal to makes a more JavaScript/ECMA compliant engine
+ *
+ * Authored By Armin Diedering <armin@diedering.de>
+ *
+ * Copyright (C) 2010-2015 ardisoft
+ *
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <type_traits>
+#include "TinyJS.h"
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#	define TINYJS_BRIDGE_CXX17 1
+#	include <optional>
+#	include <string_view>
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptValue
+//////////////////////////////////////////////////////////////////////////
+
+/// typed conversion between C++ values and script values without a detour over strings or JSON
+///   CScriptVarPtr toScriptVar(Context, const T &)	creates a script value
+///   bool fromScriptVar(Var, T &)					returns false if Var can't be converted to T
+///   T fromScriptVar<T>(Var)						throws a TypeError if Var can't be converted to T
+/// supported are bool, the arithmetic types, std::string, const char * (to script only),
+/// std::vector<T>, std::map<std::string, T>, CScriptVarPtr, structs registered with
+/// TINYJS_STRUCT_BEGIN and with C++17 std::optional<T> and std::string_view (to script only)
+/// more types can be added by a specialization of CScriptValue
+template<typename T, typename Enable=void> struct CScriptValue;
+
+template<typename T> inline CScriptVarPtr toScriptVar(CTinyJS *Context, const T &Value) {
+	return CScriptValue<T>::toScript(Context, Value);
+}
+inline CScriptVarPtr toScriptVar(CTinyJS *Context, const char *Value) {
+	return ::newScriptVar(Context, Value);
+}
+template<typename T> inline bool fromScriptVar(const CScriptVarPtr &Var, T &Value) {
+	return CScriptValue<T>::fromScript(Var, Value);
+}
+template<typename T> inline T fromScriptVar(const CScriptVarPtr &Var) {
+	T Value = T();
+	if(!CScriptValue<T>::fromScript(Var, Value))
+		throw CScriptException(TypeError, "can't convert " + Var->toString() + " to the native type");
+	return Value;
+}
+/// evaluates the code and converts the result
+template<typename T> inline T evaluateAs(CTinyJS *Context, const std::string &Code, const std::string &File="") {
+	return fromScriptVar<T>(Context->evaluateComplex(Code, File)->getVarPtr());
+}
+
+/// the value of a property - a missing property (or an Array hole) is undefined
+template<typename K> inline CScriptVarPtr scriptProperty(const CScriptVarPtr &Object, const K &Key) {
+	CScriptVarPtr Property = Object->getProperty(Key);
+	return Property ? Property : Object->getContext()->constScriptVar(Undefined);
+}
+
+template<> struct CScriptValue<CScriptVarPtr> {
+	static CScriptVarPtr toScript(CTinyJS *, const CScriptVarPtr &Value) { return Value; }
+	static bool fromScript(const CScriptVarPtr &Var, CScriptVarPtr &Value) { Value = Var; return true; }
+};
+
+template<> struct CScriptValue<bool> {
+	static CScriptVarPtr toScript(CTinyJS *Context, bool Value) { return Context->constScriptVar(Value); }
+	static bool fromScript(const CScriptVarPtr &Var, bool &Value) {
+		if(!Var->isBool()) return false;
+		Value = Var->toBoolean();
+		return true;
+	}
+};
+
+/// integers are created as int32 if possible otherwise as double
+/// from script: integers must be finite and in the range of the type (the fraction is truncated)
+template<typename T> struct CScriptValue<T, typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>::type> {
+	static CScriptVarPtr toScript(CTinyJS *Context, T Value) {
+		if(std::is_floating_point<T>::value) return ::newScriptVar(Context, CNumber(double(Value)));
+		if(std::is_signed<T>::value) return ::newScriptVar(Context, CNumber(int64_t(Value)));
+		return ::newScriptVar(Context, CNumber(uint64_t(Value)));
+	}
+	static bool fromScript(const CScriptVarPtr &Var, T &Value) {
+		if(!Var->isNumber()) return false;
+		CNumber Number = Var->toNumber();
+		if(std::is_floating_point<T>::value) {
+			Value = T(Number.toDouble());
+			return true;
+		}
+		if(Number.isInt32()) {
+			int32_t Int = Number.toInt32();
+			if(Int < 0 ? Int < int64_t(std::numeric_limits<T>::min()) : uint32_t(Int) > uint64_t(std::numeric_limits<T>::max())) return false;
+			Value = T(Int);
+			return true;
+		}
+		if(!Number.isFinite()) return false;
+		double Double = Number.toDouble();
+		if(Double <= double(std::numeric_limits<T>::min()) - 1 || Double >= double(std::numeric_limits<T>::max()) + 1) return false;
+		Value = T(Double);
+		return true;
+	}
+};
+
+template<> struct CScriptValue<std::string> {
+	static CScriptVarPtr toScript(CTinyJS *Context, const std::string &Value) { return ::newScriptVar(Context, Value); }
+	static bool fromScript(const CScriptVarPtr &Var, std::string &Value) {
+		if(!Var->isString()) return false;
+		Value = Var->toString();
+		return true;
+	}
+};
+
+/// to script: a new Array
+/// from script: any Array
+template<typename T> struct CScriptValue<std::vector<T> > {
+	static CScriptVarPtr toScript(CTinyJS *Context, const std::vector<T> &Value) {
+		CScriptVarPtr Array = ::newScriptVar(Context, ::Array);
+		for(size_t i = 0; i < Value.size(); ++i)
+			Array->addChild(uint32_t(i), CScriptValue<T>::toScript(Context, Value[i]));
+		return Array;
+	}
+	static bool fromScript(const CScriptVarPtr &Var, std::vector<T> &Value) {
+		if(!Var->isArray()) return false;
+		uint32_t Length = Var->getLength();
+		std::vector<T> Result(Length);
+		for(uint32_t i = 0; i < Length; ++i)
+			if(!CScriptValue<T>::fromScript(scriptProperty(Var, i), Result[i])) return false;
+		Value.swap(Result);
+		return true;
+	}
+};
+
+/// to script: a new Object
+/// from script: the own enumerable properties of any Object
+template<typename T> struct CScriptValue<std::map<std::string, T> > {
+	static CScriptVarPtr toScript(CTinyJS *Context, const std::map<std::string, T> &Value) {
+		CScriptVarPtr Object = ::newScriptVar(Context, ::Object);
+		for(typename std::map<std::string, T>::const_iterator it = Value.begin(); it != Value.end(); ++it)
+			Object->addChild(it->first, CScriptValue<T>::toScript(Context, it->second));
+		return Object;
+	}
+	static bool fromScript(const CScriptVarPtr &Var, std::map<std::string, T> &Value) {
+		if(!Var->isObject()) return false;
+		STRING_SET_t Keys;
+		Var->keys(Keys);
+		std::map<std::string, T> Result;
+		for(STRING_SET_it it = Keys.begin(); it != Keys.end(); ++it)
+			if(!CScriptValue<T>::fromScript(scriptProperty(Var, *it), Result[*it])) return false;
+		Value.swap(Result);
+		return true;
+	}
+};
+
+#ifdef TINYJS_BRIDGE_CXX17
+/// undefined and null are std::nullopt
+template<typename T> struct CScriptValue<std::optional<T> > {
+	static CScriptVarPtr toScript(CTinyJS *Context, const std::optional<T> &Value) {
+		return Value ? CScriptValue<T>::toScript(Context, *Value) : Context->constScriptVar(Undefined);
+	}
+	static bool fromScript(const CScriptVarPtr &Var, std::optional<T> &Value) {
+		if(Var->isNullOrUndefined()) {
+			Value.reset();
+			return true;
+		}
+		T Result;
+		if(!CScriptValue<T>::fromScript(Var, Result)) return false;
+		Value = std::move(Result);
+		return true;
+	}
+};
+
+/// to script only - a string_view can't hold the data of a script string
+template<> struct CScriptValue<std::string_view> {
+	static CScriptVarPtr toScript(CTinyJS *Context, std::string_view Value) { return ::newScriptVar(Context, std::string(Value)); }
+};
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+/// structs
+//////////////////////////////////////////////////////////////////////////
+
+/// a struct is registered by the list of its fields - the struct is converted into/from an Object
+/// example:
+///   struct Point { int x, y; std::string name; };
+///   TINYJS_STRUCT_BEGIN(Point)
+///     TINYJS_STRUCT_FIELD(x)
+///     TINYJS_STRUCT_FIELD(y)
+///     TINYJS_STRUCT_FIELD(name)
+///   TINYJS_STRUCT_END
+/// the registration must be placed in the global namespace
+template<typename T> struct CScriptStructFields {
+	enum { registered = 0 };
+};
+#define TINYJS_STRUCT_BEGIN(Type) \
+	template<> struct CScriptStructFields<Type> { \
+		enum { registered = 1 }; \
+		typedef Type type; \
+		template<typename V> static bool visit(V &Visitor) { \
+			return true
+#define TINYJS_STRUCT_FIELD(Field) \
+			&& Visitor(#Field, &type::Field)
+#define TINYJS_STRUCT_END \
+			; \
+		} \
+	};
+
+template<typename T> class CScriptStructToScript {
+public:
+	CScriptStructToScript(CTinyJS *Context, const T &Value) : context(Context), value(Value), object(::newScriptVar(Context, ::Object)) {}
+	template<typename F> bool operator()(const char *Name, F T::*Field) {
+		object->addChild(Name, CScriptValue<F>::toScript(context, value.*Field));
+		return true;
+	}
+	CTinyJS *context;
+	const T &value;
+	CScriptVarPtr object;
+};
+template<typename T> class CScriptStructFromScript {
+public:
+	CScriptStructFromScript(const CScriptVarPtr &Object, T &Value) : object(Object), value(Value) {}
+	template<typename F> bool operator()(const char *Name, F T::*Field) {
+		return CScriptValue<F>::fromScript(scriptProperty(object, std::string(Name)), value.*Field);
+	}
+	CScriptVarPtr object;
+	T &value;
+};
+
+template<typename T> struct CScriptValue<T, typename std::enable_if<CScriptStructFields<T>::registered != 0>::type> {
+	static CScriptVarPtr toScript(CTinyJS *Context, const T &Value) {
+		CScriptStructToScript<T> Visitor(Context, Value);
+		CScriptStructFields<T>::visit(Visitor);
+		return Visitor.object;
+	}
+	static bool fromScript(const CScriptVarPtr &Var, T &Value) {
+		if(!Var->isObject()) return false;
+		CScriptStructFromScript<T> Visitor(Var, Value);
+		return CScriptStructFields<T>::visit(Visitor);
+	}
+};
+
+#endif // TinyJS_Bridge_h__
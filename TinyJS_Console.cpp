@@ -0,0 +1,171 @@
+/*
+ * 42TinyJS
+ *
+ * A fork of TinyJS with the goal to makes a more JavaScript/ECMA compliant engine
+ *
+ * Authored By Armin Diedering <armin@diedering.de>
+ *
+ * Copyright (C) 2010-2015 ardisoft
+ *
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "TinyJS_Console.h"
+#include "TinyJS.h"
+#ifdef _WIN32
+#	include <windows.h>
+#else
+#	include <time.h>
+#endif
+
+using namespace std;
+
+// a monotonic time in ms
+static int64_t consoleTime() {
+#ifdef _WIN32
+	return int64_t(GetTickCount64());
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return int64_t(ts.tv_sec)*1000 + ts.tv_nsec/1000000;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptConsoleSink
+//////////////////////////////////////////////////////////////////////////
+
+CScriptConsoleSink::~CScriptConsoleSink() {}
+void CScriptConsoleSink::flush() {}
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptConsoleBufferedSink
+//////////////////////////////////////////////////////////////////////////
+
+CScriptConsoleBufferedSink::CScriptConsoleBufferedSink(FILE *Out, size_t MaxSize, uint32_t MaxDelay)
+	: out(Out), maxSize(MaxSize), maxDelay(MaxDelay), firstLineTime(0) {}
+CScriptConsoleBufferedSink::~CScriptConsoleBufferedSink() {
+	flush();
+}
+void CScriptConsoleBufferedSink::write(LEVEL Level, const char *Line, size_t Size) {
+	int64_t now = consoleTime();
+	if(buffer.empty()) firstLineTime = now;
+	buffer.append(Line, Size);
+	if(buffer.size() >= maxSize || now - firstLineTime >= maxDelay)
+		flush();
+}
+void CScriptConsoleBufferedSink::flush() {
+	if(buffer.empty()) return;
+	output(buffer);
+	buffer.clear();
+}
+void CScriptConsoleBufferedSink::output(string &Buffer) {
+	fwrite(Buffer.data(), 1, Buffer.size(), out);
+	fflush(out);
+}
+
+#ifndef NO_THREADING
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptConsoleAsyncSink
+//////////////////////////////////////////////////////////////////////////
+
+CScriptConsoleAsyncSink::CScriptConsoleAsyncSink(FILE *Out, size_t MaxSize, uint32_t MaxDelay)
+	: CScriptConsoleBufferedSink(Out, MaxSize, MaxDelay), pendingTime(0), flushing(0), writing(false), stop(false) {
+	Run();
+}
+CScriptConsoleAsyncSink::~CScriptConsoleAsyncSink() {
+	{
+		CScriptUniqueLock<CScriptMutex> lock(mutex);
+		stop = true;
+		pendingCondVar.notify_one();
+	}
+	Stop(); // the writer-thread writes the pending lines before it ends
+}
+void CScriptConsoleAsyncSink::write(LEVEL Level, const char *Line, size_t Size) {
+	CScriptUniqueLock<CScriptMutex> lock(mutex);
+	bool first = pending.empty();
+	if(first) pendingTime = consoleTime();
+	pending.append(Line, Size);
+	// the first line starts the timer of the writer-thread
+	if(first || pending.size() >= maxSize) pendingCondVar.notify_one();
+}
+void CScriptConsoleAsyncSink::flush() {
+	CScriptUniqueLock<CScriptMutex> lock(mutex);
+	++flushing;
+	pendingCondVar.notify_one();
+	while(!pending.empty() || writing) writtenCondVar.wait(lock);
+	--flushing;
+}
+int CScriptConsoleAsyncSink::ThreadFnc() {
+	string buffer;
+	CScriptUniqueLock<CScriptMutex> lock(mutex);
+	for(;;) {
+		if(pending.empty()) {
+			if(stop) return 0;
+			pendingCondVar.wait(lock);
+			continue;
+		}
+		int64_t delay = pendingTime + maxDelay - consoleTime();
+		if(!flushing && !stop && pending.size() < maxSize && delay > 0) {
+			pendingCondVar.wait_for(lock, unsigned(delay));
+			continue;
+		}
+		buffer.swap(pending);
+		writing = true;
+		mutex.unlock();
+		output(buffer);
+		buffer.clear();
+		mutex.lock();
+		writing = false;
+		writtenCondVar.notify_one();
+	}
+}
+
+#endif // NO_THREADING
+
+//////////////////////////////////////////////////////////////////////////
+/// print & console
+//////////////////////////////////////////////////////////////////////////
+
+// the arguments are separated by a space like in the browsers
+static void scConsoleWrite(const CFunctionsScopePtr &c, void *userdata) {
+	string line;
+	int length = c->getArgumentsLength();
+	for(int i=0; i<length; ++i) {
+		if(i) line.push_back(' ');
+		line.append(c->getArgument(i)->toString());
+	}
+	line.push_back('\n');
+	c->getContext()->getConsoleSink()->write(CScriptConsoleSink::LEVEL(ptrdiff_t(userdata)), line.data(), line.size());
+}
+static void scConsoleFlush(const CFunctionsScopePtr &c, void *) {
+	c->getContext()->flushConsole();
+}
+
+// ----------------------------------------------- Register Functions
+extern "C" void _registerConsoleFunctions(CTinyJS *tinyJS) {
+	tinyJS->addNative("function print(text)", scConsoleWrite, (void*)CScriptConsoleSink::LEVEL_LOG, SCRIPTVARLINK_BUILDINDEFAULT);
+	tinyJS->addNative("function console.log()", scConsoleWrite, (void*)CScriptConsoleSink::LEVEL_LOG, SCRIPTVARLINK_BUILDINDEFAULT);
+	tinyJS->addNative("function console.info()", scConsoleWrite, (void*)CScriptConsoleSink::LEVEL_INFO, SCRIPTVARLINK_BUILDINDEFAULT);
+	tinyJS->addNative("function console.warn()", scConsoleWrite, (void*)CScriptConsoleSink::LEVEL_WARN, SCRIPTVARLINK_BUILDINDEFAULT);
+	tinyJS->addNative("function console.error()", scConsoleWrite, (void*)CScriptConsoleSink::LEVEL_ERROR, SCRIPTVARLINK_BUILDINDEFAULT);
+	tinyJS->addNative("function console.flush()", scConsoleFlush, 0, SCRIPTVARLINK_BUILDINDEFAULT);
+}
@@ -0,0 +1,109 @@
+#ifndef TinyJS_Console_h__
+#define TinyJS_Console_h__
+#include "config.h"
+/*
+ * 42TinyJS
+ *
+ * A fork of TinyJS with the goal to makes a more JavaScript/ECMA compliant engine
+ *
+ * Authored By Armin Diedering <armin@diedering.de>
+ *
+ * Copyright (C) 2010-2015 ardisoft
+ *
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string>
+#include <cstdio>
+#include <stdint.h>
+#include "TinyJS_Threading.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptConsoleSink
+//////////////////////////////////////////////////////////////////////////
+
+/// the output of print() and console.* goes to the sink of the context (see CTinyJS::setConsoleSink)
+/// a sink is used by one context at a time
+class CScriptConsoleSink {
+public:
+	enum LEVEL { LEVEL_LOG, LEVEL_INFO, LEVEL_WARN, LEVEL_ERROR };
+	virtual ~CScriptConsoleSink();
+	/// Line is one complete line including the '\n'
+	virtual void write(LEVEL Level, const char *Line, size_t Size)=0;
+	/// called by console.flush(), CTinyJS::flushConsole() and at the end of the context
+	virtual void flush();
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptConsoleBufferedSink
+//////////////////////////////////////////////////////////////////////////
+
+/// the default sink - the lines are collected in a buffer and written with one fwrite when
+/// the buffer reaches MaxSize bytes, the oldest line is older than MaxDelay ms or flush is called
+/// there is no timer - MaxDelay is checked on write only, the last lines wait for the next write or flush
+/// (use CTinyJS::flushConsole after an evaluation or CScriptConsoleAsyncSink with a timer)
+class CScriptConsoleBufferedSink : public CScriptConsoleSink {
+public:
+	CScriptConsoleBufferedSink(FILE *Out=stdout, size_t MaxSize=64*1024, uint32_t MaxDelay=100);
+	virtual ~CScriptConsoleBufferedSink();
+	virtual void write(LEVEL Level, const char *Line, size_t Size);
+	virtual void flush();
+protected:
+	/// writes the collected lines - Buffer can be swapped out, it is cleared afterwards
+	virtual void output(std::string &Buffer);
+	FILE *out;
+	size_t maxSize;
+	uint32_t maxDelay;
+private:
+	std::string buffer;
+	int64_t firstLineTime;
+};
+
+#ifndef NO_THREADING
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptConsoleAsyncSink
+//////////////////////////////////////////////////////////////////////////
+
+/// the lines are handed over to a writer-thread - the script never waits for Out
+/// the writer-thread calls output when MaxSize bytes are collected, the oldest line is older
+/// than MaxDelay ms (also without further writes) or flush is called
+/// flush waits until all lines are written
+/// a derived class that overrides output must call flush in its destructor
+class CScriptConsoleAsyncSink : public CScriptConsoleBufferedSink, private CScriptThread {
+public:
+	CScriptConsoleAsyncSink(FILE *Out=stdout, size_t MaxSize=64*1024, uint32_t MaxDelay=100);
+	virtual ~CScriptConsoleAsyncSink();
+	virtual void write(LEVEL Level, const char *Line, size_t Size);
+	virtual void flush();
+private:
+	virtual int ThreadFnc();
+	CScriptMutex mutex;
+	CScriptCondVar pendingCondVar, writtenCondVar;
+	std::string pending;
+	int64_t pendingTime;	// the time of the oldest pending line
+	int flushing;			// the count of waiting flush calls
+	bool writing, stop;
+};
+
+#endif // NO_THREADING
+
+#endif // TinyJS_Console_h__
@@ -30,6 +30,7 @@
 #include <cstdlib>
 #include <sstream>
 #include <cstdio>
+#include <cstring>
 #include <iomanip>
 
 #include <ctime>
@@ -50,7 +51,6 @@ using namespace std;
 #define gmtime_s(tm, time) gmtime_r(time, tm)
 #define asctime_s(buf, bufsize, tm) asctime_r(tm, buf)
 #define _get_timezone(pTimezone) do{*pTimezone=timezone;}while(0)
-#define sprintf_s sprintf
 
 #endif
 
@@ -77,63 +77,63 @@ public:
 	int64_t getTime() const					{ return tm_time; }
 	operator int64_t() const				{ return getTime(); }
 
-	int64_t setDate(int32_t Date)			{ tm_mday = Date; return fix(); }
-	int32_t getDate() const					{ return tm_mday; }
+	int64_t setDate(int32_t Date)			{ FIELDS f = getFields(tm_islocal); f.mday = Date; return setFields(f, tm_islocal); }
+	int32_t getDate() const					{ return getFields(tm_islocal).mday; }
 
-	int64_t setUTCDate(int32_t Date)		{ return setTime(CScriptTime(*this, false).setDate(Date)); }
-	int32_t getUTCDate() const				{ return CScriptTime(*this, false).tm_mday; }
+	int64_t setUTCDate(int32_t Date)		{ FIELDS f = getFields(false); f.mday = Date; return setFields(f, false); }
+	int32_t getUTCDate() const				{ return getFields(false).mday; }
 
 
-	int32_t getDay() const					{ return tm_wday; }
-	int32_t getUTCDay() const				{ return CScriptTime(*this, false).tm_wday; }
+	int32_t getDay() const					{ return getFields(tm_islocal).wday; }
+	int32_t getUTCDay() const				{ return getFields(false).wday; }
 
 	int64_t setYear(int32_t Year);
-	int32_t getYear() const					{ return tm_year - 1900; }
+	int32_t getYear() const					{ return getFields(tm_islocal).year - 1900; }
 
-	int64_t setFullYear(int32_t Year);
-	int64_t setFullYear(int32_t Year, int32_t Month);
-	int64_t setFullYear(int32_t Year, int32_t Month, int32_t Day);
-	int32_t getFullYear() const													{ return tm_year; }
+	int64_t setFullYear(int32_t Year)										{ return setFullYear(Year, getMonth(), getDate()); }
+	int64_t setFullYear(int32_t Year, int32_t Month)					{ return setFullYear(Year, Month, getDate()); }
+	int64_t setFullYear(int32_t Year, int32_t Month, int32_t Day)	{ return setFullYear(Year, Month, Day, tm_islocal); }
+	int32_t getFullYear() const													{ return getFields(tm_islocal).year; }
 
-	int64_t setUTCFullYear(int32_t Year)										{ return setTime(CScriptTime(*this, false).setFullYear(Year)); }
-	int64_t setUTCFullYear(int32_t Year, int32_t Month)					{ return setTime(CScriptTime(*this, false).setFullYear(Year, Month)); }
-	int64_t setUTCFullYear(int32_t Year, int32_t Month, int32_t Day)	{ return setTime(CScriptTime(*this, false).setFullYear(Year, Month, Day)); }
-	int32_t getUTCFullYear() const												{ return CScriptTime(*this, false).tm_year; }
+	int64_t setUTCFullYear(int32_t Year)										{ return setUTCFullYear(Year, getUTCMonth(), getUTCDate()); }
+	int64_t setUTCFullYear(int32_t Year, int32_t Month)					{ return setUTCFullYear(Year, Month, getUTCDate()); }
+	int64_t setUTCFullYear(int32_t Year, int32_t Month, int32_t Day)	{ return setFullYear(Year, Month, Day, false); }
+	int32_t getUTCFullYear() const												{ return getFields(false).year; }
 
 
-	int64_t setHours(int32_t Hour)				{ tm_hour = Hour; return fix(); }
-	int32_t getHours() const						{ return tm_hour; }
-	int64_t setUTCHours(int32_t Hour)			{ return setTime(CScriptTime(*this, false).setHours(Hour)); }
-	int32_t getUTCHours() const					{ return CScriptTime(*this, false).tm_hour; }
+	int64_t setHours(int32_t Hour)				{ FIELDS f = getFields(tm_islocal); f.hour = Hour; return setFields(f, tm_islocal); }
+	int32_t getHours() const						{ return getFields(tm_islocal).hour; }
+	int64_t setUTCHours(int32_t Hour)			{ FIELDS f = getFields(false); f.hour = Hour; return setFields(f, false); }
+	int32_t getUTCHours() const					{ return getFields(false).hour; }
 
-	int64_t setMilliseconds(int32_t Msec)		{ tm_msec = Msec; return fix(); }
-	int32_t getMilliseconds() const				{ return tm_msec; }
-	int64_t setUTCMilliseconds(int32_t Msec)	{ return setTime(CScriptTime(*this, false).setMilliseconds(Msec)); }
-	int32_t getUTCMilliseconds() const			{ return CScriptTime(*this, false).tm_msec; }
+	int64_t setMilliseconds(int32_t Msec)		{ FIELDS f = getFields(tm_islocal); f.msec = Msec; return setFields(f, tm_islocal); }
+	int32_t getMilliseconds() const				{ return getFields(tm_islocal).msec; }
+	int64_t setUTCMilliseconds(int32_t Msec)	{ FIELDS f = getFields(false); f.msec = Msec; return setFields(f, false); }
+	int32_t getUTCMilliseconds() const			{ return getFields(false).msec; }
 
-	int64_t setMinutes(int32_t Min)				{ tm_min = Min; return fix(); }
-	int32_t getMinutes() const						{ return tm_min; }
-	int64_t setUTCMinutes(int32_t Min)			{ return setTime(CScriptTime(*this, false).setMinutes(Min)); }
-	int32_t getUTCMinutes() const					{ return CScriptTime(*this, false).tm_min; }
+	int64_t setMinutes(int32_t Min)				{ FIELDS f = getFields(tm_islocal); f.min = Min; return setFields(f, tm_islocal); }
+	int32_t getMinutes() const						{ return getFields(tm_islocal).min; }
+	int64_t setUTCMinutes(int32_t Min)			{ FIELDS f = getFields(false); f.min = Min; return setFields(f, false); }
+	int32_t getUTCMinutes() const					{ return getFields(false).min; }
 
-	int64_t setMonth(int32_t Month)				{ tm_mon = Month; return fix(); }
-	int32_t getMonth() const						{ return tm_mon; }
-	int64_t setUTCMonth(int32_t Month)			{ return setTime(CScriptTime(*this, false).setMonth(Month)); }
-	int32_t getUTCMonth() const					{ return CScriptTime(*this, false).tm_mon; }
+	int64_t setMonth(int32_t Month)				{ FIELDS f = getFields(tm_islocal); f.mon = Month; return setFields(f, tm_islocal); }
+	int32_t getMonth() const						{ return getFields(tm_islocal).mon; }
+	int64_t setUTCMonth(int32_t Month)			{ FIELDS f = getFields(false); f.mon = Month; return setFields(f, false); }
+	int32_t getUTCMonth() const					{ return getFields(false).mon; }
 
-	int64_t setSeconds(int32_t Sec)				{ tm_sec = Sec; return fix(); }
-	int32_t getSeconds() const						{ return tm_sec; }
-	int64_t setUTCSeconds(int32_t Sec)			{ return setTime(CScriptTime(*this, false).setSeconds(Sec)); }
-	int32_t getUTCSeconds() const					{ return CScriptTime(*this, false).tm_sec; }
+	int64_t setSeconds(int32_t Sec)				{ FIELDS f = getFields(tm_islocal); f.sec = Sec; return setFields(f, tm_islocal); }
+	int32_t getSeconds() const						{ return getFields(tm_islocal).sec; }
+	int64_t setUTCSeconds(int32_t Sec)			{ FIELDS f = getFields(false); f.sec = Sec; return setFields(f, false); }
+	int32_t getUTCSeconds() const					{ return getFields(false).sec; }
 
-	int32_t getTimezoneOffset()					{ return tm_offset/60; }
+	int32_t getTimezoneOffset()					{ return getFields(tm_islocal).offset/60; }
 
 	string toDateString() const;
 	string toTimeString() const;
 
-	string castToString() const;
+	string castToString() const						{ return castToString(tm_islocal); }
 	operator string() const							{ return castToString(); }
-	string toUTCString() const						{ return CScriptTime(*this, false).castToString(); } // corresponds toGMTString()
+	string toUTCString() const						{ return castToString(false); } // corresponds toGMTString()
 	string toISOString() const;					// corresponds toJSON()
 
 
@@ -142,22 +142,34 @@ public:
 	static int32_t isLeapYear(int32_t y) { return (!(y % 4) && (y % 100)) || !(y % 400); }
 	static const int32_t monthLengths[2][12];
 	static const int32_t firstDayOfMonth[2][13];
+
+	static int64_t daysFromCivil(int64_t Year, int32_t Month, int32_t Day); ///< days since 1970-01-01 (Month 0-based, out of range values are allowed)
+	static void civilFromDays(int64_t Days, int32_t &Year, int32_t &Month, int32_t &Day);
+	static int64_t localToUTC(int64_t LocalTime); ///< LocalTime is the local time in milliseconds as if it were UTC
 private:
+	// the broken-down time is computed from tm_time only if needed and is cached until the next change of tm_time
+	struct FIELDS {
+		int32_t offset;	/* offset to UTC time in seconds */
+		int32_t msec;
+		int32_t sec;	/* seconds after the minute - [0,59] */
+		int32_t min;	/* minutes after the hour - [0,59] */
+		int32_t hour;	/* hours since midnight - [0,23] */
+		int32_t mday;	/* day of the month - [1,31] */
+		int32_t mon;	/* months since January - [0,11] */
+		int32_t year;	/* years since 0000 */
+		int32_t wday;	/* days since Sunday - [0,6] */
+		int32_t yday;	/* days since January 1 - [0,365] */
+	};
+	const FIELDS &getFields(bool Local) const;
+	int64_t setFields(const FIELDS &Fields, bool Local);
+	int64_t setFullYear(int32_t Year, int32_t Month, int32_t Day, bool Local);
+	string castToString(bool Local) const;
+
 	bool tm_islocal;
 	bool tm_isvalid;
-	int32_t tm_offset;  /* offset to UTC time */
-	int32_t tm_msec;
-	int32_t tm_sec;     /* seconds after the minute - [0,59] */
-	int32_t tm_min;     /* minutes after the hour - [0,59] */
-	int32_t tm_hour;    /* hours since midnight - [0,23] */
-	int32_t tm_mday;    /* day of the month - [1,31] */
-	int32_t tm_mon;     /* months since January - [0,11] */
-	int32_t tm_year;    /* years since 0000 */
-	int32_t tm_wday;    /* days since Sunday - [0,6] */
-	int32_t tm_yday;    /* days since January 1 - [0,365] */
-	//	int32_t tm_isdst;   /* daylight savings time flag */
-	int64_t tm_time;
-	int64_t fix();
+	int64_t tm_time;	/* milliseconds since 1970-01-01 00:00:00 UTC */
+	mutable uint8_t tm_cached;	/* bit 0: UTC-fields; bit 1: local-fields */
+	mutable FIELDS tm_fields[2];
 };
 
 const int32_t CScriptTime::monthLengths[2][12] = {
@@ -169,6 +181,111 @@ const int32_t CScriptTime::firstDayOfMonth[2][13] = {
 	{0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335, 366}
 };
 
+static inline int64_t floorDiv(int64_t a, int64_t b) { return a/b - (a%b < 0); }
+
+int64_t CScriptTime::daysFromCivil(int64_t Year, int32_t Month, int32_t Day) {
+	Year += floorDiv(Month, 12);
+	Month = int32_t(Month - floorDiv(Month, 12) * 12) + 1;
+	Year -= Month <= 2;
+	int64_t era = floorDiv(Year, 400);
+	int64_t yoe = Year - era * 400;										// [0, 399]
+	int64_t doy = (153 * (Month + (Month > 2 ? -3 : 9)) + 2) / 5;	// [0, 365]
+	int64_t doe = yoe * 365 + yoe/4 - yoe/100 + doy;				// [0, 146096]
+	return era * 146097 + doe - 719468 + Day - 1;
+}
+void CScriptTime::civilFromDays(int64_t Days, int32_t &Year, int32_t &Month, int32_t &Day) {
+	Days += 719468;
+	int64_t era = floorDiv(Days, 146097);
+	int64_t doe = Days - era * 146097;											// [0, 146096]
+	int64_t yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;		// [0, 399]
+	int64_t doy = doe - (365*yoe + yoe/4 - yoe/100);						// [0, 365]
+	int64_t mp = (5*doy + 2)/153;													// [0, 11]
+	Day = int32_t(doy - (153*mp+2)/5 + 1);
+	Month = int32_t(mp < 10 ? mp+2 : mp-10);
+	Year = int32_t(yoe + era * 400 + (Month <= 1));
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptTimeZone - cached table of the transitions of the local time zone
+//////////////////////////////////////////////////////////////////////////
+
+class CScriptTimeZone {
+public:
+	static int32_t getOffset(int64_t Time);	///< offset to UTC in seconds at Time (ms since epoch)
+private:
+	struct TRANSITION {
+		TRANSITION(int64_t Time, int32_t Offset) : time(Time), offset(Offset) {}
+		bool operator<(int64_t rhs) const { return time < rhs; }
+		int64_t time;	/* seconds since epoch */
+		int32_t offset;
+	};
+	typedef vector<TRANSITION> TRANSITIONS_t;
+	static const TRANSITIONS_t &getTransitions(int32_t Year);
+	static int32_t getSystemOffset(int64_t Time);
+};
+
+int32_t CScriptTimeZone::getSystemOffset(int64_t Time) {
+	time_t t = time_t(Time);
+	struct tm local, utc;
+	localtime_s(&local, &t);
+	gmtime_s(&utc, &t);
+	int64_t local_sec = CScriptTime::daysFromCivil(local.tm_year+1900, local.tm_mon, local.tm_mday) * 86400 + local.tm_hour*3600 + local.tm_min*60 + local.tm_sec;
+	int64_t utc_sec = CScriptTime::daysFromCivil(utc.tm_year+1900, utc.tm_mon, utc.tm_mday) * 86400 + utc.tm_hour*3600 + utc.tm_min*60 + utc.tm_sec;
+	return int32_t(utc_sec - local_sec);
+}
+
+// the transitions of a year are computed once with the system functions:
+// the offset is checked at every day and a change is searched to the second
+const CScriptTimeZone::TRANSITIONS_t &CScriptTimeZone::getTransitions(int32_t Year) {
+	static map<int32_t, TRANSITIONS_t> years;
+	TRANSITIONS_t &transitions = years[Year];
+	if(transitions.empty()) {
+		int64_t begin = CScriptTime::daysFromCivil(Year, 0, 1) * 86400, end = CScriptTime::daysFromCivil(Year+1, 0, 1) * 86400;
+		int32_t offset = getSystemOffset(begin);
+		transitions.push_back(TRANSITION(begin, offset));
+		for(int64_t day = begin + 86400; day <= end; day += 86400) {
+			int32_t next_offset = getSystemOffset(day);
+			if(next_offset == offset) continue;
+			int64_t lo = day - 86400, hi = day;
+			while(hi - lo > 1) {
+				int64_t mid = lo + (hi - lo) / 2;
+				if(getSystemOffset(mid) == offset) lo = mid; else hi = mid;
+			}
+			transitions.push_back(TRANSITION(hi, offset = next_offset));
+		}
+	}
+	return transitions;
+}
+
+int32_t CScriptTimeZone::getOffset(int64_t Time) {
+	// outside of 1970..2037 the rules of the nearest year with the same leap-year-flag and the same weekday of January 1 are used
+	int64_t sec = floorDiv(Time, 1000);
+	int32_t year, month, day;
+	CScriptTime::civilFromDays(floorDiv(sec, 86400), year, month, day);
+	if(year < 1970 || year > 2037) {
+		int64_t first = CScriptTime::daysFromCivil(year, 0, 1);
+		int32_t equivalent = year < 1970 ? 1970 : 2037, step = year < 1970 ? 1 : -1;
+		while(CScriptTime::isLeapYear(equivalent) != CScriptTime::isLeapYear(year) || (CScriptTime::daysFromCivil(equivalent, 0, 1) - first) % 7)
+			equivalent += step;
+		sec += (CScriptTime::daysFromCivil(equivalent, 0, 1) - first) * 86400;
+		year = equivalent;
+	}
+#ifndef NO_THREADING
+	static CScriptMutex mutex;
+	mutex.lock();
+#endif
+	const TRANSITIONS_t &transitions = getTransitions(year);
+	int32_t offset = (lower_bound(transitions.begin()+1, transitions.end(), sec+1)-1)->offset;
+#ifndef NO_THREADING
+	mutex.unlock();
+#endif
+	return offset;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptTime
+//////////////////////////////////////////////////////////////////////////
+
 CScriptTime::CScriptTime(bool isLocalTime/*=true*/) : tm_islocal(isLocalTime), tm_isvalid(true) {
 	setTime(0);
 }
@@ -176,44 +293,63 @@ CScriptTime::CScriptTime(int64_t Time, bool isLocalTime/*=true*/) : tm_islocal(i
 	setTime(Time);
 }
 int64_t CScriptTime::setTime(int64_t Time) {
-	long tz, prevent_endless_loop=0;
-	_get_timezone(&tz);
-	tm_time = Time-tz*1000;
-recalc:
-	tm_time += 62167219200000;
-	tm_mon = tm_year = tm_wday = tm_yday = 0;
-	tm_mday = (int32_t)(tm_time/(24*60*60*1000));
-	tm_time -= ((int64_t)tm_mday++)*24*60*60*1000;
-	tm_hour = (int32_t)(tm_time/(60*60*1000));
-	tm_time -= tm_hour*60*60*1000;
-	tm_min = (int32_t)(tm_time/60000);
-	tm_time -= tm_min*60000;
-	tm_sec = (int32_t)(tm_time/1000);
-	tm_time -= tm_sec*1000;
-	tm_msec = (int32_t)tm_time;
-	fix();
-	if(tm_time != Time && prevent_endless_loop++ == 0) {
-		tm_time = Time + (Time-tm_time) - tz*1000;
-		goto recalc;
-	}
-	return tm_time;
+	tm_cached = 0;
+	tm_isvalid = -8640000000000000LL <= Time && Time <= 8640000000000000LL;
+	return tm_time = Time;
 }
 
 int64_t CScriptTime::setTime( int32_t Year, int32_t Month, int32_t Day, int32_t Hour, int32_t Min, int32_t Sec, int32_t MSec ) {
 	if(0 <= Year && Year<=99) Year += 1900;
-	tm_msec	= MSec;
-	tm_sec	= Sec;
-	tm_min	= Min;
-	tm_hour	= Hour;
-	tm_mday	= Day;
-	tm_mon	= Month;
-	tm_year	= Year;
-	return fix();
+	FIELDS f;
+	f.msec	= MSec;
+	f.sec		= Sec;
+	f.min		= Min;
+	f.hour	= Hour;
+	f.mday	= Day;
+	f.mon		= Month;
+	f.year	= Year;
+	return setFields(f, tm_islocal);
 }
 int64_t CScriptTime::UTC(int32_t Year, int32_t Month, int32_t Day/*=1*/, int32_t Hour/*=0*/, int32_t Min/*=0*/, int32_t Sec/*=0*/, int32_t MSec/*=0*/) {
 	return CScriptTime(false).setTime(Year, Month, Day, Hour, Min, Sec, MSec);
 }
 
+const CScriptTime::FIELDS &CScriptTime::getFields(bool Local) const {
+	FIELDS &f = tm_fields[Local];
+	if((tm_cached & (1<<Local)) == 0) {
+		f.offset = Local ? CScriptTimeZone::getOffset(tm_time) : 0;
+		int64_t time = tm_time - int64_t(f.offset) * 1000;
+		int64_t days = floorDiv(time, 86400000);
+		int32_t msec_of_day = int32_t(time - days * 86400000);
+		f.hour = msec_of_day / 3600000;
+		f.min = msec_of_day / 60000 % 60;
+		f.sec = msec_of_day / 1000 % 60;
+		f.msec = msec_of_day % 1000;
+		civilFromDays(days, f.year, f.mon, f.mday);
+		f.wday = int32_t((days % 7 + 11) % 7);	// 1970-01-01 was a Thursday
+		f.yday = int32_t(days - daysFromCivil(f.year, 0, 1));
+		tm_cached |= 1<<Local;
+	}
+	return f;
+}
+
+int64_t CScriptTime::localToUTC(int64_t Time) {
+	// a repeated local time (DST ends) is resolved to the earlier time,
+	// a skipped local time (DST begins) is resolved with the offset before the transition
+	int64_t before = Time + int64_t(CScriptTimeZone::getOffset(Time - 86400000)) * 1000;
+	int64_t after = Time + int64_t(CScriptTimeZone::getOffset(Time + 86400000)) * 1000;
+	bool before_valid = Time + int64_t(CScriptTimeZone::getOffset(before)) * 1000 == before;
+	bool after_valid = Time + int64_t(CScriptTimeZone::getOffset(after)) * 1000 == after;
+	return before_valid && after_valid ? min(before, after) : (after_valid && !before_valid ? after : before);
+}
+
+int64_t CScriptTime::setFields(const FIELDS &Fields, bool Local) {
+	int64_t time = daysFromCivil(Fields.year, Fields.mon, Fields.mday) * 86400000
+		+ int64_t(Fields.hour) * 3600000 + int64_t(Fields.min) * 60000 + int64_t(Fields.sec) * 1000 + Fields.msec;
+	if(Local) time = localToUTC(time);
+	return setTime(time);
+}
+
 int64_t CScriptTime::now() {
 #ifdef _WIN32
 	FILETIME ft;
@@ -242,8 +378,37 @@ int64_t CScriptTime::now() {
 
 }
 
+// reads exactly Count digits
+static inline bool readDigits(const char *&s, int Count, int32_t &Value) {
+	for(Value = 0; Count; --Count, ++s) {
+		if('0' > *s || *s > '9') return false;
+		Value = Value * 10 + (*s - '0');
+	}
+	return true;
+}
 bool CScriptTime::ParseISODate(const char *s, int64_t *result) {
-	char *end;
+	// fast path for the canonical form of toISOString() and toJSON()
+	static const char canonical[] = "0000-00-00T00:00:00.000Z";
+	const char *p = s, *c = canonical;
+	while(*c && (*c == '0' ? '0' <= *p && *p <= '9' : *p == *c)) ++p, ++c;
+	if(*c == 0 && *p == 0) {
+		int32_t year, month, day, hour, min, sec, msec;
+		p = s;
+		readDigits(p, 4, year); ++p;
+		readDigits(p, 2, month); ++p;
+		readDigits(p, 2, day); ++p;
+		readDigits(p, 2, hour); ++p;
+		readDigits(p, 2, min); ++p;
+		readDigits(p, 2, sec); ++p;
+		readDigits(p, 3, msec);
+		if((month == 0 || month > 12)
+			|| (day == 0 || day > monthLengths[isLeapYear(year)][month-1])
+			|| hour > 24 || ((hour == 24) && (min > 0 || sec > 0 || msec > 0))
+			|| min > 59 || sec > 59) return false;
+		*result = daysFromCivil(year, month-1, day) * 86400000 + ((hour * 60 + min) * 60 + sec) * 1000 + msec;
+		return true;
+	}
+
 	int32_t yearMul = 1, tzMul = 1;
 	int32_t year=1970, month=1, day=1, hour=0, min=0, sec=0, msec=0;
 	int32_t tzHour=0, tzMin=0;
@@ -251,69 +416,58 @@ bool CScriptTime::ParseISODate(const char *s, int64_t *result) {
 
 	if(*s == '+' || *s == '-') {
 		if(*s++ == '-') yearMul = -1;
-		if('0' > *s || *s > '9') return false;
-		year = strtol(s, &end, 10); if(end-s != 6) return false; else s = end;
+		if(!readDigits(s, 6, year)) return false;
 	} else if(*s != 'T') {
-		if('0' > *s || *s > '9') return false;
-		year = strtol(s, &end, 10); if(end-s != 4) return false; else s = end;
+		if(!readDigits(s, 4, year)) return false;
 	}
 	if(*s == '-') {
 		++s;
-		if('0' > *s || *s > '9') return false;
-		month = strtol(s, &end, 10); if(end-s != 2) return false; else s = end;
+		if(!readDigits(s, 2, month)) return false;
 		if(*s == '-') {
 			++s;
-			if('0' > *s || *s > '9') return false;
-			day = strtol(s, &end, 10); if(end-s != 2) return false; else s = end;
+			if(!readDigits(s, 2, day)) return false;
 		}
 	}
-	if(*s && *s++ == 'T') {
-		if('0' > *s || *s > '9') return false;
-		hour = strtol(s, &end, 10); if(end-s != 2) return false; else s = end;
-		if(*s == 0 || *s++ != ':') return false;
-		if('0' > *s || *s > '9') return false;
-		min = strtol(s, &end, 10); if(end-s != 2) return false; else s = end;
+	if(*s == 'T') {
+		++s;
+		if(!readDigits(s, 2, hour) || *s++ != ':' || !readDigits(s, 2, min)) return false;
 		if(*s == ':') {
 			++s;
-			if('0' > *s || *s > '9') return false;
-			sec = strtol(s, &end, 10); if(end-s != 2) return false; else s = end;
+			if(!readDigits(s, 2, sec)) return false;
 			if(*s == '.') {
-				if('0' > s[1] || s[1] > '9') return false;
-				msec = int32_t(strtod (s, (char**)&s) * 1000);
+				++s;
+				if('0' > *s || *s > '9') return false;
+				for(int32_t mul = 100; '0' <= *s && *s <= '9'; ++s, mul /= 10)
+					msec += (*s - '0') * mul;
 			}
 		}
 		if(*s == 'Z')
 			++s;
 		else if(*s == '-' || *s == '+') {
 			if(*s++ == '-') tzMul = -1;
-			if('0' > *s || *s > '9') return false;
-			tzHour = (*s++-'0') * 10;
-			if('0' > *s || *s > '9') return false;
-			tzHour += *s++-'0';
+			if(!readDigits(s, 2, tzHour)) return false;
 			if(*s == ':') ++s;
-			if('0' > *s || *s > '9') return false;
-			tzMin = (*s++-'0') * 10;
-			if('0' > *s || *s > '9') return false;
-			tzMin += *s++-'0';
+			if(!readDigits(s, 2, tzMin)) return false;
 		} else
 			isLocalTime = true;
 	}
 	if(*s || year > 275943 // ceil(1e8/365) + 1970
 		|| (month == 0 || month > 12)
-		|| (day == 0 || day > monthLengths[isLeapYear(year)][month])
-		|| hour > 24 || ((hour == 24) && (min > 0 || sec > 0))
+		|| (day == 0 || day > monthLengths[isLeapYear(year)][month-1])
+		|| hour > 24 || ((hour == 24) && (min > 0 || sec > 0 || msec > 0))
 		|| min > 59 || sec > 59 || tzHour > 23 || tzMin > 59) return false;
-	month -= 1; /* convert month to 0-based */
-	*result =  CScriptTime(isLocalTime).setTime(yearMul*year, month, day, hour, min, sec, msec);
-	if(!isLocalTime)
-		*result -= tzMul * ((tzHour * 60 + tzMin) * 60 * 1000);
+	int64_t time = daysFromCivil(yearMul*year, month-1, day) * 86400000 + ((hour * 60 + min) * 60 + sec) * 1000 + msec;
+	if(isLocalTime)
+		*result = localToUTC(time);
+	else
+		*result = time - tzMul * ((tzHour * 60 + tzMin) * 60 * 1000);
 	return true;
 }
 bool CScriptTime::ParseDate(const char *s, int64_t *result)
 {
 	static struct{ const char* key; int32_t value; } keywords[] = {
 		{ "AM", -1}, { "PM", -2},
-		{ "MONDAY", 0}, { "TUESDAY", 0}, { "WEDNESAY", 0}, { "THURSDAY", 0}, { "FRIDAY", 0}, { "SATURDAY", 0}, { "SUNDAY", 0},
+		{ "MONDAY", 0}, { "TUESDAY", 0}, { "WEDNESDAY", 0}, { "THURSDAY", 0}, { "FRIDAY", 0}, { "SATURDAY", 0}, { "SUNDAY", 0},
 		{ "JANUARY", 1}, { "FEBRUARY", 2}, { "MARCH", 3}, { "APRIL", 4}, { "MAY", 5}, { "JUNE", 6},
 		{ "JULY", 7}, { "AUGUST", 8}, { "SEPTEMBER", 9}, { "OCTOBER", 10}, { "NOVEMBER", 11}, { "DECEMBER", 12},
 		{ "GMT", 10000+0}, { "UT", 10000+0}, { "UTC", 10000+0},
@@ -325,6 +479,13 @@ bool CScriptTime::ParseDate(const char *s, int64_t *result)
 		{ 0, 0}
 	};
 
+	// character classes: ' ' ignored, '-' minus or ignored, '(' comment, '/' separator, '0' digit, 'A' letter, 'x' invalid
+	static const char charClass[128+1] =
+		"                                "
+		" xxxxxxx(xx/ -x/0000000000/xxxxx"
+		"xAAAAAAAAAAAAAAAAAAAAAAAAAAxxxxx"
+		"xAAAAAAAAAAAAAAAAAAAAAAAAAAxxxxx";
+
 	if (ParseISODate(s, result))
 		return true;
 
@@ -333,13 +494,18 @@ bool CScriptTime::ParseDate(const char *s, int64_t *result)
 	bool seenPlusMinus = false;
 	bool seenMonthName = false;
 	while(*s) {
-		int c = *s++;
-		if (c <= ' ' || c == ',' || c == '-') {
-			if (c == '-' && '0' <= *s && *s <= '9')
+		int c = (unsigned char)*s++;
+		char cls = c < 128 ? charClass[c] : 'x';
+		if (cls == ' ')
+			continue;
+		if (cls == '-') {
+			if ('0' <= *s && *s <= '9')
 				prevc = c;
 			continue;
 		}
-		if (c == '(') { /* comments) */
+		if (cls == 'x')
+			return false;
+		if (cls == '(') { /* comments) */
 			int depth = 1;
 			while(*s) {
 				c = *s++;
@@ -352,10 +518,12 @@ bool CScriptTime::ParseDate(const char *s, int64_t *result)
 			}
 			continue;
 		}
-		if ('0' <= c && c <= '9') {
+		if (cls == '0') {
 			int n = c - '0';
-			while (*s && '0' <= (c = *s++) && c <= '9') {
+			/* the terminating character is handled by the next pass (e.g. ':' in "12:30:15") */
+			while ('0' <= (c = (unsigned char)*s) && c <= '9') {
 				n = n * 10 + c - '0';
+				++s;
 			}
 
 			/*
@@ -427,23 +595,23 @@ bool CScriptTime::ParseDate(const char *s, int64_t *result)
 				return false;
 			}
 			prevc = 0;
-		} else if (c == '/' || c == ':' || c == '+' || c == '-') {
+		} else if (cls == '/') {
 			prevc = c;
 		} else {
 			const char *st = s-1;
 			int k;
-			while (*s) {
-				if (!(('A' <= *s && *s <= 'Z') || ('a' <= *s && *s <= 'z')))
-					break;
+			while ((unsigned char)*s < 128 && charClass[(unsigned char)*s] == 'A')
 				++s;
-			}
 
 			if (s <= st + 1)
 				return false;
+			/* a keyword matches if the word is a prefix of it (e.g. "Sep" or "Sept") */
+			size_t len = s - st;
 			for(k=0; keywords[k].key; ++k) {
-				const char *cmp_l = st, *cmp_r = keywords[k].key;
-				while(cmp_l < s && toupper(*cmp_l++) == *cmp_r++);
-				if(cmp_l == s) {
+				const char *key = keywords[k].key;
+				size_t i = 0;
+				while(i < len && toupper((unsigned char)st[i]) == key[i]) ++i;
+				if(i == len) {
 					int32_t action = keywords[k].value;
 					if (action != 0) {
 						if (action < 0) {
@@ -581,172 +749,105 @@ bool CScriptTime::ParseDate(const char *s, int64_t *result)
 	 return true;
 }
 
-static const char *day_names[] = {"Sun","Mon","Tue","Wed","Thu","Fri","Sat"};
-static const char *month_names[] = {"Jan","Feb","Mar","Apr","May","Jun","Jul","Aug","Sep","Oct","Nov","Dec"};
-string CScriptTime::toDateString() const {
-	char buffer[100];
-	sprintf_s(buffer, "%s %s %02d %04d", day_names[tm_wday], month_names[tm_mon], tm_mday, tm_year);
-	return buffer;
-}
-string CScriptTime::toTimeString() const {
-	char buffer[100];
-	const char *sign;
-	long offset;
-	if(tm_offset < 0) { sign = "+"; offset = -tm_offset/60; }
-	else { sign = "-"; offset = tm_offset/60; }
-	offset =	(tm_offset/60)*100+tm_offset%60;
-	sprintf_s(buffer, "%02d:%02d:%02d GMT%s%04ld", tm_hour, tm_min, tm_sec, sign, offset);
-	return buffer;
+static const char day_names[] = "SunMonTueWedThuFriSat";
+static const char month_names[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+// the formatters write fixed-width fields into a stack-buffer
+static inline char *putName(char *p, const char *Names, int32_t Index) {
+	memcpy(p, Names + Index * 3, 3);
+	return p + 3;
 }
-string CScriptTime::castToString() const {
-	char buffer[100];
-	const char *sign;
-	long offset;
-	if(tm_offset < 0) { sign = "+"; offset = -tm_offset/60; }
-	else { sign = "-"; offset = tm_offset/60; }
-	offset =	(offset/60)*100+offset%60;
-	if(tm_islocal)
-		sprintf_s(buffer, "%s %s %02d %04d %02d:%02d:%02d GMT%s%04ld", day_names[tm_wday], month_names[tm_mon], tm_mday, tm_year, tm_hour, tm_min, tm_sec, sign, offset);
-	else
-		sprintf_s(buffer, "%s, %02d %s %04d %02d:%02d:%02d GMT", day_names[tm_wday], tm_mday, month_names[tm_mon], tm_year, tm_hour, tm_min, tm_sec);
-	return buffer;
+static inline char *putDigits(char *p, uint32_t Value, int Width) {
+	for(int i = Width; i--; Value /= 10) p[i] = char('0' + Value % 10);
+	return p + Width;
 }
-string CScriptTime::toISOString() const {
-	char buffer[100];
-	CScriptTime utc(*this, false);
-	sprintf_s(buffer, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", utc.tm_year, utc.tm_mon+1, utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec, utc.tm_msec);
-	return buffer;
+static inline char *putYear(char *p, int32_t Year) {
+	if(Year < 0) *p++ = '-';
+	uint32_t year = Year < 0 ? 0u - uint32_t(Year) : uint32_t(Year);
+	int width = 4;
+	for(uint32_t y = year / 10000; y; y /= 10) ++width;
+	return putDigits(p, year, width);
 }
-
-
-int64_t CScriptTime::setYear( int32_t Year ) {
-	if(0 <= Year && Year<=99) Year += 1900;
-	tm_year = Year;
-	return fix();
+static inline char *putTime(char *p, int32_t Hour, int32_t Min, int32_t Sec) {
+	p = putDigits(p, Hour, 2); *p++ = ':';
+	p = putDigits(p, Min, 2); *p++ = ':';
+	return putDigits(p, Sec, 2);
 }
-int64_t CScriptTime::setFullYear( int32_t Year ) {
-	tm_year	= Year;
-	return fix();
+static inline char *putOffset(char *p, int32_t Offset) {
+	memcpy(p, "GMT", 3); p += 3;
+	*p++ = Offset <= 0 ? '+' : '-';
+	uint32_t offset = (Offset <= 0 ? -Offset : Offset) / 60;
+	p = putDigits(p, offset / 60, 2);
+	return putDigits(p, offset % 60, 2);
 }
-int64_t CScriptTime::setFullYear( int32_t Year, int32_t Month ) {
-	tm_mon	= Month;
-	tm_year	= Year;
-	return fix();
+string CScriptTime::toDateString() const {
+	char buffer[32], *p = buffer;
+	const FIELDS &f = getFields(tm_islocal);
+	p = putName(p, day_names, f.wday); *p++ = ' ';
+	p = putName(p, month_names, f.mon); *p++ = ' ';
+	p = putDigits(p, f.mday, 2); *p++ = ' ';
+	p = putYear(p, f.year);
+	return string(buffer, p);
 }
-
-int64_t CScriptTime::setFullYear( int32_t Year, int32_t Month, int32_t Day ) {
-	tm_mday	= Day;
-	tm_mon	= Month;
-	tm_year	= Year;
-	return fix();
+string CScriptTime::toTimeString() const {
+	char buffer[32], *p = buffer;
+	const FIELDS &f = getFields(tm_islocal);
+	p = putTime(p, f.hour, f.min, f.sec); *p++ = ' ';
+	p = putOffset(p, f.offset);
+	return string(buffer, p);
 }
-
-
-
-int64_t CScriptTime::fix()
-{
-	int prevent_endless_loop = 0;
-recalc:
-	int64_t time_of_year;
-	tm_offset = 0;
-	tm_time = -62167219200000;
-	if(tm_msec >= 1000) {
-		tm_sec += tm_msec / 1000;
-		tm_msec %= 1000;
-	} else if(tm_msec < 0) {
-		tm_sec += (tm_msec / 1000) - 1;
-		tm_msec = (tm_msec % 1000) + 1000;
-	}
-	tm_time += tm_msec;
-	if(tm_sec >= 60) {
-		tm_min += tm_sec / 60;
-		tm_sec %= 60;
-	} else if(tm_sec < 0) {
-		tm_min += (tm_sec / 60) - 1;
-		tm_sec = (tm_sec % 60) + 60;
-	}
-	tm_time += tm_sec * 1000;
-	if(tm_min >= 60) {
-		tm_hour += tm_min / 60;
-		tm_min %= 60;
-	} else if(tm_min < 0) {
-		tm_hour += (tm_min / 60) - 1;
-		tm_min = (tm_min % 60) + 60;
+string CScriptTime::castToString(bool Local) const {
+	char buffer[48], *p = buffer;
+	const FIELDS &f = getFields(Local);
+	p = putName(p, day_names, f.wday);
+	if(Local) {
+		*p++ = ' ';
+		p = putName(p, month_names, f.mon); *p++ = ' ';
+		p = putDigits(p, f.mday, 2); *p++ = ' ';
+	} else {
+		*p++ = ','; *p++ = ' ';
+		p = putDigits(p, f.mday, 2); *p++ = ' ';
+		p = putName(p, month_names, f.mon); *p++ = ' ';
 	}
-	tm_time += tm_min * 60 * 1000;
-
-	int days = tm_mday-1;
-	if(tm_hour >= 24) {
-		days += tm_hour / 24;
-		tm_hour %= 24;
-	} else if(tm_hour < 0) {
-		days += (tm_hour / 24) - 1;
-		tm_hour = (tm_hour % 24) + 24;
+	p = putYear(p, f.year); *p++ = ' ';
+	p = putTime(p, f.hour, f.min, f.sec); *p++ = ' ';
+	if(Local)
+		p = putOffset(p, f.offset);
+	else {
+		memcpy(p, "GMT", 3); p += 3;
 	}
-	time_of_year = (tm_time += tm_hour * 60 * 60 * 1000) + 62167219200000;
-	if(tm_mon >= 12) {
-		tm_year += tm_mon / 12;
-		tm_mon = tm_mon % 12;
-	} else if(tm_mon < 0) {
-		tm_year += (tm_mon / 12) - 1;
-		tm_mon = (tm_mon % 12) + 12;
+	return string(buffer, p);
+}
+string CScriptTime::toISOString() const {
+	char buffer[32], *p = buffer;
+	const FIELDS &utc = getFields(false);
+	if(0 <= utc.year && utc.year <= 9999)
+		p = putDigits(p, utc.year, 4);
+	else {
+		*p++ = utc.year < 0 ? '-' : '+';
+		p = putDigits(p, utc.year < 0 ? -utc.year : utc.year, 6);
 	}
-	days += tm_year*365 + leapsThruEndOf(tm_year-1);
-
-	//	for(int i=0, isLeap=isLeapYear(tm_year) ; i<tm_mon; ++i)
-	//		days += monthLengths[isLeap][i];
-	days += firstDayOfMonth[isLeapYear(tm_year)][tm_mon];
-
-	tm_time += int64_t(days) * 24 * 60 * 60 * 1000;
-	tm_wday = (days+6) % 7;
+	*p++ = '-'; p = putDigits(p, utc.mon+1, 2);
+	*p++ = '-'; p = putDigits(p, utc.mday, 2);
+	*p++ = 'T'; p = putTime(p, utc.hour, utc.min, utc.sec);
+	*p++ = '.'; p = putDigits(p, utc.msec, 3);
+	*p++ = 'Z';
+	return string(buffer, p);
+}
 
-	tm_year = days / 365;
-	days %= 365;
-	days -= leapsThruEndOf(tm_year-1);
-	while(days < 0) {
-		tm_year -= 1;
-		days += 365 + isLeapYear(tm_year);
-	}
-	time_of_year += int64_t(tm_yday = days) * 24 * 60 * 60 * 1000;
-	int month, isLeap;
-	for (month = 0, isLeap=isLeapYear(tm_year); month < 11; month++) {
-		int newdays = days - monthLengths[isLeap][month];
-		if (newdays < 0)
-			break;
-		days = newdays;
-	}
-	tm_mon = month;
-	tm_mday = days + 1;
-	if(tm_islocal) {
-		time_t time4dst;
-		if(tm_time < 0.0 || tm_time > 2145916800000) {
-			static const time_t yearStartingWith[2][7] = {
-				{252460800 /*1978*/, 94694400 /*1973*/, 126230400 /*1974*/, 157766400 /*1975*/, 347155200 /*1981*/, 31536000 /*1971*/, 220924800 /*1977*/},
-				{441763200 /*1984*/, 820454400 /*1996*/, 315532800 /*1980*/, 694224000 /*1992*/, 189302400 /*1976*/, 567993600 /*1988*/, 63072000 /*1972*/}
-			};
-			int32_t days = tm_year*365 + leapsThruEndOf(tm_year-1);
-			time4dst = yearStartingWith[isLeapYear(tm_year)][(days+6) % 7] + time_of_year/1000;
 
-		} else
-			time4dst = time_t(tm_time/1000);
-		long tz; _get_timezone(&tz);
-		struct tm tm;
-		tm_offset = tz;
-		time4dst += tm_offset;
-		localtime_s(&tm, &time4dst);
-		if(tm.tm_isdst) {
-			tm.tm_isdst = 0;
-			tm_offset += int32_t(time4dst - mktime(&tm));
-			time4dst += tm_offset - tz;
-			localtime_s(&tm, &time4dst);
-			if(!tm.tm_isdst && prevent_endless_loop++ == 0) {
-				tm_sec -= tm_offset - tz;
-				goto recalc;
-			}
-		}
-	}
-	tm_isvalid = true;
-	return tm_time+=tm_offset*1000;
+int64_t CScriptTime::setYear( int32_t Year ) {
+	if(0 <= Year && Year<=99) Year += 1900;
+	FIELDS f = getFields(tm_islocal);
+	f.year = Year;
+	return setFields(f, tm_islocal);
+}
+int64_t CScriptTime::setFullYear( int32_t Year, int32_t Month, int32_t Day, bool Local ) {
+	FIELDS f = getFields(Local);
+	f.mday	= Day;
+	f.mon		= Month;
+	f.year	= Year;
+	return setFields(f, Local);
 }
 
 
@@ -755,14 +856,13 @@ recalc:
 /// CScriptVarDate
 //////////////////////////////////////////////////////////////////////////
 
-define_ScriptVarPtr_Type(Date);
+define_ScriptVarPtr_TaggedType(Date, TYPE_TAG_DATE);
 class CScriptVarDate : public CScriptVarObject, public CScriptTime {
 protected:
 	CScriptVarDate(CTinyJS *Context);
 	CScriptVarDate(const CScriptVarDate& Copy) MEMBER_DELETE;
 public:
 	virtual ~CScriptVarDate();
-	virtual bool isDate(); // { return true; }
 	virtual CScriptVarPrimitivePtr toPrimitive(CScriptResult &execute);
 
 	virtual CScriptVarPtr toString_CallBack(CScriptResult &execute, int radix=0);
@@ -771,7 +871,7 @@ public:
 	friend inline define_newScriptVar_NamedFnc(Date, CTinyJS *Context);
 private:
 };
-inline define_newScriptVar_NamedFnc(Date, CTinyJS *Context) { return new CScriptVarDate(Context); }
+inline define_newScriptVar_NamedFnc(Date, CTinyJS *Context) { return new(Context) CScriptVarDate(Context); }
 
 //////////////////////////////////////////////////////////////////////////
 // CScriptVarDate
@@ -779,11 +879,11 @@ inline define_newScriptVar_NamedFnc(Date, CTinyJS *Context) { return new CScript
 
 
 CScriptVarDate::CScriptVarDate(CTinyJS *Context) : CScriptVarObject(Context, Context->getRoot()->findChildByPath("Date.prototype")) {
+	varFlags |= TYPE_TAG_DATE;
 
 }
 
 CScriptVarDate::~CScriptVarDate() {}
-bool CScriptVarDate::isDate() { return true; }
 
 CScriptVarPrimitivePtr CScriptVarDate::toPrimitive(CScriptResult &execute) {
 	// for the Date Object toPrimitive without hint is hintString instead hintNumber
@@ -802,6 +902,61 @@ CScriptVarPtr CScriptVarDate::valueOf_CallBack() {
 		return constScriptVar(NaN);
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// CScriptDateParseCache - the recently parsed date strings of a context
+//////////////////////////////////////////////////////////////////////////
+
+class CScriptDateParseCache {
+public:
+	CScriptDateParseCache() {}
+	bool Parse(const string &DateString, int64_t *result);
+private:
+	enum { SIZE = 64 };
+	struct ENTRY {
+		ENTRY() : used(false) {}
+		string key;
+		int64_t time;
+		bool used;
+		bool valid;
+	};
+	ENTRY entries[SIZE];	// direct mapped by the hash of the string
+};
+
+bool CScriptDateParseCache::Parse(const string &DateString, int64_t *result) {
+	uint32_t hash = 2166136261u; // FNV-1a
+	for(string::const_iterator it = DateString.begin(); it != DateString.end(); ++it)
+		hash = (hash ^ (unsigned char)*it) * 16777619u;
+	ENTRY &entry = entries[hash % SIZE];
+	if(!entry.used || entry.key != DateString) {
+		entry.key = DateString;
+		entry.used = true;
+		entry.valid = CScriptTime::Parse(DateString, &entry.time);
+	}
+	*result = entry.time;
+	return entry.valid;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptVarDateParse - Date.parse() with the parse-cache of the context
+//////////////////////////////////////////////////////////////////////////
+
+class CScriptVarDateParse : public CScriptVarFunctionNative {
+public:
+	CScriptVarDateParse(CTinyJS *Context) : CScriptVarFunctionNative(Context, 0, "parse", "(string)") {}
+	virtual ~CScriptVarDateParse() {}
+	virtual void callFunction(const CFunctionsScopePtr &c);
+	CScriptDateParseCache cache;
+};
+
+void CScriptVarDateParse::callFunction(const CFunctionsScopePtr &c) {
+	int64_t result;
+	if(cache.Parse(c->getArgument(0)->toString(), &result))
+		c->setReturnVar(c->newScriptVar((double)result));
+	else
+		c->setReturnVar(c->constScriptVar(NaN));
+}
+
 void test() {
 	CScriptTime tm;
 	tm.setTime(1970, 2, 29, 1, 59, 59, 999);
@@ -856,12 +1011,18 @@ static void scDate_Constructor(const CFunctionsScopePtr &c, void *data) {
 	int ArgumentsLength = c->getArgumentsLength();
 	if(ArgumentsLength == 1) {
 		CScriptVarPtr arg0 = c->getArgument(0);
-		CNumber v = arg0->toNumber().floor();
-		if(v.isFinite()) {
-			returnVar->setTime((int64_t)v.toDouble()); // TODO check range
+		CScriptVarDatePtr date(arg0);
+		if(date)
+			returnVar->setTime(date->getTime());
+		else if(!(arg0 = arg0->toPrimitive())->isString()) {
+			CNumber v = arg0->toNumber().floor();
+			if(v.isFinite())
+				returnVar->setTime((int64_t)v.toDouble());
+			else
+				returnVar->setInvalide();
 		} else {
 			int64_t result;
-			if(CScriptVarDate::Parse(arg0->toString(), &result))
+			if(((CScriptDateParseCache*)data)->Parse(arg0->toString(), &result))
 				returnVar->setTime(result);
 			else
 				returnVar->setInvalide();
@@ -899,13 +1060,6 @@ static void scDate_UTC(const CFunctionsScopePtr &c, void *data) {
 static void scDate_now(const CFunctionsScopePtr &c, void *data) {
 	c->setReturnVar(c->newScriptVar((double)CScriptTime::now()));
 }
-static void scDate_parse(const CFunctionsScopePtr &c, void *data) {
-	int64_t result;
-	if(CScriptTime::Parse(c->getArgument(0)->toString(), &result))
-		c->setReturnVar(c->newScriptVar((double)result));
-	else
-		c->setReturnVar(c->constScriptVar(NaN));
-}
 static inline void scDateThrowTypeError(const CFunctionsScopePtr &c, const string &Fnc) {
 	c->throwError(TypeError, Fnc + " method called on incompatible Object");
 }
@@ -1013,7 +1167,20 @@ DATE_PROTOTYPE_SET(setSeconds)
 DATE_PROTOTYPE_GET(getSeconds)
 DATE_PROTOTYPE_SET(setUTCSeconds)
 DATE_PROTOTYPE_GET(getUTCSeconds)
-DATE_PROTOTYPE_SET(setTime)
+static void scDate_prototype_setTime(const CFunctionsScopePtr &c, void *data) {
+	CScriptVarDatePtr Date(c->getArgument("this"));
+	if(!Date) scDateThrowTypeError(c, "setTime");
+	CNumber v = c->getArgument(0)->toNumber();
+	if(v.isFinite()) {
+		double value = (double)Date->setTime((int64_t)v.toDouble());
+		if(Date->isValid()) {
+			c->setReturnVar(c->newScriptVar(value));
+			return;
+		}
+	}
+	Date->setInvalide();
+	c->setReturnVar(c->constScriptVar(NaN));
+}
 DATE_PROTOTYPE_GET(getTime)
 DATE_PROTOTYPE_GET(getTimezoneOffset)
 
@@ -1023,10 +1190,11 @@ extern "C" void _registerDateFunctions(CTinyJS *tinyJS) {
 	CScriptVarPtr datePrototype = var->findChild(TINYJS_PROTOTYPE_CLASS);
 	datePrototype->addChild("valueOf", tinyJS->objectPrototype_valueOf, SCRIPTVARLINK_BUILDINDEFAULT);
 	datePrototype->addChild("toString", tinyJS->objectPrototype_toString, SCRIPTVARLINK_BUILDINDEFAULT);
-	tinyJS->addNative("function Date.__constructor__()", scDate_Constructor, 0, SCRIPTVARLINK_CONSTANT);
+	CScriptVarDateParse *parse = new(tinyJS) CScriptVarDateParse(tinyJS);
+	var->addChild("parse", parse, SCRIPTVARLINK_CONSTANT);
+	CScriptVarFunctionPtr(var)->setConstructor(::newScriptVar(tinyJS, scDate_Constructor, &parse->cache, "Date", "(year, month, day, hour, minute, second, millisecond)"));
 	tinyJS->addNative("function Date.UTC()", scDate_UTC, 0, SCRIPTVARLINK_CONSTANT);
 	tinyJS->addNative("function Date.now()", scDate_now, 0, SCRIPTVARLINK_CONSTANT);
-	tinyJS->addNative("function Date.parse()", scDate_parse, 0, SCRIPTVARLINK_CONSTANT);
 #define DATE_PROTOTYPE_NATIVE(FNC) tinyJS->addNative("function Date.prototype."#FNC"()", scDate_prototype_##FNC, 0, SCRIPTVARLINK_CONSTANT)
 	DATE_PROTOTYPE_NATIVE(setDate);
 	DATE_PROTOTYPE_NATIVE(getDate);
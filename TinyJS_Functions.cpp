@@ -98,13 +98,13 @@ static void scArrayRemove(const CFunctionsScopePtr &c, void *data) {
 	CScriptVarPtr arr = c->getArgument("this");
 //	uint32_t l = arr->getLength();
 	uint32_t offset = 0;
-	for(SCRIPTVAR_CHILDS_it it= lower_bound(arr->Childs.begin(), arr->Childs.end(), "0"); it != arr->Childs.end(); ++it) {
+	for(SCRIPTVAR_CHILDS_it it= lower_bound(arr->Childs.begin(), arr->Childs.end(), CScriptVarChildKey("0")); it != arr->Childs.end(); ++it) {
 		while(it != arr->Childs.end() && obj->mathsOp(it->getter(), LEX_EQUAL)->toBoolean()) {
 			it = arr->Childs.erase(it);
 			offset++;
 		}
 		if(offset && it != arr->Childs.end())
-			(*it)->reName(int2string((uint32_t)strtoul((*it)->getName().c_str(), 0, 10)-offset) );
+			(*it)->reName(int2string((*it)->getArrayIndex()-offset) );
 	}
 	if (offset) {
 		arr->setProperty("length", c->newScriptVar(arr->getLength() - offset));
@@ -162,8 +162,8 @@ static void scArrayPush(const CFunctionsScopePtr &c, void *data) {
 namespace {
 	class cmp_fnc {
 	public:
-		cmp_fnc(const CFunctionsScopePtr &Scope, CScriptVarFunctionPtr Fnc) : c(Scope), fnc(Fnc) {}
-		bool operator()(CScriptVarLinkPtr a,CScriptVarLinkPtr b) {
+		cmp_fnc(const CFunctionsScopePtr &Scope, const CScriptVarFunctionPtr &Fnc) : c(Scope), fnc(Fnc) {}
+		bool operator()(const CScriptVarLinkPtr &a, const CScriptVarLinkPtr &b) {
 			if(a->getVarPtr()->isUndefined()) {
 				return false;
 			} else if(b->getVarPtr()->isUndefined())
@@ -195,7 +195,7 @@ static void scArraySort(const CFunctionsScopePtr &c, void *data) {
 			cmp_fnc = c->getArgument(0);
 			if(!cmp_fnc) c->throwError(TypeError, "invalid Array.prototype.sort argument");
 		}
-		SCRIPTVAR_CHILDS_it begin = lower_bound(arr->Childs.begin(), arr->Childs.end(), "0");
+		SCRIPTVAR_CHILDS_it begin = lower_bound(arr->Childs.begin(), arr->Childs.end(), CScriptVarChildKey("0"));
 		/* in ECMAScript the sort algorithm is not specified
 		 * in some cases sort throws a TypeError e.G. an array element is read-only, non-configurable, getter or setter
 		 * this will result in a partially sorted array 
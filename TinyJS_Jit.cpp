@@ -0,0 +1,686 @@
+/*
+ * 42TinyJS
+ *
+ * A fork of TinyJS with the goal to makes a more JavaScript/ECMA compliant engine
+ *
+ * Authored By Armin Diedering <armin@diedering.de>
+ *
+ * Copyright (C) 2010-2015 ardisoft
+ *
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "TinyJS_Jit.h"
+
+#ifndef NO_JIT
+
+#include <cstring>
+#include <algorithm>
+#include <sys/mman.h>
+#include "TinyJS.h"
+
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptJitCompiler
+//////////////////////////////////////////////////////////////////////////
+
+// The code is generated with eax as accumulator, ecx/edx/r8d as scratch and the
+// machine-stack for temporaries. The arguments and the locals are int32-slots in
+// the frame. rdi points to the int32 arguments, rsi to the result and rdx to the
+// CScriptJitEnv (System V ABI). Any non int32 result jumps to "bailout".
+//
+// frame:	[rbp-8]		rbx (holds rsp while a callee is called)
+//			[rbp-16]	the result-pointer
+//			[rbp-24]	the CScriptJitEnv
+//			[rbp-28]	the result of a callee
+//			[rbp-32]	the slot of the first var (an argument or a local) ...
+class CScriptJitCompiler {
+public:
+	CScriptJitCompiler(const STRING_VECTOR_t &ArgNames);
+	bool compile(TOKEN_VECT &Body, vector<uint8_t> &Code, STRING_VECTOR_t &Callees);
+private:
+	enum KIND { NONE, INT, BOOL };
+	struct VAR {
+		VAR(const string &Name) : name(Name), initialized(false), inScope(true), lexical(false), constant(false) {}
+		string name;
+		bool initialized;	// assigned on all paths to the current position
+		bool inScope;		// false after the block of a let or const
+		bool lexical;		// let or const
+		bool constant;
+	};
+	struct LOOP {
+		vector<size_t> breaks, continues;
+	};
+	// compiles the tokens of a sub-vector (e.g. the body of a loop)
+	class CTokenRange {
+	public:
+		CTokenRange(CScriptJitCompiler &Compiler, TOKEN_VECT &Tokens) : compiler(Compiler), pos(Compiler.pos), end(Compiler.end) {
+			compiler.pos = Tokens.begin();
+			compiler.end = Tokens.end();
+		}
+		~CTokenRange() { compiler.pos = pos; compiler.end = end; }
+	private:
+		CScriptJitCompiler &compiler;
+		TOKEN_VECT::iterator pos, end;
+	};
+
+	bool statements(TOKEN_VECT &Tokens);
+	bool statement();
+	bool block();
+	bool forwarder(vector<size_t> &Scope);
+	bool declaration();
+	bool expressionStatement(bool Statement);
+	bool ifStatement();
+	bool loop();
+	bool condition(TOKEN_VECT &Tokens);
+	KIND conditional();
+	KIND logical(int Level);
+	KIND binary(int Level);
+	KIND unary();
+	KIND primary();
+	KIND call(const string &Name);
+	void operation(int Op);
+
+	int tk() { return pos < end ? pos->token : LEX_EOF; }
+	int findVar(const string &Name);
+	int assignableVar(const string &Name);
+	int32_t slot(int Var) { return -32 - 4*Var; }
+	void load(int Var) { emit(0x8b, 0x85); emit32(slot(Var)); }	// mov eax, [rbp+slot]
+	void store(int Var) { emit(0x89, 0x85); emit32(slot(Var)); }	// mov [rbp+slot], eax
+	vector<bool> saveInitialized();
+	void restoreInitialized(const vector<bool> &Initialized);
+	void endScope(const vector<size_t> &Scope) { for(vector<size_t>::const_iterator it = Scope.begin(); it != Scope.end(); ++it) vars[*it].inScope = false; }
+
+	void emit(uint8_t b) { code.push_back(b); }
+	void emit(uint8_t b1, uint8_t b2) { emit(b1); emit(b2); }
+	void emit(uint8_t b1, uint8_t b2, uint8_t b3) { emit(b1, b2); emit(b3); }
+	void emit(uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4) { emit(b1, b2); emit(b3, b4); }
+	void emit32(int32_t v) { for(int i=0; i<4; ++i) emit(uint8_t(uint32_t(v) >> (i*8))); }
+	size_t jump(uint8_t b1, uint8_t b2=0) { emit(b1); if(b2) emit(b2); emit32(0); return code.size(); }
+	void jumpBailout(uint8_t cc) { bailouts.push_back(jump(0x0f, cc)); }
+	void setJumpTarget(size_t Jump) { setJumpTarget(Jump, code.size()); }
+	void setJumpTarget(size_t Jump, size_t Target) {
+		int32_t rel = int32_t(Target - Jump);
+		memcpy(&code[Jump-4], &rel, 4);
+	}
+	void setJumpTargets(const vector<size_t> &Jumps, size_t Target) { for(vector<size_t>::const_iterator it = Jumps.begin(); it != Jumps.end(); ++it) setJumpTarget(*it, Target); }
+	size_t argsCount;
+	vector<VAR> vars;
+	vector<LOOP> loops;
+	STRING_VECTOR_t callees;
+	TOKEN_VECT::iterator pos, end;
+	vector<uint8_t> code;
+	vector<size_t> bailouts, returns;
+};
+
+enum {
+	JO = 0x80, JS = 0x88, JE = 0x84, JNE = 0x85,
+	SETE = 0x94, SETNE = 0x95, SETL = 0x9c, SETGE = 0x9d, SETLE = 0x9e, SETG = 0x9f
+};
+
+CScriptJitCompiler::CScriptJitCompiler(const STRING_VECTOR_t &ArgNames) : argsCount(ArgNames.size()) {
+	for(STRING_VECTOR_t::const_iterator it = ArgNames.begin(); it != ArgNames.end(); ++it) {
+		vars.push_back(VAR(*it));
+		vars.back().initialized = true;
+	}
+}
+
+bool CScriptJitCompiler::compile(TOKEN_VECT &Body, vector<uint8_t> &Code, STRING_VECTOR_t &Callees) {
+	emit(0x55);							// push rbp
+	emit(0x48, 0x89, 0xe5);				// mov rbp, rsp
+	emit(0x53);							// push rbx
+	emit(0x48, 0x81, 0xec);				// sub rsp, frameSize (set below)
+	size_t frameSize = code.size();
+	emit32(0);
+	emit(0x48, 0x89, 0x75, 0xf0);		// mov [rbp-16], rsi
+	emit(0x48, 0x89, 0x55, 0xe8);		// mov [rbp-24], rdx
+	for(size_t i=0; i<argsCount; ++i) {
+		emit(0x8b, 0x87); emit32(int32_t(i) * 4);	// mov eax, [rdi+i*4]
+		store(int(i));
+	}
+	if(Body.size() && Body.front().token == '{') {
+		if(!statements(Body)) return false;
+		// the end of the function returns undefined
+	} else {
+		// the expression of an arrow-function
+		CTokenRange range(*this, Body);
+		if(conditional() != INT || tk() != LEX_EOF) return false;
+		emit(0x48, 0x8b, 0x4d, 0xf0);	// mov rcx, [rbp-16]
+		emit(0x89, 0x01);				// mov [rcx], eax
+		emit(0xb8); emit32(1);			// mov eax, 1
+		returns.push_back(jump(0xe9));	// jmp done
+	}
+	setJumpTargets(bailouts, code.size());
+	emit(0x31, 0xc0);					// xor eax, eax
+	setJumpTargets(returns, code.size());
+	emit(0x48, 0x8b, 0x5d, 0xf8);		// mov rbx, [rbp-8]
+	emit(0x48, 0x89, 0xec);				// mov rsp, rbp
+	emit(0x5d);							// pop rbp
+	emit(0xc3);							// ret
+	int32_t size = (20 + 4 * int32_t(vars.size()) + 15) & ~15;
+	memcpy(&code[frameSize], &size, 4);
+	Code.swap(code);
+	Callees.swap(callees);
+	return true;
+}
+
+int CScriptJitCompiler::findVar(const string &Name) {
+	for(size_t i=0; i<vars.size(); ++i)
+		if(vars[i].name == Name) return int(i);
+	return -1;
+}
+
+// the var of an assignment or -1 (not a local or a const)
+int CScriptJitCompiler::assignableVar(const string &Name) {
+	int var = findVar(Name);
+	return var >= 0 && vars[var].inScope && !vars[var].constant ? var : -1;
+}
+
+vector<bool> CScriptJitCompiler::saveInitialized() {
+	vector<bool> initialized;
+	for(vector<VAR>::iterator it = vars.begin(); it != vars.end(); ++it)
+		initialized.push_back(it->initialized);
+	return initialized;
+}
+
+// after a conditional part (e.g. an if-body) only the vars initialized before are initialized
+void CScriptJitCompiler::restoreInitialized(const vector<bool> &Initialized) {
+	for(size_t i=0; i<vars.size(); ++i)
+		vars[i].initialized = i < Initialized.size() && Initialized[i];
+}
+
+bool CScriptJitCompiler::statements(TOKEN_VECT &Tokens) {
+	CTokenRange range(*this, Tokens);
+	while(pos < end)
+		if(!statement()) return false;
+	return true;
+}
+
+bool CScriptJitCompiler::statement() {
+	switch(tk()) {
+	case '{':
+		return block();
+	case ';':
+		++pos;
+		return true;
+	case LEX_R_VAR:
+	case LEX_R_LET:
+	case LEX_R_CONST:
+		return declaration();
+	case LEX_T_SKIP:
+	case LEX_T_INC_ID:
+		return expressionStatement(true);
+	case LEX_T_IF:
+		return ifStatement();
+	case LEX_T_LOOP:
+		return loop();
+	case LEX_R_BREAK:
+	case LEX_R_CONTINUE: {
+		bool isBreak = tk() == LEX_R_BREAK;
+		++pos;
+		if(loops.empty() || tk() != ';') return false; // no labels
+		++pos;
+		(isBreak ? loops.back().breaks : loops.back().continues).push_back(jump(0xe9));	// jmp
+		return true;
+		}
+	case LEX_R_RETURN:
+		++pos;
+		if(conditional() != INT || tk() != ';') return false;
+		++pos;
+		emit(0x48, 0x8b, 0x4d, 0xf0);	// mov rcx, [rbp-16]
+		emit(0x89, 0x01);				// mov [rcx], eax
+		emit(0xb8); emit32(1);			// mov eax, 1
+		returns.push_back(jump(0xe9));	// jmp done
+		return true;
+	}
+	return false;
+}
+
+bool CScriptJitCompiler::block() {
+	++pos;
+	vector<size_t> scope;
+	if(tk() == LEX_T_FORWARD && !forwarder(scope)) return false;
+	while(tk() != '}')
+		if(pos >= end || !statement()) return false;
+	++pos;
+	endScope(scope);
+	return true;
+}
+
+// registers the vars, lets & consts of a block - the names of all locals must be distinct
+bool CScriptJitCompiler::forwarder(vector<size_t> &Scope) {
+	CScriptTokenDataForwards &Forwarder = pos->Forwarder();
+	++pos;
+	if(Forwarder.functions.size() || Forwarder.vars_in_letscope.size()) return false;
+	STRING_SET_t &Vars = Forwarder.varNames[CScriptTokenDataForwards::VARS];
+	for(STRING_SET_it it = Vars.begin(); it != Vars.end(); ++it) {
+		int var = findVar(*it);
+		if(var < 0)
+			vars.push_back(VAR(*it));
+		else if(vars[var].lexical)
+			return false;
+	}
+	for(int type = CScriptTokenDataForwards::LETS; type <= CScriptTokenDataForwards::CONSTS; ++type) {
+		if(type == CScriptTokenDataForwards::VARS) continue;
+		for(STRING_SET_it it = Forwarder.varNames[type].begin(); it != Forwarder.varNames[type].end(); ++it) {
+			if(findVar(*it) >= 0) return false;
+			Scope.push_back(vars.size());
+			vars.push_back(VAR(*it));
+			vars.back().lexical = true;
+			vars.back().constant = type == CScriptTokenDataForwards::CONSTS;
+		}
+	}
+	return true;
+}
+
+bool CScriptJitCompiler::declaration() {
+	++pos;
+	for(;;) {
+		if(tk() != LEX_T_DESTRUCTURING_VAR) return false;
+		CScriptTokenDataDestructuringVar &DestructuringVar = pos->DestructuringVar();
+		++pos;
+		if(DestructuringVar.vars.size() != 1 || DestructuringVar.vars.front().first.size()) return false;
+		int var = findVar(DestructuringVar.vars.front().second);
+		if(var < 0 || !vars[var].inScope) return false;
+		if(tk() == '=') {
+			++pos;
+			if(conditional() != INT) return false;
+			store(var);
+			vars[var].initialized = true;
+		}
+		if(tk() != ',') break;
+		++pos;
+	}
+	if(tk() != ';') return false;
+	++pos;
+	return true;
+}
+
+// ID = expr, ID op= expr, ID++, ID--, ++ID, --ID or a call
+bool CScriptJitCompiler::expressionStatement(bool Statement) {
+	if(tk() == LEX_T_SKIP || tk() == LEX_T_INC_ID) ++pos;
+	int op = tk();
+	if(op == LEX_PLUSPLUS || op == LEX_MINUSMINUS) ++pos;
+	if(tk() != LEX_ID) return false;
+	string name = pos->String();
+	++pos;
+	if(op != LEX_PLUSPLUS && op != LEX_MINUSMINUS) op = tk();
+	if(op == '(' || op == LEX_T_TAIL_CALL) {
+		if(findVar(name) >= 0 || call(name) != INT) return false;
+	} else {
+		int var = assignableVar(name);
+		if(var < 0) return false;
+		if(op == '=') {
+			++pos;
+			if(conditional() != INT) return false;
+			vars[var].initialized = true;
+		} else if(op == LEX_PLUSPLUS || op == LEX_MINUSMINUS) {
+			if(!vars[var].initialized) return false;
+			if(tk() == op) ++pos; // postfix
+			load(var);
+			emit(0x83, op == LEX_PLUSPLUS ? 0xc0 : 0xe8, 0x01);	// add/sub eax, 1
+			jumpBailout(JO);
+		} else {
+			int binaryOp;
+			switch(op) {
+			case LEX_PLUSEQUAL: binaryOp = '+'; break;
+			case LEX_MINUSEQUAL: binaryOp = '-'; break;
+			case LEX_ASTERISKEQUAL: binaryOp = '*'; break;
+			case LEX_PERCENTEQUAL: binaryOp = '%'; break;
+			case LEX_LSHIFTEQUAL: binaryOp = LEX_LSHIFT; break;
+			case LEX_RSHIFTEQUAL: binaryOp = LEX_RSHIFT; break;
+			case LEX_RSHIFTUEQUAL: binaryOp = LEX_RSHIFTU; break;
+			case LEX_ANDEQUAL: binaryOp = '&'; break;
+			case LEX_OREQUAL: binaryOp = '|'; break;
+			case LEX_XOREQUAL: binaryOp = '^'; break;
+			default: return false;
+			}
+			if(!vars[var].initialized) return false;
+			++pos;
+			if(conditional() != INT) return false;
+			emit(0x89, 0xc1);				// mov ecx, eax
+			load(var);
+			operation(binaryOp);
+		}
+		store(var);
+	}
+	if(Statement) {
+		if(tk() != ';') return false;
+		++pos;
+	}
+	return true;
+}
+
+bool CScriptJitCompiler::ifStatement() {
+	CScriptTokenDataIf &If = pos->If();
+	++pos;
+	if(!condition(If.condition)) return false;
+	size_t toElse = jump(0x0f, JE);
+	vector<bool> initialized = saveInitialized();
+	if(!statements(If.if_body)) return false;
+	restoreInitialized(initialized);
+	if(If.else_body.size()) {
+		size_t toEnd = jump(0xe9);		// jmp
+		setJumpTarget(toElse);
+		if(!statements(If.else_body)) return false;
+		restoreInitialized(initialized);
+		setJumpTarget(toEnd);
+	} else
+		setJumpTarget(toElse);
+	return true;
+}
+
+bool CScriptJitCompiler::loop() {
+	CScriptTokenDataLoop &Loop = pos->Loop();
+	++pos;
+	if(Loop.labels.size() || (Loop.type != CScriptTokenDataLoop::FOR && Loop.type != CScriptTokenDataLoop::WHILE && Loop.type != CScriptTokenDataLoop::DO))
+		return false;
+	vector<size_t> scope;
+	{
+		CTokenRange range(*this, Loop.init);
+		if(tk() == LEX_T_FORWARD && !forwarder(scope)) return false;
+		while(pos < end)
+			if(!statement()) return false;
+	}
+	vector<bool> initialized = saveInitialized();
+	loops.push_back(LOOP());
+	size_t top = code.size();
+	// the watchdog can interrupt the loop
+	emit(0x48, 0x8b, 0x45, 0xe8);		// mov rax, [rbp-24]
+	emit(0x48, 0x8b, 0x40, uint8_t(offsetof(CScriptJitEnv, interrupt)));	// mov rax, [rax+interrupt]
+	emit(0x80, 0x38, 0x00);				// cmp byte [rax], 0
+	jumpBailout(JNE);
+	size_t toEnd = 0;
+	if(Loop.type != CScriptTokenDataLoop::DO && Loop.condition.size()) {
+		if(!condition(Loop.condition)) return false;
+		toEnd = jump(0x0f, JE);
+	}
+	if(!statements(Loop.body)) return false;
+	restoreInitialized(initialized);
+	size_t continueTarget = code.size();
+	if(Loop.type == CScriptTokenDataLoop::DO && Loop.condition.size()) {
+		if(!condition(Loop.condition)) return false;
+		setJumpTarget(jump(0x0f, JNE), top);
+	} else {
+		CTokenRange range(*this, Loop.iter);
+		if(pos < end && (!expressionStatement(false) || pos != end)) return false;
+		setJumpTarget(jump(0xe9), top);	// jmp top
+	}
+	if(toEnd) setJumpTarget(toEnd);
+	setJumpTargets(loops.back().breaks, code.size());
+	setJumpTargets(loops.back().continues, continueTarget);
+	loops.pop_back();
+	endScope(scope);
+	return true;
+}
+
+// compiles a condition and sets the flags for je (false) & jne (true)
+bool CScriptJitCompiler::condition(TOKEN_VECT &Tokens) {
+	CTokenRange range(*this, Tokens);
+	if(conditional() == NONE) return false;
+	if(tk() == LEX_T_END_EXPRESSION) ++pos;
+	if(pos != end) return false;
+	emit(0x85, 0xc0);					// test eax, eax
+	return true;
+}
+
+CScriptJitCompiler::KIND CScriptJitCompiler::conditional() {
+	KIND kind = logical(0);
+	if(tk() != '?') return kind;
+	if(kind == NONE) return NONE;
+	++pos;
+	emit(0x85, 0xc0);					// test eax, eax
+	size_t toElse = jump(0x0f, JE);
+	if(conditional() != INT || tk() != ':') return NONE;
+	++pos;
+	size_t toEnd = jump(0xe9);			// jmp
+	setJumpTarget(toElse);
+	if(conditional() != INT) return NONE;
+	setJumpTarget(toEnd);
+	return INT;
+}
+
+// Level 0 '||'; 1 '&&' - both operands must be of the same kind, the result is the last evaluated operand
+CScriptJitCompiler::KIND CScriptJitCompiler::logical(int Level) {
+	if(Level > 1) return binary(0);
+	int op = Level ? LEX_ANDAND : LEX_OROR;
+	KIND kind = logical(Level+1);
+	while(tk() == op) {
+		if(kind == NONE) return NONE;
+		++pos;
+		emit(0x85, 0xc0);				// test eax, eax
+		size_t toEnd = jump(0x0f, op == LEX_ANDAND ? JE : JNE);
+		if(logical(Level+1) != kind) return NONE;
+		setJumpTarget(toEnd);
+	}
+	return kind;
+}
+
+// Level 0 '|'; 1 '^'; 2 '&'; 3 equality; 4 relation; 5 shift; 6 '+' '-'; 7 '*' '%'
+CScriptJitCompiler::KIND CScriptJitCompiler::binary(int Level) {
+	if(Level > 7) return unary();
+	KIND kind = binary(Level+1);
+	for(;;) {
+		int op = tk();
+		bool found;
+		switch(Level) {
+		case 0: found = op == '|'; break;
+		case 1: found = op == '^'; break;
+		case 2: found = op == '&'; break;
+		case 3: found = op == LEX_EQUAL || op == LEX_TYPEEQUAL || op == LEX_NEQUAL || op == LEX_NTYPEEQUAL; break;
+		case 4: found = op == '<' || op == '>' || op == LEX_LEQUAL || op == LEX_GEQUAL; break;
+		case 5: found = op == LEX_LSHIFT || op == LEX_RSHIFT || op == LEX_RSHIFTU; break;
+		case 6: found = op == '+' || op == '-'; break;
+		default: found = op == '*' || op == '%'; break;
+		}
+		if(!found) return kind;
+		if(kind != INT) return NONE;
+		++pos;
+		emit(0x50);						// push rax
+		if(binary(Level+1) != INT) return NONE;
+		emit(0x89, 0xc1);				// mov ecx, eax
+		emit(0x58);						// pop rax
+		operation(op);
+		kind = Level == 3 || Level == 4 ? BOOL : INT;
+	}
+}
+
+// eax = eax Op ecx
+void CScriptJitCompiler::operation(int Op) {
+	switch(Op) {
+	case '|': emit(0x09, 0xc8); break;				// or eax, ecx
+	case '^': emit(0x31, 0xc8); break;				// xor eax, ecx
+	case '&': emit(0x21, 0xc8); break;				// and eax, ecx
+	case '+': emit(0x01, 0xc8); jumpBailout(JO); break;	// add eax, ecx
+	case '-': emit(0x29, 0xc8); jumpBailout(JO); break;	// sub eax, ecx
+	case '*':
+		emit(0x89, 0xc2);							// mov edx, eax
+		emit(0x09, 0xca);							// or edx, ecx
+		emit(0x0f, 0xaf, 0xc1);						// imul eax, ecx
+		jumpBailout(JO);
+		emit(0x85, 0xc0);							// test eax, eax
+		emit(0x75, 0x08);							// jnz +8
+		emit(0x85, 0xd2);							// test edx, edx
+		jumpBailout(JS);							// -0 is not an int32
+		break;
+	case '%':
+		emit(0x85, 0xc9);							// test ecx, ecx
+		jumpBailout(JE);							// NaN
+		emit(0x83, 0xf9, 0xff);						// cmp ecx, -1
+		jumpBailout(JE);							// INT_MIN % -1 traps & x % -1 can be -0
+		emit(0x41, 0x89, 0xc0);						// mov r8d, eax
+		emit(0x99);									// cdq
+		emit(0xf7, 0xf9);							// idiv ecx
+		emit(0x89, 0xd0);							// mov eax, edx
+		emit(0x85, 0xc0);							// test eax, eax
+		emit(0x75, 0x09);							// jnz +9
+		emit(0x45, 0x85, 0xc0);						// test r8d, r8d
+		jumpBailout(JS);							// -0 is not an int32
+		break;
+	case LEX_LSHIFT: emit(0xd3, 0xe0); break;		// shl eax, cl
+	case LEX_RSHIFT: emit(0xd3, 0xf8); break;		// sar eax, cl
+	case LEX_RSHIFTU:
+		emit(0xd3, 0xe8);							// shr eax, cl
+		emit(0x85, 0xc0);							// test eax, eax
+		jumpBailout(JS);							// > 0x7fffffff is not an int32
+		break;
+	default: {
+		uint8_t cc;
+		switch(Op) {
+		case '<': cc = SETL; break;
+		case '>': cc = SETG; break;
+		case LEX_LEQUAL: cc = SETLE; break;
+		case LEX_GEQUAL: cc = SETGE; break;
+		case LEX_EQUAL: case LEX_TYPEEQUAL: cc = SETE; break;
+		default: cc = SETNE; break;
+		}
+		emit(0x39, 0xc8);							// cmp eax, ecx
+		emit(0x0f, cc, 0xc0);						// setcc al
+		emit(0x0f, 0xb6, 0xc0);						// movzx eax, al
+		}
+	}
+}
+
+CScriptJitCompiler::KIND CScriptJitCompiler::unary() {
+	if(tk() == LEX_T_CMP_ID) ++pos; // superinstruction - the original tokens follow
+	int op = tk();
+	if(op == '!') {
+		++pos;
+		if(unary() == NONE) return NONE;
+		emit(0x85, 0xc0);								// test eax, eax
+		emit(0x0f, SETE, 0xc0);							// sete al
+		emit(0x0f, 0xb6, 0xc0);							// movzx eax, al
+		return BOOL;
+	}
+	if(op == '-' || op == '+' || op == '~') {
+		++pos;
+		if(unary() != INT) return NONE;
+		if(op == '-') {
+			emit(0x85, 0xc0);							// test eax, eax
+			jumpBailout(JE);							// -0 is not an int32
+			emit(0xf7, 0xd8);							// neg eax
+			jumpBailout(JO);
+		} else if(op == '~')
+			emit(0xf7, 0xd0);							// not eax
+		return INT;
+	}
+	return primary();
+}
+
+CScriptJitCompiler::KIND CScriptJitCompiler::primary() {
+	switch(tk()) {
+	case LEX_INT:
+		emit(0xb8); emit32(pos->Int());					// mov eax, imm32
+		++pos;
+		return INT;
+	case LEX_ID: {
+		string name = pos->String();
+		++pos;
+		int var = findVar(name);
+		if(tk() == '(' || tk() == LEX_T_TAIL_CALL)
+			return var < 0 ? call(name) : NONE;
+		if(var < 0 || !vars[var].inScope || !vars[var].initialized) return NONE;
+		load(var);
+		return INT;
+		}
+	case '(': {
+		++pos;
+		KIND kind = conditional();
+		if(tk() != ')') return NONE;
+		++pos;
+		return kind;
+		}
+	}
+	return NONE;
+}
+
+// the arguments are pushed and Env->call resolves and calls the function
+CScriptJitCompiler::KIND CScriptJitCompiler::call(const string &Name) {
+	++pos;
+	uint32_t count = 0;
+	while(tk() != ')') {
+		if(count == CScriptJitCode::MAX_ARGUMENTS || conditional() != INT) return NONE;
+		emit(0x50);										// push rax
+		++count;
+		if(tk() == ',') ++pos;
+		else if(tk() != ')') return NONE;
+	}
+	++pos;
+	STRING_VECTOR_t::iterator it = find(callees.begin(), callees.end(), Name);
+	uint32_t callee = uint32_t(it - callees.begin());
+	if(it == callees.end()) callees.push_back(Name);
+	emit(0x48, 0x8b, 0x7d, 0xe8);						// mov rdi, [rbp-24]
+	emit(0xbe); emit32(int32_t(callee));				// mov esi, callee
+	emit(0x48, 0x89, 0xe2);								// mov rdx, rsp
+	emit(0xb9); emit32(int32_t(count));					// mov ecx, count
+	emit(0x4c, 0x8d, 0x45, 0xe4);						// lea r8, [rbp-28]
+	emit(0x48, 0x89, 0xe3);								// mov rbx, rsp
+	emit(0x48, 0x83, 0xe4, 0xf0);						// and rsp, -16
+	emit(0xff, 0x57, uint8_t(offsetof(CScriptJitEnv, call)));	// call [rdi+call]
+	emit(0x48, 0x89, 0xdc);								// mov rsp, rbx
+	if(count) { emit(0x48, 0x81, 0xc4); emit32(int32_t(count) * 8); }	// add rsp, count*8
+	emit(0x85, 0xc0);									// test eax, eax
+	jumpBailout(JE);
+	emit(0x8b, 0x45, 0xe4);								// mov eax, [rbp-28]
+	return INT;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptJitCode
+//////////////////////////////////////////////////////////////////////////
+
+CScriptJitCode::CScriptJitCode(void *Code, size_t CodeSize, size_t ArgumentsCount, const vector<string> &Callees)
+	: code(Code), code_size(CodeSize), arguments_count(ArgumentsCount), callees(Callees), bailouts(0), fnc(0) {
+	memcpy(&fnc, &code, sizeof(fnc));
+}
+CScriptJitCode::~CScriptJitCode() {
+	munmap(code, code_size);
+}
+
+CScriptJitCode *CScriptJitCode::compile(CScriptTokenDataFnc &Fnc) {
+	if(Fnc.isGenerator() || Fnc.arguments.size() > MAX_ARGUMENTS || Fnc.body.empty()) return 0;
+
+	// only simple and distinct arguments without defaults (the last one of duplicated names wins)
+	STRING_VECTOR_t argNames;
+	for(TOKEN_VECT_it it = Fnc.arguments.begin(); it != Fnc.arguments.end(); ++it) {
+		CScriptTokenDataDestructuringVar &arg = it->DestructuringVar();
+		if(arg.vars.size() != 1 || arg.vars.front().first.size() || arg.assignment.size()) return 0;
+		if(find(argNames.begin(), argNames.end(), arg.vars.front().second) != argNames.end()) return 0;
+		argNames.push_back(arg.vars.front().second);
+	}
+
+	vector<uint8_t> code;
+	STRING_VECTOR_t callees;
+	CScriptJitCompiler compiler(argNames);
+	if(!compiler.compile(Fnc.body, code, callees)) return 0;
+
+	// W^X: the memory is writable while the code is copied and executable afterwards
+	void *mem = mmap(0, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(mem == MAP_FAILED) return 0;
+	memcpy(mem, &code[0], code.size());
+	if(mprotect(mem, code.size(), PROT_READ | PROT_EXEC) != 0) {
+		munmap(mem, code.size());
+		return 0;
+	}
+	return new CScriptJitCode(mem, code.size(), argNames.size(), callees);
+}
+
+#endif // NO_JIT
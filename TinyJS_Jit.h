@@ -0,0 +1,102 @@
+#ifndef TinyJS_Jit_h__
+#define TinyJS_Jit_h__
+#include "config.h"
+#ifndef NO_JIT
+/*
+ * 42TinyJS
+ *
+ * A fork of TinyJS with the goal to makes a more JavaScript/ECMA compliant engine
+ *
+ * Authored By Armin Diedering <armin@diedering.de>
+ *
+ * Copyright (C) 2010-2015 ardisoft
+ *
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class CScriptTokenDataFnc;
+class CScriptJitCode;
+class CScriptVar;
+class CTinyJS;
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptJitEnv
+//////////////////////////////////////////////////////////////////////////
+
+/// the runtime of a call of native code (set up by CTinyJS::callJitCode)
+struct CScriptJitEnv {
+	const volatile char *interrupt;	///< checked at every loop-iteration - if set the code returns to the interpreter
+	/// calls the function named code->getCallee(Callee) with Count int32 arguments (Arguments[0] is the last one)
+	/// returns 0 if the call is not possible from native code or the result is not an int32
+	int (*call)(CScriptJitEnv *Env, uint32_t Callee, const int64_t *Arguments, uint32_t Count, int32_t *Result);
+	CTinyJS *context;
+	CScriptVar *function;			///< the called function
+	const CScriptJitCode *code;
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptJitCode
+//////////////////////////////////////////////////////////////////////////
+
+/// native x86-64 code of a hot function
+/// compiled are functions working on int32 only - the arguments and the locals (var, let & const) must be int32
+/// statements:
+///   var/let/const declarations, blocks, expression-statements (= op= ++ -- and calls), if/else,
+///   for, while and do-while loops (without labels), break, continue and return
+/// expressions:
+///   the arguments, locals and int32 literals, the operators + - * % & | ^ << >> >>> ~ ! (unary + and -),
+///   comparisons, && ||, ( ) and cond ? a : b
+///   calls of named functions - the callee is resolved by the runtime at every call and must be compiled too
+/// the code has no side effects, so if any result is not an int32 (overflow, -0, an uncompilable callee, ...),
+/// a local is undefined or the watchdog interrupts a loop, call returns false and the function is executed
+/// by the interpreter from the beginning
+class CScriptJitCode {
+public:
+	enum { MAX_ARGUMENTS = 16, MAX_BAILOUTS = 16 };
+	~CScriptJitCode();
+
+	/// returns 0 if the function can't be compiled
+	static CScriptJitCode *compile(CScriptTokenDataFnc &Fnc);
+
+	bool call(const int32_t *Arguments, int32_t &Result, CScriptJitEnv &Env) const { return fnc(Arguments, &Result, &Env) != 0; }
+	size_t argumentsCount() const { return arguments_count; }
+	const std::string &getCallee(uint32_t Idx) const { return callees[Idx]; }
+	/// counts the returns to the interpreter - true if the code should not be used any longer
+	bool bailout() { return ++bailouts >= MAX_BAILOUTS; }
+private:
+	typedef int (*JIT_FNC)(const int32_t *Arguments, int32_t *Result, CScriptJitEnv *Env);
+	CScriptJitCode(void *Code, size_t CodeSize, size_t ArgumentsCount, const std::vector<std::string> &Callees);
+	CScriptJitCode(const CScriptJitCode &) MEMBER_DELETE;
+	CScriptJitCode &operator=(const CScriptJitCode &) MEMBER_DELETE;
+	void *code;
+	size_t code_size;
+	size_t arguments_count;
+	std::vector<std::string> callees;
+	uint32_t bailouts;
+	JIT_FNC fnc;
+};
+
+#endif // NO_JIT
+#endif // TinyJS_Jit_h__
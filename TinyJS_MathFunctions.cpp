@@ -40,6 +40,7 @@
 
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <sstream>
 #include <ctime>
 #include "TinyJS.h"
@@ -173,13 +174,27 @@ static void scMathSign(const CFunctionsScopePtr &c, void *userdata) {
 	PARAMETER_TO_NUMBER(a,"a"); RETURN_NAN_IS_NAN(a); 
 	RETURN(a.isZero() ? 0 : a.sign());
 }
+//Math.random() - returns a random number in [0, 1) from the generator of the context
 static void scMathRandom(const CFunctionsScopePtr &c, void *) {
-	static int inited=0;
-	if(!inited) {
-		inited = 1;
-		srand((unsigned int)time(NULL));
-	}
-	RETURN(double(rand())/RAND_MAX);
+	RETURN(c->getContext()->getRandom().nextDouble());
+}
+
+//Math.randomFill(array) - fills the elements 0 to length-1 of array with random numbers and returns array
+static void scMathRandomFill(const CFunctionsScopePtr &c, void *) {
+	CScriptVarPtr array = c->getArgument(0);
+	if(!array->isObject()) c->throwError(TypeError, "Math.randomFill called on non-object");
+	CScriptRandom &random = c->getContext()->getRandom();
+	for(uint32_t i=0, length=array->getLength(); i<length; ++i)
+		array->setProperty(i, c->newScriptVar(random.nextDouble()));
+	c->setReturnVar(array);
+}
+
+//Math.seedRandom(seed) - seeds the generator of Math.random for reproducible sequences
+static void scMathSeedRandom(const CFunctionsScopePtr &c, void *) {
+	double seed = c->getArgument(0)->toNumber().toDouble();
+	uint64_t bits;
+	memcpy(&bits, &seed, sizeof(bits));
+	c->getContext()->getRandom().seed(bits);
 }
 
 //Math.toDegrees(a) - returns degree value of a given angle in radians
@@ -409,6 +424,8 @@ extern "C" void _registerMathFunctions(CTinyJS *tinyJS) {
 	 tinyJS->addNative("function Math.range(x,a,b)", scMathRange, 0, SCRIPTVARLINK_BUILDINDEFAULT);
 	 tinyJS->addNative("function Math.sign(a)", scMathSign, 0, SCRIPTVARLINK_BUILDINDEFAULT);
 	 tinyJS->addNative("function Math.random(a)", scMathRandom, 0, SCRIPTVARLINK_BUILDINDEFAULT);
+	 tinyJS->addNative("function Math.randomFill(array)", scMathRandomFill, 0, SCRIPTVARLINK_BUILDINDEFAULT);
+	 tinyJS->addNative("function Math.seedRandom(seed)", scMathSeedRandom, 0, SCRIPTVARLINK_BUILDINDEFAULT);
 
 
 // atan2, ceil, floor, random, round, 
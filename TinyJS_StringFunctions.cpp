@@ -28,6 +28,7 @@
  */
 
 #include <algorithm>
+#include <iterator>
 #include "TinyJS.h"
 
 #ifndef NO_REGEXP 
@@ -54,26 +55,46 @@ using namespace std;
 #else
 #	define ptr2int32(p) ((int32_t)((ptrdiff_t)p) & 0x7FFF)
 #endif
-static string this2string(const CFunctionsScopePtr &c) {
+// the characters of a string-value (also of an external string) are not copied
+static CScriptStringRef this2string(const CFunctionsScopePtr &c) {
 	CScriptVarPtr This = c->getArgument("this");
 	CheckObjectCoercible(This);
-	return This->toString();
+	return CScriptStringRef(This);
+}
+// the string-value of this (a new one if this is not a string-value)
+// positions of the script are code-units (see CScriptVarString::getLength)
+static CScriptVarStringPtr this2stringVar(const CFunctionsScopePtr &c) {
+	CScriptVarPtr This = c->getArgument("this");
+	CheckObjectCoercible(This);
+	CScriptVarStringPtr str(This);
+	if(!str) str = CScriptVarStringPtr(c->newScriptVar(This->toString()));
+	return str;
+}
+// the position after the character at Pos (a UTF-8 sequence is one character)
+static const char *nextChar(const CScriptStringRef &Str, const char *Pos) {
+	do ++Pos; while(Pos < Str.end() && (*Pos & 0xc0) == 0x80);
+	return Pos;
+}
+// the string-value of Str without a copy if Str references one
+static CScriptVarPtr ref2var(const CFunctionsScopePtr &c, const CScriptStringRef &Str) {
+	if(Str.getVar()) return Str.getVar();
+	return c->newScriptVar(Str.str());
 }
 
 static void scStringCharAt(const CFunctionsScopePtr &c, void *) {
-	string str = this2string(c);
+	CScriptVarStringPtr str = this2stringVar(c);
 	int p = c->getArgument("pos")->toNumber().toInt32();
-	if (p>=0 && p<(int)str.length())
-		c->setReturnVar(c->newScriptVar(str.substr(p, 1)));
+	if (p>=0 && (uint32_t)p<str->getLength())
+		c->setReturnVar(c->newScriptVar(str->substrUnits(p, 1)));
 	else
 		c->setReturnVar(c->newScriptVar(""));
 }
 
 static void scStringCharCodeAt(const CFunctionsScopePtr &c, void *) {
-	string str = this2string(c);
+	CScriptVarStringPtr str = this2stringVar(c);
 	int p = c->getArgument("pos")->toNumber().toInt32();
-	if (p>=0 && p<(int)str.length())
-		c->setReturnVar(c->newScriptVar((unsigned char)str.at(p)));
+	if (p>=0 && (uint32_t)p<str->getLength())
+		c->setReturnVar(c->newScriptVar(str->getChar(p)));
 	else
 		c->setReturnVar(c->constScriptVar(NaN));
 }
@@ -87,7 +108,8 @@ static void scStringConcat(const CFunctionsScopePtr &c, void *userdata) {
 }
 
 static void scStringIndexOf(const CFunctionsScopePtr &c, void *userdata) {
-	string str = this2string(c);
+	CScriptVarStringPtr strVar = this2stringVar(c);
+	CScriptStringRef str(strVar);
 	string search = c->getArgument("search")->toString();
 	CNumber pos_n = c->getArgument("pos")->toNumber();
 	string::size_type pos;
@@ -95,19 +117,21 @@ static void scStringIndexOf(const CFunctionsScopePtr &c, void *userdata) {
 	if(pos_n.sign()<0) pos = 0;
 	else if(pos_n.isInfinity()) pos = string::npos;
 	else if(pos_n.isFinite()) pos = pos_n.toInt32();
+	if(pos != string::npos) pos = strVar->unitToByte(uint32_t(pos));
 	string::size_type p = (userdata==0) ? str.find(search, pos) : str.rfind(search, pos);
 	if(p==string::npos)
 		c->setReturnVar(c->newScriptVar(-1));
 	else
-		c->setReturnVar(c->newScriptVar(p));
+		c->setReturnVar(c->newScriptVar(strVar->byteToUnit(p)));
 }
 
 static void scStringLocaleCompare(const CFunctionsScopePtr &c, void *userdata) {
-	string str = this2string(c);
+	CScriptStringRef str = this2string(c);
 	string compareString = c->getArgument("compareString")->toString();
 	int32_t val = 0;
-	if(str<compareString) val = -1;
-	else if(str>compareString) val = 1;
+	int cmp = str.compare(compareString);
+	if(cmp<0) val = -1;
+	else if(cmp>0) val = 1;
 	c->setReturnVar(c->newScriptVar(val));
 }
 
@@ -118,7 +142,7 @@ static void scStringQuote(const CFunctionsScopePtr &c, void *userdata) {
 
 #ifndef NO_REGEXP
 // helper-function for replace search
-static bool regex_search(const string &str, const string::const_iterator &search_begin, const string &substr, bool ignoreCase, bool sticky, string::const_iterator &match_begin, string::const_iterator &match_end, smatch &match) {
+static bool regex_search(const CScriptStringRef &str, const char *search_begin, const string &substr, bool ignoreCase, bool sticky, const char *&match_begin, const char *&match_end, cmatch &match) {
 	regex::flag_type flags = regex_constants::ECMAScript;
 	if(ignoreCase) flags |= regex_constants::icase;
 	regex_constants::match_flag_type mflag = sticky?regex_constants::match_continuous:regex_constants::format_default;
@@ -130,8 +154,8 @@ static bool regex_search(const string &str, const string::const_iterator &search
 	}
 	return false;
 }
-static bool regex_search(const string &str, const string::const_iterator &search_begin, const string &substr, bool ignoreCase, bool sticky, string::const_iterator &match_begin, string::const_iterator &match_end) {
-	smatch match;
+static bool regex_search(const CScriptStringRef &str, const char *search_begin, const string &substr, bool ignoreCase, bool sticky, const char *&match_begin, const char *&match_end) {
+	cmatch match;
 	return regex_search(str, search_begin, substr, ignoreCase, sticky, match_begin, match_end, match);
 }
 #endif /* NO_REGEXP */
@@ -139,11 +163,11 @@ static bool regex_search(const string &str, const string::const_iterator &search
 static bool charcmp (char i, char j) { return (i==j); }
 static bool charicmp (char i, char j) { return (toupper(i)==toupper(j)); }
 // helper-function for replace search
-static bool string_search(const string &str, const string::const_iterator &search_begin, const string &substr, bool ignoreCase, bool sticky, string::const_iterator &match_begin, string::const_iterator &match_end) {
+static bool string_search(const CScriptStringRef &str, const char *search_begin, const string &substr, bool ignoreCase, bool sticky, const char *&match_begin, const char *&match_end) {
 	bool (*cmp)(char,char) = ignoreCase ? charicmp : charcmp;
 	if(sticky) {
 		match_begin = match_end = search_begin;
-		string::const_iterator s1e=str.end();
+		const char *s1e=str.end();
 		string::const_iterator s2=substr.begin(), s2e=substr.end();
 		while(match_end!=s1e && s2!=s2e && cmp(*match_end++, *s2++));
 		return s2==s2e;
@@ -199,7 +223,7 @@ static CScriptVarPtr getRegExpData(const CFunctionsScopePtr &c, const string &re
 }
 
 static void scStringReplace(const CFunctionsScopePtr &c, void *) {
-	const string str = this2string(c);
+	const CScriptStringRef str = this2string(c);
 	CScriptVarPtr newsubstrVar = c->getArgument("newsubstr");
 	string substr, ret_str;
 	bool global, ignoreCase, sticky;
@@ -211,10 +235,10 @@ static void scStringReplace(const CFunctionsScopePtr &c, void *) {
 		regex_constants::match_flag_type mflags = regex_constants::match_default;
 		if(!global) mflags |= regex_constants::format_first_only;
 		if(sticky) mflags |= regex_constants::match_continuous;
-		ret_str = regex_replace(str, regex(substr, flags), newsubstrVar->toString(), mflags);
+		regex_replace(back_inserter(ret_str), str.begin(), str.end(), regex(substr, flags), newsubstrVar->toString(), mflags);
 #endif /* NO_REGEXP */
 	} else {
-		bool (*search)(const string &, const string::const_iterator &, const string &, bool, bool, string::const_iterator &, string::const_iterator &);
+		bool (*search)(const CScriptStringRef &, const char *, const string &, bool, bool, const char *&, const char *&);
 #ifndef NO_REGEXP
 		if(isRegExp) 
 			search = regex_search;
@@ -226,7 +250,7 @@ static void scStringReplace(const CFunctionsScopePtr &c, void *) {
 		if(!newsubstrVar->isFunction()) 
 			newsubstr = newsubstrVar->toString();
 		global = global && substr.length();
-		string::const_iterator search_begin=str.begin(), match_begin, match_end;
+		const char *search_begin=str.begin(), *match_begin, *match_end;
 		if(search(str, search_begin, substr, ignoreCase, sticky, match_begin, match_end)) {
 			do {
 				ret_str.append(search_begin, match_begin);
@@ -238,9 +262,11 @@ static void scStringReplace(const CFunctionsScopePtr &c, void *) {
 				ret_str.append(newsubstr);
 #if 1 /* Fix from "vcmpeq" (see Issue 14) currently untested */
 				if (match_begin == match_end) {
-					if (search_begin != str.end())
-						++search_begin;
-					else
+					if (search_begin != str.end()) {
+						const char *next = nextChar(str, search_begin);
+						ret_str.append(search_begin, next);
+						search_begin = next;
+					} else
 						break;
 				} else {
 					search_begin = match_end;
@@ -256,7 +282,8 @@ static void scStringReplace(const CFunctionsScopePtr &c, void *) {
 }
 #ifndef NO_REGEXP
 static void scStringMatch(const CFunctionsScopePtr &c, void *) {
-	string str = this2string(c);
+	CScriptVarStringPtr strVar = this2stringVar(c);
+	CScriptStringRef str(strVar);
 
 	string flags="flags", substr, newsubstr, match;
 	bool global, ignoreCase, sticky;
@@ -277,7 +304,7 @@ static void scStringMatch(const CFunctionsScopePtr &c, void *) {
 			int idx=0;
 			string::size_type offset=0;
 			global = global && substr.length();
-			string::const_iterator search_begin=str.begin(), match_begin, match_end;
+			const char *search_begin=str.begin(), *match_begin, *match_end;
 			if(regex_search(str, search_begin, substr, ignoreCase, sticky, match_begin, match_end)) {
 				do {
 					offset = match_begin-str.begin();
@@ -285,7 +312,7 @@ static void scStringMatch(const CFunctionsScopePtr &c, void *) {
 #if 1 /* Fix from "vcmpeq" (see Issue 14) currently untested */
 					if (match_begin == match_end) {
 						if (search_begin != str.end())
-							++search_begin;
+							search_begin = nextChar(str, search_begin);
 						else
 							break;
 					} else {
@@ -297,8 +324,8 @@ static void scStringMatch(const CFunctionsScopePtr &c, void *) {
 				} while(global && regex_search(str, search_begin, substr, ignoreCase, sticky, match_begin, match_end));
 			}
 			if(idx) {
-				retVar->addChild("input", c->newScriptVar(str));
-				retVar->addChild("index", c->newScriptVar((int)offset));
+				retVar->addChild("input", ref2var(c, str));
+				retVar->addChild("index", c->newScriptVar(strVar->byteToUnit(offset)));
 				c->setReturnVar(retVar);
 			} else
 				c->setReturnVar(c->constScriptVar(Null));
@@ -310,46 +337,48 @@ static void scStringMatch(const CFunctionsScopePtr &c, void *) {
 #endif /* NO_REGEXP */
 
 static void scStringSearch(const CFunctionsScopePtr &c, void *userdata) {
-	string str = this2string(c);
+	CScriptVarStringPtr strVar = this2stringVar(c);
+	CScriptStringRef str(strVar);
 
 	string substr;
 	bool global, ignoreCase, sticky;
 	getRegExpData(c, "regexp", true, "flags", substr, global, ignoreCase, sticky);
-	string::const_iterator search_begin=str.begin(), match_begin, match_end;
+	const char *search_begin=str.begin(), *match_begin, *match_end;
 #ifndef NO_REGEXP
 	try { 
-		c->setReturnVar(c->newScriptVar(regex_search(str, search_begin, substr, ignoreCase, sticky, match_begin, match_end)?match_begin-search_begin:-1));
+		c->setReturnVar(c->newScriptVar(regex_search(str, search_begin, substr, ignoreCase, sticky, match_begin, match_end)?int(strVar->byteToUnit(match_begin-search_begin)):-1));
 	} catch(regex_error e) {
 		c->throwError(SyntaxError, string(e.what())+" - "+CScriptVarRegExp::ErrorStr(e.code()));
 	}
 #else /* NO_REGEXP */
-	c->setReturnVar(c->newScriptVar(string_search(str, search_begin, substr, ignoreCase, sticky, match_begin, match_end)?match_begin-search_begin:-1));
+	c->setReturnVar(c->newScriptVar(string_search(str, search_begin, substr, ignoreCase, sticky, match_begin, match_end)?int(strVar->byteToUnit(match_begin-search_begin)):-1));
 #endif /* NO_REGEXP */ 
 }
 
 static void scStringSlice(const CFunctionsScopePtr &c, void *userdata) {
-	string str = this2string(c);
+	CScriptVarStringPtr str = this2stringVar(c);
 	int32_t length = c->getArgumentsLength()-(ptr2int32(userdata) & 1);
 	bool slice = (ptr2int32(userdata) & 2) == 0;
 	int32_t start = c->getArgument("start")->toNumber().toInt32();
-	int32_t end = (int32_t)str.size();
-	if(slice && start<0) start = (int32_t)(str.size())+start;
+	int32_t end = (int32_t)str->getLength();
+	if(slice && start<0) start = (int32_t)(str->getLength())+start;
 	if(length>1) {
 		end = c->getArgument("end")->toNumber().toInt32();
-		if(slice && end<0) end = (int32_t)(str.size())+end;
+		if(slice && end<0) end = (int32_t)(str->getLength())+end;
 	}
 	if(!slice && end < start) { end^=start; start^=end; end^=start; }
 	if(start<0) start = 0;
-	if(start>=(int)str.size()) 
+	if(start>=(int)str->getLength()) 
 		c->setReturnVar(c->newScriptVar(""));
 	else if(end <= start)
 		c->setReturnVar(c->newScriptVar(""));
 	else
-		c->setReturnVar(c->newScriptVar(str.substr(start, end-start)));
+		c->setReturnVar(c->newScriptVar(str->substrUnits(start, end-start)));
 }
 
 static void scStringSplit(const CFunctionsScopePtr &c, void *) {
-	const string str = this2string(c);
+	CScriptVarStringPtr strVar = this2stringVar(c);
+	const CScriptStringRef str(strVar);
 
 	string seperator;
 	bool global, ignoreCase, sticky;
@@ -368,18 +397,18 @@ static void scStringSplit(const CFunctionsScopePtr &c, void *) {
 	if(limit == 0)
 		return;
 	else if(!str.size() || sep_var->isUndefined()) {
-		result->addChild("0", c->newScriptVar(str));
+		result->addChild("0", ref2var(c, str));
 		return;
 	}
-	if(seperator.size() == 0) {
-		for(int i=0; i<min((int)str.size(), limit); ++i)
-			result->addChild(i, c->newScriptVar(str.substr(i,1)));
+	if(seperator.size() == 0) { // the code-units
+		for(int i=0; i<min((int)strVar->getLength(), limit); ++i)
+			result->addChild(i, c->newScriptVar(strVar->substrUnits(i, 1)));
 		return;
 	}
 	int length = 0;
-	string::const_iterator search_begin=str.begin(), match_begin, match_end;
+	const char *search_begin=str.begin(), *match_begin, *match_end;
 #ifndef NO_REGEXP
-	smatch match;
+	cmatch match;
 #endif
 	bool found=true;
 	while(found) {
@@ -416,16 +445,16 @@ static void scStringSplit(const CFunctionsScopePtr &c, void *) {
 }
 
 static void scStringSubstr(const CFunctionsScopePtr &c, void *userdata) {
-	string str = this2string(c);
+	CScriptVarStringPtr str = this2stringVar(c);
 	int32_t length = c->getArgumentsLength()-ptr2int32(userdata);
 	int32_t start = c->getArgument("start")->toNumber().toInt32();
-	if(start<0 || start>=(int)str.size()) 
+	if(start<0 || start>=(int)str->getLength()) 
 		c->setReturnVar(c->newScriptVar(""));
 	else if(length>1) {
 		int length = c->getArgument("length")->toNumber().toInt32();
-		c->setReturnVar(c->newScriptVar(str.substr(start, length)));
+		c->setReturnVar(c->newScriptVar(str->substrUnits(start, length)));
 	} else
-		c->setReturnVar(c->newScriptVar(str.substr(start)));
+		c->setReturnVar(c->newScriptVar(str->substrUnits(start)));
 }
 
 static void scStringToLowerCase(const CFunctionsScopePtr &c, void *) {
@@ -441,7 +470,7 @@ static void scStringToUpperCase(const CFunctionsScopePtr &c, void *) {
 }
 
 static void scStringTrim(const CFunctionsScopePtr &c, void *userdata) {
-	string str = this2string(c);
+	CScriptStringRef str = this2string(c);
 	string::size_type start = 0;
 	string::size_type end = string::npos;
 	if(((ptr2int32(userdata)) & 2) == 0) {
@@ -467,9 +496,8 @@ static void scCharToInt(const CFunctionsScopePtr &c, void *) {
 
 
 static void scStringFromCharCode(const CFunctionsScopePtr &c, void *) {
-	char str[2];
-	str[0] = c->getArgument("char")->toNumber().toInt32();
-	str[1] = 0;
+	string str;
+	CScriptVarString::appendUnit(str, c->getArgument("char")->toNumber().toUInt32() & 0xffff);
 	c->setReturnVar(c->newScriptVar(str));
 }
 
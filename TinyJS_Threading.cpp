@@ -37,12 +37,15 @@
 #	define HAVE_THREADING
 #	ifdef HAVE_CXX_THREADS
 #		include <thread>
+#		include <chrono>
 #	else
 #		if defined(_WIN32) && !defined(HAVE_PTHREAD)
 #			include <windows.h>
 #			include <process.h>
 #		else
 #			include <pthread.h>
+#			include <unistd.h>
+#			include <time.h>
 #			ifndef HAVE_PTHREAD
 #				define HAVE_PTHREAD
 #			endif
@@ -104,37 +107,22 @@ CScriptMutex::~CScriptMutex() {
 #ifndef HAVE_CXX_THREADS
 
 #ifndef HAVE_PTHREAD
-// simple conditional Variable 4 windows
+// simple conditional Variable 4 windows (Vista and above) - the mutex is a CRITICAL_SECTION
 
 class condition_variable_impl
 {
 public:
-	condition_variable_impl() : mNumWaiters(0), mSemaphore(CreateEvent(NULL, FALSE, FALSE, NULL)), mWakeEvent(CreateEvent(NULL, FALSE, FALSE, NULL)) {}
-	~condition_variable_impl() { CloseHandle(mSemaphore); CloseHandle(mWakeEvent); }
-	void wait(pthread_mutex_t* lock)
+	condition_variable_impl() { InitializeConditionVariable(&mCondVar); }
+	void wait(pthread_mutex_t* lock, DWORD Milliseconds=INFINITE)
 	{
-		{
-			CScriptUniqueLock<CScriptMutex> lock(mMutex);
-			mNumWaiters++;
-		}
-		pthread_mutex_unlock(lock);
-		WaitForSingleObject(mSemaphore, INFINITE);
-		mNumWaiters--;
-		SetEvent(mWakeEvent);
-		pthread_mutex_lock(lock);
+		SleepConditionVariableCS(&mCondVar, lock, Milliseconds);
 	}
 	void notify_one()
 	{
-		CScriptUniqueLock<CScriptMutex> lock(mMutex);
-		if (!mNumWaiters) return;
-		SetEvent(mSemaphore);
-		WaitForSingleObject(mWakeEvent, INFINITE);
+		WakeConditionVariable(&mCondVar);
 	}
 private:
-	CScriptMutex mMutex;
-	volatile int mNumWaiters;
-	HANDLE mSemaphore;
-	HANDLE mWakeEvent;
+	CONDITION_VARIABLE mCondVar;
 };
 
 
@@ -142,7 +130,17 @@ private:
 #	define pthread_cond_init(c, a) do {} while(0)
 #	define pthread_cond_destroy(c) do {} while(0)
 #	define pthread_cond_wait(c, m) (c)->wait(m)
+#	define pthread_cond_wait_ms(c, m, ms) (c)->wait(m, ms)
 #	define pthread_cond_signal(c) (c)->notify_one()
+#else
+static void pthread_cond_wait_ms(pthread_cond_t *cond, pthread_mutex_t *mutex, unsigned Milliseconds) {
+	timespec until;
+	clock_gettime(CLOCK_REALTIME, &until);
+	until.tv_sec += Milliseconds / 1000;
+	until.tv_nsec += long(Milliseconds % 1000) * 1000000;
+	if(until.tv_nsec >= 1000000000) { until.tv_sec++; until.tv_nsec -= 1000000000; }
+	pthread_cond_timedwait(cond, mutex, &until);
+}
 #endif
 
 class CScriptCondVar_impl : public CScriptCondVar::CScriptCondVar_t {
@@ -160,6 +158,9 @@ public:
 	virtual void wait(CScriptUniqueLock<CScriptMutex> &Lock) {
 		pthread_cond_wait(&cond, (pthread_mutex_t *)Lock.mutex.getRealMutex());
 	}
+	virtual void wait_for(CScriptUniqueLock<CScriptMutex> &Lock, unsigned Milliseconds) {
+		pthread_cond_wait_ms(&cond, (pthread_mutex_t *)Lock.mutex.getRealMutex(), Milliseconds);
+	}
 	pthread_cond_t cond;
 };
 
@@ -258,6 +259,31 @@ void CScriptThread::yield() {
 	sched_yield();
 }
 
+void CScriptThread::sleep(unsigned Milliseconds) {
+#if defined(HAVE_CXX_THREADS)
+	std::this_thread::sleep_for(std::chrono::milliseconds(Milliseconds));
+#elif !defined(HAVE_PTHREAD)
+	Sleep(Milliseconds);
+#else
+	usleep(Milliseconds*1000);
+#endif
+}
+
+unsigned CScriptThread::hardwareConcurrency() {
+#if defined(HAVE_CXX_THREADS)
+	long count = std::thread::hardware_concurrency();
+#elif !defined(HAVE_PTHREAD)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	long count = info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+	long count = 1;
+#endif
+	return count > 0 ? unsigned(count) : 1;
+}
+
 CScriptCoroutine::StopIteration_t CScriptCoroutine::StopIteration;
 
 bool CScriptCoroutine::next()
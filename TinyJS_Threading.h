@@ -74,11 +74,14 @@ public:
 	~CScriptCondVar();
 	void notify_one() { condVar->notify_one(); }
 	void wait(CScriptUniqueLock<CScriptMutex> &Lock) { condVar->wait(Lock); }
+	/// waits at most Milliseconds
+	void wait_for(CScriptUniqueLock<CScriptMutex> &Lock, unsigned Milliseconds) { condVar->wait_for(Lock, Milliseconds); }
 	class CScriptCondVar_t {
 	public:
 		virtual ~CScriptCondVar_t();
 		virtual void notify_one()=0;
 		virtual void wait(CScriptUniqueLock<CScriptMutex> &Lock)=0;
+		virtual void wait_for(CScriptUniqueLock<CScriptMutex> &Lock, unsigned Milliseconds)=0;
 	};
 private:
 	CScriptCondVar_t *condVar;
@@ -91,6 +94,8 @@ public:
 	CScriptThread();
 	virtual ~CScriptThread();
 	static void yield();
+	static void sleep(unsigned Milliseconds);
+	static unsigned hardwareConcurrency(); ///< the count of processors (at least 1)
 	void Run() { thread->Run(); }
 	int Stop(bool Wait=true) { return thread->Stop(Wait); }
 	int retValue() { return thread->retValue(); }
@@ -140,6 +140,31 @@
 
 
 
+/* BASELINE-JIT
+ * ============
+ * Hot functions working on int32 only (arguments, locals, loops, if/else and
+ * calls of other such functions - see CScriptJitCode) are compiled to x86-64
+ * code. The code returns to the interpreter on any non-int32 result and when
+ * the watchdog interrupts a loop. The JIT is only available on x86-64 with a
+ * System V ABI (not on Windows) and is disabled otherwise.
+ * At runtime the JIT can be disabled with CTinyJS::setJitThreshold(0)
+ * To deactivate this stuff define NO_JIT
+ */
+//#define NO_JIT
+
+
+
+/* REFCOUNT-STATISTICS
+ * ===================
+ * To count the ref/unref-operations of CScriptVar and CScriptVarLink and the
+ * executed statements per context define WITH_REFCOUNT_STATISTICS
+ * (see CTinyJS::getRefCountStatistics, run_tests and the workload tests/bench/refcount.js)
+ * NOTE: without WITH_REFCOUNT_STATISTICS ref/unref are inlined
+ */
+//#define WITH_REFCOUNT_STATISTICS
+
+
+
 /* for Date we need the time in a resolution of 1 ms
  * on Windows the function "GetSystemTimeAsFileTime" is used
  * on non-Windows (WIN32 is not defined) it is tried to use "gettimeofday"
@@ -165,6 +190,10 @@
 ***********************************************************************\n")
 #endif
 
+#if !defined(NO_JIT) && !(defined(__x86_64__) && !defined(_WIN32))
+#	define NO_JIT
+#endif
+
 #if defined(NO_POOL_ALLOCATOR) && defined(NO_GENERATORS) && !defined(NO_THREADING)
 #	define NO_THREADING
 #endif
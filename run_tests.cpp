@@ -242,9 +242,11 @@ public:
 	}
 	bool active;
 } end;
-void js_print(const CFunctionsScopePtr &v, void *) {
-	printf("> %s\n", v->getArgument("text")->toString().c_str());
-}
+int run_api_tests(int &count); // run_tests_api.cpp
+uint32_t allocationSampling = 0; // -a N
+#ifndef NO_THREADING
+CScriptWatchdog *watchdog = 0; // -w MS
+#endif
 bool run_test(const char *filename) {
   printf("TEST %s ", filename);
 #ifdef _MSC_VER
@@ -270,8 +272,12 @@ bool run_test(const char *filename) {
   buffer[size]=0;
   fclose(file);
 
+  CScriptAllocationProfiler profiler(allocationSampling);
   CTinyJS s;
-  s.addNative("function print(text)", &js_print, 0);
+  if(allocationSampling) s.setAllocationProfiler(&profiler);
+#ifndef NO_THREADING
+  if(watchdog) watchdog->watch(&s);
+#endif
 
 //  registerFunctions(&s);
 //  registerMathFunctions(&s);
@@ -285,13 +291,22 @@ bool run_test(const char *filename) {
 //	  std::fstream out(std::string(filename)+'c', std::fstream::out | std::fstream::trunc | std::fstream::binary);
 //	  tokens.serialize(out);
     s.execute(tokens);
+    s.flushConsole();
   } catch (CScriptException &e) {
+    s.flushConsole();
     printf("%s\n", e.toString().c_str());
   }
   bool pass = s.getRoot()->findChild("result")->toBoolean();
+  if(allocationSampling) profiler.report(std::cout, 10);
 #ifdef WITH_TIME_LOGGER
   TimeLoggerLogprint(Test);
 #endif
+#ifdef WITH_REFCOUNT_STATISTICS
+  const CTinyJS::RefCountStatistics &stat = s.getRefCountStatistics();
+  double statements = stat.statements ? double(stat.statements) : 1.0;
+  printf("refcount: %llu statements, var ref/unref %.1f/%.1f, link ref/unref %.1f/%.1f per statement\n",
+    (unsigned long long)stat.statements, stat.varRefs/statements, stat.varUnrefs/statements, stat.linkRefs/statements, stat.linkUnrefs/statements);
+#endif
 
   if (pass)
     printf("PASS\n");
@@ -325,18 +340,29 @@ int main(int argc, char **argv)
   printf("   ./run_tests [-k] tests/test001.js [tests/42tests/test002.js]   : run tests\n");
   printf("   ./run_tests [-k]                      : run all tests\n");
   printf("   -k needs press enter at the end of runs\n");
+  printf("   -a N samples every N'th allocation and prints the sites with the most bytes\n");
+  printf("   -w MS reports the stack of tests running longer than MS milliseconds to stderr\n");
   int arg_num = 1;
   bool runs = false;
   for(; arg_num<argc; arg_num++) {
     if(argv[arg_num][0] == '-') {
       if(strcmp(argv[arg_num], "-k")==0)
 			end.active = true;
+      else if(strcmp(argv[arg_num], "-a")==0 && arg_num+1<argc)
+			allocationSampling = atoi(argv[++arg_num]);
+#ifndef NO_THREADING
+      else if(strcmp(argv[arg_num], "-w")==0 && arg_num+1<argc && !watchdog)
+			watchdog = new CScriptWatchdog(atoi(argv[++arg_num]));
+#endif
 	 } else {
 		run_test(argv[arg_num]);
 		runs=true;
 	 }
   }
   if (runs) {
+#ifndef NO_THREADING
+    delete watchdog;
+#endif
     return 0;
   }
 
@@ -368,6 +394,7 @@ int main(int argc, char **argv)
         test_num++;
     }
   }
+  passed += run_api_tests(count);
   printf("Done. %d tests, %d pass, %d fail\n", count, passed, count-passed);
 #ifdef WITH_TIME_LOGGER
   TimeLoggerLogprint(Tests);
@@ -375,6 +402,9 @@ int main(int argc, char **argv)
 #ifdef INSANE_MEMORY_DEBUG
     memtracing_kill();
 #endif
+#ifndef NO_THREADING
+  delete watchdog;
+#endif
 #ifdef _WIN32
 #ifdef _DEBUG
 //  _CrtDumpMemoryLeaks();
@@ -0,0 +1,562 @@
+/*
+ * 42TinyJS
+ *
+ * A fork of TinyJS with the goal to makes a more JavaScript/ECMA compliant engine
+ *
+ * Authored By Armin Diedering <armin@diedering.de>
+ *
+ * Copyright (C) 2010-2015 ardisoft
+ *
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*
+ * the tests of the C++ API - run by run_tests together with the script tests
+ */
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "TinyJS.h"
+#include "TinyJS_Binding.h"
+#include "TinyJS_Console.h"
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <fstream>
+#ifdef _MSC_VER
+#	include <sys/utime.h>
+#else
+#	include <utime.h>
+#endif
+
+#define API_CHECK(expr) do { if(!(expr)) { printf("check '%s' failed (line %d) ", #expr, __LINE__); return false; } } while(0)
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptClassBinding
+//////////////////////////////////////////////////////////////////////////
+
+namespace {
+	struct Vec {
+		Vec(double X, double Y) : x(X), y(Y) { ++alive; }
+		Vec(const Vec &Copy) : x(Copy.x), y(Copy.y) { ++alive; }
+		~Vec() { --alive; }
+		double length() const { return sqrt(x*x + y*y); }
+		Vec add(const Vec &Other) const { return Vec(x+Other.x, y+Other.y); }
+		void scale(double Factor) { x *= Factor; y *= Factor; }
+		double x, y;
+		static int alive;
+	};
+	int Vec::alive = 0;
+}
+
+static bool test_binding() {
+	Vec origin(3, 4);
+	{
+		CTinyJS js;
+		CScriptClassBinding<Vec> VecBinding(&js, "Vec");
+		VecBinding.constructor<double, double>()
+			.field("x", &Vec::x)
+			.field("y", &Vec::y, true)
+			.method("length", &Vec::length)
+			.method("add", &Vec::add)
+			.method("scale", &Vec::scale);
+		js.getRoot()->addChild("origin", VecBinding.wrap(&origin));
+
+		API_CHECK(evaluateAs<double>(&js, "origin.length()") == 5);
+		API_CHECK(evaluateAs<double>(&js, "new Vec(6, 8).length()") == 10);
+		API_CHECK(evaluateAs<double>(&js, "origin.add(new Vec(1, 2)).y") == 6);
+		API_CHECK(evaluateAs<bool>(&js, "origin.add(origin) instanceof Vec"));
+		js.execute("origin.scale(2); origin.x = origin.x + 1;");
+		API_CHECK(origin.x == 7 && origin.y == 8);
+		API_CHECK(evaluateAs<double>(&js, "var v = new Vec(1, 1); v.y = 5; v.y") == 1); // read-only
+		API_CHECK(CScriptClassBinding<Vec>::unwrap(js.getRoot()->findChild("origin")->getVarPtr()) == &origin);
+		API_CHECK(CScriptClassBinding<Vec>::unwrap(js.getRoot()->findChild("v")->getVarPtr()) != 0);
+		API_CHECK(evaluateAs<bool>(&js, "try { origin.add(1); false; } catch(e) { e instanceof TypeError }"));
+		API_CHECK(evaluateAs<bool>(&js, "try { origin.length.call({}); false; } catch(e) { e instanceof TypeError }"));
+	}
+	API_CHECK(Vec::alive == 1); // only origin - all owned objects are deleted with the context
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptValue (TinyJS_Bridge.h)
+//////////////////////////////////////////////////////////////////////////
+
+struct BridgePoint {
+	int x, y;
+	std::string name;
+	std::vector<double> weights;
+};
+TINYJS_STRUCT_BEGIN(BridgePoint)
+	TINYJS_STRUCT_FIELD(x)
+	TINYJS_STRUCT_FIELD(y)
+	TINYJS_STRUCT_FIELD(name)
+	TINYJS_STRUCT_FIELD(weights)
+TINYJS_STRUCT_END
+
+static bool test_bridge() {
+	CTinyJS js;
+	// std::vector & std::map round-trips
+	std::vector<int> ints;
+	ints.push_back(3); ints.push_back(-1); ints.push_back(7);
+	js.getRoot()->addChild("ints", toScriptVar(&js, ints));
+	API_CHECK(evaluateAs<bool>(&js, "ints instanceof Array && ints.length == 3 && ints[1] == -1"));
+	API_CHECK(fromScriptVar<std::vector<int> >(js.getRoot()->findChild("ints")->getVarPtr()) == ints);
+	std::map<std::string, std::vector<std::string> > map;
+	map["a"].push_back("x");
+	map["b"].push_back("y"); map["b"].push_back("z");
+	js.getRoot()->addChild("map", toScriptVar(&js, map));
+	API_CHECK(evaluateAs<std::string>(&js, "map.b[1] + map.a[0]") == "zx");
+	API_CHECK((evaluateAs<std::map<std::string, std::vector<std::string> > >(&js, "map") == map));
+	API_CHECK((evaluateAs<std::map<std::string, int> >(&js, "({ one: 1, two: 2 })").size() == 2));
+	std::vector<int> unchanged = ints;
+	API_CHECK(!fromScriptVar(js.evaluateComplex("([1, 'x'])")->getVarPtr(), unchanged) && unchanged == ints);
+
+	// TINYJS_STRUCT types
+	BridgePoint point = { 3, -4, "p", std::vector<double>(2, 0.5) };
+	js.getRoot()->addChild("point", toScriptVar(&js, point));
+	API_CHECK(evaluateAs<bool>(&js, "point.x == 3 && point.y == -4 && point.name == 'p' && point.weights[1] == 0.5"));
+	BridgePoint moved = evaluateAs<BridgePoint>(&js, "({ x: point.x + 1, y: 2, name: 'q', weights: [1.5] })");
+	API_CHECK(moved.x == 4 && moved.y == 2 && moved.name == "q" && moved.weights.size() == 1 && moved.weights[0] == 1.5);
+	std::vector<BridgePoint> points = evaluateAs<std::vector<BridgePoint> >(&js, "var zero = { x: 0, y: 0, name: '', weights: [] }; ([point, zero])");
+	API_CHECK(points.size() == 2 && points[0].name == "p" && points[0].weights.size() == 2 && points[1].weights.empty());
+
+	// an Array hole is undefined
+	std::vector<int> holes;
+	API_CHECK(!fromScriptVar(js.evaluateComplex("var holes = [1]; holes[2] = 3; holes")->getVarPtr(), holes) && holes.empty());
+
+	// a missing struct field or a field of another type fails
+	BridgePoint failed = BridgePoint();
+	API_CHECK(!fromScriptVar(js.evaluateComplex("({ x: 1, y: 2, weights: [] })")->getVarPtr(), failed));
+	API_CHECK(!fromScriptVar(js.evaluateComplex("({ x: 1, y: '2', name: '', weights: [] })")->getVarPtr(), failed));
+	bool thrown = false;
+	try { evaluateAs<BridgePoint>(&js, "({ x: 1, name: '', weights: [] })"); } catch(CScriptException &) { thrown = true; }
+	API_CHECK(thrown);
+
+	// integers must be in the range of the type
+	uint8_t u8 = 0;
+	uint32_t u32 = 0;
+	int16_t i16 = 0;
+	API_CHECK(!fromScriptVar(js.evaluateComplex("300")->getVarPtr(), u8) && fromScriptVar(js.evaluateComplex("255")->getVarPtr(), u8) && u8 == 255);
+	API_CHECK(!fromScriptVar(js.evaluateComplex("-1")->getVarPtr(), u32) && fromScriptVar(js.evaluateComplex("4294967295")->getVarPtr(), u32) && u32 == 4294967295u);
+	API_CHECK(!fromScriptVar(js.evaluateComplex("4294967296")->getVarPtr(), u32) && !fromScriptVar(js.evaluateComplex("-32769")->getVarPtr(), i16));
+	API_CHECK(!fromScriptVar(js.evaluateComplex("NaN")->getVarPtr(), u32) && !fromScriptVar(js.evaluateComplex("'1'")->getVarPtr(), u32));
+	API_CHECK(evaluateAs<int16_t>(&js, "-32768") == -32768 && evaluateAs<int>(&js, "2.75") == 2);
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptAllocationProfiler
+//////////////////////////////////////////////////////////////////////////
+
+static bool checkSites(const CScriptAllocationProfiler &Profiler) {
+	CScriptAllocationProfiler::SITES_t sites = Profiler.getSites();
+	uint64_t count = 0, liveCount = 0;
+	for(CScriptAllocationProfiler::SITES_cit it = sites.begin(); it != sites.end(); ++it) {
+		count += it->second.count;
+		liveCount += it->second.liveCount;
+	}
+	return count == Profiler.getSamplesCount() && liveCount == 0;
+}
+
+static bool test_allocation_profiler() {
+	CScriptAllocationProfiler first(1), second(1);
+	{
+		CTinyJS js;
+		js.setAllocationProfiler(&first);
+		js.execute("var a = []; for(var i = 0; i < 100; i++) a[i] = { i: i };");
+		API_CHECK(first.getSamplesCount() >= 100);
+		js.setAllocationProfiler(&second); // replaced while the sampled objects are alive
+		js.execute("a = null; var b = { x: 1 };");
+		API_CHECK(second.getSamplesCount() > 0);
+	}
+	// the vars of the context are freed - the profilers must not refer to them
+	API_CHECK(checkSites(first));
+	API_CHECK(checkSites(second));
+	std::ostringstream out;
+	first.report(out);
+	second.report(out);
+	API_CHECK(out.str().find("Object") != std::string::npos);
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptTypeFeedback
+//////////////////////////////////////////////////////////////////////////
+
+static void writeFile(const char *File, const char *Code) {
+	std::ofstream(File) << Code;
+	struct utimbuf times;
+	times.actime = times.modtime = time(0) - 10; // older than the .jsc written by the tests
+	utime(File, &times);
+}
+
+// true if each site of Feedback is in Other with Factor times the count
+static bool sameSites(const CScriptTypeFeedback &Feedback, const CScriptTypeFeedback &Other, uint32_t Factor) {
+	const CScriptTypeFeedback::SITES_t &sites = Feedback.getSites();
+	for(CScriptTypeFeedback::SITES_cit it = sites.begin(); it != sites.end(); ++it) {
+		const CScriptTypeFeedback::SITE *site = Other.find(it->first.file, it->first.line, it->first.column);
+		if(!site || site->count != Factor*it->second.count || site->lhsTypes != it->second.lhsTypes || site->rhsTypes != it->second.rhsTypes) return false;
+	}
+	return sites.size() == Other.getSites().size();
+}
+
+static bool test_type_feedback_jsc() {
+	const char *File = "tests/api_feedback.js";
+	writeFile(File, "function add(a, b) { return a + b; }\nvar r = add(1, 2) + add('a', 'b').length;\n");
+	bool writeCompiledTokens = CScriptTokenizer::writeCompiledTokens;
+	CScriptTokenizer::writeCompiledTokens = true;
+	CScriptTypeFeedback first, second;
+	bool ok = true;
+	for(int run=0; ok && run<2; ++run) {
+		CTinyJS js;
+		js.setTypeFeedback(run ? &second : &first);
+		CScriptTokenizer Tokenizer(0, File);
+		// the second run reads the feedback of the first run from the .jsc
+		ok = run ? sameSites(first, Tokenizer.typeFeedback, 1) : Tokenizer.typeFeedback.empty();
+		js.execute(Tokenizer);
+	}
+	CScriptTokenizer Tokenizer(0, File);
+	CScriptTokenizer::writeCompiledTokens = writeCompiledTokens;
+	remove(File);
+	remove((std::string(File)+'c').c_str());
+	API_CHECK(ok);
+	API_CHECK(!first.empty());
+	// the sites of both runs are in the .jsc
+	API_CHECK(sameSites(first, second, 2) && sameSites(first, Tokenizer.typeFeedback, 2));
+	bool mixed = false;
+	for(CScriptTypeFeedback::SITES_cit it = first.getSites().begin(); it != first.getSites().end(); ++it)
+		if(it->second.token == '+' && it->second.lhsTypes == (TYPEFEEDBACK_INT32|TYPEFEEDBACK_STRING)) mixed = true;
+	API_CHECK(mixed);
+	return true;
+}
+
+static bool test_type_feedback_require() {
+	const char *File = "tests/api_feedback_module.js";
+	writeFile(File, "exports.twice = function(x) { return x * 2; };\nvar four = exports.twice(2);\n");
+	CScriptTypeFeedback first, second;
+	std::string result[2];
+	for(int run=0; run<2; ++run) {
+		// the second context gets the feedback of the first from the tokens shared by the contexts
+		CTinyJS js;
+		js.setTypeFeedback(run ? &second : &first);
+		result[run] = js.evaluate(std::string("require('./") + File + "').twice(21)");
+	}
+	remove(File);
+	API_CHECK(result[0] == "42" && result[1] == "42");
+	API_CHECK(!first.empty());
+	const CScriptTypeFeedback::SITES_t &sites = first.getSites();
+	std::string Path;
+	for(CScriptTypeFeedback::SITES_cit it = sites.begin(); it != sites.end(); ++it)
+		if(it->first.file.find("api_feedback_module.js") != std::string::npos) Path = it->first.file;
+	API_CHECK(Path.size() && second.hasFile(Path));
+	// x * 2 runs twice per context, the call of twice(21) after the module was loaded is not stored
+	// so the second context has 1 stored + 2 own executions
+	for(CScriptTypeFeedback::SITES_cit it = sites.begin(); it != sites.end(); ++it) {
+		if(it->first.file != Path || it->second.token != '*') continue;
+		const CScriptTypeFeedback::SITE *site = second.find(it->first.file, it->first.line, it->first.column);
+		API_CHECK(it->second.count == 2 && site && site->count == 3 && site->lhsTypes == TYPEFEEDBACK_INT32);
+		return true;
+	}
+	return false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptExternalData
+//////////////////////////////////////////////////////////////////////////
+
+namespace {
+	struct Released {
+		const char *data;
+		size_t size;
+		int calls;
+	};
+	void countRelease(const char *Data, size_t Size, void *Userdata) {
+		Released *released = static_cast<Released*>(Userdata);
+		released->data = Data;
+		released->size = Size;
+		++released->calls;
+	}
+}
+
+// the host-owned memory is released exactly once - after the last string of all contexts is gone
+static bool test_external_data() {
+	static const char body[] = "hello external";
+	char emptyBody[1] = { 0 };
+	Released released = { 0, 0, 0 }, releasedEmpty = { 0, 0, 0 };
+	{
+		CTinyJS js1, js2;
+		CScriptExternalData *ext = CScriptExternalData::create(body, sizeof(body)-1, countRelease, &released);
+		js1.getRoot()->addChild("ext", ::newScriptVar(&js1, ext->ref()));
+		js2.getRoot()->addChild("ext", ::newScriptVar(&js2, ext)); // takes over the reference of create
+		js1.getRoot()->addChild("empty", ::newScriptVar(&js1, CScriptExternalData::create(emptyBody, 0, countRelease, &releasedEmpty)));
+		API_CHECK(evaluateAs<bool>(&js1, "ext.length == 14 && ext.indexOf('ext') == 6 && ext.toUpperCase() == 'HELLO EXTERNAL' && ext + '!' == 'hello external!'"));
+		API_CHECK(evaluateAs<bool>(&js1, "empty === '' && empty.length == 0"));
+		js1.execute("ext = empty = undefined;");
+		API_CHECK(evaluateAs<std::string>(&js2, "ext.slice(6)") == "external" && released.calls == 0);
+	}
+	API_CHECK(released.calls == 1 && released.data == body && released.size == sizeof(body)-1);
+	API_CHECK(releasedEmpty.calls == 1 && releasedEmpty.data == emptyBody && releasedEmpty.size == 0);
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptStringTable
+//////////////////////////////////////////////////////////////////////////
+
+// an interned string referenced by the garbage of the last evaluation is not swept while it is used again
+static bool test_interned_garbage() {
+	CTinyJS js;
+	js.execute("(function() { var a = {}, b = { a: a }; a.b = b; a.s = 'routekey'; a.t = typeof 1; for(a.k in { forinkey: 1 }); })();");
+	js.execute("var keep = 'routekey', type = typeof 2, key; for(key in { forinkey: 1 }); var junk = []; for(var i=0; i<20000; i++) junk[i] = { x: i, y: [i] };");
+	API_CHECK(evaluateAs<int>(&js, "keep.length") == 8 && evaluateAs<std::string>(&js, "keep.toUpperCase()") == "ROUTEKEY");
+	API_CHECK(evaluateAs<int>(&js, "type.length") == 6 && evaluateAs<std::string>(&js, "key.toUpperCase()") == "FORINKEY");
+	API_CHECK(evaluateAs<bool>(&js, "keep === 'routekey' && type === 'number' && key === 'forinkey'"));
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptBundle & CScriptTokenizer::tokenizeSources
+//////////////////////////////////////////////////////////////////////////
+
+static std::string readFile(const char *File) {
+	std::ifstream in(File, std::ios::in | std::ios::binary);
+	std::ostringstream out;
+	out << in.rdbuf();
+	return out.str();
+}
+
+static void writeBinaryFile(const char *File, const std::string &Data) {
+	std::ofstream(File, std::ios::out | std::ios::trunc | std::ios::binary).write(Data.data(), Data.size());
+}
+
+static bool test_bundle() {
+	const char *Bundle = "tests/api_bundle.jsb", *Corrupt = "tests/api_bundle_corrupt.jsb";
+	const char *Files[] = { "tests/api_bundle_main.js", "tests/api_bundle_b.js", "tests/api_bundle_c.js", "tests/api_bundle_error.js" };
+	writeFile(Files[0], "exports.b = require('./lib/b').value; exports.c = require('./lib/c.js').file;");
+	writeFile(Files[1], "exports.value = require('../lib/./c').value * 2;");
+	writeFile(Files[2], "exports.value = 21; exports.file = __filename;");
+	writeFile(Files[3], "exports.value = ;");
+	STRING_VECTOR_t names, files;
+	// the names are normalized like the paths of require
+	names.push_back("./main.js"); names.push_back("lib/../lib/b.js"); names.push_back("lib\\c.js");
+	files.assign(Files, Files+3);
+	CScriptBundle::write(Bundle, names, files);
+	bool syntaxError = false;
+	names.push_back("error.js");
+	files.push_back(Files[3]);
+	try {
+		CScriptBundle::write(Corrupt, names, files);
+	} catch(CScriptException &e) {
+		syntaxError = e.toString().find("error.js") != std::string::npos;
+	}
+	for(int i=0; i<4; ++i) remove(Files[i]); // the modules are loaded from the bundle only
+	API_CHECK(syntaxError);
+
+	std::string data = readFile(Bundle), result;
+	{
+		CScriptBundle bundle;
+		API_CHECK(bundle.open(Bundle));
+		STRING_VECTOR_t bundled = bundle.getNames();
+		API_CHECK(bundled.size() == 3 && bundled[0] == "lib/b.js" && bundled[1] == "lib/c.js" && bundled[2] == "main.js");
+		CTinyJS js;
+		js.addBundle(&bundle);
+		result = js.evaluate("var main = require('./main'); main.b + ' ' + main.c");
+	}
+	API_CHECK(result == "42 lib/c.js");
+
+	// truncated or corrupt bundles are refused
+	bool refused = true;
+	for(size_t size = 0; refused && size < data.size(); size += size < 64 ? 1 : 97) {
+		writeBinaryFile(Corrupt, data.substr(0, size));
+		CScriptBundle bundle;
+		refused = !bundle.open(Corrupt);
+	}
+	API_CHECK(refused);
+	std::string corrupt = data;
+	corrupt[1] ^= 0x55; // id
+	writeBinaryFile(Corrupt, corrupt);
+	CScriptBundle bundle;
+	API_CHECK(!bundle.open(Corrupt));
+	corrupt = data;
+	uint32_t offset = 0xfffffff0;
+	memcpy(&corrupt[4+2+4+4+7], &offset, sizeof(offset)); // the offset of "main.js"
+	writeBinaryFile(Corrupt, corrupt);
+	API_CHECK(!bundle.open(Corrupt));
+	corrupt = data;
+	memcpy(&offset, &data[4+2+4+4+7], sizeof(offset));
+	corrupt[offset] ^= 0x55; // the id of the compiled tokens of "main.js"
+	writeBinaryFile(Corrupt, corrupt);
+	API_CHECK(bundle.open(Corrupt) && bundle.find("main.js"));
+	CScriptTokenizer Tokenizer;
+	API_CHECK(!bundle.load("main.js", Tokenizer) && bundle.load("lib/b.js", Tokenizer));
+	bundle.close();
+	remove(Bundle);
+	remove(Corrupt);
+	return true;
+}
+
+static bool test_tokenize_sources() {
+	const char *Files[] = { "tests/api_sources_0.js", "tests/api_sources_1.js", "tests/api_sources_2.js", "tests/api_sources_3.js",
+		"tests/api_sources_4.js", "tests/api_sources_5.js", "tests/api_sources_error.js", "tests/api_sources_missing.js" };
+	for(int i=0; i<6; ++i) {
+		std::ostringstream code;
+		code << "exports.value = " << i << "; function f" << i << "(a) { for(var j=0; j<a; j++) a += j; return a; }";
+		writeFile(Files[i], code.str().c_str());
+	}
+	writeFile(Files[6], "function (");
+	std::vector<CScriptCompiledSource> serial, parallel;
+	for(int i=0; i<8; ++i) serial.push_back(CScriptCompiledSource(Files[i]));
+	parallel = serial;
+	CScriptTokenizer::tokenizeSources(serial, false, 1);
+	CScriptTokenizer::tokenizeSources(parallel, false, 4);
+	STRING_VECTOR_t modules(Files, Files+8);
+	size_t precompiled = CTinyJS::precompileModules(modules, 4);
+	std::string result;
+	{
+		CTinyJS js;
+		result = js.evaluate("require('./tests/api_sources_5.js').value");
+	}
+	for(int i=0; i<7; ++i) remove(Files[i]);
+	// each source has its own result - the same as tokenized on one thread
+	for(int i=0; i<8; ++i) {
+		API_CHECK(parallel[i].compiled == serial[i].compiled && parallel[i].error == serial[i].error);
+		API_CHECK(i < 6 ? parallel[i].compiled.size() && parallel[i].error.empty() : parallel[i].compiled.empty() && parallel[i].error.size());
+	}
+	API_CHECK(parallel[6].error.find("api_sources_error.js") != std::string::npos);
+	API_CHECK(parallel[7].error.find("can't read") != std::string::npos);
+	std::istringstream in(parallel[3].compiled);
+	CScriptTokenizer Tokenizer;
+	API_CHECK(Tokenizer.unserialize(in, Files[3]));
+	// the error and the missing module are skipped
+	API_CHECK(precompiled == 6 && result == "5");
+	return true;
+}
+
+#ifndef NO_THREADING
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptWatchdog
+//////////////////////////////////////////////////////////////////////////
+
+namespace {
+	class CountingWatchdog : public CScriptWatchdog {
+	public:
+		CountingWatchdog(uint32_t Threshold) : CScriptWatchdog(Threshold, true), reports(0) {}
+		int reports;
+	protected:
+		virtual void report(const REPORT &Report) OVERRIDE { if(Report.interrupted) ++reports; }
+	};
+}
+
+static bool test_watchdog_interrupt() {
+	CountingWatchdog watchdog(20);
+	CTinyJS js;
+	watchdog.watch(&js);
+	// neither eval nor a retry-loop can catch the interrupt - nor a loop in native code of the baseline-JIT
+	const char *code[] = { "for(;;) { try { eval('for(;;){}'); } catch(e) {} }", "for(;;) { try { JSON.parse('1'); for(;;){} } catch(e) {} }",
+		"function spin(n) { var k = 0; while (n > 0) { k = k ^ 1; if (n < 1000) n--; } return k; } for(var i=0; i<200; i++) spin(5); spin(1000);" };
+	for(int i=0; i<3; ++i) {
+		bool interrupted = false;
+		try {
+			js.execute(code[i]);
+		} catch(CScriptInterruptException &) {
+			interrupted = true;
+		}
+		API_CHECK(interrupted && watchdog.reports == i+1);
+	}
+	API_CHECK(evaluateAs<int>(&js, "1+1") == 2); // the context is usable after an interrupt
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// CScriptConsoleAsyncSink
+//////////////////////////////////////////////////////////////////////////
+
+namespace {
+	class CollectingSink : public CScriptConsoleAsyncSink {
+	public:
+		CollectingSink(uint32_t MaxDelay) : CScriptConsoleAsyncSink(stdout, 64*1024, MaxDelay) {}
+		virtual ~CollectingSink() { flush(); }
+		std::string get() { CScriptUniqueLock<CScriptMutex> lock(mutex); return lines; }
+	protected:
+		virtual void output(std::string &Buffer) OVERRIDE { CScriptUniqueLock<CScriptMutex> lock(mutex); lines.append(Buffer); }
+	private:
+		CScriptMutex mutex;
+		std::string lines;
+	};
+}
+
+static bool test_console_async_sink() {
+	CollectingSink sink(20);
+	CTinyJS js;
+	js.setConsoleSink(&sink);
+	js.execute("console.log('a', 1);");
+	// MaxDelay is timed by the writer-thread - without a further write or flush
+	for(int i=0; i<100 && sink.get().empty(); ++i) CScriptThread::sleep(10);
+	API_CHECK(sink.get() == "a 1\n");
+	js.execute("print('b'); console.flush(); print('c');");
+	API_CHECK(sink.get().compare(0, 6, "a 1\nb\n") == 0);
+	js.flushConsole();
+	API_CHECK(sink.get() == "a 1\nb\nc\n");
+	js.setConsoleSink(0);
+	return true;
+}
+
+#endif // NO_THREADING
+
+//////////////////////////////////////////////////////////////////////////
+/// run_api_tests
+//////////////////////////////////////////////////////////////////////////
+
+static const struct { const char *name; bool (*fnc)(); } api_tests[] = {
+	{ "binding", test_binding },
+	{ "bridge", test_bridge },
+	{ "allocation_profiler", test_allocation_profiler },
+	{ "type_feedback_jsc", test_type_feedback_jsc },
+	{ "type_feedback_require", test_type_feedback_require },
+	{ "external_data", test_external_data },
+	{ "interned_garbage", test_interned_garbage },
+	{ "bundle", test_bundle },
+	{ "tokenize_sources", test_tokenize_sources },
+#ifndef NO_THREADING
+	{ "watchdog_interrupt", test_watchdog_interrupt },
+	{ "console_async_sink", test_console_async_sink },
+#endif
+};
+
+int run_api_tests(int &count) {
+	int passed = 0;
+	for(size_t i=0; i<sizeof(api_tests)/sizeof(api_tests[0]); ++i) {
+		printf("TEST api:%s ", api_tests[i].name);
+		bool pass = false;
+		try {
+			pass = api_tests[i].fnc();
+		} catch (CScriptException &e) {
+			printf("%s ", e.toString().c_str());
+		}
+		printf(pass ? "PASS\n" : "FAIL\n");
+		count++;
+		if(pass) passed++;
+	}
+	return passed;
+}
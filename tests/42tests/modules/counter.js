@@ -0,0 +1,6 @@
+// module for test010.js
+var count = 0;
+exports.other = require("./other");
+exports.inc = function() { return ++count; };
+exports.dirname = __dirname;
+exports.thisIsExports = this === exports;
@@ -0,0 +1,3 @@
+// module for test010.js (circular require of counter.js)
+var counter = require("./counter.js");
+module.exports = { name: "other", counterLoaded: counter.inc !== undefined };
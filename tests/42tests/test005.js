@@ -0,0 +1,57 @@
+// tail-call-test
+
+// deep self recursion in tail-position runs without growing the stack
+function count(n, acc) {
+  if (n == 0) return acc;
+  return count(n - 1, acc + 1);
+}
+
+// mutual recursion
+function isEven(n) { if (n == 0) return true; return isOdd(n - 1); }
+function isOdd(n) { if (n == 0) return false; return isEven(n - 1); }
+
+// method call keeps this
+var obj = { value: 42, get: function() { return this.value; }, call: function() { return this.get(); } };
+
+// no tail-call inside try - the catch must see the exception
+function thrower() { throw "boom"; }
+function catcher() { try { return thrower(); } catch(e) { return e; } }
+
+// a throw through a tail-call reaches the caller
+function throwsThrough() { return thrower(); }
+var caught;
+try { throwsThrough(); } catch(e) { caught = e; }
+
+// tail-call in a constructor
+function make() { return { made: true }; }
+function Ctor() { this.x = 1; return make(); }
+function Ctor2() { this.x = 1; return Math.abs(-1); }
+
+// tail-call to a native and to a bound function
+function nat(x) { return Math.floor(x); }
+var bound = function(a) { return this.value + a; }.bind(obj);
+function callBound() { return bound(1); }
+
+// the frames of tail-calls are reused - captured frames and arguments must survive
+function collect(n, fns) {
+  if (n == 0) return fns;
+  var local = n;
+  fns[fns.length] = function() { return local; };
+  return collect(n - 1, fns);
+}
+var fns = collect(3, []);
+function keepArgs(n, list) {
+  if (n == 0) return list;
+  list[n] = arguments;
+  return keepArgs(n - 1, list);
+}
+var args = keepArgs(2, []);
+function freezeArgs(n) { if (n == 0) return arguments.length; Object.freeze(arguments); return freezeArgs(n - 1, 1, 2); }
+function defaults(n, a = n * 2, {b} = {b: a + 1}) { if (n == 0) return a + b; return defaults(n - 1); }
+
+result = fns[0]() == 3 && fns[1]() == 2 && fns[2]() == 1 &&
+  args[2][0] == 2 && args[1][0] == 1 && args[2].length == 2 &&
+  freezeArgs(2) == 3 && defaults(5) == 1 &&
+  count(20000, 0) == 20000 && isEven(50001) == false &&
+  obj.call() == 42 && catcher() == "boom" && caught == "boom" &&
+  new Ctor().made && new Ctor2().x == 1 && nat(1.5) == 1 && callBound() == 43;
@@ -0,0 +1,51 @@
+// baseline-JIT-test (hot functions are compiled after 100 calls)
+
+function add(a, b) { return a + b; }
+function poly(x) { return (x * x - 3 * x + 7) & 0xffff ^ x << 2 | x >> 1; }
+function max(a, b) { return a > b ? a : b; }
+function sign(x) { return x < 0 ? -1 : x === 0 ? 0 : 1; }
+function neg(x) { return -x; }
+function mul(a, b) { return a * b; }
+function ushr(a, b) { return a >>> b; }
+function dup(a, a) { return a; }
+
+var ok = true;
+for (var i = -150; i < 150; i++) {
+  ok = ok && add(i, 2) == i + 2 && poly(i) == ((i * i - 3 * i + 7) & 0xffff ^ i << 2 | i >> 1);
+  ok = ok && max(i, 7) == (i > 7 ? i : 7) && sign(i) == (i < 0 ? -1 : i == 0 ? 0 : 1);
+  ok = ok && neg(i) == 0 - i && mul(i, 3) == i * 3 && ushr(i, 1) == i >>> 1;
+  ok = ok && dup(1, 2) == 2;
+}
+// results that are not int32 are computed by the interpreter
+var big = 2147483647;
+ok = ok && add(big, 1) == 2147483648 && add(1.5, 1) == 2.5 && add("a", 1) == "a1" && isNaN(add(1));
+ok = ok && 1 / neg(0) == -Infinity && neg(-2147483648) == 2147483648 && neg(5) == -5;
+ok = ok && 1 / mul(0, -5) == -Infinity && mul(65536, 65536) == 4294967296 && mul(-3, 4) == -12;
+ok = ok && ushr(-1, 0) == 4294967295 && ushr(-1, 28) == 15;
+
+// locals, loops & calls of other compiled functions
+function sum(n) { var s = 0; for (var i = 0; i < n; i++) s += i; return s; }
+function collatz(n) { let steps = 0; while (n != 1) { if (n % 2 == 0) n >>= 1; else n = 3 * n + 1; ++steps; } return steps; }
+function skip(n) { let c = 0; for (let i = 0; i < n; i++) { if (i % 3 == 0) continue; if (i > 50) break; c++; } return c; }
+function steps(n) { var k = 0; do { k += 2; } while (k < n); { const half = k >> 1; k = half; } return k; }
+function fib(n) { return n < 2 ? n : fib(n - 1) + fib(n - 2); }
+function isEven(n) { return n == 0 ? 1 : isOdd(n - 1); }
+function isOdd(n) { return n == 0 ? 0 : isEven(n - 1); }
+function both(a, b) { return (a && b) || -b; }
+var inc = function(x) { return x + 1; };
+function callInc(x) { return inc(x) * 2; }
+function ctor(x) { return x; }
+for (var i = 0; i < 150; i++) {
+  ok = ok && sum(i) == i * (i - 1) / 2 && skip(i) == (i > 51 ? 34 : i - Math.ceil(i / 3)) && steps(i) == (i < 2 ? 1 : (i + 1) >> 1);
+  ok = ok && isEven(i % 20) == ((i % 20) % 2 == 0 ? 1 : 0) && both(i % 3, 4) == (i % 3 ? 4 : -4) && callInc(i) == 2 * i + 2;
+  ok = ok && ctor(i) == i;
+}
+ok = ok && fib(20) == 6765 && collatz(27) == 111 && skip(-1) == 0 && -7 % 3 == sum(0) - 1 && 7 % -3 == 1;
+// the interpreter takes over at an overflow, a non int32 callee or -0
+ok = ok && sum(100000) == 4999950000 && 1 / both(0, 0) == -Infinity;
+inc = function(x) { return x + 0.5; };
+ok = ok && callInc(1) === 3;
+// a compiled function called as constructor returns this
+ok = ok && typeof new ctor(1) == "object";
+
+result = ok;
@@ -0,0 +1,38 @@
+// superinstructions (i++, i += 1, o.count++, i < n)
+
+var ok = true;
+var n = 0, o = { count: 0 };
+for (var i = 0; i < 10; i++) { n += 2; o.count++; }
+ok = ok && i == 10 && n == 20 && o.count == 10;
+for (let j = 10; j >= 0; j -= 2) { --n; ++o.count; }
+ok = ok && n == 14 && o.count == 16;
+for (var k = 5, m = 0; m <= k; m += 1) o.count -= 1;
+ok = ok && o.count == 10;
+
+// completion value of the statement
+ok = ok && eval("n++") == 14 && eval("++n") == 16 && eval("n += 4") == 20 && eval("o.count--") == 10;
+
+// all other cases are done without superinstruction
+var s = "11";
+s++;
+ok = ok && s === 12;
+var t = "a";
+for (var x = 0; x < "3"; x++) t = t + x;
+ok = ok && t == "a012";
+var u; u++;
+ok = ok && isNaN(u);
+var p = { _v: 1, get v() { return this._v; }, set v(v) { this._v = v * 10; } };
+p.v++;
+ok = ok && p._v == 20;
+var q = Object.create({ count: 5 });
+q.count++;
+ok = ok && q.count == 6 && Object.getPrototypeOf(q).count == 5;
+var c = [1, 2];
+c.length++;
+ok = ok && c.length == 3;
+var w = Object.create({ c: 5, d: { count: 1 } });
+with (w) { c++; c += 1; d.count++; }
+ok = ok && w.c == 7 && Object.getPrototypeOf(w).c == 5 && w.d.count == 2;
+try { undefinedVar++; ok = false; } catch(e) { ok = ok && e.name == "ReferenceError"; }
+
+result = ok;
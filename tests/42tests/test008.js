@@ -0,0 +1,54 @@
+// Date (epoch ms with lazily computed fields)
+
+var ok = true;
+var d = new Date(Date.UTC(2001, 8, 9, 1, 46, 40, 123));
+ok = ok && d.getTime() == 1000000000123;
+ok = ok && d.getUTCFullYear() == 2001 && d.getUTCMonth() == 8 && d.getUTCDate() == 9 && d.getUTCDay() == 0;
+ok = ok && d.getUTCHours() == 1 && d.getUTCMinutes() == 46 && d.getUTCSeconds() == 40 && d.getUTCMilliseconds() == 123;
+
+// before 1970 and far in the future
+ok = ok && Date.UTC(1938, 3, 24, 22, 13, 20) == -1000000000000;
+d.setTime(-5000000000000);
+ok = ok && d.getUTCFullYear() == 1811 && d.getUTCMonth() == 6 && d.getUTCDate() == 23 && d.getUTCDay() == 2;
+d.setTime(9000000000000);
+ok = ok && d.getUTCFullYear() == 2255 && d.getUTCMonth() == 2 && d.getUTCDate() == 14 && d.getUTCHours() == 16;
+
+// setters normalize out of range values
+d.setTime(Date.UTC(2000, 0, 31));
+d.setUTCMonth(1);
+ok = ok && d.getUTCMonth() == 2 && d.getUTCDate() == 2;
+d.setUTCDate(0);
+ok = ok && d.getUTCMonth() == 1 && d.getUTCDate() == 29;
+d.setUTCHours(-1);
+ok = ok && d.getUTCDate() == 28 && d.getUTCHours() == 23;
+d.setUTCFullYear(2001, 11, 32);
+ok = ok && d.getUTCFullYear() == 2002 && d.getUTCMonth() == 0 && d.getUTCDate() == 1;
+
+// local fields round-trip
+var l = new Date(2021, 2, 28, 12, 30, 15, 5);
+ok = ok && l.getFullYear() == 2021 && l.getMonth() == 2 && l.getDate() == 28 && l.getHours() == 12 && l.getMinutes() == 30 && l.getSeconds() == 15 && l.getMilliseconds() == 5;
+ok = ok && l.getTime() == Date.UTC(2021, 2, 28, 12, 30, 15, 5) + l.getTimezoneOffset() * 60000;
+
+// invalid dates
+d.setTime(8.64e15 + 1);
+ok = ok && isNaN(d.getUTCFullYear());
+
+// parsing
+ok = ok && Date.parse("2001-09-09T01:46:40.123Z") == 1000000000123;
+ok = ok && Date.parse("+002001-09-09T03:46:40.5+02:00") == 1000000000500;
+ok = ok && Date.parse("2001-09-09") == Date.UTC(2001, 8, 9);
+ok = ok && isNaN(Date.parse("2001-02-29")) && isNaN(Date.parse("2001X")) && isNaN(Date.parse("bogus"));
+ok = ok && Date.parse("Sun, 09 Sep 2001 01:46:40 GMT") == 1000000000000;
+ok = ok && Date.parse("Sun Sep 09 2001 03:46:40 GMT+0200") == 1000000000000;
+ok = ok && Date.parse("Wed Nov 05 21:49:11 GMT-0800 1997") == Date.UTC(1997, 10, 6, 5, 49, 11);
+ok = ok && Date.parse("May 5 2020 10:00 UTC") == Date.UTC(2020, 4, 5, 10);
+ok = ok && Date.parse("Jan 1 2019 10:30 PM (comment) EST") == Date.UTC(2019, 0, 2, 3, 30);
+// cached strings give the same results
+ok = ok && Date.parse("May 5 2020 10:00 UTC") == Date.UTC(2020, 4, 5, 10) && isNaN(Date.parse("bogus"));
+
+// formatting round-trip
+var r = new Date(1000000000123);
+ok = ok && Date.parse(String(r)) == 1000000000000;
+ok = ok && new Date(String(r)).getTime() == 1000000000000 && new Date(r).getTime() == 1000000000123;
+
+result = ok;
@@ -0,0 +1,32 @@
+// Math.random, Math.seedRandom and Math.randomFill
+
+var ok = true;
+var a = [], b = [];
+Math.seedRandom(42);
+for (var i = 0; i < 100; i++) a[i] = Math.random();
+Math.seedRandom(42);
+for (var i = 0; i < 100; i++) b[i] = Math.random();
+
+var distinct = 0;
+for (var i = 0; i < 100; i++) {
+	ok = ok && a[i] === b[i] && a[i] >= 0 && a[i] < 1;
+	if (i && a[i] != a[i-1]) distinct++;
+}
+ok = ok && distinct == 99;
+
+// the numbers have more bits than RAND_MAX
+var fine = false;
+for (var i = 0; i < 100; i++) if (a[i] * 4294967296 % 1) fine = true;
+ok = ok && fine;
+
+// randomFill continues the same sequence
+Math.seedRandom(42);
+var c = [0, 0, 0];
+ok = ok && Math.randomFill(c) === c && c.length == 3 && c[0] === a[0] && c[1] === a[1] && c[2] === a[2];
+var d = { length: 2 };
+Math.randomFill(d);
+ok = ok && d[0] === a[3] && d[1] === a[4];
+
+try { Math.randomFill(1); ok = false; } catch(e) { ok = ok && e.name == "TypeError"; }
+
+result = ok;
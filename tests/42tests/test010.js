@@ -0,0 +1,19 @@
+// require() - module registry and module scopes
+
+var ok = true;
+var a = require("tests/42tests/modules/counter");
+var b = require("./tests/42tests/modules/counter.js");
+ok = ok && a === b && a.inc() == 1 && b.inc() == 2;
+
+// the exports of a circular require are the unfinished exports
+ok = ok && a.other.name == "other" && a.other.counterLoaded === false;
+ok = ok && a.thisIsExports && /modules$/.test(a.dirname);
+
+// variables of modules are not global
+try { count; ok = false; } catch(e) { ok = ok && e.name == "ReferenceError"; }
+
+ok = ok && require.cache[a.dirname + "/counter.js"].loaded === true && require.cache[a.dirname + "/other.js"].exports === a.other;
+
+try { require("./tests/42tests/modules/not_existing"); ok = false; } catch(e) { ok = ok && e.name == "Error"; }
+
+result = ok;
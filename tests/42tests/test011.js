@@ -0,0 +1,18 @@
+// assignment to an accessor inherited from the prototype calls its setter;
+// instanceof tests the prototype-property of the constructor
+
+var log = "";
+var P = {};
+Object.defineProperty(P, "x", { get: function() { return this._x; }, set: function(v) { log += "x" + v; this._x = v; } });
+var o = Object.create(P);
+o.x = 5;
+
+var Q = { get y() { return 2; }, set y(v) { log += "y" + v; } };
+var q = Object.create(Q);
+q.y = 7;
+
+function F() {}
+F.prototype = P;
+var instOk = o instanceof F && o instanceof Object && !(o instanceof Array) && !({} instanceof F);
+
+result = instOk && log == "x5y7" && o.x == 5 && !o.hasOwnProperty("x") && o.hasOwnProperty("_x") && P._x === undefined;
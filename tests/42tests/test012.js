@@ -0,0 +1,18 @@
+// string functions work on the characters of the string-value without a copy
+
+var s = "abcabc";
+var ok = s.indexOf("c") == 2 && s.indexOf("c", 3) == 5 && s.indexOf("x") == -1 && s.indexOf("") == 0 &&
+	s.lastIndexOf("abc") == 3 && s.lastIndexOf("abc", 2) == 0 && s.lastIndexOf("") == 6 && s.lastIndexOf("abcabcd") == -1 &&
+	s.charAt(1) == "b" && s.charAt(9) == "" && s.charCodeAt(2) == 99 &&
+	s.slice(-2) == "bc" && s.substring(4, 1) == "bca" && s.substr(2, 2) == "ca" &&
+	s.split("b").join(",") == "a,ca,c" && s.split("").length == 6 &&
+	s.replace("b", "x") == "axcabc" && s.replace(/b/g, "x") == "axcaxc" && s.replace(/B/gi, function(m) { return "[" + m + "]"; }) == "a[b]ca[b]c" &&
+	s.search(/ca/) == 2 && s.match(/a(b)/)[1] == "b" && s.match(/a/g).length == 2 &&
+	"  \t x y \r\n".trim() == "x y" && " x ".trimLeft() == "x " && " x ".trimRight() == " x" &&
+	"a".localeCompare("b") == -1 && "b".localeCompare("a") == 1 && "ab".localeCompare("ab") == 0 && "a".localeCompare("ab") == -1;
+
+// a String-object or other values are converted
+var o = new String("xyz");
+ok = ok && o.indexOf("z") == 2 && String.prototype.charAt.call(12345, 2) == "3";
+
+result = ok;
@@ -0,0 +1,10 @@
+// print and console.* are built in and write to the console-sink of the context
+
+var ok = typeof print == "function" && typeof console.log == "function" && typeof console.info == "function" &&
+	typeof console.warn == "function" && typeof console.error == "function" && typeof console.flush == "function";
+
+ok = ok && console.log("test013:", 1, { a: 1 }, [1, 2]) === undefined;
+ok = ok && print("test013: print") === undefined;
+console.flush();
+
+result = ok;
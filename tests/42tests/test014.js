@@ -0,0 +1,14 @@
+// type-tags: strict equality across types and typeof
+
+var checks = [
+	1 === 1, !(1 === "1"), "a" === "a", !(null === undefined), null === null,
+	undefined === undefined, !({} === null), !(true === 1),
+	typeof function(){} == "function", typeof [] == "object",
+	typeof new Date() == "object", typeof /x/ == "object", typeof "" == "string",
+	typeof 1.5 == "number", typeof undefined == "undefined", typeof false == "boolean",
+	[] instanceof Array, !({} instanceof Array), new Error("e") instanceof Error,
+	(function(){}) instanceof Function, !(1 !== 1), 1 !== "1"
+];
+var failed = 0;
+for(var i=0; i<checks.length; i++) if(!checks[i]) failed++;
+result = failed == 0;
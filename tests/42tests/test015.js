@@ -0,0 +1,23 @@
+// string equality: interned literals, computed strings and switch on strings
+
+function route(msg) {
+	switch(msg) {
+	case "get": return 1;
+	case "put": return 2;
+	case "delete": return 3;
+	default: return 0;
+	}
+}
+var computed = "ge" + "t", other = ["p", "u", "t"].join("");
+
+var checks = [
+	"abc" == "abc", "abc" === "abc", !("abc" != "abc"), "abc" !== "abd",
+	computed == "get", computed === "get", "get" === computed, !(computed !== "get"),
+	"ab" != "abc", "" == "", "" !== "a",
+	route(computed) == 1, route(other) == 2, route("del" + "ete") == 3, route("post") == 0,
+	typeof computed === "string", typeof 1 == "number",
+	"1" == 1, !("1" === 1), "a" < "b"
+];
+var failed = 0;
+for(var i=0; i<checks.length; i++) if(!checks[i]) failed++;
+result = failed == 0;
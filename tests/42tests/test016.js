@@ -0,0 +1,40 @@
+// strings: length and positions are UTF-16 code-units of the UTF-8 characters
+
+var ascii = "hello world";
+var ae = "ä";
+var umlaut = "a" + ae + "b";
+var euro = "€1";
+var smiley = "😀";
+var emoji = "x" + smiley + "y";
+var latin1 = "";				// not UTF-8 - one character per byte
+var hw = "héllo wörld";
+var re = /l/g, l1 = re.exec(hw), last1 = re.lastIndex, l2 = re.exec(hw), l3 = re.exec(hw), last3 = re.lastIndex;
+
+var checks = [
+	ascii.length == 11, ascii.charAt(4) == "o", ascii.charCodeAt(6) == 119, ascii.substr(6, 5) == "world",
+	ae.length == 1, umlaut.length == 3, umlaut.charCodeAt(1) == 0xe4, umlaut.charAt(2) == "b", umlaut[1] == ae,
+	umlaut.substr(1) == ae + "b", umlaut.slice(-2, -1) == ae, umlaut.substring(2, 0) == "a" + ae,
+	umlaut.indexOf("b") == 2, umlaut.lastIndexOf("a") == 0, umlaut.indexOf("b", 2) == 2,
+	euro.length == 2, euro.charCodeAt(0) == 0x20ac, "".fromCharCode(0x20ac) + "1" == euro,
+	emoji.length == 4, emoji.charCodeAt(1) == 0xd83d, emoji.charCodeAt(2) == 0xde00, emoji.charAt(3) == "y",
+	emoji.indexOf("y") == 3, emoji.substr(1, 2) == smiley,
+	latin1.length == 2, latin1.charCodeAt(1) == 0xf6,
+	// RegExp and String positions
+	hw.indexOf("w") == 6, hw.search(/w/) == 6, hw.search("r") == 8, /w/.exec(hw).index == 6, hw.match(/r/).index == 8,
+	l1.index == 2 && last1 == 3, l2.index == 3, l3.index == 9 && last3 == 10, re.exec(hw) == null && re.lastIndex == 0,
+	hw.split("").length == 11, hw.split("")[1] == "é", ae.split("").length == 1, hw.split(" ")[1].length == 5,
+	umlaut.replace(/x*/g, function(m) { return "-"; }) == "-a-" + ae + "-b-",
+	// fromCharCode gives UTF-8 - a lone surrogate is one code-unit (WTF-8)
+	"".fromCharCode(0xe9) == "é", "".fromCharCode(0xe9).length == 1, "".fromCharCode(0x7f).length == 1,
+	"".fromCharCode(0xd83d).length == 1, "".fromCharCode(0xd83d).charCodeAt(0) == 0xd83d,
+	("".fromCharCode(0xc3) + "".fromCharCode(0xa9)).length == 2, ("".fromCharCode(0xc3) + "".fromCharCode(0xa9)).charCodeAt(1) == 0xa9,
+	"".fromCharCode(0xd83d) + "".fromCharCode(0xde00) == smiley, ("".fromCharCode(0xde00) + "".fromCharCode(0xd83d)).length == 2,
+	// a split surrogate-pair gives lone surrogates
+	smiley.substring(0, 1).length == 1, smiley.substring(0, 1).charCodeAt(0) == 0xd83d, smiley.substring(1).charCodeAt(0) == 0xde00,
+	smiley.substring(0, 1) + smiley.substring(1) == smiley, smiley[1] == "".fromCharCode(0xde00), smiley.split("").length == 2,
+	("a" + smiley + "b").slice(2).length == 2, ("a" + smiley + "b").slice(2).charCodeAt(0) == 0xde00, ("a" + smiley + "b").slice(1, 2).charCodeAt(0) == 0xd83d,
+	("a" + smiley + "b").slice(3) == "b", (smiley + smiley).substr(1, 2).length == 2, (smiley + smiley).substr(1, 2).charCodeAt(1) == 0xd83d
+];
+var failed = 0;
+for(var i=0; i<checks.length; i++) if(!checks[i]) failed++;
+result = failed == 0;
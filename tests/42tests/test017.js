@@ -0,0 +1,49 @@
+// hoisting: scope-templates of the forwarders and lazily created functions
+
+function outer(n) {
+	var before = typeof inner;				// hoisted before the declaration
+	let base = 10;
+	function inner(x) { return x + base; }	// sees the lets of the body
+	function unused() { return 0; }
+	function fact(k) { return k <= 1 ? 1 : k * fact(k-1); }
+	return [before, inner(n), fact(n), typeof unused];
+}
+function replaced() {
+	f = 3;									// assigned before the first lookup
+	return f;
+	function f() {}
+}
+function shadow(a) {
+	var a;
+	return typeof a;
+	function a() {}
+}
+function getter() {
+	function get() { return value; }
+	var value = "v";
+	return get;								// called after the return
+}
+function blocks(flag) {
+	var r = 0;
+	if(flag) {
+		function inBlock() { return 2; }
+		r = inBlock();
+	}
+	function atTop() { return 1; }
+	return r + atTop();
+}
+function twice() {
+	function id() {}
+	return id;
+}
+
+var o = outer(4);
+var checks = [
+	o[0] == "function", o[1] == 14, o[2] == 24, o[3] == "function",
+	replaced() === 3, shadow(1) == "function", getter()() == "v",
+	blocks(true) == 3, blocks(false) == 1,
+	twice() !== twice(), typeof twice() == "function"
+];
+var failed = 0;
+for(var i=0; i<checks.length; i++) if(!checks[i]) failed++;
+result = failed == 0;